@@ -75,13 +75,15 @@ common_fini(void);
  * Add Module
  *
  * Add's a module into memory to be executed once start_vmm is run. This
- * function uses the platform functions to allocate memory for the executable.
- * The file that is provided should not be removed until after stop_vmm is
- * run. Removing the file from memory could cause a crash, as the start_vmm
- * function uses the file that is being added to search for symbols that are
- * needed, as well as the stop_vmm function. Once stop_vmm is run, it's safe
- * to remove the files. Also, this function cannot be run if the vmm has
- * already been started.
+ * function uses the platform functions to allocate memory for the executable,
+ * and copies each segment of the provided file into the executable before
+ * returning. As a result, the file that is provided is not used once this
+ * function returns, and can be removed right away. Also, this function
+ * cannot be run if the vmm has already been started.
+ *
+ * The file may also be a prelinked image (see bfelf_image_build), in which
+ * case it must be the only file that is added, and the VMM is loaded without
+ * having to relocate any of its modules.
  *
  * @param file the file to add to memory
  * @param fsize the size of the file in bytes
@@ -37,6 +37,9 @@
 int64_t g_num_modules = 0;
 struct bfelf_binary_t g_modules[MAX_NUM_MODULES];
 
+char *g_image = 0;
+uint64_t g_image_size = 0;
+
 _start_t _start_func = 0;
 struct crt_info_t g_info;
 struct bfelf_loader_t g_loader;
@@ -53,6 +56,9 @@ uint64_t g_stack_top = 0;
 
 void *g_rsdp = 0;
 
+void *g_node_pools[MAX_NUM_NODES] = {0};
+uint64_t g_node_pool_size = 0;
+
 /* -------------------------------------------------------------------------- */
 /* Helpers                                                                    */
 /* -------------------------------------------------------------------------- */
@@ -188,6 +194,114 @@ private_add_modules_mdl(void)
     return BF_SUCCESS;
 }
 
+int64_t
+private_add_node_pool(int64_t node)
+{
+    int64_t ret = 0;
+    uint64_t i = 0;
+
+    void *pool = platform_alloc_rw_node(g_node_pool_size, node);
+    if (pool == 0) {
+        return BF_ERROR_OUT_OF_MEMORY;
+    }
+
+    g_node_pools[node] = pool;
+    platform_memset(pool, 0, g_node_pool_size);
+
+    for (i = 0; i < g_node_pool_size; i += BAREFLANK_PAGE_SIZE) {
+        ret = private_add_raw_md_to_memory_manager(
+                  (uint64_t)pool + i,
+                  MEMORY_TYPE_R | MEMORY_TYPE_W | MEMORY_TYPE_NODE(node));
+
+        if (ret != BF_SUCCESS) {
+            return ret;
+        }
+    }
+
+    return platform_call_vmm_on_core(
+               0, BF_REQUEST_ADD_NODE_POOL, (uintptr_t)pool, g_node_pool_size);
+}
+
+/*
+ * On NUMA systems, each node is given its own pool of node-local memory,
+ * and the VMM is told which node each CPU belongs to, so that the memory
+ * the VMM allocates for a CPU (e.g. its vCPU state) is local to that CPU.
+ * Systems with a single node use the VMM's global pools.
+ *
+ * Node ids can be sparse, so pools are keyed by the real node id, and
+ * only online nodes below MAX_NUM_NODES get a pool. CPUs on any other
+ * node use the global pools.
+ */
+int64_t
+private_setup_node_pools(void)
+{
+    int64_t ret = 0;
+    int64_t node = 0;
+    int64_t cpuid = 0;
+
+    if (platform_num_nodes() <= 1) {
+        return BF_SUCCESS;
+    }
+
+    g_node_pool_size = BAREFLANK_PAGE_SIZE << NODE_POOL_K;
+
+    for (node = 0; node < (int64_t)MAX_NUM_NODES; node++) {
+        if (platform_node_online(node) == 0) {
+            continue;
+        }
+
+        ret = private_add_node_pool(node);
+        if (ret != BF_SUCCESS) {
+            return ret;
+        }
+    }
+
+    for (cpuid = 0; cpuid < platform_num_cpus(); cpuid++) {
+        node = platform_cpu_node((uint64_t)cpuid);
+        if (node < 0 || node >= (int64_t)MAX_NUM_NODES || g_node_pools[node] == 0) {
+            continue;
+        }
+
+        ret = platform_call_vmm_on_core(
+                  0, BF_REQUEST_SET_CPU_NODE, (uintptr_t)cpuid, (uintptr_t)node);
+
+        if (ret != BF_SUCCESS) {
+            return ret;
+        }
+    }
+
+    return BF_SUCCESS;
+}
+
+int64_t
+private_add_image(const char *image, uint64_t size)
+{
+    int64_t ret = 0;
+    uint64_t num_modules = 0;
+
+    /*
+     * Note:
+     *
+     * A prelinked image contains every module that makes up the VMM, already
+     * relocated, so it cannot be combined with other modules. Since the
+     * image is loaded here, common_load_vmm skips bfelf_load entirely.
+     */
+
+    if (g_num_modules != 0) {
+        return BF_ERROR_VMM_INVALID_STATE;
+    }
+
+    ret = bfelf_image_load(
+              image, size, g_modules, &num_modules, &g_image, &g_image_size,
+              (void **)&_start_func, &g_info);
+    if (ret != BF_SUCCESS) {
+        return ret;
+    }
+
+    g_num_modules = (int64_t)num_modules;
+    return BF_SUCCESS;
+}
+
 /* -------------------------------------------------------------------------- */
 /* Implementation                                                             */
 /* -------------------------------------------------------------------------- */
@@ -201,12 +315,20 @@ common_reset(void)
 {
     int64_t i;
 
-    for (i = 0; i < g_num_modules; i++) {
-        if (g_modules[i].exec != 0) {
-            platform_free_rwe(g_modules[i].exec, g_modules[i].exec_size);
+    if (g_image != 0) {
+        platform_free_rwe(g_image, g_image_size);
+    }
+    else {
+        for (i = 0; i < g_num_modules; i++) {
+            if (g_modules[i].exec != 0) {
+                platform_free_rwe(g_modules[i].exec, g_modules[i].exec_size);
+            }
         }
     }
 
+    g_image = 0;
+    g_image_size = 0;
+
     platform_memset(&g_modules, 0, sizeof(g_modules));
     platform_memset(&g_loader, 0, sizeof(struct bfelf_loader_t));
     platform_memset(&g_info, 0, sizeof(struct crt_info_t));
@@ -226,9 +348,17 @@ common_reset(void)
         platform_free_rw(g_stack, g_stack_size);
     }
 
+    for (i = 0; i < (int64_t)MAX_NUM_NODES; i++) {
+        if (g_node_pools[i] != 0) {
+            platform_free_rw(g_node_pools[i], g_node_pool_size);
+            g_node_pools[i] = 0;
+        }
+    }
+
     g_tls = 0;
     g_stack = 0;
     g_stack_top = 0;
+    g_node_pool_size = 0;
 
     g_rsdp = 0;
 }
@@ -275,6 +405,8 @@ common_fini(void)
 int64_t
 common_add_module(const char *file, uint64_t fsize)
 {
+    int64_t ret = 0;
+
     if (file == 0 || fsize == 0) {
         return BF_ERROR_INVALID_ARG;
     }
@@ -290,6 +422,14 @@ common_add_module(const char *file, uint64_t fsize)
             break;
     }
 
+    if (g_image != 0) {
+        return BF_ERROR_VMM_INVALID_STATE;
+    }
+
+    if (bfelf_file_is_image(file, fsize) != 0) {
+        return private_add_image(file, fsize);
+    }
+
     if (g_num_modules >= MAX_NUM_MODULES) {
         return BF_ERROR_MAX_MODULES_REACHED;
     }
@@ -297,6 +437,27 @@ common_add_module(const char *file, uint64_t fsize)
     g_modules[g_num_modules].file = file;
     g_modules[g_num_modules].file_size = fsize;
 
+    /*
+     * Note:
+     *
+     * The module is loaded into its exec right away so that the file is
+     * copied exactly once (straight into its final location), and so that
+     * the caller is free to release the file as soon as this function
+     * returns instead of holding on to a copy of every module until the
+     * VMM is unloaded.
+     */
+
+    ret = bfelf_load_binary(&g_modules[g_num_modules]);
+    if (ret != BF_SUCCESS) {
+
+        if (g_modules[g_num_modules].exec != 0) {
+            platform_free_rwe(g_modules[g_num_modules].exec, g_modules[g_num_modules].exec_size);
+        }
+
+        platform_memset(&g_modules[g_num_modules], 0, sizeof(struct bfelf_binary_t));
+        return ret;
+    }
+
     g_num_modules++;
     return BF_SUCCESS;
 }
@@ -337,9 +498,11 @@ common_load_vmm(void)
         goto failure;
     }
 
-    ret = bfelf_load(g_modules, (uint64_t)g_num_modules, (void **)&_start_func, &g_info, &g_loader);
-    if (ret != BF_SUCCESS) {
-        goto failure;
+    if (g_image == 0) {
+        ret = bfelf_load(g_modules, (uint64_t)g_num_modules, (void **)&_start_func, &g_info, &g_loader);
+        if (ret != BF_SUCCESS) {
+            goto failure;
+        }
     }
 
     ret = platform_call_vmm_on_core(0, BF_REQUEST_INIT, 0, 0);
@@ -362,6 +525,11 @@ common_load_vmm(void)
         goto failure;
     }
 
+    ret = private_setup_node_pools();
+    if (ret != BF_SUCCESS) {
+        goto failure;
+    }
+
     g_vmm_status = VMM_LOADED;
     return BF_SUCCESS;
 
@@ -37,14 +37,6 @@
 
 uint64_t g_vcpuid = 0;
 
-struct pmodule_t {
-    char *data;
-    uint64_t size;
-};
-
-uint64_t g_num_pmodules = 0;
-struct pmodule_t pmodules[MAX_NUM_MODULES] = {{0}};
-
 /* -------------------------------------------------------------------------- */
 /* Misc Device                                                                */
 /* -------------------------------------------------------------------------- */
@@ -52,39 +44,18 @@ struct pmodule_t pmodules[MAX_NUM_MODULES] = {{0}};
 static int64_t
 ioctl_add_module(const char *file, uint64_t len)
 {
-    char *buf;
     int64_t ret;
 
-    if (g_num_pmodules >= MAX_NUM_MODULES) {
-        BFALERT("IOCTL_ADD_MODULE: too many modules have been loaded\n");
-        return BF_IOCTL_FAILURE;
-    }
-
-    buf = platform_alloc_rw(len);
-    if (buf == NULL) {
-        BFALERT("IOCTL_ADD_MODULE: failed to allocate memory for the module\n");
-        return BF_IOCTL_FAILURE;
-    }
-
-    gBS->CopyMem(buf, (void *)file, len);
-
-    ret = common_add_module(buf, len);
+    ret = common_add_module(file, len);
     if (ret != BF_SUCCESS) {
         BFALERT("IOCTL_ADD_MODULE: common_add_module failed: %p - %s\n", (void *)ret, ec_to_str(ret));
         goto failed;
     }
 
-    pmodules[g_num_pmodules].data = buf;
-    pmodules[g_num_pmodules].size = len;
-
-    g_num_pmodules++;
-
     return BF_IOCTL_SUCCESS;
 
 failed:
 
-    platform_free_rw(buf, len);
-
     BFALERT("IOCTL_ADD_MODULE: failed\n");
     return BF_IOCTL_FAILURE;
 }
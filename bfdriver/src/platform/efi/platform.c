@@ -79,6 +79,43 @@ platform_alloc_rw(uint64_t len)
     return (void *)addr;
 }
 
+/*
+ * Large RWE allocations (e.g. the VMM's exec, which contains the VMM's page
+ * pools) are aligned to a large page. EFI memory is identity mapped, so this
+ * memory is both virtually and physically contiguous, which allows the VMM
+ * to map it using large pages.
+ */
+static void *
+private_alloc_rwe_large(uint64_t len)
+{
+    EFI_STATUS status;
+    EFI_PHYSICAL_ADDRESS addr = 0;
+    EFI_PHYSICAL_ADDRESS aligned = 0;
+
+    UINTN pages = (len / EFI_PAGE_SIZE) + 1;
+    UINTN slack = BAREFLANK_LARGE_PAGE_SIZE / EFI_PAGE_SIZE;
+
+    status = gBS->AllocatePages(
+                 AllocateAnyPages, EfiRuntimeServicesCode, pages + slack, &addr
+             );
+
+    if (EFI_ERROR(status)) {
+        return nullptr;
+    }
+
+    aligned = (addr + BAREFLANK_LARGE_PAGE_SIZE - 1) & ~(BAREFLANK_LARGE_PAGE_SIZE - 1);
+
+    if (aligned != addr) {
+        gBS->FreePages(addr, (aligned - addr) / EFI_PAGE_SIZE);
+    }
+
+    gBS->FreePages(
+        aligned + (pages * EFI_PAGE_SIZE), slack - ((aligned - addr) / EFI_PAGE_SIZE)
+    );
+
+    return (void *)aligned;
+}
+
 void *
 platform_alloc_rwe(uint64_t len)
 {
@@ -90,6 +127,14 @@ platform_alloc_rwe(uint64_t len)
         return (void *)addr;
     }
 
+    if (len >= BAREFLANK_LARGE_PAGE_SIZE) {
+        void *large = private_alloc_rwe_large(len);
+
+        if (large != nullptr) {
+            return large;
+        }
+    }
+
     status = gBS->AllocatePages(
                  AllocateAnyPages, EfiRuntimeServicesCode, (len / EFI_PAGE_SIZE) + 1, &addr
              );
@@ -179,6 +224,28 @@ platform_num_cpus(void)
     return (int64_t)NumberOfProcessors;
 }
 
+int64_t
+platform_num_nodes(void)
+{ return 1; }
+
+int64_t
+platform_node_online(int64_t node)
+{ return node == 0 ? 1 : 0; }
+
+int64_t
+platform_cpu_node(uint64_t cpuid)
+{
+    bfignored(cpuid);
+    return 0;
+}
+
+void *
+platform_alloc_rw_node(uint64_t len, int64_t node)
+{
+    bfignored(node);
+    return platform_alloc_rw(len);
+}
+
 struct call_vmm_args {
     uint64_t cpuid;
     uint64_t request;
@@ -21,13 +21,19 @@
  */
 
 #include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/timer.h>
 #include <linux/module.h>
+#include <linux/vmalloc.h>
 #include <linux/uaccess.h>
 #include <linux/miscdevice.h>
 #include <linux/kallsyms.h>
 #include <linux/notifier.h>
 #include <linux/reboot.h>
 #include <linux/suspend.h>
+#include <linux/version.h>
 
 #include <common.h>
 
@@ -45,14 +51,6 @@ uint64_t _vmcall(uint64_t r1, uint64_t r2, uint64_t r3, uint64_t r4);
 static uint64_t g_vcpuid = 0;
 static uint64_t g_module_length = 0;
 
-struct pmodule_t {
-    char *data;
-    int64_t size;
-};
-
-uint64_t g_num_pmodules = 0;
-struct pmodule_t pmodules[MAX_NUM_MODULES] = { 0 };
-
 /* -------------------------------------------------------------------------- */
 /* Status                                                                     */
 /* -------------------------------------------------------------------------- */
@@ -65,59 +63,228 @@ static int g_status = 0;
 
 DEFINE_MUTEX(g_status_mutex);
 
+/* -------------------------------------------------------------------------- */
+/* Debug Ring                                                                 */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * The VMM's debug ring can be mapped (read-only) into userspace using mmap,
+ * which allows bfm to follow the debug ring without copying the entire ring
+ * with IOCTL_DUMP_VMM each time. The VMM has no way to tell us that it wrote
+ * to the debug ring, so while someone is waiting in poll, a timer checks
+ * epos every DRR_POLL_INTERVAL jiffies.
+ *
+ * Each open file can map the debug ring once. The pages are inserted with
+ * vm_insert_page, which takes a reference to each page, so the mapping
+ * remains valid even if the VMM is unloaded while it is still mapped.
+ */
+
+#define DRR_POLL_INTERVAL (HZ / 100)
+
+struct drr_file_t {
+    struct page *page;
+    uint64_t epos;
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(g_drr_wq);
+static struct timer_list g_drr_timer;
+
+static void
+drr_timer_fn(struct timer_list *timer)
+{ wake_up_interruptible(&g_drr_wq); }
+
+static uint64_t
+drr_epos(struct drr_file_t *df)
+{ return READ_ONCE(((struct debug_ring_resources_t *)page_address(df->page))->epos); }
+
 /* -------------------------------------------------------------------------- */
 /* Misc Device                                                                */
 /* -------------------------------------------------------------------------- */
 
 static int
 dev_open(struct inode *inode, struct file *file)
-{ return 0; }
+{
+    file->private_data = 0;
+    return 0;
+}
 
 static int
 dev_release(struct inode *inode, struct file *file)
-{ return 0; }
+{
+    struct drr_file_t *df = file->private_data;
+
+    if (df != 0) {
+        put_page(df->page);
+        kfree(df);
+    }
+
+    return 0;
+}
+
+static int
+dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    int ret;
+    uint64_t off;
+    struct drr_file_t *df;
+    struct debug_ring_resources_t *drr = 0;
+    uint64_t size = vma->vm_end - vma->vm_start;
+
+    if ((vma->vm_flags & VM_WRITE) != 0) {
+        return -EPERM;
+    }
+
+    if (vma->vm_pgoff != 0 || size > PAGE_ALIGN(sizeof(struct debug_ring_resources_t))) {
+        return -EINVAL;
+    }
+
+    /*
+     * The check and set of private_data has to be atomic, as two threads
+     * could mmap the same file at once, which would leak one of the
+     * mappings' drr_file_t.
+     */
+
+    mutex_lock(&g_status_mutex);
+
+    if (file->private_data != 0) {
+        ret = -EBUSY;
+        goto MMAP_FAILURE;
+    }
+
+    if (common_dump_vmm(&drr, g_vcpuid) != BF_SUCCESS) {
+        BFALERT("mmap: common_dump_vmm failed\n");
+        ret = -EINVAL;
+        goto MMAP_FAILURE;
+    }
+
+    if (!is_vmalloc_addr(drr) || ((uint64_t)drr & (PAGE_SIZE - 1)) != 0) {
+        BFALERT("mmap: debug ring cannot be mapped: %p\n", (void *)drr);
+        ret = -EINVAL;
+        goto MMAP_FAILURE;
+    }
+
+    df = kzalloc(sizeof(struct drr_file_t), GFP_KERNEL);
+    if (df == 0) {
+        ret = -ENOMEM;
+        goto MMAP_FAILURE;
+    }
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+    for (off = 0; off < size; off += PAGE_SIZE) {
+        ret = vm_insert_page(vma, vma->vm_start + off, vmalloc_to_page((char *)drr + off));
+        if (ret != 0) {
+            BFALERT("mmap: vm_insert_page failed: %d\n", ret);
+            kfree(df);
+            goto MMAP_FAILURE;
+        }
+    }
+
+    df->page = vmalloc_to_page(drr);
+    get_page(df->page);
+
+    df->epos = drr_epos(df);
+    file->private_data = df;
+
+    mutex_unlock(&g_status_mutex);
+    return 0;
+
+MMAP_FAILURE:
+
+    mutex_unlock(&g_status_mutex);
+    return ret;
+}
+
+static __poll_t
+dev_poll(struct file *file, poll_table *wait)
+{
+    uint64_t epos;
+    struct drr_file_t *df = file->private_data;
+
+    if (df == 0) {
+        return EPOLLERR;
+    }
+
+    poll_wait(file, &g_drr_wq, wait);
+
+    epos = drr_epos(df);
+    if (epos != df->epos) {
+        df->epos = epos;
+        return EPOLLIN | EPOLLRDNORM;
+    }
+
+    mod_timer(&g_drr_timer, jiffies + DRR_POLL_INTERVAL);
+    return 0;
+}
 
 static long
 ioctl_add_module(const char *file)
 {
-    char *buf;
-    int64_t ret;
+    long i;
+    long num_pages;
+    long num_pinned = 0;
+
+    char *buf = NULL;
+    struct page **pages = NULL;
+    uint64_t offset = (uint64_t)file & (PAGE_SIZE - 1);
+    int64_t ret = BF_ERROR_UNKNOWN;
 
-    if (g_num_pmodules >= MAX_NUM_MODULES) {
-        BFALERT("IOCTL_ADD_MODULE: too many modules have been loaded\n");
+    if (file == NULL || g_module_length == 0) {
+        BFALERT("IOCTL_ADD_MODULE: invalid module\n");
         return BF_IOCTL_FAILURE;
     }
 
-    buf = platform_alloc_rw(g_module_length);
-    if (buf == NULL) {
-        BFALERT("IOCTL_ADD_MODULE: failed to allocate memory for the module\n");
+    /*
+     * Instead of copying the module into the kernel, only to have the ELF
+     * loader copy it again into its final location, we pin the userspace
+     * pages that contain the module (which bfm maps straight out of the
+     * page cache) and map them into the kernel. common_add_module copies
+     * each segment straight into the exec, after which the pages are no
+     * longer needed and are released.
+     */
+
+    num_pages = (long)(PAGE_ALIGN(offset + g_module_length) >> PAGE_SHIFT);
+
+    pages = kvmalloc_array(num_pages, sizeof(struct page *), GFP_KERNEL);
+    if (pages == NULL) {
+        BFALERT("IOCTL_ADD_MODULE: failed to allocate memory for the module's pages\n");
         return BF_IOCTL_FAILURE;
     }
 
-    ret = copy_from_user(buf, file, g_module_length);
-    if (ret != 0) {
-        BFALERT("IOCTL_ADD_MODULE: failed to copy memory from userspace\n");
-        goto IOCTL_FAILURE;
+    num_pinned = get_user_pages_fast((unsigned long)file - offset, (int)num_pages, 0, pages);
+    if (num_pinned != num_pages) {
+        BFALERT("IOCTL_ADD_MODULE: failed to pin the module's pages\n");
+        goto IOCTL_DONE;
     }
 
-    ret = common_add_module(buf, g_module_length);
+    buf = vmap(pages, (unsigned int)num_pages, VM_MAP, PAGE_KERNEL_RO);
+    if (buf == NULL) {
+        BFALERT("IOCTL_ADD_MODULE: failed to map the module's pages\n");
+        goto IOCTL_DONE;
+    }
+
+    ret = common_add_module(buf + offset, g_module_length);
     if (ret != BF_SUCCESS) {
         BFALERT("IOCTL_ADD_MODULE: common_add_module failed: %p - %s\n", \
                 (void *)ret, ec_to_str(ret));
-        goto IOCTL_FAILURE;
     }
 
-    pmodules[g_num_pmodules].data = buf;
-    pmodules[g_num_pmodules].size = g_module_length;
+IOCTL_DONE:
 
-    g_num_pmodules++;
-
-    return BF_IOCTL_SUCCESS;
+    if (buf != NULL) {
+        vunmap(buf);
+    }
 
-IOCTL_FAILURE:
+    for (i = 0; i < num_pinned; i++) {
+        put_page(pages[i]);
+    }
 
-    platform_free_rw(buf, g_module_length);
-    return BF_IOCTL_FAILURE;
+    kvfree(pages);
+    return ret == BF_SUCCESS ? BF_IOCTL_SUCCESS : BF_IOCTL_FAILURE;
 }
 
 static long
@@ -142,7 +309,6 @@ ioctl_add_module_length(uint64_t *len)
 static long
 ioctl_unload_vmm(void)
 {
-    int i;
     int64_t ret;
 
     ret = common_unload_vmm();
@@ -151,13 +317,6 @@ ioctl_unload_vmm(void)
         goto IOCTL_FAILURE;
     }
 
-    for (i = 0; i < g_num_pmodules; i++) {
-        platform_free_rw(pmodules[i].data, pmodules[i].size);
-    }
-
-    g_num_pmodules = 0;
-    platform_memset(&pmodules, 0, sizeof(pmodules));
-
     return BF_IOCTL_SUCCESS;
 
 IOCTL_FAILURE:
@@ -384,6 +543,8 @@ static struct file_operations fops = {
     .open = dev_open,
     .release = dev_release,
     .unlocked_ioctl = dev_unlocked_ioctl,
+    .mmap = dev_mmap,
+    .poll = dev_poll,
 };
 
 static struct miscdevice bareflank_dev = {
@@ -509,6 +670,8 @@ dev_init(void)
     g_status = STATUS_STOPPED;
     mutex_init(&g_status_mutex);
 
+    timer_setup(&g_drr_timer, drr_timer_fn, 0);
+
     return 0;
 
 INIT_FAILURE:
@@ -525,6 +688,7 @@ dev_exit(void)
     g_status = STATUS_STOPPED;
 
     misc_deregister(&bareflank_dev);
+    del_timer_sync(&g_drr_timer);
     unregister_pm_notifier(&pm_notifier_block);
     unregister_reboot_notifier(&reboot_notifier_block);
 
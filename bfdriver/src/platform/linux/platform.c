@@ -66,7 +66,23 @@ platform_alloc_rw(uint64_t len)
         return addr;
     }
 
-    addr = vmalloc(len);
+    /*
+     * Since 5.18, vmalloc can back an allocation with huge pages, which
+     * are physically contiguous and 2M aligned, allowing the VMM to map
+     * them with 2M pages as well. There is no exported way of doing the
+     * same for executable memory, which is why platform_alloc_rwe does
+     * not do this.
+     */
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 18, 0)
+    if (len >= PMD_SIZE) {
+        addr = vmalloc_huge(len, GFP_KERNEL);
+    }
+#endif
+
+    if (addr == nullptr) {
+        addr = vmalloc(len);
+    }
 
     if (addr == nullptr) {
         BFALERT("platform_alloc_rw: failed to vmalloc rw mem: %lld\n", len);
@@ -171,6 +187,59 @@ platform_num_cpus(void)
     return num_cpus;
 }
 
+int64_t
+platform_num_nodes(void)
+{
+    int64_t num_nodes = num_online_nodes();
+
+    if (num_nodes < 1) {
+        return 1;
+    }
+
+    return num_nodes;
+}
+
+int64_t
+platform_node_online(int64_t node)
+{
+    if (node < 0 || node >= MAX_NUMNODES) {
+        return 0;
+    }
+
+    return node_online(node) ? 1 : 0;
+}
+
+int64_t
+platform_cpu_node(uint64_t cpuid)
+{
+    int64_t node = cpu_to_node(cpuid);
+
+    if (node < 0) {
+        return 0;
+    }
+
+    return node;
+}
+
+void *
+platform_alloc_rw_node(uint64_t len, int64_t node)
+{
+    void *addr = nullptr;
+
+    if (len == 0) {
+        BFALERT("platform_alloc_rw_node: invalid length\n");
+        return addr;
+    }
+
+    addr = vmalloc_node(len, node);
+
+    if (addr == nullptr) {
+        BFALERT("platform_alloc_rw_node: failed to vmalloc rw mem: %lld\n", len);
+    }
+
+    return addr;
+}
+
 int64_t
 platform_call_vmm_on_core(
     uint64_t cpuid, uint64_t request, uintptr_t arg1, uintptr_t arg2)
@@ -107,6 +107,25 @@ int64_t
 platform_num_cpus(void)
 { return 1; }
 
+int64_t
+platform_num_nodes(void)
+{ return 1; }
+
+int64_t
+platform_node_online(int64_t node)
+{ return (node >= 0 && node < platform_num_nodes()) ? 1 : 0; }
+
+int64_t
+platform_cpu_node(uint64_t cpuid)
+{ return (int64_t)(cpuid % (uint64_t)platform_num_nodes()); }
+
+void *
+platform_alloc_rw_node(uint64_t len, int64_t node)
+{
+    bfignored(node);
+    return aligned_alloc(BAREFLANK_PAGE_SIZE, PAGE_ROUND_UP(len));
+}
+
 int64_t
 platform_call_vmm_on_core(
     uint64_t cpuid, uint64_t request, uintptr_t arg1, uintptr_t arg2)
@@ -24,11 +24,69 @@
 
 #include <bfdebug.h>
 #include <bfplatform.h>
+#include <bfconstants.h>
 #include <common.h>
 
 #define BF_TAG 'BFLK'
 #define BF_NX_TAG 'BFNX'
 
+/*
+ * Allocations of at least a large page are made physically contiguous when
+ * possible, as the VMM maps contiguous memory with 2M pages wherever the
+ * virtual and physical addresses are both 2M aligned. Pool allocations are
+ * used as a fallback. Contiguous memory has to be freed differently, which
+ * is why these allocations are remembered.
+ */
+#define MAX_CONTIGUOUS_ALLOCS 64
+static void *g_contiguous_allocs[MAX_CONTIGUOUS_ALLOCS] = {0};
+
+static void *
+private_alloc_contiguous(uint64_t len, ULONG protect)
+{
+    int i;
+    void *addr;
+    PHYSICAL_ADDRESS low, high, boundary;
+
+    if (len < BAREFLANK_LARGE_PAGE_SIZE) {
+        return nullptr;
+    }
+
+    low.QuadPart = 0;
+    high.QuadPart = -1;
+    boundary.QuadPart = 0;
+
+    addr = MmAllocateContiguousNodeMemory(
+        (SIZE_T)len, low, high, boundary, protect, MM_ANY_NODE_OK);
+
+    if (addr == nullptr) {
+        return nullptr;
+    }
+
+    for (i = 0; i < MAX_CONTIGUOUS_ALLOCS; i++) {
+        if (InterlockedCompareExchangePointer(&g_contiguous_allocs[i], addr, nullptr) == nullptr) {
+            return addr;
+        }
+    }
+
+    MmFreeContiguousMemory(addr);
+    return nullptr;
+}
+
+static int
+private_free_contiguous(void *addr)
+{
+    int i;
+
+    for (i = 0; i < MAX_CONTIGUOUS_ALLOCS; i++) {
+        if (InterlockedCompareExchangePointer(&g_contiguous_allocs[i], nullptr, addr) == addr) {
+            MmFreeContiguousMemory(addr);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int64_t
 platform_init(void)
 { return BF_SUCCESS; }
@@ -43,6 +101,11 @@ platform_alloc_rw(uint64_t len)
         return addr;
     }
 
+    addr = private_alloc_contiguous(len, PAGE_READWRITE);
+    if (addr != nullptr) {
+        return addr;
+    }
+
     addr = ExAllocatePoolWithTag(NonPagedPool, len, BF_TAG);
 
     if (addr == nullptr) {
@@ -62,6 +125,11 @@ platform_alloc_rwe(uint64_t len)
         return addr;
     }
 
+    addr = private_alloc_contiguous(len, PAGE_EXECUTE_READWRITE);
+    if (addr != nullptr) {
+        return addr;
+    }
+
     addr = ExAllocatePoolWithTag(NonPagedPoolExecute, len, BF_TAG);
 
     if (addr == nullptr) {
@@ -88,6 +156,10 @@ platform_free_rw(void *addr, uint64_t len)
         return;
     }
 
+    if (private_free_contiguous(addr)) {
+        return;
+    }
+
     ExFreePoolWithTag(addr, BF_TAG);
 }
 
@@ -101,6 +173,10 @@ platform_free_rwe(void *addr, uint64_t len)
         return;
     }
 
+    if (private_free_contiguous(addr)) {
+        return;
+    }
+
     ExFreePoolWithTag(addr, BF_TAG);
 }
 
@@ -140,6 +216,28 @@ platform_num_cpus()
     return (int64_t)KeQueryActiveProcessorCount(&k_affin);
 }
 
+int64_t
+platform_num_nodes(void)
+{ return 1; }
+
+int64_t
+platform_node_online(int64_t node)
+{ return node == 0 ? 1 : 0; }
+
+int64_t
+platform_cpu_node(uint64_t cpuid)
+{
+    bfignored(cpuid);
+    return 0;
+}
+
+void *
+platform_alloc_rw_node(uint64_t len, int64_t node)
+{
+    bfignored(node);
+    return platform_alloc_rw(len);
+}
+
 int64_t
 platform_call_vmm_on_core(
     uint64_t cpuid, uint64_t request, uintptr_t arg1, uintptr_t arg2)
@@ -37,14 +37,6 @@ FAST_MUTEX g_status_mutex;
 
 static uint64_t g_vcpuid = 0;
 
-struct pmodule_t {
-    char *data;
-    int64_t size;
-};
-
-static uint64_t g_num_pmodules = 0;
-static struct pmodule_t pmodules[MAX_NUM_MODULES] = { 0 };
-
 /* -------------------------------------------------------------------------- */
 /* Misc Device                                                                */
 /* -------------------------------------------------------------------------- */
@@ -52,45 +44,26 @@ static struct pmodule_t pmodules[MAX_NUM_MODULES] = { 0 };
 static int64_t
 ioctl_add_module(const char *file, int64_t len)
 {
-    char *buf;
     int64_t ret;
 
-    if (g_num_pmodules >= MAX_NUM_MODULES) {
-        BFALERT("IOCTL_ADD_MODULE: too many modules have been loaded\n");
-        return BF_IOCTL_FAILURE;
-    }
-
-    buf = platform_alloc_rw(len);
-    if (buf == NULL) {
-        BFALERT("IOCTL_ADD_MODULE: failed to allocate memory for the module\n");
-        return BF_IOCTL_FAILURE;
-    }
-
-    RtlCopyMemory(buf, file, len);
+    /*
+     * Note: common_add_module copies each segment of the module into its
+     * final location before returning, so there is no need to keep a copy
+     * of the module around. The input buffer is used as is.
+     */
 
-    ret = common_add_module(buf, len);
+    ret = common_add_module(file, len);
     if (ret != BF_SUCCESS) {
         BFALERT("IOCTL_ADD_MODULE: common_add_module failed: %p - %s\n", (void *)ret, ec_to_str(ret));
-        goto IOCTL_FAILURE;
+        return BF_IOCTL_FAILURE;
     }
 
-    pmodules[g_num_pmodules].data = buf;
-    pmodules[g_num_pmodules].size = len;
-
-    g_num_pmodules++;
-
     return BF_IOCTL_SUCCESS;
-
-IOCTL_FAILURE:
-
-    platform_free_rw(buf, len);
-    return BF_IOCTL_FAILURE;
 }
 
 static long
 ioctl_unload_vmm(void)
 {
-    int i;
     int64_t ret;
 
     ret = common_unload_vmm();
@@ -99,13 +72,6 @@ ioctl_unload_vmm(void)
         goto IOCTL_FAILURE;
     }
 
-    for (i = 0; i < g_num_pmodules; i++) {
-        platform_free_rw(pmodules[i].data, pmodules[i].size);
-    }
-
-    g_num_pmodules = 0;
-    platform_memset(&pmodules, 0, sizeof(pmodules));
-
     return BF_IOCTL_SUCCESS;
 
 IOCTL_FAILURE:
@@ -36,6 +36,14 @@ TEST_CASE("common_add_module: invalid size")
     CHECK(common_add_module(info.back().file, 0) == BF_ERROR_INVALID_ARG);
 }
 
+TEST_CASE("common_add_module: invalid elf")
+{
+    char file[64] = {};
+
+    CHECK(common_add_module(static_cast<char *>(file), sizeof(file)) == BFELF_ERROR_INVALID_SIGNATURE);
+    CHECK(common_load_vmm() == BF_ERROR_NO_MODULES_ADDED);
+}
+
 TEST_CASE("common_add_module: success")
 {
     binaries_info info{&g_file, g_filenames_success, false};
@@ -44,6 +52,20 @@ TEST_CASE("common_add_module: success")
     REQUIRE(common_fini() == BF_SUCCESS);
 }
 
+TEST_CASE("common_add_module: file released after add")
+{
+    {
+        binaries_info info{&g_file, g_filenames_success, false};
+
+        for (const auto &binary : info.binaries()) {
+            REQUIRE(common_add_module(binary.file, binary.file_size) == BF_SUCCESS);
+        }
+    }
+
+    CHECK(common_load_vmm() == BF_SUCCESS);
+    CHECK(common_fini() == BF_SUCCESS);
+}
+
 TEST_CASE("common_add_module: already loaded")
 {
     binaries_info info{&g_file, g_filenames_success, false};
@@ -98,3 +120,37 @@ TEST_CASE("common_add_module: too many modules")
     CHECK(common_add_module(info.front().file, info.front().file_size) == BF_ERROR_MAX_MODULES_REACHED);
     REQUIRE(common_fini() == BF_SUCCESS);
 }
+
+TEST_CASE("common_add_module: prelinked image")
+{
+    binaries_info info{&g_file, g_filenames_success, false};
+    std::vector<gsl::span<const char>> files;
+
+    for (const auto &binary : info.binaries()) {
+        files.emplace_back(binary.file, static_cast<std::ptrdiff_t>(binary.file_size));
+    }
+
+    auto image = bfelf_image_build(files);
+
+    CHECK(common_add_module(image.data(), image.size()) == BF_SUCCESS);
+    CHECK(common_add_module(image.data(), image.size()) == BF_ERROR_VMM_INVALID_STATE);
+    CHECK(common_load_vmm() == BF_SUCCESS);
+    CHECK(common_start_vmm() == BF_SUCCESS);
+    CHECK(common_fini() == BF_SUCCESS);
+}
+
+TEST_CASE("common_add_module: prelinked image after module")
+{
+    binaries_info info{&g_file, g_filenames_success, false};
+    std::vector<gsl::span<const char>> files;
+
+    for (const auto &binary : info.binaries()) {
+        files.emplace_back(binary.file, static_cast<std::ptrdiff_t>(binary.file_size));
+    }
+
+    auto image = bfelf_image_build(files);
+
+    REQUIRE(common_add_module(info.back().file, info.back().file_size) == BF_SUCCESS);
+    CHECK(common_add_module(image.data(), image.size()) == BF_ERROR_VMM_INVALID_STATE);
+    CHECK(common_fini() == BF_SUCCESS);
+}
@@ -32,6 +32,8 @@
 extern "C" int64_t private_setup_rsdp(void);
 extern "C" int64_t private_add_modules_mdl(void);
 
+extern "C" void *g_node_pools[MAX_NUM_NODES];
+
 TEST_CASE("common_load_vmm: success")
 {
     binaries_info info{&g_file, g_filenames_success, false};
@@ -205,4 +207,57 @@ TEST_CASE("common_load_vmm: add tss mdl fails")
     CHECK(common_fini() == BF_SUCCESS);
 }
 
+TEST_CASE("common_load_vmm: numa success")
+{
+    binaries_info info{&g_file, g_filenames_success, false};
+
+    for (const auto &binary : info.binaries()) {
+        REQUIRE(common_add_module(binary.file, binary.file_size) == BF_SUCCESS);
+    }
+
+    MockRepository mocks;
+    mocks.OnCallFunc(platform_num_nodes).Return(2);
+
+    CHECK(common_load_vmm() == BF_SUCCESS);
+    CHECK(common_fini() == BF_SUCCESS);
+}
+
+TEST_CASE("common_load_vmm: numa sparse node ids")
+{
+    binaries_info info{&g_file, g_filenames_success, false};
+
+    for (const auto &binary : info.binaries()) {
+        REQUIRE(common_add_module(binary.file, binary.file_size) == BF_SUCCESS);
+    }
+
+    MockRepository mocks;
+    mocks.OnCallFunc(platform_num_nodes).Return(2);
+    mocks.OnCallFunc(platform_node_online).Do([](int64_t node) -> int64_t {
+        return (node == 0 || node == 2) ? 1 : 0;
+    });
+    mocks.OnCallFunc(platform_cpu_node).Return(2);
+
+    CHECK(common_load_vmm() == BF_SUCCESS);
+    CHECK(g_node_pools[0] != nullptr);
+    CHECK(g_node_pools[1] == nullptr);
+    CHECK(g_node_pools[2] != nullptr);
+    CHECK(common_fini() == BF_SUCCESS);
+}
+
+TEST_CASE("common_load_vmm: alloc node pool fails")
+{
+    binaries_info info{&g_file, g_filenames_success, false};
+
+    for (const auto &binary : info.binaries()) {
+        REQUIRE(common_add_module(binary.file, binary.file_size) == BF_SUCCESS);
+    }
+
+    MockRepository mocks;
+    mocks.OnCallFunc(platform_num_nodes).Return(2);
+    mocks.ExpectCallFunc(platform_alloc_rw_node).Return(nullptr);
+
+    CHECK(common_load_vmm() == BF_ERROR_OUT_OF_MEMORY);
+    CHECK(common_fini() == BF_SUCCESS);
+}
+
 #endif
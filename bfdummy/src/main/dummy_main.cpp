@@ -57,6 +57,18 @@
 #define REQUEST_SET_RSDP_RETURN ENTRY_ERROR_UNKNOWN
 #endif
 
+#ifndef REQUEST_ADD_NODE_POOL_FAILS
+#define REQUEST_ADD_NODE_POOL_RETURN ENTRY_SUCCESS
+#else
+#define REQUEST_ADD_NODE_POOL_RETURN ENTRY_ERROR_UNKNOWN
+#endif
+
+#ifndef REQUEST_SET_CPU_NODE_FAILS
+#define REQUEST_SET_CPU_NODE_RETURN ENTRY_SUCCESS
+#else
+#define REQUEST_SET_CPU_NODE_RETURN ENTRY_ERROR_UNKNOWN
+#endif
+
 #ifndef REQUEST_VMM_INIT_FAILS
 #define REQUEST_VMM_INIT_RETURN ENTRY_SUCCESS
 #else
@@ -137,6 +149,12 @@ bfmain(uintptr_t request, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3)
         case BF_REQUEST_SET_RSDP:
             return REQUEST_SET_RSDP_RETURN;
 
+        case BF_REQUEST_ADD_NODE_POOL:
+            return REQUEST_ADD_NODE_POOL_RETURN;
+
+        case BF_REQUEST_SET_CPU_NODE:
+            return REQUEST_SET_CPU_NODE_RETURN;
+
         default:
             break;
     }
@@ -55,6 +55,10 @@ extern "C" {
 #define BFELF_MAX_SEGMENTS (4)
 #endif
 
+#ifndef BFELF_SYM_CACHE_SIZE
+#define BFELF_SYM_CACHE_SIZE (64)
+#endif
+
 /* @endcond */
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -258,6 +262,7 @@ struct bfelf_file_t {
     const struct bfelf_sym *symtab;
 
     bfelf64_xword relanum_dyn;
+    bfelf64_xword relacount;
     const struct bfelf_rela *relatab_dyn;
 
     bfelf64_xword relanum_plt;
@@ -852,6 +857,24 @@ struct bfelf_phdr {
 /* ELF Loader Definition                                                                          */
 /* ---------------------------------------------------------------------------------------------- */
 
+/*
+ * ELF Symbol Cache Entry
+ *
+ * Symbol relocations tend to reference the same handful of symbols over and
+ * over again (e.g. every call site of memcpy in a module). Each entry caches
+ * the result of a global symbol search for a given symbol index so that the
+ * search is only performed once per symbol for each ELF file.
+ *
+ * @cond
+ */
+struct bfelf_sym_cache_entry {
+    bfelf64_xword index;
+    struct bfelf_file_t *ef;
+    const struct bfelf_sym *sym;
+};
+
+/* @endcond */
+
 /*
  * ELF Loader
  *
@@ -865,6 +888,7 @@ struct bfelf_loader_t {
     bfelf64_word num;
     bfelf64_word relocated;
     struct bfelf_file_t *efs[MAX_NUM_MODULES];
+    struct bfelf_sym_cache_entry sym_cache[BFELF_SYM_CACHE_SIZE];
 };
 
 /* @endcond */
@@ -1020,6 +1044,47 @@ private_get_sym_global(
 
 /* @endcond */
 
+/* @cond */
+
+static inline int64_t
+private_resolve_symbol(
+    struct bfelf_loader_t *loader, struct bfelf_file_t *ef, bfelf64_xword index,
+    struct bfelf_file_t **found_ef, const struct bfelf_sym **found_sym)
+{
+    struct bfelf_sym_cache_entry *entry = &(loader->sym_cache[index % BFELF_SYM_CACHE_SIZE]);
+
+    if (entry->ef != nullptr && entry->index == index) {
+        *found_ef = entry->ef;
+        *found_sym = entry->sym;
+        return BFELF_SUCCESS;
+    }
+
+    *found_ef = ef;
+    *found_sym = &(ef->symtab[index]);
+
+    if (BFELF_SYM_BIND((*found_sym)->st_info) == bfstb_weak) {
+        *found_ef = nullptr;
+    }
+
+    if ((*found_sym)->st_value == 0 || *found_ef == nullptr) {
+        int64_t ret = 0;
+        const char *str = &(ef->strtab[(*found_sym)->st_name]);
+
+        ret = private_get_sym_global(loader, str, found_ef, found_sym);
+        if (ret != BFELF_SUCCESS) {
+            return ret;
+        }
+    }
+
+    entry->index = index;
+    entry->ef = *found_ef;
+    entry->sym = *found_sym;
+
+    return BFELF_SUCCESS;
+}
+
+/* @endcond */
+
 /*
  * Relocation definitions and relocators
  *
@@ -1038,13 +1103,44 @@ private_get_sym_global(
 
 /* @cond */
 
+/*
+ * Relative Relocations
+ *
+ * The static linker sorts all of the relative relocations to the front of
+ * .rela.dyn and reports how many there are using DT_RELACOUNT. These do not
+ * reference a symbol, so they are applied in bulk without decoding the
+ * relocation type or performing a symbol lookup.
+ */
+static inline void
+private_relocate_relative(struct bfelf_file_t *ef, bfelf64_xword num)
+{
+    bfelf64_xword i = 0;
+    const struct bfelf_rela *relatab = ef->relatab_dyn;
+
+    for (i = 0; i < num; i++) {
+        const struct bfelf_rela *rela = &(relatab[i]);
+        bfelf64_addr *ptr =
+            bfrcast(bfelf64_addr *, ef->exec_addr + rela->r_offset - ef->start_addr);
+
+        *ptr = bfrcast(bfelf64_addr, ef->exec_virt + rela->r_addend);
+    }
+}
+
 static inline int64_t
 private_relocate_symbols(struct bfelf_loader_t *loader, struct bfelf_file_t *ef)
 {
     int64_t ret = 0;
-    bfelf64_word i = 0;
+    bfelf64_xword i = 0;
+    bfelf64_xword relacount = ef->relacount;
+
+    if (relacount > ef->relanum_dyn) {
+        relacount = ef->relanum_dyn;
+    }
+
+    private_relocate_relative(ef, relacount);
+    platform_memset(loader->sym_cache, 0, sizeof(loader->sym_cache));
 
-    for (i = 0; i < ef->relanum_dyn; i++) {
+    for (i = relacount; i < ef->relanum_dyn; i++) {
         const struct bfelf_rela *rela = &(ef->relatab_dyn[i]);
 
         ret = private_relocate_symbol(loader, ef, rela);
@@ -1268,6 +1364,10 @@ private_process_dynamic_section(struct bfelf_file_t *ef)
                 ef->fini_arraysz = dyn->d_val;
                 break;
 
+            case bfdt_relacount:
+                ef->relacount = dyn->d_val;
+                break;
+
             case bfdt_flags_1:
                 ef->flags_1 = dyn->d_val;
                 break;
@@ -1845,6 +1945,7 @@ private_load_binary(struct bfelf_binary_t *binary)
     int64_t ret = 0;
     int64_t num_segments = 0;
     uint64_t exec_size = 0;
+    uint64_t zero_offset = 0;
 
     /*
      * Note:
@@ -1853,8 +1954,16 @@ private_load_binary(struct bfelf_binary_t *binary)
      * already been filled in before executing this function. It will
      * allocate the exec, and then copy each program segment in the provided
      * file into the exec
+     *
+     * If the binary has already been loaded using bfelf_load_binary, the
+     * file has been released, and the exec already contains everything we
+     * need, so there is nothing left to do.
      */
 
+    if (binary->file == nullptr && binary->ef.file != nullptr && binary->exec != nullptr) {
+        return BF_SUCCESS;
+    }
+
     if (binary->ef.file == nullptr) {
         ret = bfelf_file_init(binary->file, binary->file_size, &binary->ef);
         if (ret != BF_SUCCESS) {
@@ -1916,7 +2025,16 @@ private_load_binary(struct bfelf_binary_t *binary)
         return bfout_of_memory("unable to allocate exec RWE memory");
     }
 
-    platform_memset(binary->exec, 0, binary->exec_size);
+    /*
+     * Note:
+     *
+     * Instead of zeroing the entire exec and then copying each segment on
+     * top of it (which touches every byte of the image twice), we only zero
+     * the parts of the exec that are not copied from the file (i.e. the
+     * gaps between segments, the .bss and whatever is left over at the end
+     * of the exec). This relies on the load instructions being sorted by
+     * mem_offset, which is guaranteed by the ELF specification.
+     */
 
     for (i = 0; i < num_segments; i++) {
         const struct bfelf_load_instr *instr = nullptr;
@@ -1931,6 +2049,11 @@ private_load_binary(struct bfelf_binary_t *binary)
             uint64_t dst_size = binary->exec_size - instr->mem_offset;
             uint64_t src_size = binary->file_size - instr->file_offset;
 
+            if (instr->mem_offset > zero_offset) {
+                platform_memset(
+                    bfadd(char *, binary->exec, zero_offset), 0, instr->mem_offset - zero_offset);
+            }
+
             dst = bfadd(char *, binary->exec, instr->mem_offset);
             src = bfcadd(const char *, binary->file, instr->file_offset);
 
@@ -1938,9 +2061,18 @@ private_load_binary(struct bfelf_binary_t *binary)
             if (ret != SUCCESS) {
                 return bfinvalid_argument("memcpy failed with unknown reason");
             }
+
+            if (instr->mem_offset + instr->filesz > zero_offset) {
+                zero_offset = instr->mem_offset + instr->filesz;
+            }
         }
     }
 
+    if (binary->exec_size > zero_offset) {
+        platform_memset(
+            bfadd(char *, binary->exec, zero_offset), 0, binary->exec_size - zero_offset);
+    }
+
     return BF_SUCCESS;
 }
 
@@ -1997,6 +2129,48 @@ private_crt_info(
 
 /* @endcond */
 
+/**
+ * Load Binary
+ *
+ * Loads a single ELF binary into its exec (allocating the exec if it has
+ * not already been allocated). Once this function returns, the file is no
+ * longer needed, and binary->file is set to nullptr so that bfelf_load
+ * does not attempt to load the binary a second time. This allows the caller
+ * to load each binary straight out of wherever the file happens to live
+ * (e.g. pinned userspace pages) without keeping a copy of each file around
+ * until bfelf_load is called.
+ *
+ * @expects binary != null
+ * @expects binary->file != null
+ * @ensures none
+ *
+ * @param binary the ELF binary to load
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+static inline int64_t
+bfelf_load_binary(struct bfelf_binary_t *binary)
+{
+    int64_t ret = 0;
+
+    if (binary == nullptr) {
+        return bfinvalid_argument("binary == nullptr");
+    }
+
+    if (binary->file == nullptr) {
+        return bfinvalid_argument("binary->file == nullptr");
+    }
+
+    ret = private_load_binary(binary);
+    if (ret != BF_SUCCESS) {
+        return ret;
+    }
+
+    binary->file = nullptr;
+    binary->file_size = 0;
+
+    return BF_SUCCESS;
+}
+
 /**
  * Load
  *
@@ -2011,7 +2185,8 @@ private_crt_info(
  * @note It is assumed that file and file_size are already provided for each
  *     ELF binary. This function will loop through each binary, and use this
  *     information to actually load everything into ELF file specific
- *     structures.
+ *     structures. Binaries that were already loaded using bfelf_load_binary
+ *     are not loaded again.
  *
  * @expects binaries != null
  * @expects num_binaries != 0 && num_binaries < MAX_NUM_MODULES
@@ -2137,6 +2312,286 @@ bfelf_set_integer_args(
     return BF_SUCCESS;
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+/* ELF Image APIs                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+/*
+ * Prelinked Images
+ *
+ * Loading a set of ELF binaries requires each binary to be parsed, and every
+ * relocation to be resolved across all of the binaries, which has to be done
+ * each time the binaries are loaded, even if none of them have changed. A
+ * prelinked image is the result of loading and relocating a set of binaries
+ * into a single, flat exec that is relocated as if it were loaded at address
+ * 0. Since every relocation that this loader supports results in an absolute
+ * address, the image can be loaded at any address by adding the load address
+ * to each relocated location, which are listed in the image's fixup table.
+ *
+ * An image is laid out as follows:
+ * - struct bfelf_image_t
+ * - struct bfelf_image_module_t[num_modules]
+ * - uint64_t[num_fixups] (each fixup is an offset into the exec)
+ * - the exec (exec_size bytes)
+ *
+ * Each image is keyed on the contents of the binaries it was built from, so
+ * that a stale image can be detected (see bfelf_image_key).
+ *
+ * @cond
+ */
+
+#define BFELF_IMAGE_MAGIC 0xBF1A6EBF1A6EBF1AULL
+#define BFELF_IMAGE_VERSION 1ULL
+
+struct bfelf_image_module_t {
+    uint64_t hash;
+    uint64_t exec_offset;
+    uint64_t exec_size;
+    uint64_t num_load_instr;
+    struct bfelf_load_instr load_instr[BFELF_MAX_SEGMENTS];
+    struct section_info_t section_info;
+};
+
+struct bfelf_image_t {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t key;
+    uint64_t entry;
+    uint64_t exec_size;
+    uint64_t num_modules;
+    uint64_t num_fixups;
+};
+
+static inline void *
+private_image_rebase(void *addr, char *exec)
+{
+    if (addr == nullptr) {
+        return nullptr;
+    }
+
+    return bfadd(void *, exec, bfrcast(uintptr_t, addr));
+}
+
+static inline void
+private_image_rebase_section_info(struct section_info_t *info, char *exec)
+{
+    info->init_addr = private_image_rebase(info->init_addr, exec);
+    info->fini_addr = private_image_rebase(info->fini_addr, exec);
+    info->init_array_addr = private_image_rebase(info->init_array_addr, exec);
+    info->fini_array_addr = private_image_rebase(info->fini_array_addr, exec);
+    info->eh_frame_addr = private_image_rebase(info->eh_frame_addr, exec);
+    info->debug_info_addr = private_image_rebase(info->debug_info_addr, exec);
+}
+
+static inline int64_t
+private_image_check(const char *image, uint64_t image_size)
+{
+    uint64_t i = 0;
+    uint64_t j = 0;
+    uint64_t hdr_size = 0;
+
+    const struct bfelf_image_t *hdr = bfrcast(const struct bfelf_image_t *, image);
+    const struct bfelf_image_module_t *modules = nullptr;
+
+    if (image_size < sizeof(struct bfelf_image_t)) {
+        return bfinvalid_file("image too small");
+    }
+
+    if (hdr->magic != BFELF_IMAGE_MAGIC || hdr->version != BFELF_IMAGE_VERSION) {
+        return bfinvalid_file("not a supported image");
+    }
+
+    if (hdr->num_modules == 0 || hdr->num_modules >= MAX_NUM_MODULES) {
+        return bfinvalid_file("invalid number of modules");
+    }
+
+    if (hdr->num_fixups > image_size / sizeof(uint64_t)) {
+        return bfinvalid_file("invalid number of fixups");
+    }
+
+    hdr_size = sizeof(struct bfelf_image_t) +
+               (hdr->num_modules * sizeof(struct bfelf_image_module_t)) +
+               (hdr->num_fixups * sizeof(uint64_t));
+
+    if (hdr->exec_size == 0 || hdr_size > image_size || image_size - hdr_size != hdr->exec_size) {
+        return bfinvalid_file("invalid exec size");
+    }
+
+    if (hdr->entry >= hdr->exec_size) {
+        return bfinvalid_file("invalid entry point");
+    }
+
+    modules = bfcadd(const struct bfelf_image_module_t *, image, sizeof(struct bfelf_image_t));
+
+    for (i = 0; i < hdr->num_modules; i++) {
+        const struct bfelf_image_module_t *module = &modules[i];
+
+        if (module->exec_offset > hdr->exec_size ||
+            module->exec_size > hdr->exec_size - module->exec_offset) {
+            return bfinvalid_file("invalid module exec");
+        }
+
+        if (module->num_load_instr > BFELF_MAX_SEGMENTS) {
+            return bfinvalid_file("invalid number of load instructions");
+        }
+
+        for (j = 0; j < module->num_load_instr; j++) {
+            const struct bfelf_load_instr *instr = &module->load_instr[j];
+
+            if (instr->mem_offset > module->exec_size ||
+                instr->memsz > module->exec_size - instr->mem_offset) {
+                return bfinvalid_file("invalid load instruction");
+            }
+        }
+    }
+
+    return BFELF_SUCCESS;
+}
+
+/* @endcond */
+
+/**
+ * Is Image
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @param file the file to check
+ * @param file_size the size of the file in bytes
+ * @return 1 if the file is a prelinked image (see bfelf_image_load), 0
+ *     otherwise
+ */
+static inline int64_t
+bfelf_file_is_image(const char *file, uint64_t file_size)
+{
+    if (file == nullptr || file_size < sizeof(struct bfelf_image_t)) {
+        return 0;
+    }
+
+    return bfrcast(const struct bfelf_image_t *, file)->magic == BFELF_IMAGE_MAGIC ? 1 : 0;
+}
+
+/**
+ * Load Image
+ *
+ * Loads a prelinked image into a newly allocated exec, and applies the
+ * image's fixups so that the image can be executed from wherever the exec
+ * was allocated. Since the image has already been relocated, no ELF parsing
+ * or symbol resolution is performed. Each binary in the image is returned
+ * as a bfelf_binary_t whose exec points into the image's exec, and whose
+ * load instructions describe the binary's segments (e.g. so that the caller
+ * can set up memory permissions).
+ *
+ * @note The returned binaries do not own their exec. Instead, the image's
+ *     exec must be freed using platform_free_rwe(exec, exec_size)
+ *
+ * @expects image != null
+ * @expects binaries != null (with room for MAX_NUM_MODULES binaries)
+ * @expects num_binaries != null
+ * @expects exec != null
+ * @expects exec_size != null
+ * @ensures none
+ *
+ * @param image the prelinked image
+ * @param image_size the size of the image in bytes
+ * @param binaries the resulting ELF binaries
+ * @param num_binaries the resulting number of ELF binaries
+ * @param exec the resulting exec
+ * @param exec_size the resulting size of the exec
+ * @param entry the resulting entry point (ignored if null)
+ * @param crt_info the resulting CRT info (ignored if null)
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+static inline int64_t
+bfelf_image_load(
+    const char *image, uint64_t image_size, struct bfelf_binary_t *binaries,
+    uint64_t *num_binaries, char **exec, uint64_t *exec_size, void **entry,
+    struct crt_info_t *crt_info)
+{
+    uint64_t i = 0;
+    int64_t ret = 0;
+
+    char *img_exec = nullptr;
+    const uint64_t *fixups = nullptr;
+    const struct bfelf_image_t *hdr = nullptr;
+    const struct bfelf_image_module_t *modules = nullptr;
+
+    if (image == nullptr) {
+        return bfinvalid_argument("image == nullptr");
+    }
+
+    if (binaries == nullptr || num_binaries == nullptr) {
+        return bfinvalid_argument("binaries == nullptr || num_binaries == nullptr");
+    }
+
+    if (exec == nullptr || exec_size == nullptr) {
+        return bfinvalid_argument("exec == nullptr || exec_size == nullptr");
+    }
+
+    ret = private_image_check(image, image_size);
+    if (ret != BFELF_SUCCESS) {
+        return ret;
+    }
+
+    hdr = bfrcast(const struct bfelf_image_t *, image);
+    modules = bfcadd(const struct bfelf_image_module_t *, image, sizeof(struct bfelf_image_t));
+    fixups = bfrcast(const uint64_t *, &modules[hdr->num_modules]);
+
+    img_exec = bfscast(char *, platform_alloc_rwe(hdr->exec_size));
+    if (img_exec == nullptr) {
+        return bfout_of_memory("unable to allocate exec RWE memory");
+    }
+
+    ret = platform_memcpy(
+              img_exec, hdr->exec_size, &fixups[hdr->num_fixups], hdr->exec_size, hdr->exec_size);
+    if (ret != SUCCESS) {
+        platform_free_rwe(img_exec, hdr->exec_size);
+        return bfinvalid_argument("memcpy failed with unknown reason");
+    }
+
+    for (i = 0; i < hdr->num_fixups; i++) {
+        if (hdr->exec_size < sizeof(uint64_t) || fixups[i] > hdr->exec_size - sizeof(uint64_t)) {
+            platform_free_rwe(img_exec, hdr->exec_size);
+            return bfinvalid_file("invalid fixup");
+        }
+
+        *bfadd(uint64_t *, img_exec, fixups[i]) += bfrcast(uint64_t, img_exec);
+    }
+
+    platform_memset(binaries, 0, hdr->num_modules * sizeof(struct bfelf_binary_t));
+
+    for (i = 0; i < hdr->num_modules; i++) {
+        const struct bfelf_image_module_t *module = &modules[i];
+
+        binaries[i].exec = bfadd(char *, img_exec, module->exec_offset);
+        binaries[i].exec_size = module->exec_size;
+        binaries[i].ef.num_load_instr = module->num_load_instr;
+
+        ret = platform_memcpy(
+                  binaries[i].ef.load_instr, sizeof(binaries[i].ef.load_instr),
+                  module->load_instr, sizeof(module->load_instr),
+                  module->num_load_instr * sizeof(struct bfelf_load_instr));
+        bfignored(ret);
+
+        if (crt_info != nullptr) {
+            struct section_info_t *info = &crt_info->info[crt_info->info_num++];
+
+            *info = module->section_info;
+            private_image_rebase_section_info(info, img_exec);
+        }
+    }
+
+    if (entry != nullptr) {
+        *entry = bfadd(void *, img_exec, hdr->entry);
+    }
+
+    *exec = img_exec;
+    *exec_size = hdr->exec_size;
+    *num_binaries = hdr->num_modules;
+
+    return BFELF_SUCCESS;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -2150,6 +2605,8 @@ bfelf_set_integer_args(
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstring>
+#include <algorithm>
 #include <exception>
 
 /* @cond */
@@ -2221,6 +2678,244 @@ bfelf_read_binary_and_get_needed_list(
     return list;
 }
 
+/* @cond */
+
+constexpr const uint64_t private_image_hash_basis = 0xCBF29CE484222325ULL;
+
+inline uint64_t
+private_image_hash(uint64_t hash, gsl::span<const char> data)
+{
+    for (const auto &c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+/* @endcond */
+
+/**
+ * Image Key
+ *
+ * Returns the key of a prelinked image built from the provided ELF
+ * binaries (in the order provided), which is a hash of the contents of
+ * each binary. If the key of an existing image (see bfelf_image_get_key)
+ * matches, the image is current, and can be loaded instead of the
+ * binaries it was built from.
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @param files the contents of each ELF binary
+ * @return the key of an image built from files
+ */
+inline uint64_t
+bfelf_image_key(const std::vector<gsl::span<const char>> &files)
+{
+    auto key = private_image_hash_basis;
+
+    for (const auto &file : files) {
+        auto hash = private_image_hash(private_image_hash_basis, file);
+        key = private_image_hash(key, {reinterpret_cast<const char *>(&hash), sizeof(hash)});
+    }
+
+    return key;
+}
+
+/**
+ * Get Image Key
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @param image the contents of a prelinked image
+ * @return the key the image was built with, or 0 if the provided image is
+ *     not a supported prelinked image
+ */
+inline uint64_t
+bfelf_image_get_key(gsl::span<const char> image)
+{
+    bfelf_image_t hdr{};
+
+    if (bfelf_file_is_image(image.data(), static_cast<uint64_t>(image.size())) == 0) {
+        return 0;
+    }
+
+    std::memcpy(&hdr, image.data(), sizeof(hdr));
+    return hdr.version == BFELF_IMAGE_VERSION ? hdr.key : 0;
+}
+
+/**
+ * Build Image
+ *
+ * Loads and relocates the provided ELF binaries (in the same order that
+ * bfelf_load expects, i.e. the main executable last) into a single exec
+ * as if the exec were loaded at address 0, and returns the resulting
+ * prelinked image, which can be loaded using bfelf_image_load. All of the
+ * binaries must be compiled using PIC / PIE.
+ *
+ * @expects files.empty() == false
+ * @expects files.size() < MAX_NUM_MODULES
+ * @ensures none
+ *
+ * @param files the contents of each ELF binary
+ * @return the prelinked image, or throws
+ */
+inline file::binary_data
+bfelf_image_build(const std::vector<gsl::span<const char>> &files)
+{
+    expects(!files.empty());
+    expects(files.size() < MAX_NUM_MODULES);
+
+    int64_t ret = 0;
+    uint64_t num_fixups = 0;
+    uint64_t exec_size = 0;
+
+    auto loader = std::make_unique<bfelf_loader_t>();
+    auto binaries = std::make_unique<bfelf_binary_t[]>(files.size());
+    auto modules = std::make_unique<bfelf_image_module_t[]>(files.size());
+
+    auto binaries_view = gsl::make_span(binaries.get(), static_cast<std::ptrdiff_t>(files.size()));
+    auto modules_view = gsl::make_span(modules.get(), static_cast<std::ptrdiff_t>(files.size()));
+
+    for (auto i = 0LL; i < binaries_view.size(); i++) {
+        auto &binary = binaries_view.at(i);
+        auto &module = modules_view.at(i);
+        const auto &file = files.at(static_cast<std::size_t>(i));
+
+        binary.file = file.data();
+        binary.file_size = static_cast<uint64_t>(file.size());
+
+        ret = bfelf_file_init(binary.file, binary.file_size, &binary.ef);
+        if (ret != BFELF_SUCCESS) {
+            throw std::runtime_error("bfelf_file_init failed: " + bfn::to_string(ret, 16));
+        }
+
+        if (bfelf_file_get_pic_pie(&binary.ef) == 0) {
+            throw std::runtime_error("prelinked images require PIC/PIE binaries");
+        }
+
+        binary.exec_size = bfelf_file_get_total_size(&binary.ef);
+
+        // Large binaries (e.g. the binary with the VMM's page pools) are
+        // aligned to a large page so that, if the exec is allocated from
+        // contiguous memory, the VMM can map them using large pages
+
+        if (binary.exec_size >= BAREFLANK_LARGE_PAGE_SIZE) {
+            exec_size += BAREFLANK_LARGE_PAGE_SIZE - 1;
+            exec_size &= ~(BAREFLANK_LARGE_PAGE_SIZE - 1);
+        }
+
+        module.hash = private_image_hash(private_image_hash_basis, file);
+        module.exec_offset = exec_size;
+        module.exec_size = binary.exec_size;
+
+        exec_size += (binary.exec_size + BAREFLANK_PAGE_SIZE - 1) & ~(BAREFLANK_PAGE_SIZE - 1);
+        num_fixups += binary.ef.relanum_dyn + binary.ef.relanum_plt;
+    }
+
+    auto hdr_size =
+        sizeof(bfelf_image_t) + (files.size() * sizeof(bfelf_image_module_t)) +
+        (num_fixups * sizeof(uint64_t));
+
+    file::binary_data image(hdr_size + exec_size);
+    auto exec = image.data() + hdr_size;
+
+    for (auto i = 0LL; i < binaries_view.size(); i++) {
+        auto &binary = binaries_view.at(i);
+        const auto &module = modules_view.at(i);
+
+        binary.exec = exec + module.exec_offset;
+
+        ret = private_load_binary(&binary);
+        if (ret != BF_SUCCESS) {
+            throw std::runtime_error("private_load_binary failed: " + bfn::to_string(ret, 16));
+        }
+
+        // Every binary is relocated as if the exec was loaded at address
+        // 0, so that each relocated address is an offset into the exec
+
+        ret = bfelf_loader_add(
+                  loader.get(), &binary.ef, binary.exec,
+                  reinterpret_cast<char *>(module.exec_offset));
+        if (ret != BFELF_SUCCESS) {
+            throw std::runtime_error("bfelf_loader_add failed: " + bfn::to_string(ret, 16));
+        }
+    }
+
+    ret = bfelf_loader_relocate(loader.get());
+    if (ret != BFELF_SUCCESS) {
+        throw std::runtime_error("bfelf_loader_relocate failed: " + bfn::to_string(ret, 16));
+    }
+
+    std::vector<uint64_t> fixups;
+    fixups.reserve(num_fixups);
+
+    for (auto i = 0LL; i < binaries_view.size(); i++) {
+        auto &binary = binaries_view.at(i);
+        auto &module = modules_view.at(i);
+
+        auto dyn = gsl::make_span(
+                       binary.ef.relatab_dyn, static_cast<std::ptrdiff_t>(binary.ef.relanum_dyn));
+        auto plt = gsl::make_span(
+                       binary.ef.relatab_plt, static_cast<std::ptrdiff_t>(binary.ef.relanum_plt));
+
+        auto add_fixup = [&](const bfelf_rela & rela) {
+
+#if defined(BF_AARCH64)
+            auto type = BFELF_REL_TYPE(rela.r_info);
+            if (type == BFR_AARCH64_ABS32 || type == BFR_AARCH64_ABS16) {
+                throw std::runtime_error("prelinked images require 64bit relocations");
+            }
+#endif
+
+            fixups.push_back(module.exec_offset + rela.r_offset);
+        };
+
+        std::for_each(dyn.begin(), dyn.end(), add_fixup);
+        std::for_each(plt.begin(), plt.end(), add_fixup);
+
+        module.num_load_instr = static_cast<uint64_t>(bfelf_file_get_num_load_instrs(&binary.ef));
+
+        for (auto j = 0ULL; j < module.num_load_instr; j++) {
+            const bfelf_load_instr *instr = nullptr;
+
+            ret = bfelf_file_get_load_instr(&binary.ef, j, &instr);
+            bfignored(ret);
+
+            gsl::at(module.load_instr, static_cast<std::ptrdiff_t>(j)) = *instr;
+        }
+
+        ret = bfelf_file_get_section_info(&binary.ef, &module.section_info);
+        bfignored(ret);
+    }
+
+    void *entry = nullptr;
+    ret = bfelf_file_get_entry(&binaries_view.at(binaries_view.size() - 1).ef, &entry);
+    bfignored(ret);
+
+    bfelf_image_t hdr{};
+    hdr.magic = BFELF_IMAGE_MAGIC;
+    hdr.version = BFELF_IMAGE_VERSION;
+    hdr.key = bfelf_image_key(files);
+    hdr.entry = reinterpret_cast<uint64_t>(entry);
+    hdr.exec_size = exec_size;
+    hdr.num_modules = files.size();
+    hdr.num_fixups = fixups.size();
+
+    auto pos = image.data();
+    std::memcpy(pos, &hdr, sizeof(hdr));
+
+    pos += sizeof(hdr);
+    std::memcpy(pos, modules.get(), files.size() * sizeof(bfelf_image_module_t));
+
+    pos += files.size() * sizeof(bfelf_image_module_t);
+    std::memcpy(pos, fixups.data(), fixups.size() * sizeof(uint64_t));
+
+    return image;
+}
+
 /**
  * Binaries Info
  *
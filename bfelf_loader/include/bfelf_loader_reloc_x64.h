@@ -49,9 +49,9 @@ static inline int64_t
 private_relocate_symbol(
     struct bfelf_loader_t *loader, struct bfelf_file_t *ef, const struct bfelf_rela *rela)
 {
-    const char *str = nullptr;
+    int64_t ret = 0;
     const struct bfelf_sym *found_sym = nullptr;
-    struct bfelf_file_t *found_ef = ef;
+    struct bfelf_file_t *found_ef = nullptr;
     bfelf64_addr *ptr = bfrcast(bfelf64_addr *, ef->exec_addr + rela->r_offset - ef->start_addr);
 
     if (BFELF_REL_TYPE(rela->r_info) == BFR_X86_64_RELATIVE) {
@@ -59,20 +59,9 @@ private_relocate_symbol(
         return BFELF_SUCCESS;
     }
 
-    found_sym = &(ef->symtab[BFELF_REL_SYM(rela->r_info)]);
-
-    if (BFELF_SYM_BIND(found_sym->st_info) == bfstb_weak) {
-        found_ef = nullptr;
-    }
-
-    if (found_sym->st_value == 0 || found_ef == nullptr) {
-        int64_t ret = 0;
-        str = &(ef->strtab[found_sym->st_name]);
-
-        ret = private_get_sym_global(loader, str, &found_ef, &found_sym);
-        if (ret != BFELF_SUCCESS) {
-            return ret;
-        }
+    ret = private_resolve_symbol(loader, ef, BFELF_REL_SYM(rela->r_info), &found_ef, &found_sym);
+    if (ret != BFELF_SUCCESS) {
+        return ret;
     }
 
     *ptr = bfrcast(bfelf64_addr, found_ef->exec_virt + found_sym->st_value);
@@ -87,7 +76,7 @@ private_relocate_symbol(
             break;
 
         default:
-            return bfunsupported_rel(str);
+            return bfunsupported_rel(&(found_ef->strtab[found_sym->st_name]));
     }
 
     return BFELF_SUCCESS;
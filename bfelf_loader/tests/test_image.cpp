@@ -0,0 +1,149 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+
+#include <bfgsl.h>
+#include <bfplatform.h>
+
+#include <list>
+#include <test_real_elf.h>
+
+static auto
+build_image()
+{
+    std::list<bfn::buffer> datas;
+    std::vector<gsl::span<const char>> files;
+
+    for (const auto &filename : g_filenames) {
+        datas.emplace_back(g_file.read_binary(filename));
+        files.emplace_back(datas.back().data(), static_cast<std::ptrdiff_t>(datas.back().size()));
+    }
+
+    return std::make_pair(bfelf_image_build(files), bfelf_image_key(files));
+}
+
+TEST_CASE("bfelf_image_build: invalid file")
+{
+    char file[64] = {};
+    std::vector<gsl::span<const char>> files = {{static_cast<char *>(file), sizeof(file)}};
+
+    CHECK_THROWS(bfelf_image_build(files));
+}
+
+TEST_CASE("bfelf_image_get_key")
+{
+    auto [image, key] = build_image();
+
+    CHECK(bfelf_image_get_key({image.data(), static_cast<std::ptrdiff_t>(image.size())}) == key);
+    CHECK(bfelf_image_get_key({image.data(), 8}) == 0);
+}
+
+TEST_CASE("bfelf_file_is_image")
+{
+    auto [image, key] = build_image();
+    bfignored(key);
+
+    CHECK(bfelf_file_is_image(image.data(), image.size()) == 1);
+    CHECK(bfelf_file_is_image(nullptr, image.size()) == 0);
+    CHECK(bfelf_file_is_image(image.data(), 8) == 0);
+}
+
+TEST_CASE("bfelf_image_load: invalid args")
+{
+    char *exec = nullptr;
+    uint64_t exec_size = 0;
+    uint64_t num_binaries = 0;
+    bfelf_binary_t binaries[MAX_NUM_MODULES] = {};
+
+    auto [image, key] = build_image();
+    bfignored(key);
+
+    CHECK(bfelf_image_load(nullptr, image.size(), binaries, &num_binaries, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_ARG);
+    CHECK(bfelf_image_load(image.data(), image.size(), nullptr, &num_binaries, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_ARG);
+    CHECK(bfelf_image_load(image.data(), image.size(), binaries, nullptr, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_ARG);
+    CHECK(bfelf_image_load(image.data(), image.size(), binaries, &num_binaries, nullptr, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_ARG);
+    CHECK(bfelf_image_load(image.data(), image.size(), binaries, &num_binaries, &exec, nullptr, nullptr, nullptr) == BFELF_ERROR_INVALID_ARG);
+}
+
+TEST_CASE("bfelf_image_load: invalid image")
+{
+    char *exec = nullptr;
+    uint64_t exec_size = 0;
+    uint64_t num_binaries = 0;
+    bfelf_binary_t binaries[MAX_NUM_MODULES] = {};
+
+    auto [image, key] = build_image();
+    bfignored(key);
+
+    CHECK(bfelf_image_load(image.data(), 8, binaries, &num_binaries, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_FILE);
+    CHECK(bfelf_image_load(image.data(), image.size() - 1, binaries, &num_binaries, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_FILE);
+
+    auto hdr = reinterpret_cast<bfelf_image_t *>(image.data());
+
+    hdr->version++;
+    CHECK(bfelf_image_load(image.data(), image.size(), binaries, &num_binaries, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_FILE);
+    hdr->version--;
+
+    hdr->entry = hdr->exec_size;
+    CHECK(bfelf_image_load(image.data(), image.size(), binaries, &num_binaries, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_INVALID_FILE);
+}
+
+TEST_CASE("bfelf_image_load: out of memory")
+{
+    char *exec = nullptr;
+    uint64_t exec_size = 0;
+    uint64_t num_binaries = 0;
+    bfelf_binary_t binaries[MAX_NUM_MODULES] = {};
+
+    auto [image, key] = build_image();
+    bfignored(key);
+
+    out_of_memory = true;
+    auto ___ = gsl::finally([&] {
+        out_of_memory = false;
+    });
+
+    CHECK(bfelf_image_load(image.data(), image.size(), binaries, &num_binaries, &exec, &exec_size, nullptr, nullptr) == BFELF_ERROR_OUT_OF_MEMORY);
+}
+
+TEST_CASE("bfelf_image_load: success")
+{
+    char *exec = nullptr;
+    void *entry = nullptr;
+    uint64_t exec_size = 0;
+    uint64_t num_binaries = 0;
+    crt_info_t info = {};
+    bfelf_binary_t binaries[MAX_NUM_MODULES] = {};
+
+    auto [image, key] = build_image();
+    bfignored(key);
+
+    auto ret = bfelf_image_load(image.data(), image.size(), binaries, &num_binaries, &exec, &exec_size, &entry, &info);
+    CHECK(ret == BF_SUCCESS);
+
+    CHECK(num_binaries == g_filenames.size());
+    CHECK(info.info_num == static_cast<int>(g_filenames.size()));
+    CHECK(entry >= exec);
+    CHECK(entry < exec + exec_size);
+
+    platform_free_rwe(exec, exec_size);
+}
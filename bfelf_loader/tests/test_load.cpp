@@ -186,3 +186,39 @@ TEST_CASE("bfelf_load: success")
     auto ret = bfelf_load(reinterpret_cast<bfelf_binary_t *>(binaries), 10, &entry, &info, &loader);
     CHECK(ret == BF_SUCCESS);
 }
+
+TEST_CASE("bfelf_load_binary: invalid binary")
+{
+    CHECK(bfelf_load_binary(nullptr) == BFELF_ERROR_INVALID_ARG);
+}
+
+TEST_CASE("bfelf_load_binary: invalid file")
+{
+    bfelf_binary_t binary = {};
+    CHECK(bfelf_load_binary(&binary) == BFELF_ERROR_INVALID_ARG);
+}
+
+TEST_CASE("bfelf_load_binary: success")
+{
+    void *entry = nullptr;
+    crt_info_t info = {};
+    bfelf_loader_t loader = {};
+    bfelf_binary_t binaries[10] = {};
+
+    for (auto i = 0ULL; i < 10; i++) {
+        auto file = g_file.read_binary(g_filenames.at(i));
+        auto &binary = gsl::at(binaries, static_cast<std::ptrdiff_t>(i));
+
+        binary.file = file.data();
+        binary.file_size = file.size();
+
+        REQUIRE(bfelf_load_binary(&binary) == BF_SUCCESS);
+
+        CHECK(binary.file == nullptr);
+        CHECK(binary.file_size == 0);
+        CHECK(binary.exec != nullptr);
+    }
+
+    auto ret = bfelf_load(reinterpret_cast<bfelf_binary_t *>(binaries), 10, &entry, &info, &loader);
+    CHECK(ret == BF_SUCCESS);
+}
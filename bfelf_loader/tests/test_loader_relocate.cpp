@@ -22,6 +22,8 @@
 #include <catch/catch.hpp>
 #include <test_real_elf.h>
 
+#include <array>
+
 TEST_CASE("bfelf_loader_relocate: invalid loader")
 {
     auto ret = bfelf_loader_relocate(nullptr);
@@ -50,8 +52,164 @@ TEST_CASE("bfelf_loader_relocate: twice")
     CHECK(ret == BFELF_SUCCESS);
 }
 
+#ifdef BF_X64
+
+// The following tests relocate a hand-built ELF file so that the values
+// written by each relocation can be checked. Symbol 1 ("foo") is a global
+// symbol defined by the file itself at offset 0x40.
+
+struct relocate_test_file {
+    std::array<bfelf64_addr, 4> image{};
+    std::array<char, 0x100> virt{};
+
+    std::array<bfelf_sym, 2> symtab{};
+    const char *strtab{"\0foo"};
+
+    std::array<bfelf_rela, 4> relatab{};
+
+    bfelf_file_t ef{};
+    bfelf_loader_t loader{};
+
+    relocate_test_file()
+    {
+        symtab[1].st_name = 1;
+        symtab[1].st_info = bfstb_global << 4;
+        symtab[1].st_value = 0x40;
+
+        ef.exec_addr = reinterpret_cast<char *>(image.data());
+        ef.exec_virt = virt.data();
+        ef.symtab = symtab.data();
+        ef.strtab = strtab;
+        ef.relatab_dyn = relatab.data();
+    }
+
+    auto virt_addr(bfelf64_addr offset) const
+    { return reinterpret_cast<bfelf64_addr>(virt.data()) + offset; }
+};
+
+static auto
+rela(bfelf64_addr offset, bfelf64_xword sym, bfelf64_xword type, bfelf64_sxword addend)
+{ return bfelf_rela{offset, (sym << 32) | type, addend}; }
+
+TEST_CASE("bfelf_loader_relocate: relative relocations under relacount")
+{
+    relocate_test_file file;
+
+    // Relocations counted by DT_RELACOUNT are applied without decoding their
+    // type, so a type that is not supported must still be applied as
+    // relative.
+
+    file.relatab[0] = rela(0x00, 0, 0xFFFF, 0x10);
+    file.relatab[1] = rela(0x08, 0, 0xFFFF, 0x20);
+    file.relatab[2] = rela(0x10, 0, BFR_X86_64_RELATIVE, 0x30);
+
+    file.ef.relacount = 2;
+    file.ef.relanum_dyn = 3;
+
+    CHECK(private_relocate_symbols(&file.loader, &file.ef) == BFELF_SUCCESS);
+    CHECK(file.image[0] == file.virt_addr(0x10));
+    CHECK(file.image[1] == file.virt_addr(0x20));
+    CHECK(file.image[2] == file.virt_addr(0x30));
+    CHECK(file.image[3] == 0);
+}
+
+TEST_CASE("bfelf_loader_relocate: symbol relocations after relacount")
+{
+    relocate_test_file file;
+
+    file.relatab[0] = rela(0x00, 0, BFR_X86_64_RELATIVE, 0x10);
+    file.relatab[1] = rela(0x08, 1, BFR_X86_64_64, 0x4);
+    file.relatab[2] = rela(0x10, 1, BFR_X86_64_GLOB_DAT, 0);
+    file.relatab[3] = rela(0x18, 1, BFR_X86_64_JUMP_SLOT, 0);
+
+    file.ef.relacount = 1;
+    file.ef.relanum_dyn = 3;
+    file.ef.relatab_plt = &file.relatab[3];
+    file.ef.relanum_plt = 1;
+
+    CHECK(private_relocate_symbols(&file.loader, &file.ef) == BFELF_SUCCESS);
+    CHECK(file.image[0] == file.virt_addr(0x10));
+    CHECK(file.image[1] == file.virt_addr(0x44));
+    CHECK(file.image[2] == file.virt_addr(0x40));
+    CHECK(file.image[3] == file.virt_addr(0x40));
+
+    auto &entry = file.loader.sym_cache[1];
+    CHECK(entry.index == 1);
+    CHECK(entry.ef == &file.ef);
+    CHECK(entry.sym == &file.symtab[1]);
+}
+
+TEST_CASE("bfelf_loader_relocate: cached symbol hit")
+{
+    relocate_test_file file;
+
+    bfelf_file_t *found_ef = nullptr;
+    const bfelf_sym *found_sym = nullptr;
+
+    auto ret = private_resolve_symbol(&file.loader, &file.ef, 1, &found_ef, &found_sym);
+    CHECK(ret == BFELF_SUCCESS);
+    CHECK(found_ef == &file.ef);
+    CHECK(found_sym == &file.symtab[1]);
+
+    // Once cached, the symbol is not looked up again. Without the cache, an
+    // undefined symbol would need a global search, which fails as the loader
+    // has no files.
+
+    std::array<bfelf_sym, 2> undefined{};
+    file.ef.symtab = undefined.data();
+
+    found_ef = nullptr;
+    found_sym = nullptr;
+
+    ret = private_resolve_symbol(&file.loader, &file.ef, 1, &found_ef, &found_sym);
+    CHECK(ret == BFELF_SUCCESS);
+    CHECK(found_ef == &file.ef);
+    CHECK(found_sym == &file.symtab[1]);
+
+    // A relocation pass starts with an empty cache, so the lookup is done
+    // again and fails.
+
+    file.relatab[0] = rela(0x00, 1, BFR_X86_64_GLOB_DAT, 0);
+    file.ef.relanum_dyn = 1;
+
+    CHECK(private_relocate_symbols(&file.loader, &file.ef) == BFELF_ERROR_NO_SUCH_SYMBOL);
+}
+
+#endif
+
 #ifndef WIN64
 
+TEST_CASE("bfelf_loader_relocate: relacount larger than relanum")
+{
+    int64_t ret = 0;
+    binaries_info binaries{&g_file, g_filenames};
+
+    binaries.loader().relocated = 0;
+
+    for (auto i = 0ULL; i < binaries.loader().num; i++) {
+        binaries.ef(i).relacount = binaries.ef(i).relanum_dyn + 1;
+    }
+
+    ret = bfelf_loader_relocate(&binaries.loader());
+    CHECK(ret == BFELF_SUCCESS);
+}
+
+TEST_CASE("bfelf_loader_relocate: relative relocations only")
+{
+    int64_t ret = 0;
+    binaries_info binaries{&g_file, g_filenames};
+
+    binaries.loader().relocated = 0;
+
+    for (auto i = 0ULL; i < binaries.loader().num; i++) {
+        binaries.ef(i).relanum_plt = 0;
+        binaries.ef(i).relanum_dyn = binaries.ef(i).relacount;
+    }
+
+    ret = bfelf_loader_relocate(&binaries.loader());
+    CHECK(ret == BFELF_SUCCESS);
+}
+
 TEST_CASE("bfelf_loader_relocate: no such symbol")
 {
     int64_t ret = 0;
@@ -126,6 +126,31 @@ public:
     ///
     virtual vcpuid_type vcpuid() const noexcept;
 
+    /// Follow
+    ///
+    /// If the command provided by the arguments is "dump", and --follow
+    /// was provided, the debug ring is output continuously instead of once.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns true if the user asked to follow the debug ring
+    ///
+    virtual bool follow() const noexcept;
+
+    /// Cache
+    ///
+    /// If --cache was provided, the VMM modules are prelinked into a single
+    /// image that is stored in (and on future loads, read from) this
+    /// directory. Returns an empty string if --cache was not provided.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns the image cache directory provided by the user
+    ///
+    virtual const filename_type &cache() const noexcept;
+
 private:
 
     void reset() noexcept;
@@ -143,6 +168,8 @@ private:
     command_type m_cmd{};
     filename_type m_modules{};
     vcpuid_type m_vcpuid{};
+    bool m_follow{};
+    filename_type m_cache{};
 };
 
 #ifdef _MSC_VER
@@ -65,6 +65,7 @@ class ioctl
 public:
 
     using binary_data = file::binary_data;          ///< Binary data type
+    using mapped_data = file::mapped_data;          ///< Mapped data type
     using drr_type = debug_ring_resources_t;        ///< Debug ring resources type
     using drr_pointer = drr_type *;                 ///< Debug ring resources pointer type
     using vcpuid_type = uint64_t;                   ///< VCPUID type
@@ -96,14 +97,16 @@ public:
 
     /// Add Module
     ///
-    /// Add a module to the driver entry.
+    /// Add a module to the driver entry. The driver loads the module
+    /// straight out of module_data, so module_data only has to stay
+    /// valid for the duration of this call.
     ///
     /// @param module_data ELF file to be added to the driver entry
     ///
     /// @expects none
     /// @ensures none
     ///
-    virtual void call_ioctl_add_module(const binary_data &module_data);
+    virtual void call_ioctl_add_module(const mapped_data &module_data);
 
     /// Load VMM
     ///
@@ -153,6 +156,33 @@ public:
     ///
     virtual void call_ioctl_dump_vmm(gsl::not_null<drr_pointer> drr, vcpuid_type vcpuid);
 
+    /// Map Debug Ring
+    ///
+    /// Maps the VMM's debug ring into bfm (read-only). Unlike
+    /// call_ioctl_dump_vmm(), which copies the entire debug ring on each
+    /// call, the mapping always reflects the current state of the debug
+    /// ring, and remains valid (even if the VMM is unloaded) until bfm exits.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param vcpuid indicates which drr to map (every vcpu has its own drr)
+    /// @return a pointer to the mapped debug ring
+    ///
+    virtual const drr_type *map_drr(vcpuid_type vcpuid);
+
+    /// Wait Debug Ring
+    ///
+    /// Waits for the VMM to write to the debug ring mapped by map_drr()
+    ///
+    /// @expects map_drr() has been called
+    /// @ensures none
+    ///
+    /// @param timeout_ms how long to wait (in milliseconds)
+    /// @return true if the VMM wrote to the debug ring, false on timeout
+    ///
+    virtual bool wait_drr(int timeout_ms);
+
     /// VMM Status
     ///
     /// Get the status of the VMM
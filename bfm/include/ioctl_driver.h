@@ -51,6 +51,12 @@ public:
     using status_type = ioctl::status_type;                         ///< Status type
     using filename_type = std::string;                              ///< Filename type
     using list_type = std::vector<std::string>;                     ///< List type
+    using mapped_data = ioctl::mapped_data;                         ///< Mapped data type
+
+    /// How long dump --follow waits for the debug ring before checking
+    /// if the VMM is still loaded (in milliseconds)
+    ///
+    static constexpr const int follow_timeout_ms = 1000;
 
     /// Default Constructor
     ///
@@ -90,11 +96,13 @@ private:
 #endif
 
     void load_vmm();
+    void add_vmm_image(const list_type &module_list);
     void unload_vmm();
     void start_vmm();
     void stop_vmm();
     void quick_vmm();
     void dump_vmm();
+    void follow_vmm();
     void vmm_status();
 
     status_type get_status() const;
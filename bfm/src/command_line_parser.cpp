@@ -63,6 +63,21 @@ command_line_parser::parse(const arg_list_type &args)
             continue;
         }
 
+        if (*arg == "--cache") {
+
+            if (++arg == args.end()) {
+                break;
+            }
+
+            m_cache = *arg;
+            continue;
+        }
+
+        if (*arg == "-f" || *arg == "--follow") {
+            m_follow = true;
+            continue;
+        }
+
         if (*arg == "-h" || *arg == "--help") {
             return reset();
         }
@@ -106,12 +121,22 @@ command_line_parser::vcpuid_type
 command_line_parser::vcpuid() const noexcept
 { return m_vcpuid; }
 
+bool
+command_line_parser::follow() const noexcept
+{ return m_follow; }
+
+const command_line_parser::filename_type &
+command_line_parser::cache() const noexcept
+{ return m_cache; }
+
 void
 command_line_parser::reset() noexcept
 {
     m_cmd = command_type::help;
     m_modules.clear();
     m_vcpuid = vcpuid::invalid;
+    m_follow = false;
+    m_cache.clear();
 }
 
 void
@@ -85,13 +85,51 @@ ioctl_driver::load_vmm()
         unload_vmm();
     });
 
-    for (const auto &module : module_list) {
-        m_ioctl->call_ioctl_add_module(m_file->read_binary(module));
+    if (m_clp->cache().empty()) {
+        for (const auto &module : module_list) {
+            m_ioctl->call_ioctl_add_module(m_file->map_binary(module));
+        }
+    }
+    else {
+        add_vmm_image(module_list);
     }
 
     m_ioctl->call_ioctl_load_vmm();
 }
 
+void
+ioctl_driver::add_vmm_image(const list_type &module_list)
+{
+    std::vector<mapped_data> modules;
+    std::vector<gsl::span<const char>> files;
+
+    for (const auto &module : module_list) {
+        modules.push_back(m_file->map_binary(module));
+        files.emplace_back(
+            modules.back().data(), static_cast<std::ptrdiff_t>(modules.back().size()));
+    }
+
+    // The image is named after its key, so that images built from different
+    // VMMs can live in the same cache. The key is also stored in the image
+    // itself which is checked here in case the cache was tampered with.
+
+    auto key = bfelf_image_key(files);
+    auto filename = m_clp->cache() + "/" + bfn::to_string(key, 16) + ".bfimage";
+
+    if (m_file->exists(filename)) {
+        auto image = m_file->map_binary(filename);
+        auto image_span = gsl::span<const char>(
+                              image.data(), static_cast<std::ptrdiff_t>(image.size()));
+
+        if (bfelf_image_get_key(image_span) == key) {
+            return m_ioctl->call_ioctl_add_module(image);
+        }
+    }
+
+    m_file->write_binary(filename, bfelf_image_build(files));
+    m_ioctl->call_ioctl_add_module(m_file->map_binary(filename));
+}
+
 void
 ioctl_driver::unload_vmm()
 {
@@ -155,6 +193,10 @@ ioctl_driver::dump_vmm()
         default: throw std::runtime_error("unknown status");
     }
 
+    if (m_clp->follow()) {
+        return this->follow_vmm();
+    }
+
     m_ioctl->call_ioctl_dump_vmm(&drr, m_clp->vcpuid());
 
     if (debug_ring_read(&drr, buffer.get(), DEBUG_RING_SIZE) > 0) {
@@ -164,6 +206,32 @@ ioctl_driver::dump_vmm()
     std::cout << '\n';
 }
 
+void
+ioctl_driver::follow_vmm()
+{
+    uint64_t cursor = 0;
+
+    auto drr = m_ioctl->map_drr(m_clp->vcpuid());
+    auto buffer = std::make_unique<char[]>(DEBUG_RING_SIZE);
+
+    // Only what the VMM wrote since the last read is copied out of the
+    // debug ring, and while the debug ring is idle, we sleep in the driver.
+    // The mapping outlives the VMM, so we keep going until the VMM is
+    // unloaded, and the debug ring has been drained.
+
+    while (true) {
+        if (debug_ring_read_from(drr, &cursor, buffer.get(), DEBUG_RING_SIZE) > 0) {
+            std::cout << buffer.get() << std::flush;
+        }
+
+        if (!m_ioctl->wait_drr(follow_timeout_ms) && get_status() == VMM_UNLOADED) {
+            break;
+        }
+    }
+
+    std::cout << '\n';
+}
+
 void
 ioctl_driver::vmm_status()
 {
@@ -224,7 +292,13 @@ ioctl_driver::vmm_module_list(const filename_type &filename)
         module_list = bfelf_read_binary_and_get_needed_list(
                           m_file, filename, library_path(), buffer, binary);
 
-        bfn::shuffle(module_list);
+        // The image cache is keyed on the module order, so the modules are
+        // only shuffled when they are loaded one at a time.
+
+        if (m_clp->cache().empty()) {
+            bfn::shuffle(module_list);
+        }
+
         module_list.push_back(filename);
     }
 
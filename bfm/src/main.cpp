@@ -91,6 +91,8 @@ bfm_help()
     std::cout << std::endl;
     std::cout << R"(       -h, --help      show this help menu)" << std::endl;
     std::cout << R"(           --vcpuid    indicate the requested vcpuid)" << std::endl;
+    std::cout << R"(       -f, --follow    output the debug ring as it grows (dump))" << std::endl;
+    std::cout << R"(           --cache     prelinked image directory (load/quick))" << std::endl;
 }
 
 int
@@ -0,0 +1,75 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// TIDY_EXCLUSION=-cppcoreguidelines-no-malloc
+//
+// Reason:
+//     These functions implement the C platform interface that is needed by
+//     the ELF loader, and as such, need to use the C allocator.
+//
+
+#include <cstdlib>
+#include <cstring>
+
+#include <bftypes.h>
+#include <bferrorcodes.h>
+#include <bfplatform.h>
+
+// -----------------------------------------------------------------------------
+// Platform
+// -----------------------------------------------------------------------------
+
+// The ELF loader is only used by the BFM to build prelinked images (see
+// bfelf_image_build). The images that are loaded while building an image are
+// never executed by the BFM, so normal heap memory is used instead of RWE
+// memory.
+
+extern "C" void *
+platform_alloc_rwe(uint64_t len)
+{ return malloc(len); }
+
+extern "C" void
+platform_free_rwe(void *addr, uint64_t len)
+{
+    bfignored(len);
+    free(addr);
+}
+
+extern "C" void *
+platform_memset(void *ptr, char value, uint64_t num)
+{ return memset(ptr, value, num); }
+
+extern "C" int64_t
+platform_memcpy(
+    void *dst, uint64_t dst_size, const void *src, uint64_t src_size, uint64_t num)
+{
+    if (dst == nullptr || src == nullptr) {
+        return FAILURE;
+    }
+
+    if (num > dst_size || num > src_size) {
+        return FAILURE;
+    }
+
+    memcpy(dst, src, num);
+    return SUCCESS;
+}
@@ -31,8 +31,12 @@
 #include <bfgsl.h>
 #include <bfdriverinterface.h>
 
+#include <cerrno>
+
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/ioctl.h>
 
 // -----------------------------------------------------------------------------
@@ -74,6 +78,10 @@ ioctl_private::ioctl_private() :
 
 ioctl_private::~ioctl_private()
 {
+    if (m_drr != nullptr) {
+        munmap(m_drr, sizeof(drr_type));
+    }
+
     if (fd >= 0) {
         close(fd);
     }
@@ -149,6 +157,43 @@ ioctl_private::call_ioctl_dump_vmm(gsl::not_null<drr_pointer> drr, vcpuid_type v
     }
 }
 
+const ioctl_private::drr_type *
+ioctl_private::map_drr(vcpuid_type vcpuid)
+{
+    if (bfm_write_ioctl(fd, IOCTL_SET_VCPUID, &vcpuid) < 0) {
+        throw std::runtime_error("ioctl failed: IOCTL_SET_VCPUID");
+    }
+
+    auto drr = mmap(nullptr, sizeof(drr_type), PROT_READ, MAP_SHARED, fd, 0);
+    if (drr == MAP_FAILED) {
+        throw std::runtime_error("mmap failed: debug ring");
+    }
+
+    m_drr = drr;
+    return static_cast<const drr_type *>(m_drr);
+}
+
+bool
+ioctl_private::wait_drr(int timeout_ms)
+{
+    pollfd pfd{fd, POLLIN, 0};
+
+    auto ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) {
+        if (errno == EINTR) {
+            return false;
+        }
+
+        throw std::runtime_error("poll failed: debug ring");
+    }
+
+    if ((pfd.revents & POLLERR) != 0) {
+        throw std::runtime_error("poll failed: debug ring not mapped");
+    }
+
+    return ret > 0;
+}
+
 void
 ioctl_private::call_ioctl_vmm_status(gsl::not_null<status_pointer> status)
 {
@@ -34,7 +34,7 @@ ioctl::open()
 }
 
 void
-ioctl::call_ioctl_add_module(const binary_data &module_data)
+ioctl::call_ioctl_add_module(const mapped_data &module_data)
 {
     auto d = static_cast<ioctl_private *>(m_d.get());
     d->call_ioctl_add_module(module_data.data(), module_data.size());
@@ -75,6 +75,20 @@ ioctl::call_ioctl_dump_vmm(gsl::not_null<drr_pointer> drr, vcpuid_type vcpuid)
     d->call_ioctl_dump_vmm(drr, vcpuid);
 }
 
+const ioctl::drr_type *
+ioctl::map_drr(vcpuid_type vcpuid)
+{
+    auto d = static_cast<ioctl_private *>(m_d.get());
+    return d->map_drr(vcpuid);
+}
+
+bool
+ioctl::wait_drr(int timeout_ms)
+{
+    auto d = static_cast<ioctl_private *>(m_d.get());
+    return d->wait_drr(timeout_ms);
+}
+
 void
 ioctl::call_ioctl_vmm_status(gsl::not_null<status_pointer> status)
 {
@@ -217,6 +217,32 @@ ioctl_private::call_ioctl_dump_vmm(gsl::not_null<drr_pointer> drr, vcpuid_type v
     }
 }
 
+// The Windows driver does not support mapping the debug ring, so instead, a
+// copy of the debug ring is refreshed using IOCTL_DUMP_VMM.
+
+const ioctl_private::drr_type *
+ioctl_private::map_drr(vcpuid_type vcpuid)
+{
+    m_vcpuid = vcpuid;
+    m_drr = std::make_unique<drr_type>();
+
+    call_ioctl_dump_vmm(m_drr.get(), m_vcpuid);
+    return m_drr.get();
+}
+
+bool
+ioctl_private::wait_drr(int timeout_ms)
+{
+    expects(m_drr);
+
+    auto epos = m_drr->epos;
+
+    Sleep(gsl::narrow_cast<DWORD>(timeout_ms));
+    call_ioctl_dump_vmm(m_drr.get(), m_vcpuid);
+
+    return m_drr->epos != epos;
+}
+
 void
 ioctl_private::call_ioctl_vmm_status(gsl::not_null<status_pointer> status)
 {
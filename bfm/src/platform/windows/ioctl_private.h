@@ -40,6 +40,7 @@ public:
 
     using module_len_type = size_t;
     using module_data_type = const char *;
+    using drr_type = ioctl::drr_type;
     using drr_pointer = ioctl::drr_pointer;
     using vcpuid_type = ioctl::vcpuid_type;
     using status_pointer = ioctl::status_pointer;
@@ -55,10 +56,15 @@ public:
     virtual void call_ioctl_start_vmm();
     virtual void call_ioctl_stop_vmm();
     virtual void call_ioctl_dump_vmm(gsl::not_null<drr_pointer> drr, vcpuid_type vcpuid);
+    virtual const drr_type *map_drr(vcpuid_type vcpuid);
+    virtual bool wait_drr(int timeout_ms);
     virtual void call_ioctl_vmm_status(gsl::not_null<status_pointer> status);
 
 private:
     HANDLE fd;
+
+    vcpuid_type m_vcpuid{};
+    std::unique_ptr<drr_type> m_drr;
 };
 
 #ifdef _MSC_VER
@@ -190,6 +190,47 @@ TEST_CASE("test command line parser with valid dump")
     CHECK(clp.vcpuid() == vcpuid::invalid);
 }
 
+TEST_CASE("test command line parser with valid dump follow")
+{
+    auto args = {"dump"_s, "--follow"_s};
+    command_line_parser clp{};
+
+    CHECK_NOTHROW(clp.parse(args));
+    CHECK(clp.cmd() == command_line_parser::command_type::dump);
+    CHECK(clp.follow());
+}
+
+TEST_CASE("test command line parser with valid dump follow short")
+{
+    auto args = {"-f"_s, "dump"_s};
+    command_line_parser clp{};
+
+    CHECK_NOTHROW(clp.parse(args));
+    CHECK(clp.cmd() == command_line_parser::command_type::dump);
+    CHECK(clp.follow());
+}
+
+TEST_CASE("test command line parser with missing cache directory")
+{
+    auto args = {"load"_s, "test"_s, "--cache"_s};
+    command_line_parser clp{};
+
+    CHECK_NOTHROW(clp.parse(args));
+    CHECK(clp.cmd() == command_line_parser::command_type::load);
+    CHECK(clp.cache().empty());
+}
+
+TEST_CASE("test command line parser with valid load cache")
+{
+    auto args = {"--cache"_s, "/tmp"_s, "load"_s, "test"_s};
+    command_line_parser clp{};
+
+    CHECK_NOTHROW(clp.parse(args));
+    CHECK(clp.cmd() == command_line_parser::command_type::load);
+    CHECK(clp.modules() == "test");
+    CHECK(clp.cache() == "/tmp");
+}
+
 TEST_CASE("test command line parser with valid status")
 {
     auto args = {"status"_s};
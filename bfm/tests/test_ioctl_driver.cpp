@@ -37,8 +37,8 @@ setup_file(MockRepository &mocks)
     mocks.OnCall(fil, file::extension).Return(".modules"_s);
     mocks.OnCall(fil, file::exists).Return(true);
 
-    mocks.OnCall(fil, file::read_binary).Do([&](auto) {
-        return file::binary_data{};
+    mocks.OnCall(fil, file::map_binary).Do([&](auto) {
+        return file::mapped_data{};
     });
 
     return fil;
@@ -74,6 +74,8 @@ setup_command_line_parser(MockRepository &mocks, clpc type)
     mocks.OnCall(clp, command_line_parser::cmd).Return(type);
     mocks.OnCall(clp, command_line_parser::modules).Return(std::string{"test"});
     mocks.OnCall(clp, command_line_parser::vcpuid).Return(0);
+    mocks.OnCall(clp, command_line_parser::follow).Return(false);
+    mocks.OnCall(clp, command_line_parser::cache).Return(std::string{});
 
     return clp;
 }
@@ -450,6 +452,87 @@ TEST_CASE("test ioctl driver process load success")
     CHECK_NOTHROW(driver.process());
 }
 
+TEST_CASE("test ioctl driver process load cached image")
+{
+    MockRepository mocks;
+
+    auto fil = setup_file(mocks);
+    auto ctl = setup_ioctl(mocks, VMM_UNLOADED);
+    auto clp = setup_command_line_parser(mocks, clpc::load);
+
+    mocks.OnCall(fil, file::read_text).Return(
+        R"({"test":"test.bin"})"
+    );
+
+    mocks.OnCall(clp, command_line_parser::cache).Return(std::string{"cache"});
+    mocks.OnCallFunc(bfelf_image_key).Return(42);
+    mocks.OnCallFunc(bfelf_image_get_key).Return(42);
+
+    mocks.NeverCallFunc(bfelf_image_build);
+    mocks.NeverCall(fil, file::write_binary);
+    mocks.ExpectCall(ctl, ioctl::call_ioctl_add_module);
+    mocks.ExpectCall(ctl, ioctl::call_ioctl_load_vmm);
+
+    auto driver = ioctl_driver(fil, ctl, clp);
+    CHECK_NOTHROW(driver.process());
+}
+
+TEST_CASE("test ioctl driver process load stale image")
+{
+    MockRepository mocks;
+
+    auto fil = setup_file(mocks);
+    auto ctl = setup_ioctl(mocks, VMM_UNLOADED);
+    auto clp = setup_command_line_parser(mocks, clpc::load);
+
+    mocks.OnCall(fil, file::read_text).Return(
+        R"({"test":"test.bin"})"
+    );
+
+    mocks.OnCall(clp, command_line_parser::cache).Return(std::string{"cache"});
+    mocks.OnCallFunc(bfelf_image_key).Return(42);
+    mocks.OnCallFunc(bfelf_image_get_key).Return(0);
+
+    mocks.ExpectCallFunc(bfelf_image_build).Do([&](auto) {
+        return file::binary_data{};
+    });
+
+    mocks.ExpectCall(fil, file::write_binary);
+    mocks.ExpectCall(ctl, ioctl::call_ioctl_add_module);
+    mocks.ExpectCall(ctl, ioctl::call_ioctl_load_vmm);
+
+    auto driver = ioctl_driver(fil, ctl, clp);
+    CHECK_NOTHROW(driver.process());
+}
+
+TEST_CASE("test ioctl driver process load uncached image")
+{
+    MockRepository mocks;
+
+    auto fil = setup_file(mocks);
+    auto ctl = setup_ioctl(mocks, VMM_UNLOADED);
+    auto clp = setup_command_line_parser(mocks, clpc::load);
+
+    mocks.OnCall(fil, file::read_text).Return(
+        R"({"test":"test.bin"})"
+    );
+
+    mocks.OnCall(fil, file::exists).Return(false);
+    mocks.OnCall(clp, command_line_parser::cache).Return(std::string{"cache"});
+    mocks.OnCallFunc(bfelf_image_key).Return(42);
+
+    mocks.ExpectCallFunc(bfelf_image_build).Do([&](auto) {
+        return file::binary_data{};
+    });
+
+    mocks.ExpectCall(fil, file::write_binary);
+    mocks.ExpectCall(ctl, ioctl::call_ioctl_add_module);
+    mocks.ExpectCall(ctl, ioctl::call_ioctl_load_vmm);
+
+    auto driver = ioctl_driver(fil, ctl, clp);
+    CHECK_NOTHROW(driver.process());
+}
+
 TEST_CASE("test ioctl driver process unload vmm running")
 {
     MockRepository mocks;
@@ -838,6 +921,59 @@ TEST_CASE("test ioctl driver process dump success loaded")
     CHECK_NOTHROW(driver.process());
 }
 
+TEST_CASE("test ioctl driver process dump follow")
+{
+    MockRepository mocks;
+
+    auto fil = setup_file(mocks);
+    auto ctl = setup_ioctl(mocks, VMM_RUNNING);
+    auto clp = setup_command_line_parser(mocks, clpc::dump);
+
+    auto drr = ioctl::drr_type{};
+    drr.spos = 0;
+    drr.epos = 3;
+    drr.buf[0] = 'h';
+    drr.buf[1] = 'i';
+    drr.buf[2] = '\n';
+
+    mocks.OnCall(clp, command_line_parser::follow).Return(true);
+    mocks.NeverCall(ctl, ioctl::call_ioctl_dump_vmm);
+    mocks.OnCall(ctl, ioctl::map_drr).Return(&drr);
+
+    // The VMM writes once more, and is then unloaded
+
+    auto waits = 0;
+    mocks.OnCall(ctl, ioctl::wait_drr).Do([&](auto) {
+        if (waits++ == 0) {
+            drr.buf[3] = '!';
+            drr.epos = 4;
+            return true;
+        }
+
+        g_status = VMM_UNLOADED;
+        return false;
+    });
+
+    auto driver = ioctl_driver(fil, ctl, clp);
+    CHECK_NOTHROW(driver.process());
+    CHECK(waits == 2);
+}
+
+TEST_CASE("test ioctl driver process dump follow map failed")
+{
+    MockRepository mocks;
+
+    auto fil = setup_file(mocks);
+    auto ctl = setup_ioctl(mocks, VMM_LOADED);
+    auto clp = setup_command_line_parser(mocks, clpc::dump);
+
+    mocks.OnCall(clp, command_line_parser::follow).Return(true);
+    mocks.OnCall(ctl, ioctl::map_drr).Throw(std::runtime_error("error"));
+
+    auto driver = ioctl_driver(fil, ctl, clp);
+    CHECK_THROWS(driver.process());
+}
+
 TEST_CASE("test ioctl driver process vmm status running")
 {
     MockRepository mocks;
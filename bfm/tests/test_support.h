@@ -43,7 +43,7 @@ ioctl::open()
 { }
 
 void
-ioctl::call_ioctl_add_module(const binary_data &module_data)
+ioctl::call_ioctl_add_module(const mapped_data &module_data)
 {
     bfignored(module_data);
 }
@@ -71,6 +71,20 @@ ioctl::call_ioctl_dump_vmm(gsl::not_null<drr_pointer> drr, vcpuid_type vcpuid)
     bfignored(vcpuid);
 }
 
+const ioctl::drr_type *
+ioctl::map_drr(vcpuid_type vcpuid)
+{
+    bfignored(vcpuid);
+    return nullptr;
+}
+
+bool
+ioctl::wait_drr(int timeout_ms)
+{
+    bfignored(timeout_ms);
+    return false;
+}
+
 void
 ioctl::call_ioctl_vmm_status(gsl::not_null<status_pointer> status)
 {
@@ -82,7 +96,7 @@ TEST_CASE("support")
     ioctl ctl{};
     int64_t status;
     auto drr = ioctl::drr_type{};
-    auto data = ioctl::binary_data{};
+    auto data = ioctl::mapped_data{};
 
     CHECK_NOTHROW(ctl.call_ioctl_add_module(data));
     CHECK_NOTHROW(ctl.call_ioctl_load_vmm());
@@ -90,6 +104,8 @@ TEST_CASE("support")
     CHECK_NOTHROW(ctl.call_ioctl_start_vmm());
     CHECK_NOTHROW(ctl.call_ioctl_stop_vmm());
     CHECK_NOTHROW(ctl.call_ioctl_dump_vmm(&drr, 0));
+    CHECK_NOTHROW(ctl.map_drr(0));
+    CHECK_NOTHROW(ctl.wait_drr(0));
     CHECK_NOTHROW(ctl.call_ioctl_vmm_status(&status));
 }
 
@@ -51,10 +51,17 @@
 #include <bfgsl.h>
 #include <bfdebug.h>
 #include <bfexports.h>
+#include <bfticketlock.h>
 #include <bfthreadcontext.h>
 
 #define MAX_THREAD_SPECIFIC_DATA 512
 
+static_assert(sizeof(pthread_mutex_t) == sizeof(uint32_t));
+
+static inline uint32_t *
+mutex_word(pthread_mutex_t *__mutex)
+{ return reinterpret_cast<uint32_t *>(__mutex); }
+
 extern "C" int
 pthread_cond_broadcast(pthread_cond_t *__cond)
 {
@@ -212,17 +219,22 @@ pthread_mutex_lock(pthread_mutex_t *__mutex)
         return -EINVAL;
     }
 
-    while (!__sync_bool_compare_and_swap(__mutex, PTHREAD_MUTEX_INITIALIZER, 0))
-    { };
-
+    bfn::ticketlock::acquire(mutex_word(__mutex));
     return 0;
 }
 
 extern "C" int
-pthread_mutex_trylock(pthread_mutex_t * /*unused*/)
+pthread_mutex_trylock(pthread_mutex_t *__mutex)
 {
-    UNHANDLED();
-    return -ENOSYS;
+    if (__mutex == nullptr) {
+        return -EINVAL;
+    }
+
+    if (!bfn::ticketlock::try_acquire(mutex_word(__mutex))) {
+        return -EBUSY;
+    }
+
+    return 0;
 }
 
 extern "C" int
@@ -232,7 +244,7 @@ pthread_mutex_unlock(pthread_mutex_t *__mutex)
         return -EINVAL;
     }
 
-    *__mutex = PTHREAD_MUTEX_INITIALIZER;
+    bfn::ticketlock::release(mutex_word(__mutex));
     return 0;
 }
 
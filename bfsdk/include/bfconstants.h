@@ -52,6 +52,20 @@
 #define BAREFLANK_PAGE_SIZE (0x1000ULL)
 #endif
 
+/*
+ * Bareflank Large Page Size
+ *
+ * Defines the large page size that is used by the VMM to map its own memory
+ * when that memory is both virtually and physically contiguous. The VMM's
+ * page pools are aligned to this size so that they can be mapped using
+ * large pages.
+ *
+ * Note: defined in bytes
+ */
+#ifndef BAREFLANK_LARGE_PAGE_SIZE
+#define BAREFLANK_LARGE_PAGE_SIZE (0x200000ULL)
+#endif
+
 /*
  * Page Pool K
  *
@@ -85,6 +99,19 @@
 #define MEM_MAP_POOL_K (15ULL)
 #endif
 
+/*
+ * Node Pool K
+ *
+ * Defines the size of each per-NUMA node page pool. On systems with more than
+ * one NUMA node, the driver allocates one of these pools from each node's
+ * local memory, and the VMM uses it for page and huge allocations made on
+ * behalf of a CPU on that node. Note that increasing "K" by 1 will double
+ * the amount of memory used by each node.
+ */
+#ifndef NODE_POOL_K
+#define NODE_POOL_K (13ULL)
+#endif
+
 /*
  * Memory Map Pool Start
  *
@@ -118,6 +145,27 @@
 #define MAX_NUM_MODULES (75LL)
 #endif
 
+/*
+ * Max Supported Physical CPUs
+ *
+ * The maximum number of physical cores the VMM keeps per-core state for
+ * (e.g. the VPID allocators). If your system has more cores than this,
+ * this value will need to be increased.
+ */
+#ifndef MAX_NUM_PCPUS
+#define MAX_NUM_PCPUS (256ULL)
+#endif
+
+/*
+ * Max Supported NUMA Nodes
+ *
+ * The maximum number of NUMA nodes the VMM keeps a node pool for. Nodes
+ * beyond this limit use the global page and huge pools.
+ */
+#ifndef MAX_NUM_NODES
+#define MAX_NUM_NODES (16ULL)
+#endif
+
 /*
  * Debug Ring Size
  *
@@ -133,6 +181,22 @@
  */
 #define DEBUG_RING_SIZE (1 << 15ULL)
 
+/*
+ * Hypercall Ring Size
+ *
+ * Defines the number of entries in a hypercall ring, which is the maximum
+ *     number of hypercalls userspace can have in flight before it has to
+ *     ring the doorbell (or wait for the VMM to poll the ring).
+ *
+ * Note: Must be defined using a bit shift as the position of an entry in
+ *     the ring is calculated using a mask
+ *
+ * Note: defined in entries
+ */
+#ifndef HYPERCALL_RING_SIZE
+#define HYPERCALL_RING_SIZE (1 << 8ULL)
+#endif
+
 /*
  * Stack Size
  *
@@ -157,6 +157,68 @@ debug_ring_read(struct debug_ring_resources_t *drr, char *str, uint64_t len)
     return count;
 }
 
+/**
+ * Debug Ring Read From
+ *
+ * Reads the strings that have been written to the debug ring since the
+ * previous call. Unlike debug_ring_read, which always returns the entire
+ * contents of the debug ring, the reader owns a cursor that records how
+ * much of the debug ring it has already seen, which allows a reader to
+ * follow the debug ring (e.g. through a read-only mapping) without copying
+ * the same data twice. If the writer has overwritten data the reader has
+ * not seen yet, the cursor skips ahead to the oldest data in the ring.
+ *
+ * The cursor should start at 0, in which case the first call returns the
+ * entire contents of the debug ring.
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @param drr the debug_ring_resource that was used to create the
+ *        debug ring
+ * @param cursor the position of the reader in the debug ring. This is
+ *        updated to the position of the last byte read.
+ * @param str the buffer to read the string into
+ * @param len the length of the str buffer in bytes
+ * @return the number of bytes read from the debug ring, 0
+ *        on error
+ */
+static inline uint64_t
+debug_ring_read_from(
+    const struct debug_ring_resources_t *drr, uint64_t *cursor, char *str, uint64_t len)
+{
+    uint64_t pos;
+    uint64_t spos;
+    uint64_t epos;
+    uint64_t count;
+
+    if (drr == 0 || cursor == 0 || str == 0 || len == 0) {
+        return 0;
+    }
+
+    spos = drr->spos;
+    epos = drr->epos;
+
+    if (spos > epos) {
+        return 0;
+    }
+
+    if (*cursor < spos || *cursor > epos) {
+        *cursor = spos;
+    }
+
+    for (pos = *cursor, count = 0; pos < epos && count < len - 1; pos++) {
+        if (drr->buf[pos % DEBUG_RING_SIZE] != '\0') {
+            str[count++] = drr->buf[pos % DEBUG_RING_SIZE];
+        }
+    }
+
+    *cursor = pos;
+
+    str[count] = '\0';
+    return count;
+}
+
 #ifdef __cplusplus
 }
 #endif
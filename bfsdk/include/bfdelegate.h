@@ -28,6 +28,7 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <type_traits>
 
@@ -144,12 +145,13 @@ public:
     void (&copy)(state_t &lhs, const state_t &rhs);
     void (&move)(state_t &lhs, state_t &&rhs);
     void (&destroy)(state_t &state);
+    bool (&equal)(const state_t &lhs, const state_t &rhs);
 
     template<typename F>
     static const vtable &init() noexcept
     {
         static const vtable self = {
-            s_copy<F>, s_move<F>, s_destroy<F>
+            s_copy<F>, s_move<F>, s_destroy<F>, s_equal<F>
         };
 
         return self;
@@ -177,6 +179,10 @@ private:
         >
     static void s_destroy(state_t &state) noexcept
     { get_state<F>(state).~F(); }
+
+    template<typename F>
+    static bool s_equal(const state_t &lhs, const state_t &rhs) noexcept
+    { return std::memcmp(&get_state<F>(lhs), &get_state<F>(rhs), sizeof(F)) == 0; }
 };
 
 /// @endcond
@@ -466,6 +472,32 @@ public:
     operator bool() const
     { return m_call != nullptr; }
 
+    /// operator==
+    ///
+    /// Two delegates are equal if they wrap the same function, or the same
+    /// member function and object. This is what allows a delegate that was
+    /// added to a list of handlers to be removed again.
+    ///
+    /// @param other the delegate to compare with
+    /// @return true iff both delegates call the same thing
+    ///
+    bool operator==(const delegate &other) const
+    {
+        if (m_call != other.m_call) {
+            return false;
+        }
+
+        return m_call == nullptr || m_vtbl->equal(m_state, other.m_state);
+    }
+
+    /// operator!=
+    ///
+    /// @param other the delegate to compare with
+    /// @return true iff the delegates call different things
+    ///
+    bool operator!=(const delegate &other) const
+    { return !(*this == other); }
+
 private:
     /// @cond
 
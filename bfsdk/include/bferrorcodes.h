@@ -129,6 +129,14 @@
 #define BF_VMCALL_SUCCESS bfscast(status_t, SUCCESS)
 #define BF_VMCALL_FAILURE bfscast(status_t, 0x8000001000000000)
 
+/* -------------------------------------------------------------------------- */
+/* VM Exit Error Codes                                                        */
+/* -------------------------------------------------------------------------- */
+
+#define VMEXIT_SUCCESS bfscast(status_t, SUCCESS)
+#define VMEXIT_ERROR_UNHANDLED bfscast(status_t, 0x8000010000000000)
+#define VMEXIT_ERROR_INVALID_STATE bfscast(status_t, 0x8000020000000000)
+
 /* -------------------------------------------------------------------------- */
 /* Stringify Error Codes                                                      */
 /* -------------------------------------------------------------------------- */
@@ -172,6 +180,8 @@ ec_to_str(int64_t value)
         case BF_ERROR_UNKNOWN: return "BF_ERROR_UNKNOWN";
         case BF_BAD_ALLOC: return "BF_BAD_ALLOC";
         case BF_IOCTL_FAILURE: return "BF_IOCTL_FAILURE";
+        case VMEXIT_ERROR_UNHANDLED: return "VMEXIT_ERROR_UNHANDLED";
+        case VMEXIT_ERROR_INVALID_STATE: return "VMEXIT_ERROR_INVALID_STATE";
 
         default:
             return "UNDEFINED_ERROR_CODE";
@@ -0,0 +1,165 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+///
+/// @file bfexpected.h
+///
+
+#ifndef BFEXPECTED_H
+#define BFEXPECTED_H
+
+#include <utility>
+#include <type_traits>
+
+#include <bferrorcodes.h>
+
+namespace bfn
+{
+
+/// Unexpected
+///
+/// Wraps an error code so that it can be implicitly converted to any
+/// bfn::expected<T>, which allows a function to "return unexpected(ec);"
+/// regardless of the type it returns on success.
+///
+struct unexpected {
+
+    /// Constructor
+    ///
+    /// @expects ec != SUCCESS
+    /// @ensures none
+    ///
+    /// @param ec the error code to return
+    ///
+    constexpr explicit unexpected(status_t ec) noexcept :
+        m_ec{ec}
+    { }
+
+    status_t m_ec;      ///< The error code
+};
+
+/// Expected
+///
+/// Holds either a value of type T, or an error code (see bferrorcodes.h).
+/// This provides a way to report an error without throwing, which is needed
+/// by code that must not unwind (e.g. the VM exit hot path). Unlike
+/// std::optional, the reason for the failure is retained, and unlike a
+/// plain status_t, a successful result can also carry a value.
+///
+/// None of the functions provided by this class throw. The value is only
+/// meaningful if has_value() returns true, and error() returns SUCCESS if
+/// a value is present.
+///
+template<typename T>
+class expected
+{
+    static_assert(std::is_nothrow_move_constructible<T>::value);
+    static_assert(std::is_nothrow_default_constructible<T>::value);
+
+public:
+
+    using value_type = T;       ///< Value type
+
+    /// Value Constructor
+    ///
+    /// @expects none
+    /// @ensures has_value() == true
+    ///
+    /// @param val the value to store
+    ///
+    constexpr expected(T val) noexcept :
+        m_val{std::move(val)}
+    { }
+
+    /// Error Constructor
+    ///
+    /// @expects none
+    /// @ensures has_value() == false
+    ///
+    /// @param u the error code to store
+    ///
+    constexpr expected(unexpected u) noexcept :
+        m_ec{u.m_ec}
+    { }
+
+    /// Has Value
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns true if a value is stored, false if an error
+    ///     code is stored instead
+    ///
+    constexpr bool has_value() const noexcept
+    { return m_ec == SUCCESS; }
+
+    /// Has Value
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns has_value()
+    ///
+    constexpr explicit operator bool() const noexcept
+    { return this->has_value(); }
+
+    /// Value
+    ///
+    /// @expects has_value() == true
+    /// @ensures none
+    ///
+    /// @return returns the stored value
+    ///
+    constexpr const T &value() const noexcept
+    { return m_val; }
+
+    /// Value Or
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param def the value to return if an error code is stored
+    /// @return returns the stored value if there is one, def otherwise
+    ///
+    constexpr T value_or(T def) const noexcept
+    { return this->has_value() ? m_val : def; }
+
+    /// Error
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns the stored error code, or SUCCESS if a value
+    ///     is stored
+    ///
+    constexpr status_t error() const noexcept
+    { return m_ec; }
+
+private:
+
+    T m_val{};
+    status_t m_ec{SUCCESS};
+};
+
+}
+
+#endif
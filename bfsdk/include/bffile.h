@@ -29,6 +29,7 @@
 #include <cstdlib>
 
 #include <string>
+#include <utility>
 #include <vector>
 #include <fstream>
 
@@ -37,6 +38,130 @@
 #include <bfbuffer.h>
 #include <bfexception.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/// Mapped Binary
+///
+/// A read-only view of the contents of a file. On POSIX systems the file
+/// is mapped into memory so that nothing is copied out of the page cache
+/// (the pages are unmapped when this object goes out of scope). On
+/// Windows, the file is read into memory instead.
+///
+class mapped_binary
+{
+public:
+
+    using size_type = std::size_t;      ///< Size type of the mapping
+    using data_type = char;             ///< Data type of the mapping
+
+    /// Default Constructor
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    mapped_binary() noexcept = default;
+
+    /// Mapping Constructor
+    ///
+    /// @note Takes ownership of data. On POSIX systems, data must have been
+    ///     returned by mmap, and is unmapped when this object goes out of
+    ///     scope. Otherwise, data must have been allocated using new[].
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param data a pointer to the mapping to store
+    /// @param size the size of the provided mapping
+    ///
+    mapped_binary(data_type *data, size_type size) :
+        m_size(size),
+        m_data(data)
+    {
+        expects(size != 0 || data == nullptr);
+        expects(data != nullptr || size == 0);
+    }
+
+    /// Destructor
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    ~mapped_binary()
+    {
+        if (m_data == nullptr) {
+            return;
+        }
+
+#ifndef _WIN32
+        munmap(m_data, m_size);
+#else
+        delete[] m_data;
+#endif
+    }
+
+    /// Get Data
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns a pointer to the mapping
+    ///
+    const data_type *data() const noexcept
+    { return m_data; }
+
+    /// Size
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns the size of the mapping
+    ///
+    size_type size() const noexcept
+    { return m_size; }
+
+    /// Is Empty
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns true if size() == 0, false otherwise
+    ///
+    bool empty() const noexcept
+    { return m_size == 0; }
+
+private:
+
+    size_type m_size{0};
+    data_type *m_data{nullptr};
+
+public:
+
+    /// @cond
+
+    mapped_binary(mapped_binary &&other) noexcept :
+        m_size(std::exchange(other.m_size, 0)),
+        m_data(std::exchange(other.m_data, nullptr))
+    { }
+
+    mapped_binary &operator=(mapped_binary &&other) noexcept
+    {
+        std::swap(m_size, other.m_size);
+        std::swap(m_data, other.m_data);
+
+        return *this;
+    }
+
+    mapped_binary(const mapped_binary &) = delete;
+    mapped_binary &operator=(const mapped_binary &) = delete;
+
+    /// @endcond
+};
+
 /// File
 ///
 /// This class is responsible for working with a file. Specifically, this
@@ -50,6 +175,7 @@ public:
 
     using text_data = std::string;                      ///< File format for text data
     using binary_data = bfn::buffer;                    ///< File format for binary data
+    using mapped_data = mapped_binary;                  ///< File format for mapped data
     using filename_type = std::string;                  ///< File name type
     using extension_type = std::string;                 ///< Extension name type
     using path_list_type = std::vector<std::string>;    ///< Find files path type
@@ -149,6 +275,72 @@ public:
         throw std::runtime_error("invalid filename: " + filename);
     }
 
+    /// Map
+    ///
+    /// Maps the entire contents of a file, in binary form, read-only. Unlike
+    /// read_binary, the file is not copied (on POSIX systems), which makes
+    /// this the preferred way to hand large files (e.g. VMM modules) to
+    /// something that will copy them anyway.
+    ///
+    /// @expects filename.empty() == false
+    /// @ensures none
+    ///
+    /// @param filename name of the file to map.
+    /// @return the contents of filename
+    ///
+    VIRTUAL mapped_data
+    map_binary(const filename_type &filename) const
+    {
+        expects(!filename.empty());
+
+#ifndef _WIN32
+        auto fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("invalid filename: " + filename);
+        }
+
+        auto ___ = gsl::finally([&] {
+            close(fd);
+        });
+
+        struct stat st {};
+        if (fstat(fd, &st) != 0) {
+            throw std::runtime_error("fstat failed: " + filename);
+        }
+
+        if (st.st_size <= 0) {
+            return mapped_data{};
+        }
+
+        auto size = static_cast<mapped_data::size_type>(st.st_size);
+
+        // The mapping is populated up front as whoever asked for it is
+        // about to read every page anyway, and faulting them in one at a
+        // time is slower than letting the kernel read the file in bulk.
+
+#ifdef MAP_POPULATE
+        auto flags = MAP_PRIVATE | MAP_POPULATE;
+#else
+        auto flags = MAP_PRIVATE;
+#endif
+
+        auto data = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("mmap failed: " + filename);
+        }
+
+        return {static_cast<mapped_data::data_type *>(data), size};
+#else
+        auto buffer = this->read_binary(filename);
+        auto size = buffer.size();
+
+        auto data = buffer.data();
+        buffer.release();
+
+        return {data, size};
+#endif
+    }
+
     /// Write
     ///
     /// Writes text data to the file provided
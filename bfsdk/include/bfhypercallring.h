@@ -0,0 +1,270 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+///
+/// @file bfhypercallring.h
+///
+
+#ifndef BFHYPERCALLRING_H
+#define BFHYPERCALLRING_H
+
+#include <array>
+#include <atomic>
+
+#include <bftypes.h>
+#include <bfconstants.h>
+
+// -----------------------------------------------------------------------------
+// Opcodes
+// -----------------------------------------------------------------------------
+
+/// Hypercall Ring Register
+///
+/// vmcall opcode (reg1) used to hand a hypercall ring to the VMM. reg2
+/// holds the virtual address of the ring, which must remain resident (e.g.
+/// mlock()) until the ring is unregistered.
+///
+#define HYPERCALL_RING_REGISTER 0xBF01000000000001ULL
+
+/// Hypercall Ring Unregister
+///
+/// vmcall opcode (reg1) used to take a hypercall ring back from the VMM. This
+/// must be issued before the memory backing the ring is released.
+///
+#define HYPERCALL_RING_UNREGISTER 0xBF01000000000002ULL
+
+/// Hypercall Ring Doorbell
+///
+/// vmcall opcode (reg1) used to tell the VMM that the ring has pending
+/// entries. All pending entries are completed before the vmcall returns.
+///
+#define HYPERCALL_RING_DOORBELL 0xBF01000000000003ULL
+
+/// Hypercall Ring Magic
+///
+/// Used by the VMM to validate the ring on registration, and to identify the
+/// ring from a memory dump
+///
+#define HYPERCALL_RING_MAGIC 0xBF0CA11BF0CA11BFULL
+
+/// Hypercall Ring Unhandled
+///
+/// The value the VMM stores in reg1 of an entry that no handler serviced
+///
+#define HYPERCALL_RING_UNHANDLED 0xFFFFFFFFFFFFFFFFULL
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfn
+{
+
+/// Hypercall Ring Entry
+///
+/// A single hypercall. The registers have the same meaning as the registers
+/// of a vmcall (i.e. ioctl_vmcall_args_t), and once the entry completes, reg1
+/// holds the result just like the return value of a vmcall.
+///
+struct hypercall_ring_entry_t {
+    uint64_t reg1;      ///< Opcode on submission, result on completion
+    uint64_t reg2;      ///< Argument 1
+    uint64_t reg3;      ///< Argument 2
+    uint64_t reg4;      ///< Argument 3
+};
+
+/// Hypercall Ring
+///
+/// A single producer / single consumer ring of hypercalls that lives in
+/// memory shared by userspace (the producer) and the VMM (the consumer).
+/// Instead of paying for a VM exit per hypercall, userspace queues a batch
+/// of entries, and then either rings the doorbell once, or lets the VMM
+/// pick the entries up the next time it polls the ring.
+///
+/// Like the debug ring, the positions are counters that grow forever, and
+/// the index of an entry is pos & (HYPERCALL_RING_SIZE - 1). Entries are
+/// completed in place and in order, so the ring is split into three regions:
+///
+/// - [cq_head, cq_tail): completed, waiting to be reaped by userspace
+/// - [cq_tail, sq_tail): submitted, waiting to be completed by the VMM
+/// - [sq_tail, cq_head + HYPERCALL_RING_SIZE): free
+///
+/// Each position is only ever written by one side, and each lives on its
+/// own cache line so that the producer and the consumer do not bounce the
+/// same line between cores while the ring is busy.
+///
+struct hypercall_ring_t {
+    uint64_t magic;                             ///< HYPERCALL_RING_MAGIC
+
+    alignas(64) std::atomic<uint64_t> sq_tail;  ///< Written by userspace
+    alignas(64) std::atomic<uint64_t> cq_tail;  ///< Written by the VMM
+    alignas(64) std::atomic<uint64_t> cq_head;  ///< Written by userspace
+
+    /// The ring of entries
+    ///
+    alignas(64) std::array<hypercall_ring_entry_t, HYPERCALL_RING_SIZE> entries;
+};
+
+/// @cond
+
+static_assert((HYPERCALL_RING_SIZE & (HYPERCALL_RING_SIZE - 1)) == 0);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+/// @endcond
+
+/// Hypercall Ring Init
+///
+/// Prepares the memory of a hypercall ring. This must be done by userspace
+/// before the ring is registered with the VMM.
+///
+/// @expects ring != nullptr
+/// @ensures none
+///
+/// @param ring the ring to initialize
+///
+inline void
+hypercall_ring_init(hypercall_ring_t *ring) noexcept
+{
+    ring->sq_tail.store(0, std::memory_order_relaxed);
+    ring->cq_tail.store(0, std::memory_order_relaxed);
+    ring->cq_head.store(0, std::memory_order_relaxed);
+
+    ring->entries = {};
+    ring->magic = HYPERCALL_RING_MAGIC;
+}
+
+/// Hypercall Ring Submit
+///
+/// Queues a hypercall (producer side). The entry is not seen by the VMM
+/// until the doorbell is rung, or the VMM polls the ring.
+///
+/// @expects ring != nullptr
+/// @ensures none
+///
+/// @param ring the ring to submit the entry to
+/// @param entry the hypercall to submit
+/// @return returns false if the ring is full, true otherwise
+///
+inline bool
+hypercall_ring_submit(
+    hypercall_ring_t *ring, const hypercall_ring_entry_t &entry) noexcept
+{
+    auto sq_tail = ring->sq_tail.load(std::memory_order_relaxed);
+    auto cq_head = ring->cq_head.load(std::memory_order_relaxed);
+
+    if (sq_tail - cq_head >= HYPERCALL_RING_SIZE) {
+        return false;
+    }
+
+    ring->entries[sq_tail & (HYPERCALL_RING_SIZE - 1)] = entry;
+    ring->sq_tail.store(sq_tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+/// Hypercall Ring Reap
+///
+/// Removes the oldest completed hypercall from the ring (producer side).
+/// Completions are returned in the same order the entries were submitted.
+///
+/// @expects ring != nullptr
+/// @ensures none
+///
+/// @param ring the ring to reap the entry from
+/// @param entry where to store the completed hypercall
+/// @return returns false if there are no completed entries, true otherwise
+///
+inline bool
+hypercall_ring_reap(
+    hypercall_ring_t *ring, hypercall_ring_entry_t &entry) noexcept
+{
+    auto cq_head = ring->cq_head.load(std::memory_order_relaxed);
+    auto cq_tail = ring->cq_tail.load(std::memory_order_acquire);
+
+    if (cq_head == cq_tail) {
+        return false;
+    }
+
+    entry = ring->entries[cq_head & (HYPERCALL_RING_SIZE - 1)];
+    ring->cq_head.store(cq_head + 1, std::memory_order_release);
+
+    return true;
+}
+
+/// Hypercall Ring Pending
+///
+/// @expects ring != nullptr
+/// @ensures none
+///
+/// @param ring the ring to query
+/// @return returns the number of entries that have been submitted, but not
+///     yet completed by the VMM. Userspace only needs to ring the doorbell
+///     if this is not 0.
+///
+inline uint64_t
+hypercall_ring_pending(const hypercall_ring_t *ring) noexcept
+{
+    auto cq_tail = ring->cq_tail.load(std::memory_order_acquire);
+    return ring->sq_tail.load(std::memory_order_relaxed) - cq_tail;
+}
+
+/// Hypercall Ring Consume
+///
+/// Completes every pending hypercall (consumer side). func is called once
+/// per entry, in order, and stores the result of the hypercall in the
+/// entry's reg1. The completions are published to userspace all at once,
+/// after the whole batch has been processed.
+///
+/// Note that sq_tail is written by userspace, so it cannot be trusted. If
+/// it claims more than HYPERCALL_RING_SIZE pending entries, the ring is
+/// corrupt and nothing is consumed.
+///
+/// @expects ring != nullptr
+/// @ensures none
+///
+/// @param ring the ring to consume entries from
+/// @param func the function to call for each pending entry
+/// @return returns the number of entries that were completed
+///
+template<typename FUNC>
+uint64_t
+hypercall_ring_consume(hypercall_ring_t *ring, FUNC &&func)
+{
+    auto cq_tail = ring->cq_tail.load(std::memory_order_relaxed);
+    auto sq_tail = ring->sq_tail.load(std::memory_order_acquire);
+
+    auto num = sq_tail - cq_tail;
+    if (num == 0 || num > HYPERCALL_RING_SIZE) {
+        return 0;
+    }
+
+    for (auto pos = cq_tail; pos != sq_tail; pos++) {
+        func(ring->entries[pos & (HYPERCALL_RING_SIZE - 1)]);
+    }
+
+    ring->cq_tail.store(sq_tail, std::memory_order_release);
+    return num;
+}
+
+}
+
+#endif
@@ -24,16 +24,43 @@
 
 #include <mutex>
 #include <memory>
+#include <utility>
+#include <type_traits>
 #include <unordered_map>
 
 #include <bfgsl.h>
 
+/// @cond
+
+namespace bfmanager_detail
+{
+
+template<typename T, typename T_factory, typename tid, typename = void>
+struct is_pooled : std::false_type
+{ };
+
+template<typename T, typename T_factory, typename tid>
+struct is_pooled<T, T_factory, tid, std::void_t<
+    decltype(std::declval<T_factory &>().acquire(std::declval<tid>(), nullptr)),
+    decltype(std::declval<T_factory &>().release(std::declval<std::unique_ptr<T>>()))
+    >> : std::true_type
+{ };
+
+}
+
+/// @endcond
+
 /// Manager
 ///
 /// A generic class for creating, destroying, running and stopping T given a
 /// T_factory to actually instantiate T, and a tid to identify which T to
 /// interact with.
 ///
+/// If the T_factory provides acquire() and release(), T is created using
+/// acquire() instead of make(), and a destroyed T is handed back to the
+/// factory's release() instead of being deleted, which allows the factory
+/// to pool and recycle Ts.
+///
 template<typename T, typename T_factory, typename tid>
 class bfmanager
 {
@@ -78,7 +105,7 @@ public:
             throw std::runtime_error("bfmanager: id already exists");
         }
 
-        if (auto t = m_T_factory->make(id, data)) {
+        if (auto t = this->make(id, data)) {
             m_ts[id] = std::move(t);
             return;
         }
@@ -96,7 +123,15 @@ public:
     void destroy(tid id)
     {
         std::lock_guard<std::mutex> guard(m_mutex);
-        m_ts.erase(id);
+
+        if (auto iter = m_ts.find(id); iter != m_ts.end()) {
+            auto t = std::move(iter->second);
+            m_ts.erase(iter);
+
+            if constexpr (bfmanager_detail::is_pooled<T, T_factory, tid>::value) {
+                m_T_factory->release(std::move(t));
+            }
+        }
     }
 
     /// For Each
@@ -154,6 +189,28 @@ public:
     gsl::not_null<U> get(tid id, const char *err = nullptr)
     { return dynamic_cast<U>(get(id, err).get()); }
 
+    /// Factory
+    ///
+    /// @expects none
+    /// @ensures ret != nullptr
+    ///
+    /// @return returns the factory that is used to create T
+    ///
+    T_factory *factory() noexcept
+    { return m_T_factory.get(); }
+
+private:
+
+    std::unique_ptr<T> make(tid id, void *data)
+    {
+        if constexpr (bfmanager_detail::is_pooled<T, T_factory, tid>::value) {
+            return m_T_factory->acquire(id, data);
+        }
+        else {
+            return m_T_factory->make(id, data);
+        }
+    }
+
 private:
 
     bfmanager() noexcept :
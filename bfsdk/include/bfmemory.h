@@ -43,6 +43,10 @@ extern "C" {
 #define MEMORY_TYPE_W 0x2U
 #define MEMORY_TYPE_E 0x4U
 
+#define MEMORY_TYPE_NODE_SHIFT 32
+#define MEMORY_TYPE_NODE(node) (((uint64_t)(node)) << MEMORY_TYPE_NODE_SHIFT)
+#define MEMORY_TYPE_GET_NODE(type) (((uint64_t)(type)) >> MEMORY_TYPE_NODE_SHIFT)
+
 /* @endcond */
 
 /**
@@ -61,7 +65,8 @@ extern "C" {
  *     the starting virtual address of the block of memory
  * @var memory_descriptor::type
  *     the type of memory block. This is likely architecture specific as
- *     this holds information about access rights, etc...
+ *     this holds information about access rights, etc... The upper 32 bits
+ *     hold the NUMA node the memory is local to (see MEMORY_TYPE_NODE)
  */
 struct memory_descriptor {
     uint64_t phys;
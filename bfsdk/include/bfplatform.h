@@ -147,6 +147,57 @@ int64_t platform_memcpy(
  */
 int64_t platform_num_cpus(void);
 
+/**
+ * Get Number of NUMA Nodes
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @return returns the total number of NUMA nodes available. Platforms that
+ *     are not NUMA aware report a single node.
+ */
+int64_t platform_num_nodes(void);
+
+/**
+ * Is NUMA Node Online
+ *
+ * NUMA node ids are not guaranteed to be contiguous, so callers should not
+ * assume that the online nodes are 0 through platform_num_nodes() - 1.
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @param node the NUMA node id to check
+ * @return returns 1 if the provided node is online, 0 otherwise
+ */
+int64_t platform_node_online(int64_t node);
+
+/**
+ * Get CPU NUMA Node
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @param cpuid the core id to get the NUMA node of
+ * @return returns the NUMA node that the provided core belongs to
+ */
+int64_t platform_cpu_node(uint64_t cpuid);
+
+/**
+ * Allocate Node-Local Memory
+ *
+ * @expects none
+ * @ensures none
+ *
+ * @note: memory allocated from this function must be 4k aligned, and is
+ * freed using platform_free_rw.
+ *
+ * @param len the size of memory to allocate in bytes.
+ * @param node the NUMA node the memory should be local to
+ * @return returns the address of the newly allocated memory
+ */
+void *platform_alloc_rw_node(uint64_t len, int64_t node);
+
 /**
  * Call VMM on Core
  *
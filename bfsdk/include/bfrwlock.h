@@ -0,0 +1,192 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+///
+/// @file bfrwlock.h
+///
+
+#ifndef BFRWLOCK_H
+#define BFRWLOCK_H
+
+#include <array>
+#include <cstdint>
+
+#include <bfticketlock.h>
+#include <bfthreadcontext.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+/// Reader-Writer Lock Slots
+///
+/// The number of reader counters each lock keeps. Readers pick a counter
+/// using the CPU they are running on, so as long as there are at least as
+/// many slots as CPUs, readers on different CPUs never share a cache line.
+///
+#ifndef BFRWLOCK_SLOTS
+#define BFRWLOCK_SLOTS 16U
+#endif
+
+/// Cache Line Size
+///
+#ifndef BFRWLOCK_CACHE_LINE_SIZE
+#define BFRWLOCK_CACHE_LINE_SIZE 64U
+#endif
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+namespace bfn
+{
+
+/// Reader-Writer Lock
+///
+/// A writer-preferring reader-writer lock for read-mostly data. Each CPU
+/// counts its readers in its own cache line, so readers on different CPUs
+/// never write to the same memory, and taking a shared lock costs one
+/// uncontended atomic increment. Writers are serialized with a ticket lock,
+/// announce themselves with a flag that stops new readers, and then wait
+/// for every reader count to drain.
+///
+/// This class meets the SharedMutex requirements, so it can be used with
+/// std::lock_guard / std::unique_lock for exclusive access and with
+/// std::shared_lock for shared access. std::shared_mutex is not used as
+/// libc++ implements it using condition variables, which the VMM's
+/// runtime does not support.
+///
+/// @note the lock is not recursive. A reader must release its shared lock
+///     on the same CPU that acquired it, which is always the case in the
+///     VMM as threads never migrate between CPUs.
+///
+class rwlock
+{
+public:
+
+    /// Lock (Exclusive)
+    ///
+    void lock() noexcept
+    {
+        m_writer.lock();
+        __atomic_store_n(&m_writing, 1U, __ATOMIC_SEQ_CST);
+
+        for (auto &slot : m_slots) {
+            while (__atomic_load_n(&slot.readers, __ATOMIC_SEQ_CST) != 0) {
+                cpu_relax();
+            }
+        }
+    }
+
+    /// Try Lock (Exclusive)
+    ///
+    /// @return true if the lock was acquired, false otherwise
+    ///
+    bool try_lock() noexcept
+    {
+        if (!m_writer.try_lock()) {
+            return false;
+        }
+
+        __atomic_store_n(&m_writing, 1U, __ATOMIC_SEQ_CST);
+
+        for (auto &slot : m_slots) {
+            if (__atomic_load_n(&slot.readers, __ATOMIC_SEQ_CST) != 0) {
+                this->unlock();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// Unlock (Exclusive)
+    ///
+    void unlock() noexcept
+    {
+        __atomic_store_n(&m_writing, 0U, __ATOMIC_RELEASE);
+        m_writer.unlock();
+    }
+
+    /// Lock (Shared)
+    ///
+    void lock_shared() noexcept
+    {
+        auto readers = this->readers();
+
+        while (true) {
+            __atomic_fetch_add(readers, 1U, __ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&m_writing, __ATOMIC_SEQ_CST) == 0) {
+                return;
+            }
+
+            __atomic_fetch_sub(readers, 1U, __ATOMIC_RELEASE);
+
+            while (__atomic_load_n(&m_writing, __ATOMIC_RELAXED) != 0) {
+                cpu_relax();
+            }
+        }
+    }
+
+    /// Try Lock (Shared)
+    ///
+    /// @return true if the lock was acquired, false otherwise
+    ///
+    bool try_lock_shared() noexcept
+    {
+        auto readers = this->readers();
+        __atomic_fetch_add(readers, 1U, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&m_writing, __ATOMIC_SEQ_CST) == 0) {
+            return true;
+        }
+
+        __atomic_fetch_sub(readers, 1U, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    /// Unlock (Shared)
+    ///
+    void unlock_shared() noexcept
+    { __atomic_fetch_sub(this->readers(), 1U, __ATOMIC_RELEASE); }
+
+private:
+
+    uint64_t *readers() noexcept
+    { return &m_slots[thread_context_cpuid() % BFRWLOCK_SLOTS].readers; }
+
+private:
+
+    struct alignas(BFRWLOCK_CACHE_LINE_SIZE) slot_t {
+        uint64_t readers{0};
+    };
+
+    std::array<slot_t, BFRWLOCK_SLOTS> m_slots{};
+
+    alignas(BFRWLOCK_CACHE_LINE_SIZE) uint32_t m_writing{0};
+    ticket_lock m_writer{};
+};
+
+}
+
+#endif
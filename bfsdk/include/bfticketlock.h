@@ -0,0 +1,233 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+///
+/// @file bfticketlock.h
+///
+
+#ifndef BFTICKETLOCK_H
+#define BFTICKETLOCK_H
+
+#include <cstdint>
+
+#include <bfarch.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+/// Ticket Lock Backoff
+///
+/// The number of pause instructions a waiter executes for each ticket that
+/// is still ahead of it in the queue before it re-reads the lock word.
+///
+#ifndef BFTICKETLOCK_BACKOFF
+#define BFTICKETLOCK_BACKOFF 32U
+#endif
+
+/// Ticket Lock Max Backoff
+///
+/// The maximum number of pause instructions a waiter executes between two
+/// reads of the lock word, regardless of how long the queue is.
+///
+#ifndef BFTICKETLOCK_MAX_BACKOFF
+#define BFTICKETLOCK_MAX_BACKOFF 4096U
+#endif
+
+// -----------------------------------------------------------------------------
+// Implementation
+// -----------------------------------------------------------------------------
+
+namespace bfn
+{
+
+/// CPU Relax
+///
+/// Tells the CPU that the caller is spinning so that it can back off the
+/// memory bus (and on hyperthreaded cores, give up execution resources to
+/// the sibling thread).
+///
+inline void
+cpu_relax() noexcept
+{
+#if defined(BF_X64)
+    __builtin_ia32_pause();
+#elif defined(BF_AARCH64)
+    __asm__ volatile("yield" ::: "memory");
+#endif
+}
+
+/// Ticket Lock
+///
+/// A fair spinlock stored in a single 32bit word. The lower 16 bits hold the
+/// ticket currently being served, and the upper 16 bits hold the next ticket
+/// to be handed out. The lock is free when both halves are equal, which
+/// means that both 0 and 0xFFFFFFFF (newlib's PTHREAD_MUTEX_INITIALIZER) are
+/// valid unlocked states.
+///
+/// Waiters are served in FIFO order and only read the lock word while they
+/// wait (no atomic RMW), backing off in proportion to their distance from the
+/// head of the queue so that the cache line is not hammered while a long
+/// queue drains.
+///
+/// The functions in this namespace operate on a raw word so that they can be
+/// used to implement pthread_mutex_t, while bfn::ticket_lock wraps them in
+/// the standard Lockable interface.
+///
+namespace ticketlock
+{
+
+/// @cond
+
+constexpr const uint32_t owner_mask = 0x0000FFFFU;
+constexpr const uint32_t next_shift = 16U;
+constexpr const uint32_t next_inc = 0x00010000U;
+
+/// @endcond
+
+/// Acquire
+///
+/// Takes a ticket and spins until that ticket is served.
+///
+/// @param word the lock word
+///
+inline void
+acquire(uint32_t *word) noexcept
+{
+    auto ticket = __atomic_fetch_add(word, next_inc, __ATOMIC_ACQUIRE) >> next_shift;
+
+    while (true) {
+        auto owner = __atomic_load_n(word, __ATOMIC_ACQUIRE) & owner_mask;
+        if (owner == ticket) {
+            return;
+        }
+
+        auto delay = ((ticket - owner) & owner_mask) * BFTICKETLOCK_BACKOFF;
+        if (delay > BFTICKETLOCK_MAX_BACKOFF) {
+            delay = BFTICKETLOCK_MAX_BACKOFF;
+        }
+
+        for (auto i = 0U; i < delay; i++) {
+            cpu_relax();
+        }
+    }
+}
+
+/// Try Acquire
+///
+/// Takes a ticket only if it would be served immediately.
+///
+/// @param word the lock word
+/// @return true if the lock was acquired, false otherwise
+///
+inline bool
+try_acquire(uint32_t *word) noexcept
+{
+    auto val = __atomic_load_n(word, __ATOMIC_RELAXED);
+
+    if ((val & owner_mask) != (val >> next_shift)) {
+        return false;
+    }
+
+    return __atomic_compare_exchange_n(
+               word, &val, val + next_inc, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/// Release
+///
+/// Serves the next ticket. Only the owner may call this. The owner half is
+/// updated with a CAS on the whole word so that a wrap of the owner ticket
+/// never carries into the next ticket while other cores are queueing.
+///
+/// @param word the lock word
+///
+inline void
+release(uint32_t *word) noexcept
+{
+    auto val = __atomic_load_n(word, __ATOMIC_RELAXED);
+
+    while (true) {
+        auto owner = ((val & owner_mask) + 1U) & owner_mask;
+
+        if (__atomic_compare_exchange_n(
+                word, &val, (val & ~owner_mask) | owner, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return;
+        }
+
+        cpu_relax();
+    }
+}
+
+/// Is Locked
+///
+/// @param word the lock word
+/// @return true if a ticket is currently being served
+///
+inline bool
+is_locked(const uint32_t *word) noexcept
+{
+    auto val = __atomic_load_n(word, __ATOMIC_RELAXED);
+    return (val & owner_mask) != (val >> next_shift);
+}
+
+}
+
+/// Ticket Lock
+///
+/// Lockable wrapper around the bfn::ticketlock functions. This can be used
+/// with std::lock_guard, std::unique_lock, etc...
+///
+class ticket_lock
+{
+public:
+
+    /// Lock
+    ///
+    void lock() noexcept
+    { ticketlock::acquire(&m_word); }
+
+    /// Try Lock
+    ///
+    /// @return true if the lock was acquired, false otherwise
+    ///
+    bool try_lock() noexcept
+    { return ticketlock::try_acquire(&m_word); }
+
+    /// Unlock
+    ///
+    void unlock() noexcept
+    { ticketlock::release(&m_word); }
+
+    /// Is Locked
+    ///
+    /// @return true if the lock is currently held
+    ///
+    bool is_locked() const noexcept
+    { return ticketlock::is_locked(&m_word); }
+
+private:
+    uint32_t m_word{0};
+};
+
+}
+
+#endif
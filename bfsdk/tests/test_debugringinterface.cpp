@@ -99,3 +99,81 @@ TEST_CASE("debug_ring_read: full")
 
     CHECK(debug_ring_read(&g_drr, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == DEBUG_RING_SIZE - 1);
 }
+
+TEST_CASE("debug_ring_read_from: invalid args")
+{
+    uint64_t cursor = 0;
+
+    CHECK(debug_ring_read_from(nullptr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 0);
+    CHECK(debug_ring_read_from(&g_drr, nullptr, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 0);
+    CHECK(debug_ring_read_from(&g_drr, &cursor, nullptr, DEBUG_RING_SIZE) == 0);
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), 0) == 0);
+}
+
+TEST_CASE("debug_ring_read_from: invalid spos / epos")
+{
+    uint64_t cursor = 0;
+
+    g_drr.spos = 42;
+    g_drr.epos = 0;
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 0);
+}
+
+TEST_CASE("debug_ring_read_from: follow")
+{
+    uint64_t cursor = 0;
+
+    g_drr.spos = 0;
+    g_drr.epos = 0;
+
+    auto view = gsl::make_span(g_drr.buf);
+    for (auto &elem : view) {
+        elem = 'A';
+    }
+
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 0);
+
+    g_drr.epos = 42;
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 42);
+    CHECK(cursor == 42);
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 0);
+
+    g_drr.epos = 50;
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 8);
+    CHECK(cursor == 50);
+}
+
+TEST_CASE("debug_ring_read_from: small buffer")
+{
+    uint64_t cursor = 0;
+
+    g_drr.spos = 0;
+    g_drr.epos = 42;
+
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), 11) == 10);
+    CHECK(cursor == 10);
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 32);
+    CHECK(cursor == 42);
+}
+
+TEST_CASE("debug_ring_read_from: overrun")
+{
+    uint64_t cursor = 10;
+
+    g_drr.spos = DEBUG_RING_SIZE - 42;
+    g_drr.epos = DEBUG_RING_SIZE + 42;
+
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 42 * 2);
+    CHECK(cursor == DEBUG_RING_SIZE + 42);
+}
+
+TEST_CASE("debug_ring_read_from: ring reset")
+{
+    uint64_t cursor = DEBUG_RING_SIZE;
+
+    g_drr.spos = 0;
+    g_drr.epos = 42;
+
+    CHECK(debug_ring_read_from(&g_drr, &cursor, static_cast<char *>(g_buf), DEBUG_RING_SIZE) == 42);
+    CHECK(cursor == 42);
+}
@@ -231,3 +231,26 @@ TEST_CASE("list move")
     CHECK(!d2);
     CHECK(!d3);
 }
+
+TEST_CASE("equality")
+{
+    test_class t1;
+    test_class t2;
+
+    auto d1 = delegate(&test_class::foo, &t1);
+    auto d2 = delegate(&test_class::foo, &t1);
+    auto d3 = delegate(&test_class::foo, &t2);
+    auto d4 = delegate(foo);
+
+    CHECK(d1 == d2);
+    CHECK(d1 != d3);
+    CHECK(d1 != d4);
+    CHECK(d4 == delegate(foo));
+    CHECK(delegate<int(int)>() == delegate<int(int)>());
+
+    std::list<delegate<int(int)>> delegates{d1, d3, d4};
+    delegates.remove(d2);
+
+    CHECK(delegates.size() == 2);
+    CHECK(delegates.front() == d3);
+}
@@ -61,6 +61,8 @@ TEST_CASE("ec_to_str: known")
     CHECK(ec_to_str(BF_ERROR_UNKNOWN) == "BF_ERROR_UNKNOWN"_s);
     CHECK(ec_to_str(BF_BAD_ALLOC) == "BF_BAD_ALLOC"_s);
     CHECK(ec_to_str(BF_IOCTL_FAILURE) == "BF_IOCTL_FAILURE"_s);
+    CHECK(ec_to_str(VMEXIT_ERROR_UNHANDLED) == "VMEXIT_ERROR_UNHANDLED"_s);
+    CHECK(ec_to_str(VMEXIT_ERROR_INVALID_STATE) == "VMEXIT_ERROR_INVALID_STATE"_s);
 }
 
 TEST_CASE("ec_to_str: unknown")
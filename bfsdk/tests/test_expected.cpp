@@ -0,0 +1,73 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+#include <bfexpected.h>
+
+static bfn::expected<int>
+half(int val) noexcept
+{
+    if ((val & 1) != 0) {
+        return bfn::unexpected(BF_ERROR_INVALID_ARG);
+    }
+
+    return val / 2;
+}
+
+TEST_CASE("expected: value")
+{
+    auto ret = half(42);
+
+    CHECK(ret);
+    CHECK(ret.has_value());
+    CHECK(ret.value() == 21);
+    CHECK(ret.value_or(0) == 21);
+    CHECK(ret.error() == SUCCESS);
+}
+
+TEST_CASE("expected: error")
+{
+    auto ret = half(43);
+
+    CHECK(!ret);
+    CHECK(!ret.has_value());
+    CHECK(ret.value_or(0) == 0);
+    CHECK(ret.error() == BF_ERROR_INVALID_ARG);
+}
+
+TEST_CASE("expected: bool")
+{
+    bfn::expected<bool> handled = false;
+    bfn::expected<bool> failed = bfn::unexpected(VMEXIT_ERROR_UNHANDLED);
+
+    CHECK(handled);
+    CHECK(!handled.value());
+    CHECK(!failed);
+    CHECK(failed.error() == VMEXIT_ERROR_UNHANDLED);
+}
+
+TEST_CASE("expected: noexcept")
+{
+    CHECK(noexcept(half(42)));
+    CHECK(noexcept(half(42).value()));
+    CHECK(noexcept(half(42).error()));
+}
@@ -45,6 +45,14 @@ TEST_CASE("read with bad filename")
     CHECK_THROWS(g_file.read_binary(filename));
 }
 
+TEST_CASE("map with bad filename")
+{
+    std::string filename{"/blah/bad_filename.txt"};
+
+    CHECK_THROWS(g_file.map_binary(""));
+    CHECK_THROWS(g_file.map_binary(filename));
+}
+
 TEST_CASE("write with bad filename")
 {
     std::string filename{"/blah/bad_filename.txt"};
@@ -83,6 +91,31 @@ TEST_CASE("read / write success")
     REQUIRE(std::remove(filename.c_str()) == 0);
 }
 
+TEST_CASE("map success")
+{
+    std::string filename{"test.txt"};
+
+    bfn::buffer binary_data1{};
+    bfn::buffer binary_data2{'h', 'e', 'l', 'l', 'o'};
+
+    REQUIRE_NOTHROW(g_file.write_binary(filename, binary_data1));
+    CHECK(g_file.map_binary(filename).empty());
+
+    REQUIRE_NOTHROW(g_file.write_binary(filename, binary_data2));
+    {
+        auto data = g_file.map_binary(filename);
+
+        CHECK(data.size() == binary_data2.size());
+        CHECK(memcmp(data.data(), binary_data2.data(), data.size()) == 0);
+
+        auto moved = std::move(data);
+        CHECK(data.empty());
+        CHECK(moved.size() == binary_data2.size());
+    }
+
+    REQUIRE(std::remove(filename.c_str()) == 0);
+}
+
 TEST_CASE("extension")
 {
     CHECK(g_file.extension("").empty());
@@ -0,0 +1,182 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+#include <bfhypercallring.h>
+
+constexpr const auto num_iterations = 100000ULL;
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+// The stub VMM. Like the real consumer, it doubles reg2 and stores the
+// result in reg1, and rejects any opcode it does not know about.
+//
+constexpr const uint64_t stub_opcode = 42;
+
+static void
+stub_handler(bfn::hypercall_ring_entry_t &entry) noexcept
+{
+    if (entry.reg1 != stub_opcode) {
+        entry.reg1 = HYPERCALL_RING_UNHANDLED;
+        return;
+    }
+
+    entry.reg1 = entry.reg2 * 2;
+}
+
+static auto
+make_ring()
+{
+    auto ring = std::make_unique<bfn::hypercall_ring_t>();
+    bfn::hypercall_ring_init(ring.get());
+
+    return ring;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+TEST_CASE("init")
+{
+    auto ring = make_ring();
+
+    CHECK(ring->magic == HYPERCALL_RING_MAGIC);
+    CHECK(bfn::hypercall_ring_pending(ring.get()) == 0);
+}
+
+TEST_CASE("layout")
+{
+    CHECK(offsetof(bfn::hypercall_ring_t, sq_tail) == 64);
+    CHECK(offsetof(bfn::hypercall_ring_t, cq_tail) == 128);
+    CHECK(offsetof(bfn::hypercall_ring_t, cq_head) == 192);
+    CHECK(offsetof(bfn::hypercall_ring_t, entries) == 256);
+}
+
+TEST_CASE("reap empty")
+{
+    auto ring = make_ring();
+    bfn::hypercall_ring_entry_t entry{};
+
+    CHECK(!bfn::hypercall_ring_reap(ring.get(), entry));
+    CHECK(bfn::hypercall_ring_consume(ring.get(), stub_handler) == 0);
+}
+
+TEST_CASE("submit / consume / reap")
+{
+    auto ring = make_ring();
+    bfn::hypercall_ring_entry_t entry{};
+
+    CHECK(bfn::hypercall_ring_submit(ring.get(), {stub_opcode, 1, 0, 0}));
+    CHECK(bfn::hypercall_ring_submit(ring.get(), {stub_opcode, 2, 0, 0}));
+    CHECK(bfn::hypercall_ring_submit(ring.get(), {0, 3, 0, 0}));
+    CHECK(bfn::hypercall_ring_pending(ring.get()) == 3);
+
+    CHECK(!bfn::hypercall_ring_reap(ring.get(), entry));
+    CHECK(bfn::hypercall_ring_consume(ring.get(), stub_handler) == 3);
+    CHECK(bfn::hypercall_ring_pending(ring.get()) == 0);
+
+    CHECK(bfn::hypercall_ring_reap(ring.get(), entry));
+    CHECK(entry.reg1 == 2);
+    CHECK(bfn::hypercall_ring_reap(ring.get(), entry));
+    CHECK(entry.reg1 == 4);
+    CHECK(bfn::hypercall_ring_reap(ring.get(), entry));
+    CHECK(entry.reg1 == HYPERCALL_RING_UNHANDLED);
+    CHECK(!bfn::hypercall_ring_reap(ring.get(), entry));
+}
+
+TEST_CASE("full")
+{
+    auto ring = make_ring();
+    bfn::hypercall_ring_entry_t entry{};
+
+    for (auto i = 0ULL; i < HYPERCALL_RING_SIZE; i++) {
+        CHECK(bfn::hypercall_ring_submit(ring.get(), {stub_opcode, i, 0, 0}));
+    }
+
+    CHECK(!bfn::hypercall_ring_submit(ring.get(), {stub_opcode, 0, 0, 0}));
+    CHECK(bfn::hypercall_ring_consume(ring.get(), stub_handler) == HYPERCALL_RING_SIZE);
+
+    // Completed entries still occupy the ring until they are reaped
+
+    CHECK(!bfn::hypercall_ring_submit(ring.get(), {stub_opcode, 0, 0, 0}));
+    CHECK(bfn::hypercall_ring_reap(ring.get(), entry));
+    CHECK(bfn::hypercall_ring_submit(ring.get(), {stub_opcode, 0, 0, 0}));
+}
+
+TEST_CASE("corrupt sq_tail")
+{
+    auto ring = make_ring();
+
+    ring->sq_tail = HYPERCALL_RING_SIZE + 1;
+    CHECK(bfn::hypercall_ring_consume(ring.get(), stub_handler) == 0);
+    CHECK(ring->cq_tail == 0);
+}
+
+TEST_CASE("stub vmm")
+{
+    auto ring = make_ring();
+    std::atomic<bool> done{false};
+
+    // The stub VMM polls the ring from its own thread, the same way the VMM
+    // polls the ring on every VM exit when polling is enabled.
+
+    std::thread vmm([&] {
+        while (!done) {
+            bfn::hypercall_ring_consume(ring.get(), stub_handler);
+        }
+    });
+
+    auto submitted = 0ULL;
+    auto reaped = 0ULL;
+    auto errors = 0ULL;
+
+    while (reaped < num_iterations) {
+        while (submitted < num_iterations &&
+               bfn::hypercall_ring_submit(ring.get(), {stub_opcode, submitted, 0, 0})) {
+            submitted++;
+        }
+
+        bfn::hypercall_ring_entry_t entry{};
+        while (bfn::hypercall_ring_reap(ring.get(), entry)) {
+            if (entry.reg1 != reaped * 2) {
+                errors++;
+            }
+
+            reaped++;
+        }
+    }
+
+    done = true;
+    vmm.join();
+
+    CHECK(errors == 0);
+    CHECK(bfn::hypercall_ring_pending(ring.get()) == 0);
+}
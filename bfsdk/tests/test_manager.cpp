@@ -75,6 +75,41 @@ public:
 
 #define g_test_manager bfmanager<test, test_factory, test::id_t>::instance()
 
+class pooled_test_factory
+{
+public:
+    std::unique_ptr<test>
+    make(test::id_t id, void *obj)
+    {
+        bfignored(id);
+        bfignored(obj);
+
+        return std::make_unique<test>();
+    }
+
+    std::unique_ptr<test>
+    acquire(test::id_t id, void *obj)
+    {
+        if (m_pool) {
+            return std::move(m_pool);
+        }
+
+        return this->make(id, obj);
+    }
+
+    void
+    release(std::unique_ptr<test> t)
+    { m_pool = std::move(t); }
+
+    test *pooled() const
+    { return m_pool.get(); }
+
+private:
+    std::unique_ptr<test> m_pool;
+};
+
+#define g_pooled_test_manager bfmanager<test, pooled_test_factory, test::id_t>::instance()
+
 TEST_CASE("test_manager: support")
 {
     test_factory factory{};
@@ -151,3 +186,26 @@ TEST_CASE("test_manager: get invalid type")
     CHECK_THROWS(g_test_manager->get<not_a_test_base *>(0));
     g_test_manager->destroy(0);
 }
+
+TEST_CASE("test_manager: pooled factory recycles")
+{
+    g_pooled_test_manager->create(0);
+    auto t = g_pooled_test_manager->get(0).get();
+
+    g_pooled_test_manager->destroy(0);
+    CHECK(g_pooled_test_manager->factory()->pooled() == t);
+
+    g_pooled_test_manager->create(1);
+    CHECK(g_pooled_test_manager->get(1).get() == t);
+    CHECK(g_pooled_test_manager->factory()->pooled() == nullptr);
+
+    g_pooled_test_manager->destroy(1);
+}
+
+TEST_CASE("test_manager: pooled factory destroy without creating")
+{
+    auto pooled = g_pooled_test_manager->factory()->pooled();
+
+    CHECK_NOTHROW(g_pooled_test_manager->destroy(42));
+    CHECK(g_pooled_test_manager->factory()->pooled() == pooled);
+}
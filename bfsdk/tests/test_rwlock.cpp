@@ -0,0 +1,179 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <bfrwlock.h>
+
+constexpr const auto num_iterations = 10000ULL;
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+// The lock picks a reader slot using the CPU a thread is running on. Each
+// test thread gets its own ID here so that readers are spread across slots
+// the same way they would be in the VMM.
+//
+static std::atomic<uint64_t> g_next_cpuid{0};
+static thread_local uint64_t t_cpuid = g_next_cpuid++;
+
+extern "C" uint64_t
+thread_context_cpuid(void)
+{ return t_cpuid; }
+
+static uint64_t
+num_threads()
+{
+    auto num = std::thread::hardware_concurrency();
+    return num < 2 ? 2 : num;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+TEST_CASE("exclusive lock / unlock")
+{
+    bfn::rwlock lock;
+
+    lock.lock();
+    CHECK(!lock.try_lock());
+    CHECK(!lock.try_lock_shared());
+
+    lock.unlock();
+    CHECK(lock.try_lock());
+
+    lock.unlock();
+}
+
+TEST_CASE("shared lock / unlock")
+{
+    bfn::rwlock lock;
+
+    lock.lock_shared();
+    CHECK(lock.try_lock_shared());
+    CHECK(!lock.try_lock());
+
+    lock.unlock_shared();
+    CHECK(!lock.try_lock());
+
+    lock.unlock_shared();
+    CHECK(lock.try_lock());
+
+    lock.unlock();
+}
+
+TEST_CASE("std lock types")
+{
+    bfn::rwlock lock;
+
+    {
+        std::shared_lock<bfn::rwlock> guard1(lock);
+        std::shared_lock<bfn::rwlock> guard2(lock);
+        CHECK(!lock.try_lock());
+    }
+
+    {
+        std::lock_guard<bfn::rwlock> guard(lock);
+        CHECK(!lock.try_lock_shared());
+    }
+
+    CHECK(lock.try_lock_shared());
+    lock.unlock_shared();
+}
+
+TEST_CASE("readers on other cpus block the writer")
+{
+    bfn::rwlock lock;
+
+    std::atomic<bool> locked{false};
+    std::atomic<bool> release{false};
+
+    std::thread reader([&] {
+        lock.lock_shared();
+        locked = true;
+
+        while (!release) {
+            bfn::cpu_relax();
+        }
+
+        lock.unlock_shared();
+    });
+
+    while (!locked) {
+        bfn::cpu_relax();
+    }
+
+    CHECK(!lock.try_lock());
+
+    release = true;
+    reader.join();
+
+    CHECK(lock.try_lock());
+    lock.unlock();
+}
+
+TEST_CASE("readers and writers")
+{
+    bfn::rwlock lock;
+
+    uint64_t value1 = 0;
+    uint64_t value2 = 0;
+    std::atomic<uint64_t> torn{0};
+
+    std::vector<std::thread> threads;
+
+    for (auto t = 0ULL; t < num_threads(); t++) {
+        threads.emplace_back([&, t] {
+            for (auto i = 0ULL; i < num_iterations; i++) {
+                if (t == 0 || (i % 64) == 0) {
+                    std::lock_guard<bfn::rwlock> guard(lock);
+                    value1++;
+                    value2++;
+                }
+                else {
+                    std::shared_lock<bfn::rwlock> guard(lock);
+                    if (value1 != value2) {
+                        torn++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    auto writes = num_iterations + (num_threads() - 1) * ((num_iterations + 63) / 64);
+
+    CHECK(torn == 0);
+    CHECK(value1 == writes);
+    CHECK(value2 == writes);
+}
@@ -0,0 +1,177 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <bfdebug.h>
+#include <bfbenchmark.h>
+#include <bfticketlock.h>
+
+constexpr const auto num_iterations = 10000ULL;
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+// The following is the spinlock that the runtime's pthread_mutex_lock used
+// before the ticket lock, and is only here to benchmark against.
+//
+class cas_lock
+{
+public:
+
+    void lock() noexcept
+    {
+        while (!__sync_bool_compare_and_swap(&m_word, 0U, 1U))
+        { }
+    }
+
+    void unlock() noexcept
+    { m_word = 0; }
+
+private:
+    uint32_t m_word{0};
+};
+
+template<typename L>
+uint64_t
+contend(L &lock, uint64_t &counter, uint64_t num_threads)
+{
+    return benchmark([&] {
+        std::vector<std::thread> threads;
+
+        for (auto t = 0ULL; t < num_threads; t++) {
+            threads.emplace_back([&] {
+                for (auto i = 0ULL; i < num_iterations; i++) {
+                    std::lock_guard<L> guard(lock);
+                    counter++;
+                }
+            });
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    });
+}
+
+// Note that a ticket lock is only fair if every waiter is running. In the VMM
+// each thread owns a physical core, so we do the same here and never
+// oversubscribe the host, which would otherwise turn every hand-off into a
+// context switch.
+//
+static uint64_t
+num_threads()
+{
+    auto num = std::thread::hardware_concurrency();
+    return num == 0 ? 1 : num;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+TEST_CASE("lock / unlock")
+{
+    bfn::ticket_lock lock;
+    CHECK(!lock.is_locked());
+
+    lock.lock();
+    CHECK(lock.is_locked());
+
+    lock.unlock();
+    CHECK(!lock.is_locked());
+}
+
+TEST_CASE("try_lock")
+{
+    bfn::ticket_lock lock;
+
+    CHECK(lock.try_lock());
+    CHECK(!lock.try_lock());
+
+    lock.unlock();
+    CHECK(lock.try_lock());
+
+    lock.unlock();
+}
+
+TEST_CASE("pthread mutex initializer is unlocked")
+{
+    uint32_t word = 0xFFFFFFFF;
+
+    CHECK(!bfn::ticketlock::is_locked(&word));
+    CHECK(bfn::ticketlock::try_acquire(&word));
+    CHECK(bfn::ticketlock::is_locked(&word));
+
+    bfn::ticketlock::release(&word);
+    CHECK(!bfn::ticketlock::is_locked(&word));
+    CHECK(word == 0);
+}
+
+TEST_CASE("tickets wrap")
+{
+    uint32_t word = 0xFFFEFFFE;
+
+    for (auto i = 0; i < 4; i++) {
+        bfn::ticketlock::acquire(&word);
+        CHECK(bfn::ticketlock::is_locked(&word));
+
+        bfn::ticketlock::release(&word);
+        CHECK(!bfn::ticketlock::is_locked(&word));
+    }
+
+    CHECK(word == 0x00020002);
+}
+
+TEST_CASE("mutual exclusion")
+{
+    uint64_t counter = 0;
+    bfn::ticket_lock lock;
+
+    contend(lock, counter, num_threads());
+    CHECK(counter == num_iterations * num_threads());
+    CHECK(!lock.is_locked());
+}
+
+TEST_CASE("contention benchmark")
+{
+    uint64_t ticket_counter = 0;
+    uint64_t cas_counter = 0;
+
+    bfn::ticket_lock ticket;
+    cas_lock cas;
+
+    auto ticket_time = contend(ticket, ticket_counter, num_threads());
+    auto cas_time = contend(cas, cas_counter, num_threads());
+
+    CHECK(ticket_counter == num_iterations * num_threads());
+    CHECK(cas_counter == num_iterations * num_threads());
+
+    bfdebug_ndec(0, "threads", num_threads());
+    bfdebug_subndec(0, "ticket lock (ns)", ticket_time);
+    bfdebug_subndec(0, "cas spinlock (ns)", cas_time);
+}
@@ -0,0 +1,146 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DECODER_INTEL_X64_H
+#define DECODER_INTEL_X64_H
+
+#include <hve/arch/intel_x64/vcpu.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+/// Decoder
+///
+/// The following decodes the register and memory operands that the hardware
+/// provides in the exit qualification and VM-exit instruction information
+/// fields. Each register operand is returned using the hardware encoding of
+/// the general purpose registers, which can be given directly to
+/// vcpu::gpr() and vcpu::set_gpr(). All of these functions take the raw
+/// field so that a handler only has to read the VMCS once.
+///
+namespace bfvmm::intel_x64::decoder
+{
+
+/// Control Register Access GPR
+///
+/// @expects none
+/// @ensures none
+///
+/// @param qualification the exit qualification of a control register access
+/// @return the general purpose register used by the MOV to/from CR
+///
+inline uint64_t
+cr_access_gpr(uint64_t qualification) noexcept
+{
+    using namespace vmcs_n::exit_qualification::control_register_access;
+    return (qualification & general_purpose_register::mask) >> general_purpose_register::from;
+}
+
+/// MOV DR GPR
+///
+/// @expects none
+/// @ensures none
+///
+/// @param qualification the exit qualification of a MOV DR
+/// @return the general purpose register used by the MOV to/from DR
+///
+inline uint64_t
+mov_dr_gpr(uint64_t qualification) noexcept
+{
+    using namespace vmcs_n::exit_qualification::mov_dr;
+    return (qualification & general_purpose_register::mask) >> general_purpose_register::from;
+}
+
+/// Instruction Information Reg1
+///
+/// @expects none
+/// @ensures none
+///
+/// @param info the VM-exit instruction information
+/// @return the general purpose register encoded in bits 6:3
+///
+inline uint64_t
+reg1(uint64_t info) noexcept
+{
+    using namespace vmcs_n::vm_exit_instruction_information::vmread;
+    return (info & reg1::mask) >> reg1::from;
+}
+
+/// Instruction Information Reg2
+///
+/// @expects none
+/// @ensures none
+///
+/// @param info the VM-exit instruction information
+/// @return the general purpose register encoded in bits 31:28
+///
+inline uint64_t
+reg2(uint64_t info) noexcept
+{
+    using namespace vmcs_n::vm_exit_instruction_information::invept;
+    return (info & reg2::mask) >> reg2::from;
+}
+
+/// Memory Operand
+///
+/// Computes the effective address of a memory operand using the base,
+/// index and scale found in the VM-exit instruction information, and the
+/// displacement found in the exit qualification. The segment base is not
+/// added, as it is ignored in 64bit mode for all but FS and GS.
+///
+/// @expects none
+/// @ensures none
+///
+/// @param vcpu the vcpu whose registers are used to compute the address
+/// @param info the VM-exit instruction information
+/// @param displacement the exit qualification
+/// @return the effective address of the memory operand
+///
+inline uint64_t
+memory_operand(const vcpu *vcpu, uint64_t info, uint64_t displacement) noexcept
+{
+    using namespace vmcs_n::vm_exit_instruction_information::invept;
+    auto addr = displacement;
+
+    if ((info & base_reg_invalid::mask) == 0) {
+        addr += vcpu->gpr((info & base_reg::mask) >> base_reg::from);
+    }
+
+    if ((info & index_reg_invalid::mask) == 0) {
+        addr += vcpu->gpr((info & index_reg::mask) >> index_reg::from) << (info & scaling::mask);
+    }
+
+    switch ((info & address_size::mask) >> address_size::from) {
+        case address_size::_16bit:
+            return addr & 0xFFFFU;
+
+        case address_size::_32bit:
+            return addr & 0xFFFFFFFFU;
+
+        default:
+            return addr;
+    }
+}
+
+}
+
+#endif
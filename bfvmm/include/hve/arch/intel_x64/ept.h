@@ -70,6 +70,17 @@ public:
     ///
     void set_eptp(ept::mmap *map);
 
+    /// Reset
+    ///
+    /// Drops the EPTP without touching the VMCS, so that a recycled vCPU
+    /// starts with EPT disabled. The caller is expected to reset the VMCS
+    /// as well, which disables EPT in hardware.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    void reset();
+
     /// Invalidate EPT
     ///
     /// @expects
@@ -449,6 +449,10 @@ identity_map_convert_4k_to_2m(
 /// range that is not on a 2m boundry in which case 4k is used. Regular RAM
 /// is likely to be mapped using 2m regions.
 ///
+/// The MTRRs are queried once per run of memory with the same memory type
+/// (and not once per page), and each run is then mapped with the largest
+/// pages that fit in it.
+///
 /// Note that this version should ALWAYS be used when creating an EPT memory
 /// map for the Host OS, as using EPT ignores the MTRRs which can cause
 /// corruption on the host OS.
@@ -466,26 +470,27 @@ identity_map(
     mmap::attr_type attr = mmap::attr_type::read_write_execute)
 {
     using namespace ::intel_x64::ept;
-    auto range = g_mtrrs->ranges().begin();
 
     expects(g_mtrrs->size() != 0);
     expects(bfn::lower(saddr, pd::from) == 0);
     expects(bfn::lower(eaddr, pd::from) == 0);
 
     while (saddr < eaddr) {
-        while (!range->contains(saddr)) {
-            range++;
-        }
-
-        if (bfn::lower(saddr, pd::from) == 0 &&
-            std::min(range->distance(saddr), eaddr - saddr) >= pd::page_size
-           ) {
-            map.map_2m(saddr, saddr, attr, range->type);
-            saddr += pd::page_size;
-        }
-        else {
-            map.map_4k(saddr, saddr, attr, range->type);
-            saddr += pt::page_size;
+        auto type = g_mtrrs->type_of(saddr);
+        auto run = std::min(g_mtrrs->largest_uniform_run(saddr), eaddr - saddr);
+
+        expects(run >= pt::page_size);
+        auto end = saddr + run;
+
+        while (saddr < end) {
+            if (bfn::lower(saddr, pd::from) == 0 && end - saddr >= pd::page_size) {
+                map.map_2m(saddr, saddr, attr, type);
+                saddr += pd::page_size;
+            }
+            else {
+                map.map_4k(saddr, saddr, attr, type);
+                saddr += pt::page_size;
+            }
         }
     }
 }
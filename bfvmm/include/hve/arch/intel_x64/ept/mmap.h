@@ -23,9 +23,11 @@
 #define EPT_MMAP_INTEL_X64_H
 
 #include <mutex>
+#include <shared_mutex>
 
 #include <bfgsl.h>
 #include <bfdebug.h>
+#include <bfrwlock.h>
 #include <bfupperlower.h>
 
 #include <intrinsics.h>
@@ -400,39 +402,14 @@ public:
     std::pair<std::reference_wrapper<entry_type>, uintptr_t>
     entry(void *virt_addr)
     {
-        std::lock_guard lock(m_mutex);
-        using namespace ::intel_x64::ept;
-
-        this->map_pdpt(pml4::index(virt_addr));
-        auto &pdpte = m_pdpt.virt_addr.at(pdpt::index(virt_addr));
-
-        if (pdpte == 0) {
-            throw std::runtime_error("entry: pdpte not mapped");
-        }
-
-        if (pdpt::entry::ps::is_enabled(pdpte)) {
-            return {pdpte, pdpt::from};
-        }
-
-        this->map_pd(pdpt::index(virt_addr));
-        auto &pde = m_pd.virt_addr.at(pd::index(virt_addr));
-
-        if (pde == 0) {
-            throw std::runtime_error("entry: pde not mapped");
-        }
-
-        if (pd::entry::ps::is_enabled(pde)) {
-            return {pde, pd::from};
-        }
-
-        this->map_pt(pd::index(virt_addr));
-        auto &pte = m_pt.virt_addr.at(pt::index(virt_addr));
+        std::shared_lock lock(m_mutex);
 
-        if (pte == 0) {
-            throw std::runtime_error("entry: pte not mapped");
+        auto [entry_ptr, entry_from] = this->walk(virt_addr);
+        if (entry_ptr == nullptr || *entry_ptr == 0) {
+            throw std::runtime_error("entry: virt_addr not mapped");
         }
 
-        return {pte, pt::from};
+        return {*entry_ptr, entry_from};
     }
 
     /// Virtual Address to Entry
@@ -469,48 +446,33 @@ public:
     std::pair<uintptr_t, uintptr_t>
     virt_to_phys(virt_addr_t virt_addr)
     {
-        std::lock_guard lock(m_mutex);
+        std::shared_lock lock(m_mutex);
         using namespace ::intel_x64::ept;
 
-        this->map_pdpt(pml4::index(virt_addr));
-        auto pdpte = m_pdpt.virt_addr.at(pdpt::index(virt_addr));
-
-        if (pdpte == 0) {
-            throw std::runtime_error("virt_to_phys: pdpte not mapped");
+        auto [entry_ptr, entry_from] = this->walk(reinterpret_cast<void *>(virt_addr));
+        if (entry_ptr == nullptr || *entry_ptr == 0) {
+            throw std::runtime_error("virt_to_phys: virt_addr not mapped");
         }
 
-        if (pdpt::entry::ps::is_enabled(pdpte)) {
-            return {
-                pdpt::entry::phys_addr::get(pdpte) | bfn::lower(virt_addr, pdpt::from),
-                pdpt::from
-            };
+        switch (entry_from) {
+            case pdpt::from:
+                return {
+                    pdpt::entry::phys_addr::get(*entry_ptr) | bfn::lower(virt_addr, entry_from),
+                    entry_from
+                };
+
+            case pd::from:
+                return {
+                    pd::entry::phys_addr::get(*entry_ptr) | bfn::lower(virt_addr, entry_from),
+                    entry_from
+                };
+
+            default:
+                return {
+                    pt::entry::phys_addr::get(*entry_ptr) | bfn::lower(virt_addr, entry_from),
+                    entry_from
+                };
         }
-
-        this->map_pd(pdpt::index(virt_addr));
-        auto pde = m_pd.virt_addr.at(pd::index(virt_addr));
-
-        if (pde == 0) {
-            throw std::runtime_error("virt_to_phys: pde not mapped");
-        }
-
-        if (pd::entry::ps::is_enabled(pde)) {
-            return {
-                pd::entry::phys_addr::get(pde) | bfn::lower(virt_addr, pd::from),
-                pd::from
-            };
-        }
-
-        this->map_pt(pd::index(virt_addr));
-        auto pte = m_pt.virt_addr.at(pt::index(virt_addr));
-
-        if (pte == 0) {
-            throw std::runtime_error("virt_to_phys: pte not mapped");
-        }
-
-        return {
-            pt::entry::phys_addr::get(pte) | bfn::lower(virt_addr, pt::from),
-            pt::from
-        };
     }
 
     /// Virtual Address to From
@@ -524,39 +486,14 @@ public:
     uintptr_t
     from(void *virt_addr)
     {
-        std::lock_guard lock(m_mutex);
-        using namespace ::intel_x64::ept;
-
-        this->map_pdpt(pml4::index(virt_addr));
-        auto pdpte = m_pdpt.virt_addr.at(pdpt::index(virt_addr));
+        std::shared_lock lock(m_mutex);
 
-        if (pdpte == 0) {
-            throw std::runtime_error("from: pdpte not mapped");
+        auto [entry_ptr, entry_from] = this->walk(virt_addr);
+        if (entry_ptr == nullptr || *entry_ptr == 0) {
+            throw std::runtime_error("from: virt_addr not mapped");
         }
 
-        if (pdpt::entry::ps::is_enabled(pdpte)) {
-            return pdpt::from;
-        }
-
-        this->map_pd(pdpt::index(virt_addr));
-        auto pde = m_pd.virt_addr.at(pd::index(virt_addr));
-
-        if (pde == 0) {
-            throw std::runtime_error("from: pde not mapped");
-        }
-
-        if (pd::entry::ps::is_enabled(pde)) {
-            return pd::from;
-        }
-
-        this->map_pt(pd::index(virt_addr));
-        auto pte = m_pt.virt_addr.at(pt::index(virt_addr));
-
-        if (pte == 0) {
-            throw std::runtime_error("from: pte not mapped");
-        }
-
-        return pt::from;
+        return entry_from;
     }
 
     /// Virtual Address to From
@@ -680,7 +617,7 @@ private:
 private:
 
     pair
-    phys_to_pair(phys_addr_t phys_addr, size_type num_entries)
+    phys_to_pair(phys_addr_t phys_addr, size_type num_entries) const
     {
         auto virt_addr =
             static_cast<virt_addr_t *>(
@@ -693,6 +630,44 @@ private:
         };
     }
 
+    // Read-only page walk used by the lookup functions. Unlike map_pdpt(),
+    // map_pd() and map_pt(), this neither allocates missing tables nor
+    // updates the last lookup cache (m_pdpt, m_pd and m_pt), so it is safe
+    // to run concurrently under a shared lock. Returns the entry that maps
+    // the address along with its page size, or nullptr if the PML4 entry
+    // is not present.
+    //
+    std::pair<entry_type *, uintptr_t>
+    walk(void *virt_addr) const
+    {
+        using namespace ::intel_x64::ept;
+
+        auto pml4e = m_pml4.virt_addr.at(pml4::index(virt_addr));
+        if (pml4e == 0) {
+            return {nullptr, pdpt::from};
+        }
+
+        auto pdpt_span =
+            phys_to_pair(pml4::entry::phys_addr::get(pml4e), pdpt::num_entries).virt_addr;
+        auto &pdpte = pdpt_span.at(pdpt::index(virt_addr));
+
+        if (pdpte == 0 || pdpt::entry::ps::is_enabled(pdpte)) {
+            return {&pdpte, pdpt::from};
+        }
+
+        auto pd_span =
+            phys_to_pair(pdpt::entry::phys_addr::get(pdpte), pd::num_entries).virt_addr;
+        auto &pde = pd_span.at(pd::index(virt_addr));
+
+        if (pde == 0 || pd::entry::ps::is_enabled(pde)) {
+            return {&pde, pd::from};
+        }
+
+        auto pt_span =
+            phys_to_pair(pd::entry::phys_addr::get(pde), pt::num_entries).virt_addr;
+        return {&pt_span.at(pt::index(virt_addr)), pt::from};
+    }
+
     void
     map_pdpt(index_type pml4i)
     {
@@ -1189,7 +1164,7 @@ private:
     pair m_pd;
     pair m_pt;
 
-    mutable std::mutex m_mutex;
+    mutable bfn::rwlock m_mutex;
 
 public:
 
@@ -72,6 +72,8 @@ extern "C" void _esr29(void) noexcept;
 extern "C" void _esr30(void) noexcept;
 extern "C" void _esr31(void) noexcept;
 
+extern "C" void _esr7_lazy_xsave(void) noexcept;
+
 /// @endcond
 
 // *INDENT-ON*
@@ -23,6 +23,7 @@
 #define EXIT_HANDLER_INTEL_X64_H
 
 #include <bfdelegate.h>
+#include <bfexpected.h>
 
 #include <list>
 #include <array>
@@ -49,6 +50,28 @@ class exit_handler;
 ///
 using handler_delegate_t = delegate<bool(bfvmm::intel_x64::vcpu *)>;
 
+/// Exit result type
+///
+/// The result of a result delegate. The value is true if the VM exit was
+/// handled and false if the next delegate should be given a chance to handle
+/// it. An error code (see bferrorcodes.h) is returned instead if the VM exit
+/// cannot be handled at all, which halts the vCPU without unwinding.
+///
+using exit_result_t = bfn::expected<bool>;
+
+/// Result exit handler delegate type
+///
+using result_delegate_t = delegate<exit_result_t(bfvmm::intel_x64::vcpu *)>;
+
+/// Fast exit handler type
+///
+/// A fast handler is a plain function that is called directly from
+/// exit_handler_entry, before any of the C++ dispatch logic executes. It
+/// returns true if it handled the VM exit, in which case the guest is
+/// resumed immediately, or false to fall back to the normal handlers.
+///
+using fast_handler_t = bool (*)(bfvmm::intel_x64::vcpu *) noexcept;
+
 // -----------------------------------------------------------------------------
 // Dispatcher
 // -----------------------------------------------------------------------------
@@ -67,6 +90,16 @@ using handler_delegate_t = delegate<bool(bfvmm::intel_x64::vcpu *)>;
 extern "C" void handle_exit(
     bfvmm::intel_x64::vcpu *vcpu, bfvmm::intel_x64::exit_handler *exit_handler);
 
+/// Fast Path Failure
+///
+/// This function is called by the exit_handler_entry if the vmresume
+/// executed on behalf of a fast handler fails.
+///
+/// @param vcpu the vcpu associated with the VM exit
+///
+extern "C" void handle_fast_exit_failure(
+    bfvmm::intel_x64::vcpu *vcpu);
+
 // -----------------------------------------------------------------------------
 // Exit Handler
 // -----------------------------------------------------------------------------
@@ -131,6 +164,48 @@ public:
         const handler_delegate_t &d
     );
 
+    /// Remove Handler Delegate
+    ///
+    /// Removes a handler previously registered with add_handler(). If the
+    /// handler was not registered, nothing happens.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param reason The exit reason the handler was registered for
+    /// @param d The delegate being removed
+    ///
+    void remove_handler(
+        ::intel_x64::vmcs::value_type reason,
+        const handler_delegate_t &d
+    );
+
+    /// Add Result Handler Delegate
+    ///
+    /// Adds a result handler for a specific exit reason. Result handlers
+    /// report failures with an error code instead of an exception, and are
+    /// executed before the delegates registered with add_handler(), outside
+    /// of any try / catch. If a result handler handles the VM exit, the
+    /// guest is resumed without an exception ever being thrown. If it
+    /// returns an error code, the vCPU is halted. Like add_handler(), the
+    /// handlers are called in the reverse order they are registered.
+    ///
+    /// @note Result handlers must not throw. They are executed from a
+    ///     noexcept function, so an exception terminates the VMM instead
+    ///     of being reported. Handlers that can throw (e.g. because they
+    ///     allocate memory) should be registered with add_handler().
+    ///
+    /// @expects reason < 128
+    /// @ensures none
+    ///
+    /// @param reason The exit reason for the handler being registered
+    /// @param d The delegate being registered
+    ///
+    void add_result_handler(
+        ::intel_x64::vmcs::value_type reason,
+        const result_delegate_t &d
+    );
+
     /// Add Exit Delegate
     ///
     /// Adds an exit function to the exit list. Exit functions are executed
@@ -148,10 +223,55 @@ public:
         const handler_delegate_t &d
     );
 
+    /// Set Fast Handler
+    ///
+    /// Sets the fast handler for a specific exit reason. A fast handler is
+    /// executed by exit_handler_entry directly, without saving the guest's
+    /// control and debug registers, without executing any of the exit
+    /// delegates, handler delegates or resume delegates, and without
+    /// exception support. If the fast handler returns true, the guest is
+    /// resumed right away. If it returns false, the VM exit is handled as
+    /// if no fast handler were registered, which means the fast handler
+    /// must not modify any of the guest's state in this case.
+    ///
+    /// Only one fast handler can be registered per exit reason. Passing
+    /// nullptr removes the fast handler.
+    ///
+    /// @note Fast handlers must be leaf functions that do not throw. They
+    ///     are meant for the hottest exit reasons (e.g., CPUID and RDTSC)
+    ///     and should do as little as possible. Since the guest is resumed
+    ///     without going through vcpu::run(), they also must not use the
+    ///     vCPU setters that are backed by the VMCS write cache (see
+    ///     vcpu::flush_vmcs_writes()).
+    ///
+    /// @expects reason < 128
+    /// @ensures none
+    ///
+    /// @param reason The exit reason for the handler being registered
+    /// @param func The fast handler being registered
+    ///
+    void set_fast_handler(
+        ::intel_x64::vmcs::value_type reason,
+        fast_handler_t func
+    );
+
+    /// @cond
+
+    const fast_handler_t *fast_handlers() const noexcept
+    { return m_fast_handlers.data(); }
+
+    /// @endcond
+
+private:
+
+    exit_result_t handle_results(bfvmm::intel_x64::vcpu *vcpu) const noexcept;
+
 private:
 
     std::list<handler_delegate_t> m_exit_handlers;
     std::array<std::list<handler_delegate_t>, 128> m_exit_handlers_array;
+    std::array<std::list<result_delegate_t>, 128> m_result_handlers_array;
+    std::array<fast_handler_t, 128> m_fast_handlers{};
 
 public:
 
@@ -22,7 +22,8 @@
 #ifndef INTERRUPT_QUEUE_INTEL_X64_H
 #define INTERRUPT_QUEUE_INTEL_X64_H
 
-#include <queue>
+#include <array>
+#include <cstdint>
 
 // -----------------------------------------------------------------------------
 // Definitions
@@ -33,7 +34,14 @@ namespace bfvmm::intel_x64
 
 /// Interrupt Queue
 ///
-/// Simple queue designed to work with external interrupts.
+/// Pending external interrupts are stored in a 256 bit bitmap, one bit per
+/// vector, the same way the APIC's IRR stores them. Pushing a vector that
+/// is already pending is a no-op, and pop() always returns the highest
+/// pending vector, which is the one with the highest priority.
+///
+/// push() is lock free and does not allocate, so it is safe to call from
+/// any core. pop() and empty() should only be called by the core that owns
+/// the vCPU.
 ///
 class interrupt_queue
 {
@@ -57,9 +65,10 @@ public:
 
     /// Push
     ///
-    /// Add an interrupt vector to the queue
+    /// Add an interrupt vector to the queue. If the vector is already
+    /// pending, this function does nothing.
     ///
-    /// @expects
+    /// @expects vector < 256
     /// @ensures
     ///
     /// @param vector the vector number to add to the queue
@@ -68,7 +77,7 @@ public:
 
     /// Pop
     ///
-    /// Removes a vector from the queue, and returns it.
+    /// Removes the highest priority vector from the queue, and returns it.
     ///
     /// @expects
     /// @ensures
@@ -83,14 +92,13 @@ public:
     /// @expects
     /// @ensures
     ///
-    /// @return returns the removed vector or throws if the queue
-    ///     is empty
+    /// @return returns true if no vectors are pending, false otherwise
     ///
     bool empty() const;
 
 private:
 
-    std::queue<uint64_t> m_vectors;
+    std::array<uint64_t, 4> m_irr{};
 
 public:
 
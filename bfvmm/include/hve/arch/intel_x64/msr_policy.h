@@ -0,0 +1,217 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef MSR_POLICY_INTEL_X64_H
+#define MSR_POLICY_INTEL_X64_H
+
+#include <vector>
+
+#include <bfgsl.h>
+#include <intrinsics.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfvmm::intel_x64
+{
+
+class vcpu;
+
+/// MSR Policy
+///
+/// Provides a declarative way of describing how the guest accesses MSRs.
+/// A policy is a list of rules that is compiled into both the hardware MSR
+/// bitmap and a dense emulation table. The bitmap ensures that only the
+/// MSRs that need the VMM trap, and the table allows the rules that emulate
+/// an MSR to be serviced with an array lookup, ahead of the rdmsr / wrmsr
+/// handlers, instead of a search through the handler maps.
+///
+/// Example:
+/// @code
+/// vcpu->set_msr_policy({
+///     {0x00000048, msr_policy::type_t::shadow, 0, 0x7, true},
+///     {0x000001A0, msr_policy::type_t::masked, 0, 0x1},
+///     {0x00000140, msr_policy::type_t::constant, 0},
+/// });
+/// @endcode
+///
+class msr_policy
+{
+public:
+
+    /// Rule Type
+    ///
+    /// - passthrough: reads and writes do not trap
+    /// - trap: reads and writes trap and are serviced by the rdmsr / wrmsr
+    ///   handlers (i.e., the policy only sets the MSR bitmap)
+    /// - constant: reads return the rule's value, writes are ignored
+    /// - shadow: reads return the shadowed value (which starts as the rule's
+    ///   value), writes update the bits of the shadowed value that are set in
+    ///   the rule's mask, and if writeback is enabled, the result is also
+    ///   written to the MSR
+    /// - masked: reads do not trap, writes only update the bits of the MSR
+    ///   that are set in the rule's mask
+    ///
+    enum class type_t : uint8_t {
+        passthrough,
+        trap,
+        constant,
+        shadow,
+        masked
+    };
+
+    /// Rule
+    ///
+    struct rule_t {
+
+        /// MSR
+        ///
+        /// The address of the MSR this rule applies to. This must be an
+        /// address covered by the MSR bitmap.
+        ///
+        uint32_t msr;
+
+        /// Type
+        ///
+        type_t type;
+
+        /// Value
+        ///
+        /// The constant value for constant rules, or the initial value for
+        /// shadow rules.
+        ///
+        uint64_t value{0};
+
+        /// Mask
+        ///
+        /// The bits that the guest is allowed to write for shadow and masked
+        /// rules.
+        ///
+        uint64_t mask{0xFFFFFFFFFFFFFFFF};
+
+        /// Writeback
+        ///
+        /// If true, writes to a shadow rule are also written to the MSR.
+        ///
+        bool writeback{false};
+    };
+
+    /// Constructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param vcpu the vcpu object for this msr policy
+    ///
+    msr_policy(
+        gsl::not_null<vcpu *> vcpu);
+
+    /// Destructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    ~msr_policy() = default;
+
+    /// Compile
+    ///
+    /// Replaces the current emulation table with the provided rules, and
+    /// updates the MSR bitmap for each MSR in the provided rules. The bitmap
+    /// bits of MSRs that are not in the provided rules are not modified.
+    ///
+    /// @expects each rule's msr is covered by the MSR bitmap
+    /// @expects rules.size() < 256
+    /// @ensures
+    ///
+    /// @param rules the rules to compile
+    ///
+    void compile(const std::vector<rule_t> &rules);
+
+    /// Reset
+    ///
+    /// Compiles the last compiled rules again, which restores the initial
+    /// value of each shadow rule and the MSR bitmap bits of each rule, so
+    /// that a recycled vCPU does not see the values written by the guest
+    /// that last used it.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    void reset();
+
+    /// Value
+    ///
+    /// Returns the current value of a constant or shadow rule. This is
+    /// useful for saving the guest's view of a shadowed MSR.
+    ///
+    /// @expects msr has a constant or shadow rule
+    /// @ensures
+    ///
+    /// @param msr the msr to get the value of
+    /// @return the current value of the rule
+    ///
+    uint64_t value(uint32_t msr) const;
+
+public:
+
+    /// @cond
+
+    bool handle_rdmsr(vcpu *vcpu);
+    bool handle_wrmsr(vcpu *vcpu);
+
+    /// @endcond
+
+private:
+
+    struct entry_t {
+        uint64_t value;
+        uint64_t mask;
+        type_t type;
+        bool writeback;
+    };
+
+    entry_t *lookup(uint64_t msr) noexcept;
+
+private:
+
+    vcpu *m_vcpu;
+
+    std::vector<rule_t> m_rules;
+    std::vector<uint8_t> m_index;
+    std::vector<entry_t> m_entries;
+
+public:
+
+    /// @cond
+
+    msr_policy(msr_policy &&) = default;
+    msr_policy &operator=(msr_policy &&) = default;
+
+    msr_policy(const msr_policy &) = delete;
+    msr_policy &operator=(const msr_policy &) = delete;
+
+    /// @endcond
+};
+
+}
+
+#endif
@@ -50,6 +50,11 @@ namespace bfvmm::intel_x64
 /// match what is in the MSRs, but instead provides a corrected version that
 /// is continuous and non-overlapping.
 ///
+/// The corrected ranges are also indexed as a sorted list of runs, where
+/// neighbouring ranges of the same memory type are merged, so that the
+/// memory type of an address, and how far that type extends, can be found
+/// with a binary search instead of walking the ranges.
+///
 class mtrrs
 {
 public:
@@ -153,6 +158,38 @@ public:
     auto size() const
     { return m_num; }
 
+    /// Type Of
+    ///
+    /// Returns the memory type of the provided physical address. This is
+    /// O(log n) in the number of ranges.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param addr the physical address to look up
+    /// @return returns the memory type of addr. If addr is not covered by
+    ///     any range (i.e. size() == 0), uncacheable is returned.
+    ///
+    ept::mmap::memory_type type_of(uint64_t addr) const noexcept;
+
+    /// Largest Uniform Run
+    ///
+    /// Returns the number of bytes, starting at the provided physical
+    /// address, that have the same memory type as the address. Code like
+    /// EPT can use this to pick the largest page size that can be used to
+    /// map an address without spanning more than one memory type. This is
+    /// O(log n) in the number of ranges.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param addr the physical address to look up
+    /// @return returns the number of bytes from addr to the end of its run.
+    ///     If addr is not covered by any range (i.e. size() == 0), 0 is
+    ///     returned.
+    ///
+    uint64_t largest_uniform_run(uint64_t addr) const noexcept;
+
     /// Dump
     ///
     /// Prints the MTRR ranges.
@@ -172,6 +209,9 @@ private:
     void get_variable_ranges();
 
     bool make_continuous();
+    void make_index();
+
+    const range_t *find_run(uint64_t addr) const noexcept;
 
     void add_range(const range_t &range);
     void add_range(uint64_t ia32_mtrr_physbase, uint64_t ia32_mtrr_physmask);
@@ -181,6 +221,9 @@ private:
     uint8_t m_num{0};
     std::array<range_t, 256> m_ranges;
 
+    uint8_t m_num_runs{0};
+    std::array<range_t, 256> m_runs;
+
 public:
 
     // @cond
@@ -0,0 +1,150 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef POSTED_INTERRUPT_INTEL_X64_H
+#define POSTED_INTERRUPT_INTEL_X64_H
+
+#include <array>
+#include <cstdint>
+
+#include <bfgsl.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfvmm::intel_x64
+{
+
+/// Posted Interrupt Descriptor
+///
+/// Implements the 64 byte posted-interrupt descriptor defined by the Intel
+/// SDM (see section 29.6). A vector is posted by setting its bit in the
+/// posted-interrupt requests (PIR) and then setting the outstanding
+/// notification (ON) bit. Whoever sets ON is responsible for notifying the
+/// vCPU, either by sending the notification vector to the physical core
+/// running the vCPU (in which case the hardware moves the PIR into the
+/// virtual-APIC page without a VM exit), or by calling sync() on the next VM
+/// exit.
+///
+/// post() is lock free and does not allocate, so it is safe to call from
+/// any core. sync() should only be called by the core that owns the vCPU
+/// while the vCPU is not running, which is also the only time the hardware
+/// would not be the one consuming the descriptor.
+///
+class posted_interrupt_descriptor
+{
+public:
+
+    using vector_t = uint64_t;              ///< Vector type
+
+    /// Post
+    ///
+    /// Marks the vector as pending in the PIR and sets the outstanding
+    /// notification bit.
+    ///
+    /// @expects vector < 256
+    /// @ensures
+    ///
+    /// @param vector the vector to post
+    /// @return returns true if the outstanding notification bit was not
+    ///     already set, meaning the caller must notify the vCPU
+    ///
+    bool post(vector_t vector);
+
+    /// Pending
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns true if the outstanding notification bit is set
+    ///
+    bool pending() const;
+
+    /// Sync
+    ///
+    /// Clears the outstanding notification bit, and moves all of the
+    /// posted vectors into the VIRR of the provided virtual-APIC page. This
+    /// is the software equivalent of the hardware's posted-interrupt
+    /// processing, and is used when the notification vector was not
+    /// delivered while the guest was running.
+    ///
+    /// @expects virtual_apic_page.size() >= 0x400
+    /// @ensures
+    ///
+    /// @param virtual_apic_page the virtual-APIC page of the vCPU
+    /// @return returns the highest vector that was moved into the VIRR, or
+    ///     0 if no vectors were pending
+    ///
+    vector_t sync(gsl::span<uint32_t> virtual_apic_page);
+
+    /// Set Notification Vector
+    ///
+    /// @expects vector < 256
+    /// @ensures
+    ///
+    /// @param vector the vector the hardware recognizes as a notification
+    ///
+    void set_notification_vector(vector_t vector);
+
+    /// Set Notification Destination
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param apic_id the x2APIC ID of the core that is notified
+    ///
+    void set_notification_destination(uint32_t apic_id);
+
+    /// Notification Vector
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the notification vector
+    ///
+    vector_t notification_vector() const;
+
+    /// Notification Destination
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the x2APIC ID of the core that is notified
+    ///
+    uint32_t notification_destination() const;
+
+private:
+
+    std::array<uint64_t, 4> m_pir{};
+    uint64_t m_control{};
+    std::array<uint64_t, 3> m_reserved{};
+};
+
+/// @cond
+
+static_assert(sizeof(posted_interrupt_descriptor) == 64);
+
+/// @endcond
+
+}
+
+#endif
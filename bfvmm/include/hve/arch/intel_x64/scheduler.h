@@ -0,0 +1,356 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SCHEDULER_INTEL_X64_H
+#define SCHEDULER_INTEL_X64_H
+
+#include <list>
+#include <cstdint>
+
+#include <bfgsl.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfvmm::intel_x64
+{
+
+class vcpu;
+
+/// Run Queue
+///
+/// Implements the scheduling policy used by the scheduler. vCPUs are run in
+/// round robin order, each for its own time slice. All of the functions in
+/// this class are given the current time (in TSC ticks) instead of reading
+/// the TSC themselves, which keeps the policy independent of the hardware
+/// so that it can be tested with a simulated clock.
+///
+/// The run queue is per physical core, and is not thread safe.
+///
+class run_queue
+{
+public:
+
+    using tick_t = uint64_t;                ///< Time type (in TSC ticks)
+
+    /// Constructor
+    ///
+    /// @expects slice != 0
+    /// @ensures
+    ///
+    /// @param slice the default time slice given to each vCPU
+    ///
+    explicit run_queue(tick_t slice);
+
+    /// Destructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    ~run_queue() = default;
+
+    /// Add
+    ///
+    /// Adds a vCPU to the end of the run queue.
+    ///
+    /// @expects vcpu is not already in the run queue
+    /// @ensures
+    ///
+    /// @param vcpu the vCPU to add
+    /// @param slice the time slice given to this vCPU, or 0 to use the
+    ///     default time slice
+    ///
+    void add(gsl::not_null<vcpu *> vcpu, tick_t slice = 0);
+
+    /// Remove
+    ///
+    /// Removes a vCPU from the run queue. If the vCPU is the current vCPU,
+    /// no vCPU is current until next() is called.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param vcpu the vCPU to remove
+    ///
+    void remove(gsl::not_null<vcpu *> vcpu);
+
+    /// Next
+    ///
+    /// Moves the current vCPU (if any) to the end of the run queue, and
+    /// starts the time slice of the vCPU at the front of the run queue.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param now the current time
+    /// @return returns the vCPU that should run next, or nullptr if the run
+    ///     queue is empty
+    ///
+    vcpu *next(tick_t now);
+
+    /// Boost
+    ///
+    /// Moves a vCPU so that it is the next vCPU returned by next(). This is
+    /// used to implement a directed yield (e.g., to the holder of a lock
+    /// that the current vCPU is spinning on).
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param vcpu the vCPU to boost
+    /// @return returns false if the vCPU is not in the run queue, or if it
+    ///     is the current vCPU, true otherwise
+    ///
+    bool boost(gsl::not_null<vcpu *> vcpu);
+
+    /// Remaining
+    ///
+    /// Returns the amount of time left in the current vCPU's time slice.
+    /// If the current vCPU is the only vCPU in the run queue, it does not
+    /// need to be preempted, in which case 0 is returned. An expired time
+    /// slice returns 1 so that the caller preempts as soon as possible.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param now the current time
+    /// @return returns the remaining time, or 0 if no preemption is needed
+    ///
+    tick_t remaining(tick_t now) const;
+
+    /// Current
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the current vCPU, or nullptr if no vCPU is running
+    ///
+    vcpu *current() const noexcept;
+
+    /// Size
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the number of vCPUs in the run queue
+    ///
+    std::size_t size() const noexcept
+    { return m_queue.size(); }
+
+private:
+
+    struct entry_t {
+        vcpu *ptr;
+        tick_t slice;
+    };
+
+    tick_t m_slice;
+    tick_t m_start{};
+
+    bool m_running{false};
+    std::list<entry_t> m_queue;
+
+public:
+
+    /// @cond
+
+    run_queue(run_queue &&) = default;
+    run_queue &operator=(run_queue &&) = default;
+
+    run_queue(const run_queue &) = delete;
+    run_queue &operator=(const run_queue &) = delete;
+
+    /// @endcond
+};
+
+/// Scheduler
+///
+/// Multiplexes guest vCPUs on a single physical core using the VMX
+/// preemption timer. Each vCPU runs until its time slice expires, or until
+/// it executes a HLT or is caught spinning by PAUSE-loop exiting (i.e., it
+/// has nothing useful to do), at which point the next vCPU in the run queue
+/// is loaded and run. When only one vCPU is in the run queue, the
+/// preemption timer and HLT exiting are disabled so that an idle vCPU
+/// waits in the HLT activity state instead of generating VM exits.
+///
+/// Each physical core should have its own scheduler, and the scheduler
+/// should only be used from the core that owns it.
+///
+class scheduler
+{
+public:
+
+    using tick_t = run_queue::tick_t;       ///< Time type (in TSC ticks)
+
+    /// Default time slice (in microseconds)
+    ///
+    static constexpr const uint64_t default_slice_usec = 1000;
+
+    /// Constructor
+    ///
+    /// Reads the TSC frequency and the preemption timer rate from the
+    /// hardware so that time slices can be given in microseconds.
+    ///
+    /// @expects slice_usec != 0
+    /// @ensures
+    ///
+    /// @param slice_usec the default time slice given to each vCPU
+    ///
+    explicit scheduler(uint64_t slice_usec = default_slice_usec);
+
+    /// Destructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    ~scheduler() = default;
+
+    /// Add
+    ///
+    /// Adds a guest vCPU to the scheduler. If a vCPU is already running,
+    /// this function must be called from one of its VM exits, as its
+    /// preemption timer might need to be enabled.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param vcpu the vCPU to add
+    /// @param slice_usec the time slice given to this vCPU, or 0 to use
+    ///     the default time slice
+    ///
+    void add(gsl::not_null<vcpu *> vcpu, uint64_t slice_usec = 0);
+
+    /// Remove
+    ///
+    /// Removes a guest vCPU from the scheduler, along with the preemption
+    /// timer, HLT and PAUSE handlers that add() registered with it.
+    ///
+    /// @expects vcpu is not the currently running vCPU
+    /// @ensures
+    ///
+    /// @param vcpu the vCPU to remove
+    ///
+    void remove(gsl::not_null<vcpu *> vcpu);
+
+    /// Run
+    ///
+    /// Loads and runs the first vCPU in the run queue. On success, this
+    /// function does not return.
+    ///
+    /// @expects the run queue is not empty
+    /// @ensures
+    ///
+    void run();
+
+    /// Yield To
+    ///
+    /// Gives the rest of the current vCPU's time slice to another vCPU
+    /// (e.g., the holder of a lock the current vCPU is spinning on). This
+    /// is meant to be called from a PAUSE policy added using
+    /// vcpu::add_pause_handler(). On success, this function does not
+    /// return.
+    ///
+    /// @expects current is the currently running vCPU
+    /// @ensures
+    ///
+    /// @param current the vCPU that is giving up the physical core
+    /// @param target the vCPU to run next
+    /// @return returns false if target is not in the run queue
+    ///
+    bool yield_to(gsl::not_null<vcpu *> current, gsl::not_null<vcpu *> target);
+
+    /// Spin Ticks Saved
+    ///
+    /// Each time a vCPU yields because of a PAUSE-loop exit, the rest of
+    /// its time slice (which it would have otherwise spent spinning) is
+    /// added to this counter.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the number of TSC ticks that were not spent spinning
+    ///
+    tick_t spin_ticks_saved() const noexcept
+    { return m_spin_ticks_saved; }
+
+    /// TSC Frequency
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the frequency of the TSC in kHz, or throws if the
+    ///     frequency cannot be determined
+    ///
+    static uint64_t tsc_frequency_khz();
+
+    /// Microseconds To Ticks
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param usec the time to convert
+    /// @param tsc_khz the frequency of the TSC in kHz
+    /// @return returns usec converted to TSC ticks
+    ///
+    static constexpr tick_t usec_to_ticks(uint64_t usec, uint64_t tsc_khz) noexcept
+    { return (usec * tsc_khz) / 1000; }
+
+public:
+
+    /// @cond
+
+    bool handle_preemption(vcpu *vcpu);
+    bool handle_yield(vcpu *vcpu);
+    bool handle_pause(vcpu *vcpu);
+
+    /// @endcond
+
+private:
+
+    void switch_to(vcpu *current, vcpu *next, tick_t now);
+    void update_hlt_exiting();
+    void arm(vcpu *vcpu, tick_t now);
+
+private:
+
+    uint64_t m_tsc_khz;
+    uint64_t m_timer_shift;
+    tick_t m_spin_ticks_saved{};
+
+    run_queue m_run_queue;
+
+public:
+
+    /// @cond
+
+    scheduler(scheduler &&) = default;
+    scheduler &operator=(scheduler &&) = default;
+
+    scheduler(const scheduler &) = delete;
+    scheduler &operator=(const scheduler &) = delete;
+
+    /// @endcond
+};
+
+}
+
+#endif
@@ -33,9 +33,11 @@
 #include "vmexit/monitor_trap.h"
 #include "vmexit/nmi_window.h"
 #include "vmexit/nmi.h"
+#include "vmexit/pause.h"
 #include "vmexit/rdmsr.h"
 #include "vmexit/sipi_signal.h"
 #include "vmexit/preemption_timer.h"
+#include "vmexit/vmcall.h"
 #include "vmexit/wrmsr.h"
 #include "vmexit/xsetbv.h"
 
@@ -43,9 +45,12 @@
 #include "exit_handler.h"
 #include "interrupt_queue.h"
 #include "microcode.h"
+#include "msr_policy.h"
 #include "vcpu_global_state.h"
 #include "vcpu_state.h"
 #include "vmcs.h"
+#include "vmcs_cache.h"
+#include "vmcs_template.h"
 #include "vmx.h"
 #include "vpid.h"
 
@@ -92,6 +97,47 @@ public:
     ///
     ~vcpu() override = default;
 
+    /// Reset
+    ///
+    /// Returns a guest vCPU to the state its constructor left it in, with
+    /// a new id, so that the vcpu_factory can recycle it instead of making
+    /// a new one. Nothing is allocated: the vCPU keeps its stacks, XSAVE
+    /// areas, bitmaps, VMCS and handlers. The software state and XSAVE
+    /// areas are zeroed, the MSR policy is compiled again, the VMCS is
+    /// reset and its host and control state is written again, a new VPID
+    /// is used, and any pending interrupts and EPT map are dropped. The MSR
+    /// and IO bitmaps are kept, so handlers added by the constructor keep
+    /// trapping.
+    ///
+    /// The launch, resume and clear delegates and the CR0/CR4 write masks
+    /// are restored to what they were when the vCPU was first launched or
+    /// retired, whichever came first. Delegates and CR0/CR4 traps that are
+    /// added by a constructor (i.e., before the vCPU first runs) are
+    /// therefore kept, while the ones added for a guest are dropped.
+    ///
+    /// Handlers that were added after the vCPU was created are not removed,
+    /// so vCPUs that are pooled should have their handlers added by their
+    /// constructors, and subclasses that keep per-guest state of their own
+    /// should override this function.
+    ///
+    /// @expects is_guest_vcpu() and id is a guest vcpuid
+    /// @ensures none
+    ///
+    /// @param id the new id of the vcpu
+    ///
+    void reset(vcpuid::type id) override;
+
+    /// Retire
+    ///
+    /// Clears the vCPU (see clear()), which runs its clear delegates and
+    /// flushes its VMCS out of the CPU, so that the VMCS can be reset and
+    /// loaded on another pCPU when the vCPU is recycled.
+    ///
+    /// @expects called on the pCPU that last ran the vCPU
+    /// @ensures none
+    ///
+    void retire() override;
+
 public:
 
     /// Run
@@ -159,12 +205,23 @@ public:
     VIRTUAL void add_clear_delegate(const vcpu_delegate_t &d) noexcept
     { m_clear_delegates.push_front(std::move(d)); }
 
+#ifndef ENABLE_BUILD_TEST
+private:
+#endif
+
+    static void write_shared_state(vmcs_template &golden, bool host);
+    static void write_shared_host_state();
+    static void write_shared_control_state(bool host);
+
 private:
 
+    void init_state();
     void init_xsave();
     void write_host_state();
     void write_guest_state();
     void write_control_state();
+    void write_template_state();
+    void save_construction_state();
 
 public:
 
@@ -210,6 +267,30 @@ public:
     ///
     VIRTUAL bool advance();
 
+    /// Flush VMCS Writes
+    ///
+    /// Writes the guest state that the vCPU's setters have cached (segment
+    /// registers, descriptor tables, CR0, CR3, CR4, DR7, EFER and PAT) to
+    /// the VMCS. This is done automatically just before the vCPU is
+    /// launched / resumed, and only needs to be called by code that is
+    /// about to access one of these fields through vmcs_n directly.
+    ///
+    /// @expects this vCPU's VMCS is loaded
+    /// @ensures none
+    ///
+    VIRTUAL void flush_vmcs_writes();
+
+    /// VMCS Write Statistics
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns the number of guest state writes made through the
+    ///     vCPU's setters, the number of VMWRITEs that were actually issued
+    ///     and the number of exits that had something to write
+    ///
+    VIRTUAL const vmcs_write_cache::stats_t &vmcs_write_stats() const noexcept;
+
     //==========================================================================
     // Handler Operations
     //==========================================================================
@@ -242,6 +323,52 @@ public:
     VIRTUAL void add_exit_handler_for_reason(
         ::intel_x64::vmcs::value_type reason, const handler_delegate_t &d);
 
+    /// Remove Exit Handler (for specific reason)
+    ///
+    /// Removes an exit handler added with add_exit_handler_for_reason()
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param reason The exit reason the handler was registered for
+    /// @param d The delegate being removed
+    ///
+    VIRTUAL void remove_exit_handler_for_reason(
+        ::intel_x64::vmcs::value_type reason, const handler_delegate_t &d);
+
+    /// Add Result Exit Handler (for specific reason)
+    ///
+    /// Adds a result handler for a specific reason. Result handlers report
+    /// failures with an error code instead of throwing, and are executed
+    /// ahead of the handlers added with add_exit_handler_for_reason(). See
+    /// exit_handler::add_result_handler for the rules a result handler
+    /// must follow.
+    ///
+    /// @expects reason < 128
+    /// @ensures none
+    ///
+    /// @param reason The exit reason for the handler being registered
+    /// @param d The delegate being registered
+    ///
+    VIRTUAL void add_result_handler_for_reason(
+        ::intel_x64::vmcs::value_type reason, const result_delegate_t &d);
+
+    /// Set Fast Exit Handler (for specific reason)
+    ///
+    /// Sets the fast handler for a specific reason. Fast handlers are
+    /// executed directly by the exit handler's entry point, ahead of all
+    /// other handlers. See exit_handler::set_fast_handler for the rules a
+    /// fast handler must follow. Passing nullptr removes the fast handler.
+    ///
+    /// @expects reason < 128
+    /// @ensures none
+    ///
+    /// @param reason The exit reason for the handler being registered
+    /// @param func The fast handler being registered
+    ///
+    VIRTUAL void set_fast_exit_handler(
+        ::intel_x64::vmcs::value_type reason, fast_handler_t func);
+
     //==========================================================================
     // Fault Handling
     //==========================================================================
@@ -317,6 +444,32 @@ public:
     VIRTUAL void add_wrcr4_handler(
         vmcs_n::value_type mask, const handler_delegate_t &d);
 
+    /// Set Write CR0 Mask
+    ///
+    /// Sets the CR0 bits the VMM cares about, replacing the bits provided
+    /// to add_wrcr0_handler(). Only guest writes that change one of these
+    /// bits (or one of the bits the VMM must always own) exit.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param mask the CR0 bits that should trap on write
+    ///
+    VIRTUAL void set_wrcr0_mask(vmcs_n::value_type mask);
+
+    /// Set Write CR4 Mask
+    ///
+    /// Sets the CR4 bits the VMM cares about, replacing the bits provided
+    /// to add_wrcr4_handler(). Only guest writes that change one of these
+    /// bits (or one of the bits the VMM must always own) exit.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param mask the CR4 bits that should trap on write
+    ///
+    VIRTUAL void set_wrcr4_mask(vmcs_n::value_type mask);
+
     /// Execute wrcr0
     ///
     /// Executes the wrcr0 instruction, and populates the vCPU's registers.
@@ -566,6 +719,45 @@ public:
     ///
     VIRTUAL void inject_external_interrupt(uint64_t vector);
 
+    /// Enable Virtual Interrupt Delivery
+    ///
+    /// Delivers queued external interrupts using virtual interrupt delivery
+    /// instead of interrupt-window exiting. This requires that external
+    /// interrupt exiting is enabled (i.e., the VMM owns all external
+    /// interrupts), and that the guest uses the APIC in x2APIC mode.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    VIRTUAL void enable_virtual_interrupt_delivery();
+
+    /// Enable Posted Interrupts
+    ///
+    /// Enables posted-interrupt processing if supported by the hardware.
+    /// Virtual interrupt delivery must be enabled first.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param notification_vector the vector used to notify this vCPU
+    ///
+    VIRTUAL void enable_posted_interrupts(uint64_t notification_vector);
+
+    /// Post External Interrupt
+    ///
+    /// Posts an external interrupt to this vCPU. Unlike
+    /// queue_external_interrupt(), this may be called from any core.
+    /// Virtual interrupt delivery must be enabled first.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param vector the vector to post to the guest
+    /// @return returns true if the caller must send the notification vector
+    ///     to the core running this vCPU
+    ///
+    VIRTUAL bool post_external_interrupt(uint64_t vector);
+
     //--------------------------------------------------------------------------
     // IO Instruction
     //--------------------------------------------------------------------------
@@ -608,6 +800,27 @@ public:
         const io_instruction_handler::handler_delegate_t &in_d,
         const io_instruction_handler::handler_delegate_t &out_d);
 
+    /// Add IO String Instruction Handler
+    ///
+    /// String handlers are given all of the elements of an ins / outs
+    /// instruction at once instead of one element at a time. If a port
+    /// was registered using emulate_io_instruction(), the string
+    /// handlers for that port are emulated as well.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param port the port to call
+    /// @param in_d the delegate to call when the guest executes ins on the
+    ///        given port
+    /// @param out_d the delegate to call when the guest executes outs on the
+    ///        given port
+    ///
+    VIRTUAL void add_io_string_instruction_handler(
+        vmcs_n::value_type port,
+        const io_instruction_handler::string_handler_delegate_t &in_d,
+        const io_instruction_handler::string_handler_delegate_t &out_d);
+
     /// Emulate IO Instruction Handler
     ///
     /// Adds a handler, and tells the APIs that full emulation is desired.
@@ -870,6 +1083,34 @@ public:
     VIRTUAL void add_default_wrmsr_handler(
         const ::handler_delegate_t &d);
 
+    //--------------------------------------------------------------------------
+    // MSR Policy
+    //--------------------------------------------------------------------------
+
+    /// Set MSR Policy
+    ///
+    /// Compiles the provided rules into the MSR bitmap and the vCPU's MSR
+    /// emulation table, replacing any previously set policy. MSRs handled
+    /// by the policy are serviced before any rdmsr / wrmsr handlers. See
+    /// msr_policy for more information.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param rules the rules that make up the policy
+    ///
+    VIRTUAL void set_msr_policy(const std::vector<msr_policy::rule_t> &rules);
+
+    /// MSR Policy Value
+    ///
+    /// @expects msr has a constant or shadow rule
+    /// @ensures
+    ///
+    /// @param msr the msr to get the value of
+    /// @return the current value of the msr's constant or shadow rule
+    ///
+    VIRTUAL uint64_t msr_policy_value(uint32_t msr) const;
+
     //--------------------------------------------------------------------------
     // XSetBV
     //--------------------------------------------------------------------------
@@ -898,6 +1139,16 @@ public:
     VIRTUAL void add_preemption_timer_handler(
         const preemption_timer_handler::handler_delegate_t &d);
 
+    /// Remove VMX preemption timer handler
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the delegate to remove
+    ///
+    VIRTUAL void remove_preemption_timer_handler(
+        const preemption_timer_handler::handler_delegate_t &d);
+
     /// Set VMX preemption timer
     ///
     /// @expects
@@ -931,6 +1182,106 @@ public:
     ///
     VIRTUAL void disable_preemption_timer();
 
+    //--------------------------------------------------------------------------
+    // PAUSE-loop exiting
+    //--------------------------------------------------------------------------
+
+    /// Add PAUSE handler
+    ///
+    /// Adds a policy that is called when the guest is caught spinning. The
+    /// policy is expected to yield the physical core, or to boost the vCPU
+    /// holding the lock the guest is spinning on.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the delegate to call when a PAUSE-loop exit occurs
+    ///
+    VIRTUAL void add_pause_handler(
+        const pause_handler::handler_delegate_t &d);
+
+    /// Remove PAUSE handler
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the delegate to remove
+    ///
+    VIRTUAL void remove_pause_handler(
+        const pause_handler::handler_delegate_t &d);
+
+    /// Enable PAUSE-loop exiting
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    VIRTUAL void enable_pause_loop_exiting();
+
+    /// Disable PAUSE-loop exiting
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    VIRTUAL void disable_pause_loop_exiting();
+
+    /// Set PAUSE-loop exiting window
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param gap the maximum number of TSC ticks between two PAUSE
+    ///     instructions of the same loop
+    /// @param window the number of TSC ticks a guest may spin before a
+    ///     PAUSE-loop exit occurs
+    ///
+    VIRTUAL void set_pause_loop_window(
+        pause_handler::value_t gap, pause_handler::value_t window);
+
+    /// PAUSE-loop exiting statistics
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return the PAUSE-loop exit statistics of this vCPU
+    ///
+    VIRTUAL const pause_handler::stats_t &pause_loop_stats() const noexcept;
+
+    //--------------------------------------------------------------------------
+    // Hypercall Ring
+    //--------------------------------------------------------------------------
+
+    /// Add Hypercall handler
+    ///
+    /// Adds a handler for the entries userspace submits through its
+    /// hypercall ring. See vmcall_handler for more information.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the delegate to call for each entry in the ring
+    ///
+    VIRTUAL void add_hypercall_handler(
+        const vmcall_handler::handler_delegate_t &d);
+
+    /// Enable Hypercall Ring Polling
+    ///
+    /// Drains the hypercall ring on every VM exit instead of only when
+    /// userspace rings the doorbell.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    VIRTUAL void enable_hypercall_ring_polling();
+
+    /// Hypercall Ring statistics
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return the hypercall ring statistics of this vCPU
+    ///
+    VIRTUAL const vmcall_handler::stats_t &hypercall_ring_stats() const noexcept;
+
     //==========================================================================
     // EPT
     //==========================================================================
@@ -1656,7 +2007,7 @@ public:
     {
         using namespace ::x64::pt;
 
-        if (vmcs_n::guest_cr0::paging::is_disabled()) {
+        if (!this->guest_paging_enabled()) {
             return map_gpa_4k<T>(gva, len);
         }
 
@@ -1759,10 +2110,39 @@ public:
 
 private:
 
+    bool guest_paging_enabled() const noexcept;
     uintptr_t get_entry(uintptr_t tble_gpa, std::ptrdiff_t index);
 
 public:
 
+    /// General Purpose Register
+    ///
+    /// Returns the value of the general purpose register identified by
+    /// index, using the same encoding as the hardware (i.e., 0 == rax,
+    /// 1 == rcx, ..., 15 == r15). Only the lower 4 bits of index are used.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param index the hardware encoding of the register to read
+    /// @return the value of the requested register
+    ///
+    VIRTUAL uint64_t gpr(uint64_t index) const noexcept;
+
+    /// Set General Purpose Register
+    ///
+    /// Sets the value of the general purpose register identified by
+    /// index, using the same encoding as the hardware. Only the lower 4 bits
+    /// of index are used.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param index the hardware encoding of the register to write
+    /// @param val the value to write to the requested register
+    ///
+    VIRTUAL void set_gpr(uint64_t index, uint64_t val) noexcept;
+
     /// @cond
 
     /// vCPU Registers
@@ -1968,6 +2348,7 @@ private:
     std::unique_ptr<vmx> m_vmx;
 
     vmcs m_vmcs;
+    vmcs_write_cache m_vmcs_cache;
     exit_handler m_exit_handler;
 
     control_register_handler m_control_register_handler;
@@ -1981,14 +2362,17 @@ private:
     monitor_trap_handler m_monitor_trap_handler;
     nmi_window_handler m_nmi_window_handler;
     nmi_handler m_nmi_handler;
+    pause_handler m_pause_handler;
     preemption_timer_handler m_preemption_timer_handler;
     rdmsr_handler m_rdmsr_handler;
     sipi_signal_handler m_sipi_signal_handler;
+    vmcall_handler m_vmcall_handler;
     wrmsr_handler m_wrmsr_handler;
     xsetbv_handler m_xsetbv_handler;
 
     ept_handler m_ept_handler;
     microcode_handler m_microcode_handler;
+    msr_policy m_msr_policy;
     vpid_handler m_vpid_handler;
 
 private:
@@ -1999,6 +2383,15 @@ private:
     std::list<vcpu_delegate_t> m_resume_delegates{};
     std::list<vcpu_delegate_t> m_clear_delegates{};
 
+    bool m_construction_state_saved{false};
+
+    std::list<vcpu_delegate_t> m_saved_launch_delegates{};
+    std::list<vcpu_delegate_t> m_saved_resume_delegates{};
+    std::list<vcpu_delegate_t> m_saved_clear_delegates{};
+
+    vmcs_n::value_type m_saved_wrcr0_mask{};
+    vmcs_n::value_type m_saved_wrcr4_mask{};
+
     ept::mmap *m_mmap{};
 };
 }
@@ -22,6 +22,7 @@
 #ifndef VCPU_STATE_INTEL_X64_H
 #define VCPU_STATE_INTEL_X64_H
 
+#include <cstddef>
 #include <cstdint>
 
 /// @cond
@@ -30,24 +31,31 @@
 namespace bfvmm::intel_x64
 {
 
+// Note:
+//
+// The general purpose registers are laid out in the same order as the
+// hardware encoding of these registers (i.e., the encoding used by the exit
+// qualification and instruction information fields), which allows them to
+// be accessed as an array using vcpu::gpr() and vcpu::set_gpr().
+
 struct vcpu_state_t {
     uint64_t rax;                   // 0x000
-    uint64_t rbx;                   // 0x008
-    uint64_t rcx;                   // 0x010
-    uint64_t rdx;                   // 0x018
-    uint64_t rbp;                   // 0x020
-    uint64_t rsi;                   // 0x028
-    uint64_t rdi;                   // 0x030
-    uint64_t r08;                   // 0x038
-    uint64_t r09;                   // 0x040
-    uint64_t r10;                   // 0x048
-    uint64_t r11;                   // 0x050
-    uint64_t r12;                   // 0x058
-    uint64_t r13;                   // 0x060
-    uint64_t r14;                   // 0x068
-    uint64_t r15;                   // 0x070
-    uint64_t rip;                   // 0x078
-    uint64_t rsp;                   // 0x080
+    uint64_t rcx;                   // 0x008
+    uint64_t rdx;                   // 0x010
+    uint64_t rbx;                   // 0x018
+    uint64_t rsp;                   // 0x020
+    uint64_t rbp;                   // 0x028
+    uint64_t rsi;                   // 0x030
+    uint64_t rdi;                   // 0x038
+    uint64_t r08;                   // 0x040
+    uint64_t r09;                   // 0x048
+    uint64_t r10;                   // 0x050
+    uint64_t r11;                   // 0x058
+    uint64_t r12;                   // 0x060
+    uint64_t r13;                   // 0x068
+    uint64_t r14;                   // 0x070
+    uint64_t r15;                   // 0x078
+    uint64_t rip;                   // 0x080
 
     uint64_t pcpuid;                // 0x088
     uint64_t vcpuid;                // 0x090
@@ -68,8 +76,14 @@ struct vcpu_state_t {
     uint64_t dr2;                   // 0x0F8
     uint64_t dr3;                   // 0x100
     uint64_t dr6;                   // 0x108
+
+    uint64_t xsave_switched;        // 0x110
+    uint64_t fast_handlers_ptr;     // 0x118
 };
 
+static_assert(offsetof(vcpu_state_t, r15) == 0x078);
+static_assert(offsetof(vcpu_state_t, rip) == 0x080);
+
 }
 
 #pragma pack(pop)
@@ -155,6 +155,18 @@ public:
     ///
     VIRTUAL void clear();
 
+    /// Reset
+    ///
+    /// Clears the VMCS and returns its region to the state of a newly
+    /// created VMCS (zeroed, with the revision id written), so that a
+    /// vCPU can be recycled without allocating a new VMCS. Like a newly
+    /// created VMCS, it must be loaded before it is written to.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    VIRTUAL void reset();
+
     /// Check
     ///
     /// This function checks to see if the VMCS is configured improperly.
@@ -0,0 +1,195 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef VMCS_CACHE_INTEL_X64_H
+#define VMCS_CACHE_INTEL_X64_H
+
+#include <array>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfvmm::intel_x64
+{
+
+/// VMCS Write Cache
+///
+/// Batches writes to the VMCS-backed guest state fields. A write is stored
+/// in the cache and marked dirty instead of being issued as a VMWRITE, and
+/// all of the dirty fields are written at once by flush(), which the vCPU
+/// calls just before it launches / resumes. Writing the same field more
+/// than once during a single exit (e.g. a mode switch that touches CR0,
+/// CR4 and EFER from several handlers) therefore only costs one VMWRITE.
+///
+/// Reads of a dirty field return the cached value, so the vCPU's getters
+/// always see the most recent write. Code that accesses one of these
+/// fields through vmcs_n directly must flush() first, otherwise it might
+/// read a stale value, or have its write overwritten by the next flush.
+///
+/// Note that pending writes are only ever flushed by the vCPU that owns
+/// the cache, which is only run while its VMCS is loaded, so a vCPU can be
+/// switched out or cleared with dirty fields without losing them.
+///
+class vmcs_write_cache
+{
+public:
+
+    using field_type = uint64_t;            ///< VMCS field encoding type
+    using value_type = uint64_t;            ///< VMCS field value type
+
+    /// Cached Fields
+    ///
+    /// Each of the VMCS-backed guest fields that the vCPU's setters write.
+    /// The index of a field is its bit in the dirty mask.
+    ///
+    enum index_t : uint64_t {
+        es_selector, es_base, es_limit, es_access_rights,
+        cs_selector, cs_base, cs_limit, cs_access_rights,
+        ss_selector, ss_base, ss_limit, ss_access_rights,
+        ds_selector, ds_base, ds_limit, ds_access_rights,
+        fs_selector, fs_base, fs_limit, fs_access_rights,
+        gs_selector, gs_base, gs_limit, gs_access_rights,
+        ldtr_selector, ldtr_base, ldtr_limit, ldtr_access_rights,
+        tr_selector, tr_base, tr_limit, tr_access_rights,
+        gdtr_base, gdtr_limit, idtr_base, idtr_limit,
+        cr0, cr0_read_shadow, cr3, cr4, cr4_read_shadow,
+        dr7, ia32_efer, ia32_pat,
+        num_fields
+    };
+
+    static_assert(num_fields <= 64, "the dirty mask is a single uint64_t");
+
+    /// Statistics
+    ///
+    /// writes counts every write made through the cache, vmwrites counts
+    /// the VMWRITE instructions flush() actually issued, and flushes counts
+    /// the number of flush() calls that had something to write. The
+    /// VMWRITEs saved per exit is (writes - vmwrites) / flushes.
+    ///
+    struct stats_t {
+        uint64_t writes;
+        uint64_t vmwrites;
+        uint64_t flushes;
+    };
+
+    /// Default Constructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    vmcs_write_cache() = default;
+
+    /// Destructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    ~vmcs_write_cache() = default;
+
+    /// Read
+    ///
+    /// @expects index < num_fields
+    /// @ensures
+    ///
+    /// @param index the field to read
+    /// @return returns the cached value of the field if it is dirty,
+    ///     otherwise the value is read from the currently loaded VMCS
+    ///
+    value_type read(index_t index) const;
+
+    /// Write
+    ///
+    /// Stores the value and marks the field dirty. No VMWRITE is issued
+    /// until flush() is called.
+    ///
+    /// @expects index < num_fields
+    /// @ensures
+    ///
+    /// @param index the field to write
+    /// @param val the value to write to the field
+    ///
+    void write(index_t index, value_type val);
+
+    /// Flush
+    ///
+    /// Writes each dirty field to the currently loaded VMCS, and marks it
+    /// clean. Fields are written in index order.
+    ///
+    /// @expects
+    /// @ensures dirty() == false
+    ///
+    void flush();
+
+    /// Dirty
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns true if there are writes waiting to be flushed
+    ///
+    bool dirty() const noexcept
+    { return m_dirty != 0; }
+
+    /// Statistics
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the cache's statistics
+    ///
+    const stats_t &stats() const noexcept
+    { return m_stats; }
+
+    /// Field
+    ///
+    /// @expects index < num_fields
+    /// @ensures
+    ///
+    /// @param index the field to look up
+    /// @return returns the VMCS field encoding of the field
+    ///
+    static field_type field(index_t index);
+
+private:
+
+    uint64_t m_dirty{};
+    stats_t m_stats{};
+    std::array<value_type, num_fields> m_values{};
+
+public:
+
+    /// @cond
+
+    vmcs_write_cache(vmcs_write_cache &&) = default;
+    vmcs_write_cache &operator=(vmcs_write_cache &&) = default;
+
+    vmcs_write_cache(const vmcs_write_cache &) = delete;
+    vmcs_write_cache &operator=(const vmcs_write_cache &) = delete;
+
+    /// @endcond
+};
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef VMCS_TEMPLATE_INTEL_X64_H
+#define VMCS_TEMPLATE_INTEL_X64_H
+
+#include <vector>
+#include <cstdint>
+#include <initializer_list>
+
+#include <bfrwlock.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfvmm::intel_x64
+{
+
+/// VMCS Template
+///
+/// A "golden" set of VMCS field values shared by every vCPU of the same
+/// kind. The first vCPU of a kind writes its VMCS the slow way, and then
+/// captures the shared fields from it. Every vCPU after that applies the
+/// template instead, which is a single loop of VMWRITEs with no MSR reads
+/// and no read-modify-write of the control fields.
+///
+/// Only fields that differ from a freshly reset VMCS (i.e. fields that
+/// are non-zero) are stored, so the template must only be applied to a
+/// VMCS that was just reset.
+///
+/// The template can be captured and applied from any CPU. Once captured,
+/// it does not change until it is cleared.
+///
+class vmcs_template
+{
+public:
+
+    using field_type = uint64_t;            ///< VMCS field encoding type
+    using value_type = uint64_t;            ///< VMCS field value type
+
+    /// Entry
+    ///
+    /// A field and the value the template writes to it.
+    ///
+    struct entry_t {
+        field_type field;
+        value_type val;
+    };
+
+    /// Default Constructor
+    ///
+    /// @expects
+    /// @ensures captured() == false
+    ///
+    vmcs_template() = default;
+
+    /// Destructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    ~vmcs_template() = default;
+
+    /// Capture
+    ///
+    /// Reads each of the provided fields from the currently loaded VMCS,
+    /// and stores the ones that are non-zero. Fields that do not exist on
+    /// this CPU are skipped. If the template was already captured (e.g.
+    /// by a vCPU on another CPU) this does nothing.
+    ///
+    /// @expects
+    /// @ensures captured() == true
+    ///
+    /// @param fields the fields that are shared by every vCPU of this kind
+    ///
+    void capture(std::initializer_list<field_type> fields);
+
+    /// Apply
+    ///
+    /// Writes each stored field to the currently loaded VMCS, in the
+    /// order they were captured.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns false if the template has not been captured yet,
+    ///     in which case nothing is written, true otherwise
+    ///
+    bool apply() const;
+
+    /// Clear
+    ///
+    /// Removes all of the stored fields, so that the next vCPU captures
+    /// the template again.
+    ///
+    /// @expects
+    /// @ensures captured() == false
+    ///
+    void clear() noexcept;
+
+    /// Captured
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns true if the template has been captured
+    ///
+    bool captured() const noexcept;
+
+    /// Entries
+    ///
+    /// @expects captured() == true
+    /// @ensures
+    ///
+    /// @return returns the stored fields and values, in the order they
+    ///     are applied
+    ///
+    const std::vector<entry_t> &entries() const noexcept
+    { return m_entries; }
+
+private:
+
+    bool m_captured{};
+    std::vector<entry_t> m_entries;
+
+    mutable bfn::rwlock m_lock;
+
+public:
+
+    /// @cond
+
+    vmcs_template(vmcs_template &&) = delete;
+    vmcs_template &operator=(vmcs_template &&) = delete;
+
+    vmcs_template(const vmcs_template &) = delete;
+    vmcs_template &operator=(const vmcs_template &) = delete;
+
+    /// @endcond
+};
+
+}
+
+#endif
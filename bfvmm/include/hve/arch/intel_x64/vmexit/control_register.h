@@ -274,18 +274,36 @@ public:
 
     /// Enable Write CR0 Exiting
     ///
+    /// Adds the bits in mask to the set of CR0 bits the VMM cares about.
+    /// Only guest writes that change one of these bits (or one of the bits
+    /// the VMM must always own, like the VMX fixed bits) exit. Writes to all
+    /// other bits are executed by the guest without a VM exit.
+    ///
     /// Example:
     /// @code
-    /// this->enable_wrcr0_exiting();
+    /// this->enable_wrcr0_exiting(0);
     /// @endcode
     ///
     /// @expects
     /// @ensures
     ///
-    /// @param mask the value of the cr0 guest/host mask to set in the vmcs
+    /// @param mask the cr0 bits to add to the cr0 guest/host mask
     ///
     void enable_wrcr0_exiting(vmcs_n::value_type mask);
 
+    /// Set Write CR0 Mask
+    ///
+    /// Replaces the set of CR0 bits the VMM cares about. Unlike
+    /// enable_wrcr0_exiting, this can be used to stop trapping bits that
+    /// are no longer needed.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param mask the cr0 bits the VMM cares about
+    ///
+    void set_wrcr0_mask(vmcs_n::value_type mask);
+
     /// Enable Read CR3 Exiting
     ///
     /// Example:
@@ -312,18 +330,58 @@ public:
 
     /// Enable Write CR4 Exiting
     ///
+    /// Adds the bits in mask to the set of CR4 bits the VMM cares about.
+    /// Only guest writes that change one of these bits (or one of the bits
+    /// the VMM must always own, like the VMX fixed bits) exit. Writes to all
+    /// other bits are executed by the guest without a VM exit.
+    ///
     /// Example:
     /// @code
-    /// this->enable_wrcr4_exiting();
+    /// this->enable_wrcr4_exiting(0);
     /// @endcode
     ///
     /// @expects
     /// @ensures
     ///
-    /// @param mask the value of the cr4 guest/host mask to set in the vmcs
+    /// @param mask the cr4 bits to add to the cr4 guest/host mask
     ///
     void enable_wrcr4_exiting(vmcs_n::value_type mask);
 
+    /// Set Write CR4 Mask
+    ///
+    /// Replaces the set of CR4 bits the VMM cares about. Unlike
+    /// enable_wrcr4_exiting, this can be used to stop trapping bits that
+    /// are no longer needed.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param mask the cr4 bits the VMM cares about
+    ///
+    void set_wrcr4_mask(vmcs_n::value_type mask);
+
+    /// Write CR0 Mask
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the CR0 bits the VMM cares about, not including the
+    ///     bits the VMM must always own
+    ///
+    vmcs_n::value_type wrcr0_mask() const noexcept
+    { return m_wrcr0_mask; }
+
+    /// Write CR4 Mask
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the CR4 bits the VMM cares about, not including the
+    ///     bits the VMM must always own
+    ///
+    vmcs_n::value_type wrcr4_mask() const noexcept
+    { return m_wrcr4_mask; }
+
 public:
 
     /// @cond
@@ -343,10 +401,16 @@ private:
     bool handle_wrcr3(vcpu *vcpu);
     bool handle_wrcr4(vcpu *vcpu);
 
+    void write_cr0_guest_host_mask();
+    void write_cr4_guest_host_mask();
+
 private:
 
     vcpu *m_vcpu;
 
+    vmcs_n::value_type m_wrcr0_mask{};
+    vmcs_n::value_type m_wrcr4_mask{};
+
     std::list<handler_delegate_t> m_wrcr0_handlers;
     std::list<handler_delegate_t> m_rdcr3_handlers;
     std::list<handler_delegate_t> m_wrcr3_handlers;
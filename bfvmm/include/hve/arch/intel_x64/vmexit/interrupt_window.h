@@ -25,7 +25,10 @@
 #include <bfgsl.h>
 #include <bfdelegate.h>
 
+#include "external_interrupt.h"
 #include "../interrupt_queue.h"
+#include "../posted_interrupt.h"
+#include "../../../../memory_manager/memory_manager.h"
 
 // -----------------------------------------------------------------------------
 // Definitions
@@ -100,11 +103,80 @@ public:
     ///
     void inject_external_interrupt(uint64_t vector);
 
+    /// Enable Virtual Interrupt Delivery
+    ///
+    /// Switches this vCPU from interrupt-window based injection to virtual
+    /// interrupt delivery. Once enabled, queued external interrupts are
+    /// written to the VIRR of a virtual-APIC page and the guest's RVI is
+    /// updated, which allows the hardware to deliver them (and virtualize
+    /// the guest's EOIs) without an interrupt window VM exit.
+    ///
+    /// Since guest EOIs are no longer seen by the physical APIC, this mode
+    /// requires that the VMM owns all external interrupts (i.e., external
+    /// interrupt exiting is enabled), and that the guest uses the APIC in
+    /// x2APIC mode.
+    ///
+    /// @expects external interrupt exiting is enabled
+    /// @ensures
+    ///
+    void enable_virtual_interrupt_delivery();
+
+    /// Enable Posted Interrupts
+    ///
+    /// Enables posted-interrupt processing on top of virtual interrupt
+    /// delivery if the hardware supports it. Interrupts posted using
+    /// post_external_interrupt() are then delivered to a running guest by
+    /// sending the notification vector to this core, without a VM exit.
+    /// If the hardware does not support posted interrupts, posted vectors
+    /// are delivered on the next VM exit instead.
+    ///
+    /// A notification vector that arrives while the guest is not running
+    /// causes an external interrupt exit instead, which is handled by
+    /// syncing the posted interrupts and sending an EOI to the physical
+    /// x2APIC.
+    ///
+    /// @expects virtual interrupt delivery is enabled
+    /// @ensures
+    ///
+    /// @param notification_vector the vector used to notify this core
+    ///
+    void enable_posted_interrupts(uint64_t notification_vector);
+
+    /// Post External Interrupt
+    ///
+    /// Posts an external interrupt to the vCPU's posted-interrupt
+    /// descriptor. Unlike queue_external_interrupt(), this function is lock
+    /// free and may be called from any core.
+    ///
+    /// @expects virtual interrupt delivery is enabled
+    /// @ensures
+    ///
+    /// @param vector the vector to post to the guest
+    /// @return returns true if the caller must notify the vCPU by sending
+    ///     the notification vector to the core running the vCPU. This is
+    ///     always false if posted interrupts are not enabled.
+    ///
+    bool post_external_interrupt(uint64_t vector);
+
+    /// Reset
+    ///
+    /// Drops any queued interrupts, and forgets about the interrupt window
+    /// exiting that the old VMCS state had enabled, so that the vCPU can be
+    /// recycled. Virtual interrupt delivery cannot be turned off once it is
+    /// enabled, so a vCPU that uses it cannot be reset.
+    ///
+    /// @expects virtual interrupt delivery is not enabled
+    /// @ensures
+    ///
+    void reset();
+
 public:
 
     /// @cond
 
     bool handle(vcpu *vcpu);
+    bool handle_posted(vcpu *vcpu);
+    bool handle_notification(vcpu *vcpu, external_interrupt_handler::info_t &info);
 
     /// @endcond
 
@@ -113,6 +185,8 @@ private:
     void enable_exiting();
     void disable_exiting();
 
+    void sync_posted_interrupts();
+
 private:
 
     vcpu *m_vcpu;
@@ -120,6 +194,12 @@ private:
     bool m_enabled{false};
     interrupt_queue m_interrupt_queue;
 
+    page_ptr<uint32_t> m_virtual_apic_page;
+    page_ptr<posted_interrupt_descriptor> m_pi_desc;
+
+    bool m_posted_interrupts_enabled{false};
+    uint64_t m_notification_vector{0};
+
 public:
 
     /// @cond
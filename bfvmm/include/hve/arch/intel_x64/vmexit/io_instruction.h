@@ -116,6 +116,86 @@ public:
         bool ignore_advance;
     };
 
+    ///
+    /// String Info
+    ///
+    /// This struct is created by io_instruction_handler::handle for string
+    /// instructions (ins / outs) before being passed to each registered
+    /// string handler. Instead of one element at a time, string handlers
+    /// are given all of the elements the guest is transferring at once,
+    /// using a single mapping of the guest's memory.
+    ///
+    struct string_info_t {
+
+        /// Port number
+        ///
+        /// The port number accessed by the guest.
+        ///
+        /// default: see info_t::port_number
+        ///
+        uint64_t port_number;
+
+        /// Size of access
+        ///
+        /// The size of each element.
+        ///
+        /// default: vmcs_n::exit_qualification::io_instruction::size_of_access
+        ///
+        uint64_t size_of_access;
+
+        /// Address
+        ///
+        /// The guest linear address of the first element.
+        ///
+        /// default: vmcs_n::guest_linear_address
+        ///
+        uint64_t address;
+
+        /// Count
+        ///
+        /// The number of elements in buf. This can be less than the guest's
+        /// repeat count, in which case the guest will exit again for the
+        /// remaining elements.
+        ///
+        /// default: min(rcx & 0xFFFFFFFF, max batch) if rep prefixed, 1
+        ///          otherwise
+        ///
+        uint64_t count;
+
+        /// Buffer
+        ///
+        /// The guest's memory at info.address, mapped into the VMM. For 'in'
+        /// accesses the handler fills this buffer, and for 'out' accesses
+        /// it contains the data the guest is writing.
+        ///
+        /// default: 'in' buf contains the guest's memory. String handlers
+        ///          are called before the port is read, so a handler that
+        ///          returns true must fill buf itself
+        /// default: 'out' buf contains the guest's memory
+        ///
+        gsl::span<uint8_t> buf;
+
+        /// Ignore write (out)
+        ///
+        /// For 'out' accesses, do not write buf to the port
+        /// info.port_number if this field is true. Has no effect on 'in'
+        /// accesses as the handler writes to buf directly.
+        ///
+        /// default: false
+        ///
+        bool ignore_write;
+
+        /// Ignore advance (out)
+        ///
+        /// If true, do not update the guest's rcx, rsi / rdi and instruction
+        /// pointer. Set this to true if your handler returns true and has
+        /// already updated the guest's state.
+        ///
+        /// default: false
+        ///
+        bool ignore_advance;
+    };
+
     /// Handler delegate type
     ///
     /// The type of delegate clients must use when registering
@@ -124,6 +204,14 @@ public:
     using handler_delegate_t =
         delegate<bool(vcpu *, info_t &)>;
 
+    /// String handler delegate type
+    ///
+    /// The type of delegate clients must use when registering
+    /// string handlers
+    ///
+    using string_handler_delegate_t =
+        delegate<bool(vcpu *, string_info_t &)>;
+
     /// Constructor
     ///
     /// @expects
@@ -158,6 +246,32 @@ public:
         const handler_delegate_t &out_d
     );
 
+    /// Add String Handler
+    ///
+    /// String handlers are called for ins / outs instructions, and take
+    /// precedence over handlers registered using add_handler(), which
+    /// are otherwise called once per element.
+    ///
+    /// For ins, the string handlers are called before the port is read.
+    /// If none of them handle the access, the port is read once (unless
+    /// it is emulated) and each element is passed to the handlers
+    /// registered using add_handler(). As with single accesses, an
+    /// element that none of them accept is given to the default handler,
+    /// once the elements before it have been completed.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param port the port to listen to
+    /// @param in_d the handler to call when an ins exit occurs
+    /// @param out_d the handler to call when an outs exit occurs
+    ///
+    void add_string_handler(
+        vmcs_n::value_type port,
+        const string_handler_delegate_t &in_d,
+        const string_handler_delegate_t &out_d
+    );
+
     /// Emulate
     ///
     /// Prevents the APIs from talking to physical hardware which means that
@@ -268,14 +382,28 @@ public:
 
     /// @endcond
 
+#ifndef ENABLE_BUILD_TEST
 private:
+#endif
 
     bool handle_in(vcpu *vcpu, info_t &info);
     bool handle_out(vcpu *vcpu, info_t &info);
 
+    uint64_t string_address_mask(vcpu *vcpu);
+    static uint64_t string_register_add(uint64_t reg, uint64_t val, uint64_t mask) noexcept;
+
+    bool handle_string(vcpu *vcpu, info_t &info, uint64_t reps, uint64_t mask);
+    bool has_string_handlers(vmcs_n::value_type port, bool in) const;
+    bool handle_string_default(vcpu *vcpu, info_t &info);
+    bool handle_string_in(vcpu *vcpu, string_info_t &info);
+    bool handle_string_out(vcpu *vcpu, string_info_t &info);
+
     void emulate_in(info_t &info);
     void emulate_out(info_t &info);
 
+    void emulate_string_in(string_info_t &info);
+    void emulate_string_out(string_info_t &info);
+
     void load_operand(vcpu *vcpu, info_t &info);
     void store_operand(vcpu *vcpu, info_t &info);
 
@@ -286,11 +414,17 @@ private:
     gsl::span<uint8_t> m_io_bitmap_a;
     gsl::span<uint8_t> m_io_bitmap_b;
 
+    bool m_address_size_reported;
+
     ::handler_delegate_t m_default_handler{};
     std::unordered_map<vmcs_n::value_type, bool> m_emulate;
     std::unordered_map<vmcs_n::value_type, std::list<handler_delegate_t>> m_in_handlers;
     std::unordered_map<vmcs_n::value_type, std::list<handler_delegate_t>> m_out_handlers;
 
+    using string_handlers_t = std::list<string_handler_delegate_t>;
+    std::unordered_map<vmcs_n::value_type, string_handlers_t> m_string_in_handlers;
+    std::unordered_map<vmcs_n::value_type, string_handlers_t> m_string_out_handlers;
+
 public:
 
     /// @cond
@@ -305,6 +439,7 @@ public:
 };
 
 using io_instruction_handler_delegate_t = io_instruction_handler::handler_delegate_t;
+using io_instruction_string_handler_delegate_t = io_instruction_handler::string_handler_delegate_t;
 
 }
 
@@ -0,0 +1,194 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef VMEXIT_PAUSE_INTEL_X64_H
+#define VMEXIT_PAUSE_INTEL_X64_H
+
+#include <list>
+
+#include <bfgsl.h>
+#include <bfdelegate.h>
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfvmm::intel_x64
+{
+
+class vcpu;
+
+/// PAUSE
+///
+/// Provides an interface for handling PAUSE-loop exits. A PAUSE-loop exit
+/// occurs when the guest executes a loop of PAUSE instructions (i.e., it is
+/// spinning on a lock) for longer than the PLE window, which usually means
+/// the lock holder is not running. Registered handlers act as the policy
+/// for these exits, and are expected to yield the physical core (or boost
+/// the lock holder). If no handler acts on the exit, the guest is resumed.
+///
+class pause_handler
+{
+public:
+
+    using value_t = uint64_t;           ///< PLE gap/window type (in TSC ticks)
+
+    /// Handler delegate type
+    ///
+    /// The type of delegate clients must use when registering
+    /// handlers
+    ///
+    using handler_delegate_t = delegate<bool(vcpu *)>;
+
+    /// Statistics
+    ///
+    struct stats_t {
+        uint64_t exits;                 ///< Number of PAUSE-loop exits
+        uint64_t yields;                ///< Number of exits that yielded the core
+        uint64_t boosts;                ///< Number of exits handled without a yield
+        uint64_t spin_ticks;            ///< Minimum time spent spinning (in TSC ticks)
+    };
+
+    /// Default PLE gap (the maximum number of ticks between two PAUSE
+    /// instructions of the same loop)
+    ///
+    static constexpr const value_t default_gap = 128;
+
+    /// Default PLE window (the number of ticks a guest may spin before an
+    /// exit occurs)
+    ///
+    static constexpr const value_t default_window = 4096;
+
+    /// Constructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param vcpu the vcpu object for this PAUSE handler
+    ///
+    pause_handler(
+        gsl::not_null<vcpu *> vcpu);
+
+    /// Destructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    ~pause_handler() = default;
+
+public:
+
+    /// Add PAUSE Handler
+    ///
+    /// Handlers are called in the reverse order they are added. Note that
+    /// a handler that yields the physical core to another vCPU does not
+    /// return. A handler that returns true acted on the exit without
+    /// yielding (e.g., it boosted the lock holder), and is counted as a
+    /// boost instead of a yield.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the handler to call when an exit occurs
+    ///
+    void add_handler(const handler_delegate_t &d);
+
+    /// Remove PAUSE Handler
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the handler to remove
+    ///
+    void remove_handler(const handler_delegate_t &d);
+
+    /// Enable exiting
+    ///
+    /// Enables PAUSE-loop exiting if the hardware supports it.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    void enable_exiting();
+
+    /// Disable exiting
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    void disable_exiting();
+
+    /// Set Window
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param gap the maximum number of ticks between two PAUSE
+    ///     instructions for them to be considered part of the same loop
+    /// @param window the number of ticks a guest may spin before an exit
+    ///
+    void set_window(value_t gap, value_t window);
+
+    /// Statistics
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the PAUSE-loop exit statistics of this vCPU
+    ///
+    const stats_t &stats() const noexcept
+    { return m_stats; }
+
+public:
+
+    /// @cond
+
+    bool handle(vcpu *vcpu);
+
+    /// @endcond
+
+private:
+
+    vcpu *m_vcpu;
+
+    value_t m_window{default_window};
+    stats_t m_stats{};
+
+    std::list<handler_delegate_t> m_handlers;
+
+public:
+
+    /// @cond
+
+    pause_handler(pause_handler &&) = default;
+    pause_handler &operator=(pause_handler &&) = default;
+
+    pause_handler(const pause_handler &) = delete;
+    pause_handler &operator=(const pause_handler &) = delete;
+
+    /// @endcond
+};
+
+using pause_handler_delegate_t = pause_handler::handler_delegate_t;
+
+}
+
+#endif
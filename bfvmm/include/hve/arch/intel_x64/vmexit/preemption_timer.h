@@ -81,6 +81,15 @@ public:
     ///
     void add_handler(const handler_delegate_t &d);
 
+    /// Remove VMX Preemption Timer Handler
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the handler to remove
+    ///
+    void remove_handler(const handler_delegate_t &d);
+
     /// Enable exiting
     ///
     /// Example:
@@ -0,0 +1,198 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef VMEXIT_VMCALL_INTEL_X64_H
+#define VMEXIT_VMCALL_INTEL_X64_H
+
+#include <list>
+
+#include <bfgsl.h>
+#include <bfdelegate.h>
+#include <bfhypercallring.h>
+
+#include "../exit_handler.h"
+#include "../../x64/unmapper.h"
+
+// -----------------------------------------------------------------------------
+// Definitions
+// -----------------------------------------------------------------------------
+
+namespace bfvmm::intel_x64
+{
+
+class vcpu;
+
+/// VMCall
+///
+/// Provides the VMM side of the hypercall ring (see bfhypercallring.h).
+/// Userspace registers a ring with a HYPERCALL_RING_REGISTER vmcall, queues
+/// hypercalls in the ring, and then issues a single
+/// HYPERCALL_RING_DOORBELL vmcall to have all of them completed by one VM
+/// exit. If polling is enabled, the ring is also drained on every VM exit,
+/// in which case the doorbell is only needed when userspace cannot wait.
+///
+/// The ring is mapped using the guest's page tables at the time it is
+/// registered, and it belongs to this vCPU, so userspace should pin itself
+/// to the core it registered the ring on (like the hook example does) and
+/// must keep the ring resident until it is unregistered.
+///
+/// vmcalls that are not for the hypercall ring are not handled here, and
+/// are passed on to the handlers added with add_exit_handler_for_reason().
+///
+class vmcall_handler
+{
+public:
+
+    /// Handler delegate type
+    ///
+    /// The type of delegate clients must use when registering handlers.
+    /// A handler that services the entry stores its result in reg1 and
+    /// returns true. Handlers are called with the same registers a vmcall
+    /// would provide, so the same handler logic can service both.
+    ///
+    using handler_delegate_t =
+        delegate<bool(vcpu *, bfn::hypercall_ring_entry_t &)>;
+
+    /// Statistics
+    ///
+    struct stats_t {
+        uint64_t doorbells;             ///< Number of doorbell vmcalls
+        uint64_t polls;                 ///< Number of polls that found work
+        uint64_t hypercalls;            ///< Number of entries completed
+    };
+
+    /// Constructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param vcpu the vcpu object for this vmcall handler
+    ///
+    vmcall_handler(
+        gsl::not_null<vcpu *> vcpu);
+
+    /// Destructor
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    ~vmcall_handler() = default;
+
+public:
+
+    /// Add Hypercall Handler
+    ///
+    /// Handlers are called in the reverse order they are added.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param d the handler to call for each entry in the ring
+    ///
+    void add_handler(const handler_delegate_t &d);
+
+    /// Enable Polling
+    ///
+    /// Drains the ring (if one is registered) on every VM exit. This adds a
+    /// couple of loads to every VM exit, but allows userspace to submit
+    /// hypercalls without a doorbell at all.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    void enable_polling();
+
+    /// Drain
+    ///
+    /// Completes every pending entry in the ring. An entry that is not
+    /// serviced by a handler (or whose handler throws) is completed with
+    /// HYPERCALL_RING_UNHANDLED.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return the number of entries that were completed
+    ///
+    uint64_t drain();
+
+    /// Is Registered
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns true if userspace has registered a ring
+    ///
+    bool is_registered() const noexcept
+    { return static_cast<bool>(m_ring); }
+
+    /// Statistics
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the hypercall ring statistics of this vCPU
+    ///
+    const stats_t &stats() const noexcept
+    { return m_stats; }
+
+public:
+
+    /// @cond
+
+    exit_result_t handle(vcpu *vcpu);
+    bool poll(vcpu *vcpu);
+
+    /// @endcond
+
+private:
+
+    void register_ring(uintptr_t gva);
+    void complete(bfn::hypercall_ring_entry_t &entry);
+
+private:
+
+    vcpu *m_vcpu;
+
+    bool m_polling{false};
+    stats_t m_stats{};
+
+    x64::unique_map<bfn::hypercall_ring_t> m_ring;
+    std::list<handler_delegate_t> m_handlers;
+
+public:
+
+    /// @cond
+
+    vmcall_handler(vmcall_handler &&) = default;
+    vmcall_handler &operator=(vmcall_handler &&) = default;
+
+    vmcall_handler(const vmcall_handler &) = delete;
+    vmcall_handler &operator=(const vmcall_handler &) = delete;
+
+    /// @endcond
+};
+
+using vmcall_handler_delegate_t = vmcall_handler::handler_delegate_t;
+
+}
+
+#endif
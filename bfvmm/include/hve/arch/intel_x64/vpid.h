@@ -22,6 +22,8 @@
 #ifndef VPID_INTEL_X64_H
 #define VPID_INTEL_X64_H
 
+#include <cstdint>
+
 // -----------------------------------------------------------------------------
 // Definitions
 // -----------------------------------------------------------------------------
@@ -31,9 +33,118 @@ namespace bfvmm::intel_x64
 
 class vcpu;
 
+/// VPID Allocator
+///
+/// Hands out VPIDs for a single physical core, in the same way Linux hands
+/// out ASIDs. Each allocator has a generation. A VPID is only valid on the
+/// core it was acquired on, and only while the core's generation has not
+/// changed. VPIDs are handed out sequentially, and once they have all been
+/// used, the generation is incremented, every VPID becomes free again, and
+/// the core's TLB is flushed once for all VPIDs. vCPUs that still hold a
+/// VPID from the old generation acquire a new one the next time they run.
+///
+/// This means that the VPIDs of destroyed vCPUs are recycled without ever
+/// flushing the TLB when a VPID is (re)assigned. A VPID cannot be reused any
+/// sooner, as the core might still have translations cached for it.
+///
+/// Each allocator is only ever used by the core it belongs to, so there is
+/// no need for locks or atomics.
+///
+class vpid_allocator
+{
+public:
+
+    using id_type = uint16_t;               ///< VPID type
+    using generation_type = uint64_t;       ///< Generation type
+
+    /// The largest VPID. VPID 0 is reserved for the VMM.
+    ///
+    static constexpr const id_type max_id = 0xFFFF;
+
+    /// Statistics
+    ///
+    /// allocations counts the VPIDs that were handed out, and rollovers
+    /// counts the number of times the generation rolled over, which is also
+    /// the number of times the core's TLB had to be flushed.
+    ///
+    struct stats_t {
+        uint64_t allocations;
+        uint64_t rollovers;
+    };
+
+    /// Acquire
+    ///
+    /// Ensures the provided VPID is valid on this core. If it is already
+    /// valid, it is left unchanged. Otherwise, a new VPID is handed out and
+    /// the id and generation are updated.
+    ///
+    /// @expects
+    /// @ensures id != 0
+    ///
+    /// @param id the VPID to validate / replace
+    /// @param gen the generation id was acquired in
+    /// @return returns true if the generation rolled over, in which case the
+    ///     caller must flush the core's TLB for all VPIDs before using id
+    ///
+    bool acquire(id_type &id, generation_type &gen) noexcept;
+
+    /// Is Valid
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param id the VPID to check
+    /// @param gen the generation id was acquired in
+    /// @return returns true if id can still be used on this core
+    ///
+    bool is_valid(id_type id, generation_type gen) const noexcept
+    { return id != 0 && gen == m_generation; }
+
+    /// Generation
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the current generation
+    ///
+    generation_type generation() const noexcept
+    { return m_generation; }
+
+    /// Statistics
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the allocator's statistics
+    ///
+    const stats_t &stats() const noexcept
+    { return m_stats; }
+
+    /// Instance
+    ///
+    /// @expects pcpuid < MAX_NUM_PCPUS
+    /// @ensures
+    ///
+    /// @param pcpuid the physical core to get the allocator for
+    /// @return returns the VPID allocator of the provided physical core
+    ///
+    static vpid_allocator &instance(uint64_t pcpuid);
+
+private:
+
+    generation_type m_generation{1};
+    uint64_t m_next{1};
+
+    stats_t m_stats{};
+};
+
 /// VPID
 ///
-/// Provides an interface for enabling VPID
+/// Provides an interface for enabling VPID. The vCPU's VPID is acquired from
+/// the allocator of the physical core the vCPU runs on, and is revalidated
+/// each time the vCPU is launched / resumed, which only costs a compare
+/// unless the vCPU moved to another core, or that core's generation rolled
+/// over.
 ///
 class vpid_handler
 {
@@ -70,9 +181,46 @@ public:
     ///
     void disable();
 
+    /// Reset
+    ///
+    /// Drops the vCPU's VPID, so that a recycled vCPU does not share the
+    /// TLB entries of the guest that last used it. A new VPID is acquired
+    /// the next time the handler is enabled.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    void reset() noexcept;
+
+    /// Refresh
+    ///
+    /// Makes sure the vCPU's VPID is valid on the current physical core,
+    /// acquiring a new one (and flushing the core's TLB if the generation
+    /// rolls over) if it is not. Called by the vCPU right before it is
+    /// launched / resumed.
+    ///
+    /// @expects the vCPU's VMCS is loaded
+    /// @ensures
+    ///
+    void refresh();
+
+    /// ID
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @return returns the vCPU's current VPID, or 0 if VPID is disabled
+    ///
+    vpid_allocator::id_type id() const noexcept
+    { return m_enabled ? m_id : 0; }
+
 private:
 
-    vmcs_n::value_type m_id;
+    bool m_enabled{false};
+    uint64_t m_pcpuid{};
+
+    vpid_allocator::id_type m_id{};
+    vpid_allocator::generation_type m_generation{};
 
 public:
 
@@ -247,6 +247,39 @@ public:
         return (m_idt.at(index * 2U) & 0x0000800000000000ULL) != 0;
     }
 
+    /// Set Interrupt Stack Table Index
+    ///
+    /// Sets the IST index of the descriptor. By default, set_present()
+    /// uses IST 1. An index of 0 tells the CPU to use the current stack.
+    ///
+    /// @expects index < m_idt.size()
+    /// @expects ist < 8
+    /// @ensures none
+    ///
+    /// @param index the index of the IDT descriptor
+    /// @param ist the IST index
+    ///
+    void set_ist(index_type index, uint64_t ist)
+    {
+        expects(ist < 8);
+
+        auto sd1 = m_idt.at(index * 2U) & 0xFFFFFFF8FFFFFFFFULL;
+        m_idt.at(index * 2U) = sd1 | (ist << 32);
+    }
+
+    /// Get Interrupt Stack Table Index
+    ///
+    /// @expects index < m_idt.size()
+    /// @ensures none
+    ///
+    /// @param index the index of the IDT descriptor
+    /// @return the IST index
+    ///
+    uint64_t ist(index_type index) const
+    {
+        return (m_idt.at(index * 2U) & 0x0000000700000000ULL) >> 32;
+    }
+
     /// Set All Fields
     ///
     /// @expects index < m_idt.size()
@@ -23,10 +23,12 @@
 #define MMAP_CR3_X64_H
 
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include <bfgsl.h>
 #include <bfdebug.h>
+#include <bfrwlock.h>
 #include <bfupperlower.h>
 
 #include <intrinsics.h>
@@ -312,6 +314,61 @@ public:
         return map_4k(reinterpret_cast<void *>(virt_addr), phys_addr, attr, cache);
     }
 
+    /// Map Virt Address Range to Phys Address Range
+    ///
+    /// Maps size bytes starting at virt_addr to the physically contiguous
+    /// range starting at phys_addr. Wherever both the virtual and the
+    /// physical address are 2m aligned, and at least 2m of the range remains,
+    /// a 2m page is used. The rest of the range is mapped using 4k pages.
+    /// Unlike map_2m / map_4k, the lock is only taken once for the whole
+    /// range.
+    ///
+    /// @expects
+    /// @ensures
+    ///
+    /// @param virt_addr the virtual address to map from
+    /// @param phys_addr the physical address to map to
+    /// @param size the number of bytes to map
+    /// @param attr the map permissions
+    /// @param cache the memory type for the mapping
+    ///
+    void
+    map_range(
+        virt_addr_t virt_addr,
+        phys_addr_t phys_addr,
+        size_type size,
+        attr_type attr = attr_type::read_write,
+        memory_type cache = memory_type::write_back)
+    {
+        using namespace ::x64;
+        std::lock_guard lock(m_mutex);
+
+        expects(bfn::lower(virt_addr, pt::from) == 0);
+        expects(bfn::lower(phys_addr, pt::from) == 0);
+        expects(bfn::lower(size, pt::from) == 0);
+
+        for (size_type i = 0; i < size;) {
+            auto virt = reinterpret_cast<void *>(virt_addr + i);
+            auto phys = phys_addr + i;
+
+            this->map_pdpt(pml4::index(virt));
+            this->map_pd(pdpt::index(virt));
+
+            if (bfn::lower(virt, pd::from) == 0 &&
+                bfn::lower(phys, pd::from) == 0 && size - i >= pd::page_size) {
+                this->map_pde(virt, phys, attr, cache);
+
+                i += pd::page_size;
+                continue;
+            }
+
+            this->map_pt(pd::index(virt));
+            this->map_pte(virt, phys, attr, cache);
+
+            i += pt::page_size;
+        }
+    }
+
     /// Unmap Virtual Address
     ///
     /// @expects
@@ -422,39 +479,14 @@ public:
     std::pair<std::reference_wrapper<entry_type>, uintptr_t>
     entry(void *virt_addr)
     {
-        using namespace ::x64;
-        std::lock_guard lock(m_mutex);
-
-        this->map_pdpt(pml4::index(virt_addr));
-        auto &pdpte = m_pdpt.virt_addr.at(pdpt::index(virt_addr));
-
-        if (pdpte == 0) {
-            throw std::runtime_error("entry: pdpte not mapped");
-        }
-
-        if (pdpt::entry::ps::is_enabled(pdpte)) {
-            return {pdpte, pdpt::from};
-        }
-
-        this->map_pd(pdpt::index(virt_addr));
-        auto &pde = m_pd.virt_addr.at(pd::index(virt_addr));
-
-        if (pde == 0) {
-            throw std::runtime_error("entry: pde not mapped");
-        }
-
-        if (pd::entry::ps::is_enabled(pde)) {
-            return {pde, pd::from};
-        }
-
-        this->map_pt(pd::index(virt_addr));
-        auto &pte = m_pt.virt_addr.at(pt::index(virt_addr));
+        std::shared_lock lock(m_mutex);
 
-        if (pte == 0) {
-            throw std::runtime_error("entry: pte not mapped");
+        auto [entry_ptr, entry_from] = this->walk(virt_addr);
+        if (entry_ptr == nullptr || *entry_ptr == 0) {
+            throw std::runtime_error("entry: virt_addr not mapped");
         }
 
-        return {pte, pt::from};
+        return {*entry_ptr, entry_from};
     }
 
     /// Virtual Address to Entry
@@ -502,47 +534,32 @@ public:
     virt_to_phys(virt_addr_t virt_addr)
     {
         using namespace ::x64;
-        std::lock_guard lock(m_mutex);
-
-        this->map_pdpt(pml4::index(virt_addr));
-        auto pdpte = m_pdpt.virt_addr.at(pdpt::index(virt_addr));
-
-        if (pdpte == 0) {
-            throw std::runtime_error("virt_to_phys: pdpte not mapped");
-        }
-
-        if (pdpt::entry::ps::is_enabled(pdpte)) {
-            return {
-                pdpt::entry::phys_addr::get(pdpte) | bfn::lower(virt_addr, pdpt::from),
-                pdpt::from
-            };
-        }
-
-        this->map_pd(pdpt::index(virt_addr));
-        auto pde = m_pd.virt_addr.at(pd::index(virt_addr));
+        std::shared_lock lock(m_mutex);
 
-        if (pde == 0) {
-            throw std::runtime_error("virt_to_phys: pde not mapped");
+        auto [entry_ptr, entry_from] = this->walk(reinterpret_cast<void *>(virt_addr));
+        if (entry_ptr == nullptr || *entry_ptr == 0) {
+            throw std::runtime_error("virt_to_phys: virt_addr not mapped");
         }
 
-        if (pd::entry::ps::is_enabled(pde)) {
-            return {
-                pd::entry::phys_addr::get(pde) | bfn::lower(virt_addr, pd::from),
-                pd::from
-            };
+        switch (entry_from) {
+            case pdpt::from:
+                return {
+                    pdpt::entry::phys_addr::get(*entry_ptr) | bfn::lower(virt_addr, entry_from),
+                    entry_from
+                };
+
+            case pd::from:
+                return {
+                    pd::entry::phys_addr::get(*entry_ptr) | bfn::lower(virt_addr, entry_from),
+                    entry_from
+                };
+
+            default:
+                return {
+                    pt::entry::phys_addr::get(*entry_ptr) | bfn::lower(virt_addr, entry_from),
+                    entry_from
+                };
         }
-
-        this->map_pt(pd::index(virt_addr));
-        auto pte = m_pt.virt_addr.at(pt::index(virt_addr));
-
-        if (pte == 0) {
-            throw std::runtime_error("virt_to_phys: pte not mapped");
-        }
-
-        return {
-            pt::entry::phys_addr::get(pte) | bfn::lower(virt_addr, pt::from),
-            pt::from
-        };
     }
 
     /// Virtual Address to From
@@ -556,39 +573,14 @@ public:
     uint64_t
     from(void *virt_addr)
     {
-        using namespace ::x64;
-        std::lock_guard lock(m_mutex);
-
-        this->map_pdpt(pml4::index(virt_addr));
-        auto pdpte = m_pdpt.virt_addr.at(pdpt::index(virt_addr));
+        std::shared_lock lock(m_mutex);
 
-        if (pdpte == 0) {
-            throw std::runtime_error("from: pdpte not mapped");
+        auto [entry_ptr, entry_from] = this->walk(virt_addr);
+        if (entry_ptr == nullptr || *entry_ptr == 0) {
+            throw std::runtime_error("from: virt_addr not mapped");
         }
 
-        if (pdpt::entry::ps::is_enabled(pdpte)) {
-            return pdpt::from;
-        }
-
-        this->map_pd(pdpt::index(virt_addr));
-        auto pde = m_pd.virt_addr.at(pd::index(virt_addr));
-
-        if (pde == 0) {
-            throw std::runtime_error("from: pde not mapped");
-        }
-
-        if (pd::entry::ps::is_enabled(pde)) {
-            return pd::from;
-        }
-
-        this->map_pt(pd::index(virt_addr));
-        auto pte = m_pt.virt_addr.at(pt::index(virt_addr));
-
-        if (pte == 0) {
-            throw std::runtime_error("from: pte not mapped");
-        }
-
-        return pt::from;
+        return entry_from;
     }
 
     /// Virtual Address to From
@@ -728,7 +720,7 @@ private:
 private:
 
     pair
-    phys_to_pair(phys_addr_t phys_addr, size_type num_entries)
+    phys_to_pair(phys_addr_t phys_addr, size_type num_entries) const
     {
         auto virt_addr =
             static_cast<virt_addr_t *>(
@@ -741,6 +733,44 @@ private:
         };
     }
 
+    // Read-only page walk used by the lookup functions. Unlike map_pdpt(),
+    // map_pd() and map_pt(), this neither allocates missing tables nor
+    // updates the last lookup cache (m_pdpt, m_pd and m_pt), so it is safe
+    // to run concurrently under a shared lock. Returns the entry that maps
+    // the address along with its page size, or nullptr if the PML4 entry
+    // is not present.
+    //
+    std::pair<entry_type *, uintptr_t>
+    walk(void *virt_addr) const
+    {
+        using namespace ::x64;
+
+        auto pml4e = m_pml4.virt_addr.at(pml4::index(virt_addr));
+        if (pml4e == 0) {
+            return {nullptr, pdpt::from};
+        }
+
+        auto pdpt_span =
+            phys_to_pair(pml4::entry::phys_addr::get(pml4e), pdpt::num_entries).virt_addr;
+        auto &pdpte = pdpt_span.at(pdpt::index(virt_addr));
+
+        if (pdpte == 0 || pdpt::entry::ps::is_enabled(pdpte)) {
+            return {&pdpte, pdpt::from};
+        }
+
+        auto pd_span =
+            phys_to_pair(pdpt::entry::phys_addr::get(pdpte), pd::num_entries).virt_addr;
+        auto &pde = pd_span.at(pd::index(virt_addr));
+
+        if (pde == 0 || pd::entry::ps::is_enabled(pde)) {
+            return {&pde, pd::from};
+        }
+
+        auto pt_span =
+            phys_to_pair(pd::entry::phys_addr::get(pde), pt::num_entries).virt_addr;
+        return {&pt_span.at(pt::index(virt_addr)), pt::from};
+    }
+
     void
     map_pdpt(index_type pml4i)
     {
@@ -1111,7 +1141,7 @@ private:
     pair m_pd;
     pair m_pt;
 
-    mutable std::mutex m_mutex;
+    mutable bfn::rwlock m_mutex;
     std::unordered_map<void *, phys_addr_t> m_mdl;
 
 public:
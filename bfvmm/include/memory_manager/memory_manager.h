@@ -22,6 +22,9 @@
 #ifndef MEMORY_MANAGER_H
 #define MEMORY_MANAGER_H
 
+#include <array>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
@@ -86,6 +89,28 @@ public:
     using attr_type = decltype(memory_descriptor::type);            ///< Attribute type
     using memory_descriptor_list = std::vector<memory_descriptor>;  ///< Memory descriptor list type
 
+    /// Memory Descriptor Run
+    ///
+    /// A run of memory descriptors that are both virtually and physically
+    /// contiguous, and share the same attributes.
+    ///
+    struct memory_descriptor_run {
+        integer_pointer phys;       ///< Physical address of the run
+        integer_pointer virt;       ///< Virtual address of the run
+        size_type size;             ///< Size of the run in bytes
+        attr_type type;             ///< Attributes of the run
+    };
+
+    using memory_descriptor_run_list = std::vector<memory_descriptor_run>;  ///< Run list type
+
+    using node_type = uint64_t;                                     ///< NUMA node type
+
+    /// Invalid Node
+    ///
+    /// Returned when memory does not belong to a node pool
+    ///
+    static constexpr const node_type invalid_node = ~0ULL;
+
     /// Default Destructor
     ///
     /// @expects none
@@ -381,10 +406,158 @@ public:
     ///
     virtual memory_descriptor_list descriptors() const;
 
+    /// Descriptor Run List
+    ///
+    /// Same as descriptors(), but descriptors that are both virtually and
+    /// physically contiguous, and share the same attributes, are merged into
+    /// a single run (sorted by virtual address). Runs are used to map the
+    /// VMM's own memory using large pages where possible.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return memory descriptor run list
+    ///
+    virtual memory_descriptor_run_list descriptor_runs() const;
+
+    /// Add Node Pool
+    ///
+    /// Adds a pool of NUMA node-local memory to the memory manager. Once
+    /// added, page and huge allocations made on a CPU that belongs to this
+    /// node (see set_cpu_node), or within a node_scope for this node, are
+    /// served from this pool, falling back to the global pools when the
+    /// node pool is exhausted. The node is taken from the memory descriptors
+    /// of the pool, so every page of the pool must have been added using
+    /// add_md with the same MEMORY_TYPE_NODE tag.
+    ///
+    /// @expects virt & (page_size - 1) == 0
+    /// @expects size / page_size is a power of 2
+    /// @expects every page of the pool was added using add_md
+    /// @ensures none
+    ///
+    /// @param virt virtual address of the node pool
+    /// @param size the size of the node pool in bytes
+    ///
+    virtual void add_node_pool(
+        integer_pointer virt, size_type size);
+
+    /// Remove Node Pool
+    ///
+    /// Removes a node pool previously added using add_node_pool. Any memory
+    /// that is still allocated from this pool must not be used (or freed)
+    /// once the pool is removed.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param node the node to remove the pool for
+    ///
+    virtual void remove_node_pool(
+        node_type node) noexcept;
+
+    /// Set CPU Node
+    ///
+    /// Tells the memory manager which NUMA node a physical CPU belongs to.
+    /// CPUs default to node 0.
+    ///
+    /// @expects cpuid < MAX_NUM_PCPUS
+    /// @expects node < MAX_NUM_NODES
+    /// @ensures none
+    ///
+    /// @param cpuid the physical CPU to set the node for
+    /// @param node the NUMA node cpuid belongs to
+    ///
+    virtual void set_cpu_node(
+        uint64_t cpuid, node_type node);
+
+    /// CPU Node
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param cpuid the physical CPU to get the node of
+    /// @return the NUMA node cpuid belongs to (0 if cpuid is out of range)
+    ///
+    virtual node_type cpu_node(
+        uint64_t cpuid) const noexcept;
+
+    /// Current Node
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return the NUMA node that page and huge allocations made on the
+    ///     current CPU are served from
+    ///
+    virtual node_type node() const noexcept;
+
+    /// Node of Memory
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param ptr a pointer to previously allocated memory
+    /// @return the NUMA node ptr was allocated from, or invalid_node if ptr
+    ///     was not allocated from a node pool
+    ///
+    virtual node_type node(
+        pointer ptr) const noexcept;
+
+    /// Node Scope
+    ///
+    /// While a node scope is alive, page and huge allocations made on the
+    /// current CPU are served from the provided node instead of the CPU's
+    /// own node. This is used to allocate a structure from the node of the
+    /// CPU that will use it (e.g. a vCPU), regardless of which CPU creates
+    /// it. Node scopes can be nested.
+    ///
+    class node_scope
+    {
+    public:
+
+        /// Constructor
+        ///
+        /// @expects none
+        /// @ensures none
+        ///
+        /// @param node the node to allocate from while in scope
+        ///
+        explicit node_scope(node_type node) noexcept;
+
+        /// Destructor
+        ///
+        /// @expects none
+        /// @ensures none
+        ///
+        ~node_scope() noexcept;
+
+    private:
+
+        uint64_t m_cpuid;
+        node_type m_prev;
+
+    public:
+
+        /// @cond
+
+        node_scope(node_scope &&) noexcept = delete;
+        node_scope &operator=(node_scope &&) noexcept = delete;
+
+        node_scope(const node_scope &) = delete;
+        node_scope &operator=(const node_scope &) = delete;
+
+        /// @endcond
+    };
+
 private:
 
     memory_manager() noexcept;
 
+    node_type owner(pointer ptr) const noexcept;
+    pointer alloc_node(size_type size) noexcept;
+    bool free_node(pointer ptr) noexcept;
+    size_type size_node(pointer ptr) const noexcept;
+
 private:
 
     struct virt_t {
@@ -400,6 +573,16 @@ private:
     std::unordered_map<integer_pointer, virt_t> m_virt_map;
     std::unordered_map<integer_pointer, phys_t> m_phys_map;
 
+    struct node_pool_t {
+        std::unique_ptr<uint8_t[]> node_tree;
+        std::unique_ptr<buddy_allocator> pool;
+    };
+
+    std::array<node_pool_t, MAX_NUM_NODES> m_node_pools;
+    std::atomic<size_type> m_num_node_pools{};
+    std::array<node_type, MAX_NUM_PCPUS> m_cpu_nodes;
+    std::array<node_type, MAX_NUM_PCPUS> m_scope_nodes;
+
     buddy_allocator g_page_pool;
     buddy_allocator g_huge_pool;
     buddy_allocator g_mem_map_pool;
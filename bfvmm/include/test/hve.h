@@ -70,6 +70,7 @@ extern "C" void _esr4(void) noexcept {}
 extern "C" void _esr5(void) noexcept {}
 extern "C" void _esr6(void) noexcept {}
 extern "C" void _esr7(void) noexcept {}
+extern "C" void _esr7_lazy_xsave(void) noexcept {}
 extern "C" void _esr8(void) noexcept {}
 extern "C" void _esr9(void) noexcept {}
 extern "C" void _esr10(void) noexcept {}
@@ -113,14 +114,19 @@ bfvmm::intel_x64::vcpu_state_t g_state{};
 uint8_t g_msr_bitmap[0x1000] {};
 uint8_t g_io_bitmap_a[0x1000] {};
 uint8_t g_io_bitmap_b[0x1000] {};
+bfvmm::intel_x64::pause_handler::stats_t g_pause_stats{};
+bfvmm::intel_x64::vmcs_write_cache::stats_t g_vmcs_write_stats{};
+bfvmm::intel_x64::vmcall_handler::stats_t g_hypercall_ring_stats{};
 
 extern "C" void vmcs_launch(
     bfvmm::intel_x64::vcpu_state_t *state) noexcept
 { bfignored(state); }
 
+bfvmm::intel_x64::vcpu_state_t *g_promoted_state{};
+
 extern "C" void vmcs_promote(
     bfvmm::intel_x64::vcpu_state_t *state, const void *gdt) noexcept
-{ bfignored(state); bfignored(gdt); }
+{ g_promoted_state = state; bfignored(gdt); }
 
 extern "C" void vmcs_resume(
     bfvmm::intel_x64::vcpu_state_t *state) noexcept
@@ -153,12 +159,17 @@ setup_vcpu(MockRepository &mocks, ::intel_x64::vmcs::value_type reason = 0)
 
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_exit_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_exit_handler_for_reason);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::remove_exit_handler_for_reason);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_result_handler_for_reason);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_fast_exit_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::dump);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::halt);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_wrcr0_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_rdcr3_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_wrcr3_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_wrcr4_handler);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_wrcr0_mask);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_wrcr4_mask);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::execute_wrcr0);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::execute_rdcr3);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::execute_wrcr3);
@@ -178,10 +189,14 @@ setup_vcpu(MockRepository &mocks, ::intel_x64::vmcs::value_type reason = 0)
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::queue_external_interrupt);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::inject_exception);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::inject_external_interrupt);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::enable_virtual_interrupt_delivery);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::enable_posted_interrupts);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::post_external_interrupt).Return(false);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::trap_on_all_io_instruction_accesses);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::pass_through_all_io_instruction_accesses);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::pass_through_io_accesses);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_io_instruction_handler);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_io_string_instruction_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::emulate_io_instruction);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_default_io_instruction_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_monitor_trap_handler);
@@ -205,12 +220,25 @@ setup_vcpu(MockRepository &mocks, ::intel_x64::vmcs::value_type reason = 0)
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_wrmsr_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::emulate_wrmsr);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_default_wrmsr_handler);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_msr_policy);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_xsetbv_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_preemption_timer_handler);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::remove_preemption_timer_handler);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_preemption_timer);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::get_preemption_timer).Return(0);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::enable_preemption_timer);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::disable_preemption_timer);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_pause_handler);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::remove_pause_handler);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::enable_pause_loop_exiting);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::disable_pause_loop_exiting);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_pause_loop_window);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::pause_loop_stats).Return(g_pause_stats);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_hypercall_handler);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::enable_hypercall_ring_polling);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::hypercall_ring_stats).Return(g_hypercall_ring_stats);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::flush_vmcs_writes);
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::vmcs_write_stats).Return(g_vmcs_write_stats);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_eptp);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::disable_ept);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::enable_vpid);
@@ -223,6 +251,12 @@ setup_vcpu(MockRepository &mocks, ::intel_x64::vmcs::value_type reason = 0)
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::io_bitmap_a).Return(g_io_bitmap_a);
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::io_bitmap_b).Return(g_io_bitmap_b);
 
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::gpr).Do([&](uint64_t index) {
+        return reinterpret_cast<uint64_t *>(&g_state)[index & 0xF];
+    });
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_gpr).Do([&](uint64_t index, uint64_t val) {
+        reinterpret_cast<uint64_t *>(&g_state)[index & 0xF] = val;
+    });
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::rax).Do([&] { return g_state.rax; });
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::set_rax).Do([&](uint64_t val) { g_state.rax = val; });
     mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::rbx).Do([&] { return g_state.rbx; });
@@ -33,6 +33,7 @@ std::map<uint32_t, uint32_t> g_edx_cpuid;
 std::map<x64::portio::port_addr_type, x64::portio::port_32bit_type> g_ports;
 
 x64::rflags::value_type g_rflags = 0;
+uint64_t g_tsc = 0;
 
 uint16_t g_es;
 uint16_t g_cs;
@@ -158,6 +159,54 @@ extern "C" void
 _outd(uint16_t port, uint32_t val) noexcept
 { g_ports[port] = val; }
 
+extern "C" void
+_insbrep(uint16_t port, uint64_t m8, uint32_t count) noexcept
+{
+    for (auto i = 0U; i < count; i++) {
+        reinterpret_cast<uint8_t *>(m8)[i] = _inb(port);
+    }
+}
+
+extern "C" void
+_inswrep(uint16_t port, uint64_t m16, uint32_t count) noexcept
+{
+    for (auto i = 0U; i < count; i++) {
+        reinterpret_cast<uint16_t *>(m16)[i] = _inw(port);
+    }
+}
+
+extern "C" void
+_insdrep(uint16_t port, uint64_t m32, uint32_t count) noexcept
+{
+    for (auto i = 0U; i < count; i++) {
+        reinterpret_cast<uint32_t *>(m32)[i] = _ind(port);
+    }
+}
+
+extern "C" void
+_outsbrep(uint16_t port, uint64_t m8, uint32_t count) noexcept
+{
+    for (auto i = 0U; i < count; i++) {
+        _outb(port, reinterpret_cast<uint8_t *>(m8)[i]);
+    }
+}
+
+extern "C" void
+_outswrep(uint16_t port, uint64_t m16, uint32_t count) noexcept
+{
+    for (auto i = 0U; i < count; i++) {
+        _outw(port, reinterpret_cast<uint16_t *>(m16)[i]);
+    }
+}
+
+extern "C" void
+_outsdrep(uint16_t port, uint64_t m32, uint32_t count) noexcept
+{
+    for (auto i = 0U; i < count; i++) {
+        _outd(port, reinterpret_cast<uint32_t *>(m32)[i]);
+    }
+}
+
 extern "C" void
 _stop() noexcept
 { }
@@ -215,6 +264,10 @@ extern "C" uint32_t
 _cpuid_subedx(uint32_t val, uint32_t sub) noexcept
 { bfignored(sub); return g_edx_cpuid[val]; }
 
+extern "C" uint32_t
+_cpuid_ebx(uint32_t val) noexcept
+{ return g_ebx_cpuid[val]; }
+
 extern "C" uint32_t
 _cpuid_ecx(uint32_t val) noexcept
 { return g_ecx_cpuid[val]; }
@@ -223,10 +276,19 @@ extern "C" uint32_t
 _cpuid_edx(uint32_t val) noexcept
 { return g_edx_cpuid[val]; }
 
+extern "C" uint64_t
+_read_tsc(void) noexcept
+{ return g_tsc; }
+
+extern "C" uint64_t
+_read_tscp(void) noexcept
+{ return g_tsc; }
+
 void
 setup_registers_x64()
 {
     g_rflags = 0x0;
+    g_tsc = 0;
 }
 
 #endif
@@ -239,6 +301,7 @@ intel_x64::cr3::value_type g_cr3 = 0;
 intel_x64::cr4::value_type g_cr4 = 0;
 intel_x64::cr8::value_type g_cr8 = 0;
 intel_x64::dr7::value_type g_dr7 = 0;
+intel_x64::xcr0::value_type g_xcr0 = 0;
 
 bool g_vmload_fails = false;
 bool g_vmlaunch_fails = false;
@@ -294,9 +357,13 @@ extern "C" void
 _write_cr8(uint64_t val) noexcept
 { g_cr8 = val; }
 
+extern "C" uint64_t
+_read_xcr0() noexcept
+{ return g_xcr0; }
+
 extern "C" void
 _write_xcr0(uint64_t val) noexcept
-{ bfignored(val); }
+{ g_xcr0 = val; }
 
 extern "C" uint64_t
 _read_dr7() noexcept
@@ -349,6 +416,7 @@ setup_registers_intel_x64()
     g_cr4 = 0;
     g_cr8 = 0;
     g_dr7 = 0;
+    g_xcr0 = 0;
 }
 
 void
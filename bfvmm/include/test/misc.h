@@ -31,9 +31,11 @@ extern "C" uint64_t
 unsafe_write_cstr(const char *cstr, size_t len)
 { bfignored(cstr); bfignored(len); return 0; }
 
+uint64_t g_thread_context_cpuid = 0;
+
 extern "C" uint64_t
 thread_context_cpuid(void)
-{ return 0; }
+{ return g_thread_context_cpuid; }
 
 extern "C" uint64_t *
 thread_context_tlsptr(void)
@@ -0,0 +1,108 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+/// @cond
+
+#include <cstdlib>
+#include <vector>
+
+#include <bfmemory.h>
+#include "../memory_manager/memory_manager.h"
+
+extern uint64_t g_thread_context_cpuid;
+
+// NUMA Topology Simulator
+//
+// Simulates a NUMA system with num_nodes nodes, each with cpus_per_node
+// physical CPUs. Each node is given a pool of 2^k pages, which is tagged and
+// added to the memory manager the same way the driver adds node-local
+// memory, so that the node pools can be tested without NUMA hardware.
+//
+class numa_topology_simulator
+{
+public:
+
+    numa_topology_simulator(
+        uint64_t num_nodes, uint64_t cpus_per_node, uint64_t k = 4
+    ) :
+        m_size{BAREFLANK_PAGE_SIZE << k}
+    {
+        for (uint64_t node = 0; node < num_nodes; node++) {
+            auto pool = reinterpret_cast<uintptr_t>(aligned_alloc(BAREFLANK_PAGE_SIZE, m_size));
+
+            for (uint64_t i = 0; i < m_size; i += BAREFLANK_PAGE_SIZE) {
+                g_mm->add_md(pool + i, pool + i, MEMORY_TYPE_R | MEMORY_TYPE_W | MEMORY_TYPE_NODE(node));
+            }
+
+            g_mm->add_node_pool(pool, m_size);
+            m_pools.push_back(pool);
+        }
+
+        for (uint64_t cpuid = 0; cpuid < num_nodes * cpus_per_node; cpuid++) {
+            g_mm->set_cpu_node(cpuid, cpuid / cpus_per_node);
+        }
+
+        m_num_cpus = num_nodes * cpus_per_node;
+    }
+
+    ~numa_topology_simulator()
+    {
+        for (uint64_t node = 0; node < m_pools.size(); node++) {
+            auto pool = m_pools.at(node);
+            g_mm->remove_node_pool(node);
+
+            for (uint64_t i = 0; i < m_size; i += BAREFLANK_PAGE_SIZE) {
+                g_mm->remove_md(pool + i, pool + i);
+            }
+
+            free(reinterpret_cast<void *>(pool));
+        }
+
+        for (uint64_t cpuid = 0; cpuid < m_num_cpus; cpuid++) {
+            g_mm->set_cpu_node(cpuid, 0);
+        }
+
+        g_thread_context_cpuid = 0;
+    }
+
+    void run_on(uint64_t cpuid)
+    { g_thread_context_cpuid = cpuid; }
+
+    uint64_t pool_size() const
+    { return m_size; }
+
+private:
+
+    uint64_t m_size;
+    uint64_t m_num_cpus{};
+    std::vector<uintptr_t> m_pools;
+
+public:
+
+    numa_topology_simulator(numa_topology_simulator &&) noexcept = delete;
+    numa_topology_simulator &operator=(numa_topology_simulator &&) noexcept = delete;
+
+    numa_topology_simulator(const numa_topology_simulator &) = delete;
+    numa_topology_simulator &operator=(const numa_topology_simulator &) = delete;
+};
+
+/// @endcond
@@ -35,6 +35,7 @@
 #include "hve.h"
 #include "memory_manager.h"
 #include "misc.h"
+#include "numa.h"
 
 struct quiet {
     quiet()
@@ -147,6 +147,43 @@ public:
     VIRTUAL bool is_guest_vcpu()
     { return vcpuid::is_guest_vcpu(m_id); }
 
+    /// Reset
+    ///
+    /// Resets the vCPU so that it can be reused with a new id instead of
+    /// being destroyed and created again (see vcpu_factory::acquire). The
+    /// base vCPU resets its id and user data. Architectural vCPUs extend
+    /// this to restore the state set up by their constructors, and so
+    /// should any subclass that keeps per-guest state of its own.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param id the new id of the vcpu
+    ///
+    virtual void reset(vcpuid::type id)
+    {
+        if ((id & vcpuid::reserved) != 0) {
+            throw std::invalid_argument("invalid vcpuid");
+        }
+
+        m_id = id;
+        m_data.reset();
+    }
+
+    /// Retire
+    ///
+    /// Called by vcpu_factory::release() when a guest vCPU is destroyed,
+    /// before it is pooled or deleted. The base vCPU does nothing.
+    /// Architectural vCPUs extend this to flush any state the CPU caches
+    /// for the vCPU, which is why this has to be called on the pCPU that
+    /// last ran the vCPU.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    virtual void retire()
+    { }
+
     /// Generate vCPU ID
     ///
     /// @expects
@@ -22,7 +22,10 @@
 #ifndef VCPU_FACTORY_H
 #define VCPU_FACTORY_H
 
+#include <mutex>
 #include <memory>
+#include <vector>
+
 #include "vcpu.h"
 
 // -----------------------------------------------------------------------------
@@ -40,6 +43,14 @@ namespace bfvmm
 /// of Bareflank above and beyond what is already provided. This seem also
 /// provides a means to unit test the vcpu_manager.
 ///
+/// The factory can also keep a pool of guest vCPUs (see set_pool_size()).
+/// When the pool is enabled, the vcpu_manager gets its vCPUs from acquire()
+/// and hands them back to release() when they are destroyed, and a guest
+/// vCPU that is created while the pool has a vCPU in it is recycled using
+/// vcpu::reset() instead of being made from scratch, which saves the
+/// allocation of its stacks, pages and handlers. The pool can be filled
+/// ahead of time using prewarm(). Host vCPUs are never pooled.
+///
 class vcpu_factory
 {
 public:
@@ -70,12 +81,221 @@ public:
     virtual std::unique_ptr<vcpu> make(
         vcpuid::type vcpuid, void *data);
 
+    /// Acquire vCPU
+    ///
+    /// Returns a vCPU from the pool, reset to the provided vcpuid, if the
+    /// vCPU is a guest vCPU and the pool is not empty. Otherwise, a new vCPU
+    /// is made using make(). Note that data is only given to make(), so a
+    /// factory that uses data to set up its vCPUs should do the same to a
+    /// recycled vCPU in its vCPU's reset().
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param vcpuid the vcpuid for the vcpu to acquire
+    /// @param data a pointer to user defined data
+    /// @return returns a pointer to a ready to use vCPU.
+    ///
+    std::unique_ptr<vcpu> acquire(vcpuid::type vcpuid, void *data)
+    {
+        if (vcpuid::is_guest_vcpu(vcpuid)) {
+            if (auto vcpu = this->pop()) {
+                try {
+                    vcpu->reset(vcpuid);
+
+                    this->count(&pool_stats_t::hits);
+                    return vcpu;
+                }
+                catch (...) {
+                    this->count(&pool_stats_t::dropped);
+                }
+            }
+
+            this->count(&pool_stats_t::misses);
+        }
+
+        return this->make(vcpuid, data);
+    }
+
+    /// Release vCPU
+    ///
+    /// Returns a guest vCPU to the pool so that it can be recycled by
+    /// acquire(). If the vCPU is a host vCPU, or the pool is disabled or
+    /// full, the vCPU is destroyed instead, the same way it would be
+    /// without a pool. Only vCPUs that go into the pool are retired first
+    /// (see vcpu::retire()), and a vCPU that fails to retire is destroyed.
+    ///
+    /// @expects called on the pCPU that last ran the vCPU
+    /// @ensures none
+    ///
+    /// @param vcpu the vCPU to release
+    ///
+    void release(std::unique_ptr<vcpu> vcpu)
+    {
+        if (!vcpu || vcpu->is_host_vcpu() || this->full()) {
+            return;
+        }
+
+        try {
+            vcpu->retire();
+        }
+        catch (...) {
+            this->count(&pool_stats_t::dropped);
+            return;
+        }
+
+        // Note that the pool can fill up while the vCPU is retired, in
+        // which case the vCPU is destroyed after all.
+
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+        if (m_pool.size() < m_pool_capacity) {
+            m_pool.push_back(std::move(vcpu));
+        }
+    }
+
+    /// Prewarm
+    ///
+    /// Makes count vCPUs ahead of time and adds them to the pool, so that
+    /// the first count guest vCPUs that are created do not have to be
+    /// made. The pool is never filled past its size.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param count the number of vCPUs to make
+    /// @param data a pointer to user defined data given to make()
+    ///
+    void prewarm(std::size_t count, void *data = nullptr)
+    {
+        for (std::size_t i = 0; i < count; i++) {
+            if (this->pooled() >= this->pool_size()) {
+                return;
+            }
+
+            this->release(this->make(vcpu::generate_vcpuid(), data));
+        }
+    }
+
+    /// Set Pool Size
+    ///
+    /// Sets the maximum number of vCPUs the pool will hold. A size of 0
+    /// (the default) disables the pool. If the pool already holds more
+    /// vCPUs than the new size, the extra vCPUs are destroyed.
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @param size the maximum number of vCPUs in the pool
+    ///
+    void set_pool_size(std::size_t size)
+    {
+        std::vector<std::unique_ptr<vcpu>> extra;
+
+        {
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            m_pool_capacity = size;
+            while (m_pool.size() > m_pool_capacity) {
+                extra.push_back(std::move(m_pool.back()));
+                m_pool.pop_back();
+            }
+        }
+    }
+
+    /// Pool Size
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns the maximum number of vCPUs in the pool
+    ///
+    std::size_t pool_size() const
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+        return m_pool_capacity;
+    }
+
+    /// Pooled
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns the number of vCPUs currently in the pool
+    ///
+    std::size_t pooled() const
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+        return m_pool.size();
+    }
+
+    /// Pool Statistics
+    ///
+    /// hits counts the guest vCPUs that acquire() recycled from the pool,
+    /// misses counts the ones that had to be made, and dropped counts the
+    /// vCPUs that failed to retire or reset and were destroyed instead.
+    ///
+    struct pool_stats_t {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t dropped;
+    };
+
+    /// Pool Statistics
+    ///
+    /// @expects none
+    /// @ensures none
+    ///
+    /// @return returns the pool's statistics
+    ///
+    pool_stats_t pool_stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+        return m_pool_stats;
+    }
+
+private:
+
+    void count(uint64_t pool_stats_t::*stat)
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+        m_pool_stats.*stat += 1;
+    }
+
+    bool full() const
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+        return m_pool.size() >= m_pool_capacity;
+    }
+
+    std::unique_ptr<vcpu> pop()
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+        if (m_pool.empty()) {
+            return nullptr;
+        }
+
+        auto vcpu = std::move(m_pool.back());
+        m_pool.pop_back();
+
+        return vcpu;
+    }
+
+private:
+
+    std::size_t m_pool_capacity{};
+    std::vector<std::unique_ptr<vcpu>> m_pool;
+
+    pool_stats_t m_pool_stats{};
+    mutable std::mutex m_pool_mutex;
+
 public:
 
     /// @cond
 
-    vcpu_factory(vcpu_factory &&) noexcept = default;
-    vcpu_factory &operator=(vcpu_factory &&) noexcept = default;
+    vcpu_factory(vcpu_factory &&) noexcept = delete;
+    vcpu_factory &operator=(vcpu_factory &&) noexcept = delete;
 
     vcpu_factory(const vcpu_factory &) = delete;
     vcpu_factory &operator=(const vcpu_factory &) = delete;
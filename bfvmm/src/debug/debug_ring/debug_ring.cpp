@@ -29,7 +29,10 @@
 // -----------------------------------------------------------------------------
 
 #include <mutex>
-std::mutex g_debug_mutex;
+#include <shared_mutex>
+#include <bfrwlock.h>
+
+bfn::rwlock g_debug_mutex;
 
 // -----------------------------------------------------------------------------
 // Global
@@ -49,8 +52,10 @@ get_drr(uint64_t vcpuid, struct debug_ring_resources_t **drr) noexcept
         return GET_DRR_FAILURE;
     }
 
-    if (auto found_drr = drr_map()[vcpuid]) {
-        *drr = found_drr;
+    std::shared_lock<bfn::rwlock> guard(g_debug_mutex);
+
+    if (auto iter = drr_map().find(vcpuid); iter != drr_map().end()) {
+        *drr = iter->second;
         return GET_DRR_SUCCESS;
     }
 
@@ -74,13 +79,13 @@ debug_ring::debug_ring(vcpuid::type vcpuid) noexcept
     m_drr->tag1 = 0xDB60DB60DB60DB60;
     m_drr->tag2 = 0x06BD06BD06BD06BD;
 
-    std::lock_guard<std::mutex> guard(g_debug_mutex);
+    std::lock_guard<bfn::rwlock> guard(g_debug_mutex);
     drr_map()[vcpuid] = m_drr.get();
 }
 
 debug_ring::~debug_ring() noexcept
 {
-    std::lock_guard<std::mutex> guard(g_debug_mutex);
+    std::lock_guard<bfn::rwlock> guard(g_debug_mutex);
     drr_map().erase(m_vcpuid);
 }
 
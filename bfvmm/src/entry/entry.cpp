@@ -78,6 +78,22 @@ private_add_md(struct memory_descriptor *md) noexcept
     });
 }
 
+extern "C" int64_t
+private_add_node_pool(uintptr_t virt, uint64_t size) noexcept
+{
+    return guard_exceptions(MEMORY_MANAGER_FAILURE, [&] {
+        g_mm->add_node_pool(virt, size);
+    });
+}
+
+extern "C" int64_t
+private_set_cpu_node(uint64_t cpuid, uint64_t node) noexcept
+{
+    return guard_exceptions(MEMORY_MANAGER_FAILURE, [&] {
+        g_mm->set_cpu_node(cpuid, node);
+    });
+}
+
 extern "C" int64_t
 private_set_rsdp(uintptr_t rsdp) noexcept
 {
@@ -144,6 +160,12 @@ bfmain(uintptr_t request, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3)
         case BF_REQUEST_SET_RSDP:
             return private_set_rsdp(arg1);
 
+        case BF_REQUEST_ADD_NODE_POOL:
+            return private_add_node_pool(arg1, arg2);
+
+        case BF_REQUEST_SET_CPU_NODE:
+            return private_set_cpu_node(arg1, arg2);
+
         case BF_REQUEST_GET_DRR:
             return get_drr(arg1, reinterpret_cast<debug_ring_resources_t **>(arg2));
 
@@ -52,6 +52,16 @@ ept_handler::ept_handler(
     }
 }
 
+void ept_handler::reset()
+{
+    if (vmcs_n::ept_pointer::phys_addr::get(m_eptp) != 0) {
+        m_vcpu->global_state()->ia32_vmx_cr0_fixed0 |= ::intel_x64::cr0::paging::mask;
+        m_vcpu->global_state()->ia32_vmx_cr0_fixed0 |= ::intel_x64::cr0::protection_enable::mask;
+    }
+
+    m_eptp = 0;
+}
+
 void ept_handler::invept()
 {
     m_invept(m_eptp);
@@ -23,6 +23,9 @@ bits 64
 default rel
 
 extern default_esr
+extern lazy_xsave_switch
+
+%define CR0_TS 0x8
 
 section .text
 
@@ -215,3 +218,24 @@ ESR_NOERRCODE 28
 ESR_NOERRCODE 29
 ESR_NOERRCODE 30
 ESR_NOERRCODE 31
+
+; Device Not Available (#NM)
+;
+; The host CR0 has TS set on every VM exit so that the guest's XSAVE state
+; is only switched if the VMM actually uses it (see exit_handler_entry.asm).
+; This handler performs the switch and then returns to the faulting
+; instruction. Note that this handler cannot use PUSHALL (which would fault
+; again), and that it does not use the IST so that a #NM that occurs while
+; another exception handler is running on the IST does not overwrite its
+; stack. If TS is clear, this is a real #NM, which is fatal.
+
+global _esr7_lazy_xsave
+_esr7_lazy_xsave:
+    push rax
+    mov rax, cr0
+    test rax, CR0_TS
+    pop rax
+    jz _esr7
+
+    call lazy_xsave_switch wrt ..plt
+    iretq
@@ -179,4 +179,7 @@ void set_default_esrs(
     idt->set(29, _esr29, selector);
     idt->set(30, _esr30, selector);
     idt->set(31, _esr31, selector);
+
+    idt->set(7, _esr7_lazy_xsave, selector);
+    idt->set_ist(7, 0);
 }
@@ -27,6 +27,13 @@
 //     impractical.
 //
 
+// TIDY_EXCLUSION=-cppcoreguidelines-pro-bounds-constant-array-index
+//
+// Reason:
+//     The result handlers are dispatched from a noexcept function, which
+//     cannot use gsl::at(). The index is range checked before it is used.
+//
+
 #include <hve/arch/intel_x64/vcpu.h>
 #include <hve/arch/intel_x64/exit_handler.h>
 
@@ -51,34 +58,118 @@ exit_handler::add_handler(
     const handler_delegate_t &d)
 { m_exit_handlers_array.at(reason).push_front(d); }
 
+void
+exit_handler::remove_handler(
+    ::intel_x64::vmcs::value_type reason,
+    const handler_delegate_t &d)
+{ m_exit_handlers_array.at(reason).remove(d); }
+
+void
+exit_handler::add_result_handler(
+    ::intel_x64::vmcs::value_type reason,
+    const result_delegate_t &d)
+{ m_result_handlers_array.at(reason).push_front(d); }
+
 void
 exit_handler::add_exit_handler(
     const handler_delegate_t &d)
 { m_exit_handlers.push_front(d); }
 
+void
+exit_handler::set_fast_handler(
+    ::intel_x64::vmcs::value_type reason,
+    fast_handler_t func)
+{ m_fast_handlers.at(reason) = func; }
+
+exit_result_t
+exit_handler::handle_results(vcpu *vcpu) const noexcept
+{
+    // The exit reason is read with the intrinsic directly, as vm::read()
+    // reports a failure by throwing.
+
+    uint64_t reason{};
+    if (!_vmread(vmcs_n::exit_reason::addr, &reason)) {
+        return bfn::unexpected(VMEXIT_ERROR_INVALID_STATE);
+    }
+
+    reason &= vmcs_n::exit_reason::basic_exit_reason::mask;
+    if (GSL_UNLIKELY(reason >= m_result_handlers_array.size())) {
+        return bfn::unexpected(VMEXIT_ERROR_INVALID_STATE);
+    }
+
+    // Note that gsl::at() and std::array::at() are not used here as both
+    // are allowed to throw. The range of reason is checked above.
+
+    const auto &handlers = m_result_handlers_array[reason];
+
+    for (const auto &d : handlers) {
+        if (auto ret = d(vcpu); !ret || ret.value()) {
+            return ret;
+        }
+    }
+
+    return false;
+}
+
 }
 
 extern "C"  void
 handle_exit(
     vcpu_t *vcpu, exit_handler_t *exit_handler)
 {
-    guard_exceptions([&]() {
+    // Exit delegates and the handlers registered with add_handler() are
+    // allowed to throw, so they are executed by guard_exceptions(). Result
+    // handlers are not, and run in between, which means that when a result
+    // handler services the VM exit, nothing is ever unwound.
 
-        for (const auto &d : exit_handler->m_exit_handlers) {
-            d(vcpu);
-        }
+    status_t ret = VMEXIT_SUCCESS;
 
-        const auto &handlers =
-            exit_handler->m_exit_handlers_array.at(
-                vmcs_n::exit_reason::basic_exit_reason::get()
-            );
+    if (!exit_handler->m_exit_handlers.empty()) {
+        ret = guard_exceptions(VMEXIT_ERROR_INVALID_STATE, [&]() {
+            for (const auto &d : exit_handler->m_exit_handlers) {
+                d(vcpu);
+            }
+        });
+    }
 
-        for (const auto &d : handlers) {
-            if (d(vcpu)) {
+    if (ret == VMEXIT_SUCCESS) {
+        if (auto result = exit_handler->handle_results(vcpu); !result) {
+            ret = result.error();
+        }
+        else if (result.value()) {
+            guard_exceptions([&]() {
                 vcpu->run();
-            }
+            });
+
+            ret = VMEXIT_ERROR_INVALID_STATE;
         }
-    });
+    }
+
+    if (ret == VMEXIT_SUCCESS) {
+        ret = guard_exceptions(VMEXIT_ERROR_UNHANDLED, [&]() {
 
-    vcpu->halt("unhandled vm exit");
+            const auto &handlers =
+                exit_handler->m_exit_handlers_array.at(
+                    vmcs_n::exit_reason::basic_exit_reason::get()
+                );
+
+            for (const auto &d : handlers) {
+                if (d(vcpu)) {
+                    vcpu->run();
+                }
+            }
+        });
+    }
+
+    if (ret == VMEXIT_SUCCESS) {
+        vcpu->halt("unhandled vm exit");
+        return;
+    }
+
+    vcpu->halt(std::string("vm exit failed: ") + ec_to_str(ret));
 }
+
+extern "C"  void
+handle_fast_exit_failure(
+    vcpu_t *vcpu)
+{ vcpu->halt("fast exit handler: vmresume failed"); }
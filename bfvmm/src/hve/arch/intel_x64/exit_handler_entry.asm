@@ -23,11 +23,15 @@ bits 64
 default rel
 
 %define IA32_XSS_MSR   0xDA0
+%define CR0_TS         0x8
 %define VMCS_GUEST_RSP 0x0000681C
 %define VMCS_GUEST_RIP 0x0000681E
+%define VMCS_EXIT_REASON 0x00004402
 
 extern handle_exit
+extern handle_fast_exit_failure
 global exit_handler_entry:function
+global lazy_xsave_switch:function
 
 section .text
 
@@ -43,79 +47,61 @@ section .text
 exit_handler_entry:
 
     mov [gs:0x000], rax
-    mov [gs:0x008], rbx
-    mov [gs:0x010], rcx
-    mov [gs:0x018], rdx
-    mov [gs:0x020], rbp
-    mov [gs:0x028], rsi
-    mov [gs:0x030], rdi
-    mov [gs:0x038], r8
-    mov [gs:0x040], r9
-    mov [gs:0x048], r10
-    mov [gs:0x050], r11
-    mov [gs:0x058], r12
-    mov [gs:0x060], r13
-    mov [gs:0x068], r14
-    mov [gs:0x070], r15
+    mov [gs:0x008], rcx
+    mov [gs:0x010], rdx
+    mov [gs:0x018], rbx
+    mov [gs:0x028], rbp
+    mov [gs:0x030], rsi
+    mov [gs:0x038], rdi
+    mov [gs:0x040], r8
+    mov [gs:0x048], r9
+    mov [gs:0x050], r10
+    mov [gs:0x058], r11
+    mov [gs:0x060], r12
+    mov [gs:0x068], r13
+    mov [gs:0x070], r14
+    mov [gs:0x078], r15
 
     mov rsi, VMCS_GUEST_RIP
-    vmread [gs:0x078], rsi
-    mov rsi, VMCS_GUEST_RSP
     vmread [gs:0x080], rsi
+    mov rsi, VMCS_GUEST_RSP
+    vmread [gs:0x020], rsi
 
-    ; To handle the XSAVE data, we do not know what the guest is currently
-    ; using. One approach would be to save all state and then restore all
-    ; of that state. The problem with that approach is if the guest is only
-    ; using a small amount of state, this would be wasteful. To prevent
-    ; that we use the second approach. In this approach you save what the
-    ; guest is using (i.e., save based on the guest's values for xcr0 and
-    ; xss), and then restore all state. Any bits that are not saved here
-    ; will be initialized to their defaults on restore during a resume.
-    ; This ensures that we reduce how much we save (if possible) while still
-    ; ensuring the state on resume does not include data from other guest VMs
+    ; The guest's XSAVE state is not switched here. Instead, the host CR0
+    ; has TS set, so the guest's state stays in the CPU until the VMM
+    ; executes its first FPU / SIMD instruction, which traps (#NM) to
+    ; lazy_xsave_switch below. Exits that never touch this state (e.g.,
+    ; most CPUID, MSR and I/O exits) skip the switch entirely, and
+    ; vmcs_resume skips the restore. All we have to do here is note that
+    ; the switch has not happened yet for this exit.
 
-    xor ecx, ecx
-    xgetbv
-    mov [gs:0x0A8], eax
+    mov qword [gs:0x110], 0x0
 
-    mov rcx, IA32_XSS_MSR
-    rdmsr
-    mov [gs:0x0B8], eax
+    ; Before doing anything else, check to see if a fast handler has been
+    ; registered for this exit reason. Fast handlers are executed before
+    ; the control and debug registers are switched, which means that if
+    ; the fast handler handles the exit, the guest can be resumed without
+    ; having to restore any of this state. If the fast handler does not
+    ; handle the exit (or one is not registered), the exit is handled by
+    ; the normal exit handler logic below.
 
-    mov rsi, [gs:0x0C8]
-    xor edx, edx
-    mov eax, 0xFFFFFFFF
-    xsaves64 [rsi]
-
-    ; Now that we have saved the guest state based on what the guest was
-    ; using, we need to set the xcr0 and xss to all bits (based on what the
-    ; cpuid instruction reports). Once that is done, we will restore the
-    ; state using a black save area. This ensures that the hypervisor always
-    ; have initialized state when it executes. In addition, on resume, this
-    ; will ensure that the restore of the state uses all bits as well. Any
-    ; state that was not saved by the guest above will be initialized on
-    ; resume. Note that since the host state that we restore above never
-    ; gets saved (i.e., we never run xsave on it, we only use it for xrstor
-    ; to initialize state), we need to flip the bit in the header that tells
-    ; xrstor that it is compressed. This ensures we can use the xrstors
-    ; instruction which is needed to include xss.
+    mov rsi, VMCS_EXIT_REASON
+    vmread rax, rsi
+    and eax, 0xFFFF
+    cmp eax, 128
+    jae .slow_path
 
-    mov eax, [gs:0x0B0]
-    xor edx, edx
-    xor ecx, ecx
-    xsetbv
+    mov rsi, [gs:0x118]
+    mov rax, [rsi + rax * 8]
+    test rax, rax
+    jz .slow_path
 
-    mov eax, [gs:0x0C0]
-    xor edx, edx
-    mov ecx, IA32_XSS_MSR
-    wrmsr
+    mov rdi, [gs:0x098]
+    call rax
+    test al, al
+    jnz .fast_resume
 
-    mov rsi, [gs:0x0D0]
-    mov al, 0x80
-    mov [rsi + 0x20f], al
-    xor edx, edx
-    mov eax, 0xFFFFFFFF
-    xrstors64 [rsi]
+.slow_path:
 
     ; Finally, we need to initialize the remaining control and debug
     ; registers that are not handled by the VMCS. This ensures that the
@@ -162,3 +148,153 @@ exit_handler_entry:
 ; resume doesn't happen.
 
     hlt
+
+; Fast Resume
+;
+; The fast handler handled the exit, so we resume the guest directly. This
+; is the same as vmcs_resume with the exception that the control and debug
+; registers were never changed, and the vCPU being resumed is always the
+; vCPU that exited. The only thing left to check is whether the fast
+; handler used any XSAVE state (i.e., CR0.TS was cleared by the #NM
+; handler), in which case the guest's state has to be restored.
+;
+.fast_resume:
+
+    mov rax, cr0
+    test rax, CR0_TS
+    jnz .skip_xsave
+
+    mov rsi, [gs:0x0C8]
+    xor edx, edx
+    mov eax, 0xFFFFFFFF
+    xrstors64 [rsi]
+
+    mov eax, [gs:0x0B8]
+    xor edx, edx
+    mov ecx, IA32_XSS_MSR
+    wrmsr
+
+    mov eax, [gs:0x0A8]
+    xor edx, edx
+    xor ecx, ecx
+    xsetbv
+
+.skip_xsave:
+
+    mov rsi, VMCS_GUEST_RSP
+    vmwrite rsi, [gs:0x020]
+    mov rsi, VMCS_GUEST_RIP
+    vmwrite rsi, [gs:0x080]
+
+    mov r15, [gs:0x078]
+    mov r14, [gs:0x070]
+    mov r13, [gs:0x068]
+    mov r12, [gs:0x060]
+    mov r11, [gs:0x058]
+    mov r10, [gs:0x050]
+    mov r9,  [gs:0x048]
+    mov r8,  [gs:0x040]
+    mov rdi, [gs:0x038]
+    mov rsi, [gs:0x030]
+    mov rbp, [gs:0x028]
+    mov rbx, [gs:0x018]
+    mov rdx, [gs:0x010]
+    mov rcx, [gs:0x008]
+    mov rax, [gs:0x000]
+
+    vmresume
+
+; If the resume fails, there is no exception support to fall back on, so
+; we hand the vCPU to the C++ code which will dump its state and halt.
+
+    mov rdi, [gs:0x098]
+    call handle_fast_exit_failure wrt ..plt
+
+    hlt
+
+; Lazy XSAVE Switch
+;
+; Saves the guest's XSAVE state and loads an initialized host state. This
+; is called by the #NM handler the first time the VMM uses FPU / SIMD state
+; after an exit (i.e., while CR0.TS is set), or by the launch and resume
+; logic when switching to a different vCPU. This function preserves all
+; registers, clears CR0.TS and only performs the switch once per exit.
+;
+; To handle the XSAVE data, we do not know what the guest is currently
+; using. One approach would be to save all state and then restore all
+; of that state. The problem with that approach is if the guest is only
+; using a small amount of state, this would be wasteful. To prevent
+; that we use the second approach. In this approach you save what the
+; guest is using (i.e., save based on the guest's values for xcr0 and
+; xss), and then restore all state. Any bits that are not saved here
+; will be initialized to their defaults on restore during a resume.
+; This ensures that we reduce how much we save (if possible) while still
+; ensuring the state on resume does not include data from other guest VMs
+;
+; Note that the flag is set before TS is cleared. If an NMI arrives in
+; between, its handler traps (#NM) back into this function, which sees the
+; flag, clears TS and returns without switching. The NMI handler then
+; preserves the guest's xmm registers for us.
+;
+lazy_xsave_switch:
+
+    push rax
+    push rcx
+    push rdx
+    push rsi
+
+    lock bts qword [gs:0x110], 0
+    clts
+    jc .done
+
+    xor ecx, ecx
+    xgetbv
+    mov [gs:0x0A8], eax
+
+    mov rcx, IA32_XSS_MSR
+    rdmsr
+    mov [gs:0x0B8], eax
+
+    mov rsi, [gs:0x0C8]
+    xor edx, edx
+    mov eax, 0xFFFFFFFF
+    xsaves64 [rsi]
+
+    ; Now that we have saved the guest state based on what the guest was
+    ; using, we need to set the xcr0 and xss to all bits (based on what the
+    ; cpuid instruction reports). Once that is done, we will restore the
+    ; state using a black save area. This ensures that the hypervisor always
+    ; have initialized state when it executes. In addition, on resume, this
+    ; will ensure that the restore of the state uses all bits as well. Any
+    ; state that was not saved by the guest above will be initialized on
+    ; resume. Note that since the host state that we restore above never
+    ; gets saved (i.e., we never run xsave on it, we only use it for xrstor
+    ; to initialize state), we need to flip the bit in the header that tells
+    ; xrstor that it is compressed. This ensures we can use the xrstors
+    ; instruction which is needed to include xss.
+
+    mov eax, [gs:0x0B0]
+    xor edx, edx
+    xor ecx, ecx
+    xsetbv
+
+    mov eax, [gs:0x0C0]
+    xor edx, edx
+    mov ecx, IA32_XSS_MSR
+    wrmsr
+
+    mov rsi, [gs:0x0D0]
+    mov al, 0x80
+    mov [rsi + 0x20f], al
+    xor edx, edx
+    mov eax, 0xFFFFFFFF
+    xrstors64 [rsi]
+
+.done:
+
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rax
+
+    ret
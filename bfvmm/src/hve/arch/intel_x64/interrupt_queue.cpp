@@ -25,30 +25,51 @@
 namespace bfvmm::intel_x64
 {
 
-// For now, this is a simple first in, first out queue. In the future,
-// we should implement the priority portion of the interrupt queue that
-// the APIC is doing in hardware.
-//
-// It should be noted that the reason this works is that by the time
-// the VMM sees the interrupt, the APIC has already released an interrupt
-// with priority in mind, which means in theory, a simple queue is
-// sufficient. Incomplete, but sufficient.
+// The queue is modeled after the APIC's IRR. Each vector owns a single bit,
+// which means a vector that is pushed more than once is only delivered
+// once (just like the APIC), and the highest priority vector can be found
+// with a single bit scan per 64 vectors. Other cores only ever set bits,
+// and the owning core is the only one that clears them, so push() does not
+// need a lock.
+
+constexpr const auto irr_bits = 64ULL;
 
 void
 interrupt_queue::push(vector_t vector)
-{ m_vectors.push(vector); }
+{
+    expects(vector < m_irr.size() * irr_bits);
+
+    auto &word = m_irr.at(vector / irr_bits);
+    __atomic_fetch_or(&word, 1ULL << (vector % irr_bits), __ATOMIC_RELEASE);
+}
 
 interrupt_queue::vector_t
 interrupt_queue::pop()
 {
-    auto vector = m_vectors.front();
-    m_vectors.pop();
+    for (auto i = m_irr.size(); i > 0; i--) {
+        auto &word = m_irr.at(i - 1);
 
-    return vector;
+        if (auto bits = __atomic_load_n(&word, __ATOMIC_ACQUIRE); bits != 0) {
+            auto bit = (irr_bits - 1) - static_cast<uint64_t>(__builtin_clzll(bits));
+            __atomic_fetch_and(&word, ~(1ULL << bit), __ATOMIC_ACQ_REL);
+
+            return ((i - 1) * irr_bits) + bit;
+        }
+    }
+
+    throw std::runtime_error("interrupt_queue::pop: queue is empty");
 }
 
 bool
 interrupt_queue::empty() const
-{ return m_vectors.empty(); }
+{
+    for (const auto &word : m_irr) {
+        if (__atomic_load_n(&word, __ATOMIC_ACQUIRE) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
 
 }
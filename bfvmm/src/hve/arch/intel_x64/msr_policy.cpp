@@ -0,0 +1,228 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <hve/arch/intel_x64/vcpu.h>
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+// The emulation table is indexed the same way as the MSR bitmap (i.e., the
+// low MSRs followed by the high MSRs), which means that any MSR that can be
+// trapped has a slot in the table.
+
+constexpr const auto msr_index_size = 0x4000ULL;
+constexpr const auto msr_invalid_index = msr_index_size;
+
+static uint64_t
+msr_to_index(uint64_t msr) noexcept
+{
+    if (msr <= 0x00001FFFULL) {
+        return msr;
+    }
+
+    if (msr >= 0xC0000000ULL && msr <= 0xC0001FFFULL) {
+        return (msr - 0xC0000000ULL) + 0x2000ULL;
+    }
+
+    return msr_invalid_index;
+}
+
+namespace bfvmm::intel_x64
+{
+
+msr_policy::msr_policy(
+    gsl::not_null<vcpu *> vcpu
+) :
+    m_vcpu{vcpu}
+{
+    using namespace vmcs_n;
+
+    vcpu->add_exit_handler_for_reason(
+        exit_reason::basic_exit_reason::rdmsr,
+    {&msr_policy::handle_rdmsr, this}
+    );
+
+    vcpu->add_exit_handler_for_reason(
+        exit_reason::basic_exit_reason::wrmsr,
+    {&msr_policy::handle_wrmsr, this}
+    );
+}
+
+// -----------------------------------------------------------------------------
+// Compile
+// -----------------------------------------------------------------------------
+
+void
+msr_policy::compile(const std::vector<rule_t> &rules)
+{
+    expects(rules.size() < 256);
+
+    // The table is built before the MSR bitmap is touched so that an invalid
+    // rule does not leave the bitmap half updated.
+
+    std::vector<uint8_t> index(msr_index_size, 0);
+    std::vector<entry_t> entries(1);
+
+    for (const auto &rule : rules) {
+        auto i = msr_to_index(rule.msr);
+
+        if (i == msr_invalid_index) {
+            throw std::runtime_error("msr_policy: invalid msr: " + std::to_string(rule.msr));
+        }
+
+        switch (rule.type) {
+            case type_t::constant:
+            case type_t::shadow:
+            case type_t::masked:
+                index.at(i) = gsl::narrow_cast<uint8_t>(entries.size());
+                entries.push_back({rule.value, rule.mask, rule.type, rule.writeback});
+                break;
+
+            default:
+                index.at(i) = 0;
+                break;
+        }
+    }
+
+    for (const auto &rule : rules) {
+        switch (rule.type) {
+            case type_t::passthrough:
+                m_vcpu->pass_through_rdmsr_access(rule.msr);
+                m_vcpu->pass_through_wrmsr_access(rule.msr);
+                break;
+
+            case type_t::masked:
+                m_vcpu->pass_through_rdmsr_access(rule.msr);
+                m_vcpu->trap_on_wrmsr_access(rule.msr);
+                break;
+
+            default:
+                m_vcpu->trap_on_rdmsr_access(rule.msr);
+                m_vcpu->trap_on_wrmsr_access(rule.msr);
+                break;
+        }
+    }
+
+    m_index = std::move(index);
+    m_entries = std::move(entries);
+
+    if (&rules != &m_rules) {
+        m_rules = rules;
+    }
+}
+
+void
+msr_policy::reset()
+{ this->compile(m_rules); }
+
+uint64_t
+msr_policy::value(uint32_t msr) const
+{
+    auto i = msr_to_index(msr);
+
+    if (i != msr_invalid_index && !m_index.empty()) {
+        if (auto entry = m_index[i]; entry != 0) {
+            if (m_entries[entry].type != type_t::masked) {
+                return m_entries[entry].value;
+            }
+        }
+    }
+
+    throw std::runtime_error("msr_policy::value: msr not emulated: " + std::to_string(msr));
+}
+
+msr_policy::entry_t *
+msr_policy::lookup(uint64_t msr) noexcept
+{
+    auto i = msr_to_index(msr);
+
+    if (i == msr_invalid_index || m_index.empty()) {
+        return nullptr;
+    }
+
+    if (auto entry = m_index[i]; entry != 0) {
+        return &m_entries[entry];
+    }
+
+    return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+// Handlers
+// -----------------------------------------------------------------------------
+
+bool
+msr_policy::handle_rdmsr(vcpu *vcpu)
+{
+    auto entry = this->lookup(vcpu->rcx());
+
+    // Reads of a masked MSR are passed through, so if one traps anyway, it
+    // was trapped by someone else, and the rdmsr handlers take care of it.
+
+    if (entry == nullptr || entry->type == type_t::masked) {
+        return false;
+    }
+
+    vcpu->set_rax(((entry->value >> 0x00) & 0x00000000FFFFFFFF));
+    vcpu->set_rdx(((entry->value >> 0x20) & 0x00000000FFFFFFFF));
+
+    return vcpu->advance();
+}
+
+bool
+msr_policy::handle_wrmsr(vcpu *vcpu)
+{
+    auto entry = this->lookup(vcpu->rcx());
+
+    if (entry == nullptr) {
+        return false;
+    }
+
+    auto msr = gsl::narrow_cast<::x64::msrs::field_type>(vcpu->rcx());
+    auto val =
+        ((vcpu->rax() & 0x00000000FFFFFFFF) << 0) |
+        ((vcpu->rdx() & 0x00000000FFFFFFFF) << 32);
+
+    vcpu->flush_vmcs_writes();
+
+    switch (entry->type) {
+        case type_t::shadow:
+            entry->value = set_bits(entry->value, entry->mask, val);
+
+            if (entry->writeback) {
+                ::emulate_wrmsr(msr, entry->value);
+            }
+
+            break;
+
+        case type_t::masked:
+            ::emulate_wrmsr(msr, set_bits(::emulate_rdmsr(msr), entry->mask, val));
+            break;
+
+        default:
+            break;
+    };
+
+    return vcpu->advance();
+}
+
+}
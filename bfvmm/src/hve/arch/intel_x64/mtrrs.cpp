@@ -19,6 +19,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
+
 #include <bfdebug.h>
 
 #include <intrinsics.h>
@@ -88,6 +90,26 @@ mtrrs::dump(int level, const char *str) const
     });
 }
 
+ept::mmap::memory_type
+mtrrs::type_of(uint64_t addr) const noexcept
+{
+    if (auto run = this->find_run(addr)) {
+        return run->type;
+    }
+
+    return ept::mmap::memory_type::uncacheable;
+}
+
+uint64_t
+mtrrs::largest_uniform_run(uint64_t addr) const noexcept
+{
+    if (auto run = this->find_run(addr)) {
+        return run->size - (addr - run->base);
+    }
+
+    return 0;
+}
+
 // Constructor
 //
 // The constructor first gets both the fixed and variable MTRRs and adds all of
@@ -113,6 +135,7 @@ mtrrs::mtrrs() noexcept
                 ept::mmap::memory_type::write_back, 0, 0xFFFFFFFFFFFFFFFF
             });
 
+            this->make_index();
             return;
         }
 
@@ -154,6 +177,7 @@ mtrrs::mtrrs() noexcept
         while (!this->make_continuous())
         { }
 
+        this->make_index();
         dump(1, "corrected mtrrs");
     },
     [&] {
@@ -163,6 +187,7 @@ mtrrs::mtrrs() noexcept
         }
 
         m_num = 0;
+        m_num_runs = 0;
     });
 }
 
@@ -329,6 +354,66 @@ mtrrs::make_continuous()
     return true;
 }
 
+// Make Index
+//
+// Once the ranges are continuous, they are sorted and do not overlap, so
+// the only thing left to do to index them is to merge neighbouring ranges
+// that have the same memory type (e.g. the two halves of the default range
+// that make_continuous() split around a variable range of the same type).
+// The result is a sorted list of runs where each run is as large as it can
+// be, which find_run() can binary search.
+//
+void
+mtrrs::make_index()
+{
+    m_num_runs = 0;
+
+    for (uint8_t i = 0U; i < m_num; i++) {
+        const auto &range = m_ranges.at(i);
+
+        if (m_num_runs != 0) {
+            auto &run = m_runs.at(m_num_runs - 1U);
+
+            if (run.type == range.type && run.base + run.size == range.base) {
+                run.size += range.size;
+                continue;
+            }
+        }
+
+        m_runs.at(m_num_runs++) = range;
+    }
+}
+
+// Find Run
+//
+// Returns the run that contains the provided address, or nullptr if the
+// address is not covered by any run. The runs are sorted and do not
+// overlap, so the only run that can contain the address is the last run
+// whose base is at or below the address.
+//
+const mtrrs::range_t *
+mtrrs::find_run(uint64_t addr) const noexcept
+{
+    auto begin = m_runs.begin();
+    auto end = m_runs.begin() + m_num_runs;
+
+    auto iter = std::upper_bound(begin, end, addr, [](uint64_t val, const range_t & range) {
+        return val < range.base;
+    });
+
+    if (iter == begin) {
+        return nullptr;
+    }
+
+    iter--;
+
+    if (addr - iter->base >= iter->size) {
+        return nullptr;
+    }
+
+    return &(*iter);
+}
+
 void
 mtrrs::add_range(const range_t &range)
 {
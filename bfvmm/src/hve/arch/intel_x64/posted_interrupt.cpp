@@ -0,0 +1,105 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bfdebug.h>
+#include <hve/arch/intel_x64/posted_interrupt.h>
+
+namespace bfvmm::intel_x64
+{
+
+// The control word of the descriptor contains the outstanding notification
+// bit (bit 256 of the descriptor), the notification vector (bits 279:272)
+// and the notification destination (bits 319:288). The VIRR is stored in
+// the virtual-APIC page as eight 32 bit registers, starting at offset 0x200
+// and aligned on 16 byte boundaries.
+
+constexpr const auto pir_bits = 64ULL;
+
+constexpr const auto on_bit = 1ULL << 0;
+constexpr const auto nv_mask = 0x0000000000FF0000ULL;
+constexpr const auto nv_from = 16ULL;
+constexpr const auto ndst_mask = 0xFFFFFFFF00000000ULL;
+constexpr const auto ndst_from = 32ULL;
+
+constexpr const auto virr_index = 0x200 / sizeof(uint32_t);
+constexpr const auto virr_stride = 0x10 / sizeof(uint32_t);
+
+bool
+posted_interrupt_descriptor::post(vector_t vector)
+{
+    expects(vector < m_pir.size() * pir_bits);
+
+    auto &word = m_pir.at(vector / pir_bits);
+    __atomic_fetch_or(&word, 1ULL << (vector % pir_bits), __ATOMIC_SEQ_CST);
+
+    return (__atomic_fetch_or(&m_control, on_bit, __ATOMIC_SEQ_CST) & on_bit) == 0;
+}
+
+bool
+posted_interrupt_descriptor::pending() const
+{ return (__atomic_load_n(&m_control, __ATOMIC_ACQUIRE) & on_bit) != 0; }
+
+posted_interrupt_descriptor::vector_t
+posted_interrupt_descriptor::sync(gsl::span<uint32_t> virtual_apic_page)
+{
+    expects(virtual_apic_page.size() >= 0x400);
+
+    vector_t highest = 0;
+    __atomic_fetch_and(&m_control, ~on_bit, __ATOMIC_SEQ_CST);
+
+    for (auto i = 0ULL; i < m_pir.size(); i++) {
+        auto bits = __atomic_exchange_n(&m_pir.at(i), 0, __ATOMIC_SEQ_CST);
+        if (bits == 0) {
+            continue;
+        }
+
+        auto lo = static_cast<std::ptrdiff_t>(virr_index + (virr_stride * (i * 2)));
+        auto hi = static_cast<std::ptrdiff_t>(virr_index + (virr_stride * ((i * 2) + 1)));
+
+        virtual_apic_page.at(lo) |= static_cast<uint32_t>(bits);
+        virtual_apic_page.at(hi) |= static_cast<uint32_t>(bits >> 32);
+
+        highest = (i * pir_bits) + (pir_bits - 1) - static_cast<uint64_t>(__builtin_clzll(bits));
+    }
+
+    return highest;
+}
+
+void
+posted_interrupt_descriptor::set_notification_vector(vector_t vector)
+{
+    expects(vector < m_pir.size() * pir_bits);
+    m_control = (m_control & ~nv_mask) | (vector << nv_from);
+}
+
+void
+posted_interrupt_descriptor::set_notification_destination(uint32_t apic_id)
+{ m_control = (m_control & ~ndst_mask) | (static_cast<uint64_t>(apic_id) << ndst_from); }
+
+posted_interrupt_descriptor::vector_t
+posted_interrupt_descriptor::notification_vector() const
+{ return (m_control & nv_mask) >> nv_from; }
+
+uint32_t
+posted_interrupt_descriptor::notification_destination() const
+{ return static_cast<uint32_t>((m_control & ndst_mask) >> ndst_from); }
+
+}
@@ -0,0 +1,322 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+
+#include <hve/arch/intel_x64/vcpu.h>
+#include <hve/arch/intel_x64/scheduler.h>
+
+namespace bfvmm::intel_x64
+{
+
+// -----------------------------------------------------------------------------
+// Run Queue
+// -----------------------------------------------------------------------------
+
+run_queue::run_queue(tick_t slice) :
+    m_slice{slice}
+{ expects(slice != 0); }
+
+void
+run_queue::add(gsl::not_null<vcpu *> vcpu, tick_t slice)
+{
+    for (const auto &entry : m_queue) {
+        if (entry.ptr == vcpu) {
+            throw std::runtime_error("run_queue::add: vcpu already added");
+        }
+    }
+
+    m_queue.push_back({vcpu, slice != 0 ? slice : m_slice});
+}
+
+void
+run_queue::remove(gsl::not_null<vcpu *> vcpu)
+{
+    if (this->current() == vcpu) {
+        m_running = false;
+    }
+
+    m_queue.remove_if([&](const auto &entry) {
+        return entry.ptr == vcpu;
+    });
+}
+
+vcpu *
+run_queue::next(tick_t now)
+{
+    if (m_queue.empty()) {
+        return nullptr;
+    }
+
+    // The current vCPU is always at the front of the run queue, so moving
+    // it to the end is a single splice, which does not allocate.
+
+    if (m_running) {
+        m_queue.splice(m_queue.end(), m_queue, m_queue.begin());
+    }
+
+    m_start = now;
+    m_running = true;
+
+    return m_queue.front().ptr;
+}
+
+bool
+run_queue::boost(gsl::not_null<vcpu *> vcpu)
+{
+    auto iter = std::find_if(m_queue.begin(), m_queue.end(), [&](const auto &entry) {
+        return entry.ptr == vcpu;
+    });
+
+    if (iter == m_queue.end() || (m_running && iter == m_queue.begin())) {
+        return false;
+    }
+
+    auto pos = m_running ? std::next(m_queue.begin()) : m_queue.begin();
+    m_queue.splice(pos, m_queue, iter);
+
+    return true;
+}
+
+run_queue::tick_t
+run_queue::remaining(tick_t now) const
+{
+    if (!m_running || m_queue.size() < 2) {
+        return 0;
+    }
+
+    auto slice = m_queue.front().slice;
+    auto elapsed = now - m_start;
+
+    return elapsed < slice ? slice - elapsed : 1;
+}
+
+vcpu *
+run_queue::current() const noexcept
+{ return m_running ? m_queue.front().ptr : nullptr; }
+
+// -----------------------------------------------------------------------------
+// Scheduler
+// -----------------------------------------------------------------------------
+
+scheduler::scheduler(uint64_t slice_usec) :
+    m_tsc_khz{tsc_frequency_khz()},
+    m_timer_shift{::intel_x64::msrs::ia32_vmx_misc::preemption_timer_decrement::get()},
+    m_run_queue{usec_to_ticks(slice_usec, m_tsc_khz)}
+{ }
+
+void
+scheduler::add(gsl::not_null<vcpu *> vcpu, uint64_t slice_usec)
+{
+    using namespace vmcs_n::exit_reason;
+
+    m_run_queue.add(vcpu, usec_to_ticks(slice_usec, m_tsc_khz));
+
+    vcpu->add_preemption_timer_handler({&scheduler::handle_preemption, this});
+    vcpu->add_exit_handler_for_reason(basic_exit_reason::hlt, {&scheduler::handle_yield, this});
+    vcpu->add_pause_handler({&scheduler::handle_pause, this});
+
+    // If the current vCPU was running on its own, its preemption timer and
+    // HLT exiting are disabled, and need to be enabled now that it has to
+    // share the core.
+
+    if (auto current = m_run_queue.current(); current != nullptr && m_run_queue.size() == 2) {
+        this->update_hlt_exiting();
+        this->arm(current, ::x64::tsc::get());
+    }
+}
+
+void
+scheduler::remove(gsl::not_null<vcpu *> vcpu)
+{
+    using namespace vmcs_n::exit_reason;
+
+    expects(m_run_queue.current() != vcpu);
+    m_run_queue.remove(vcpu);
+
+    vcpu->remove_preemption_timer_handler({&scheduler::handle_preemption, this});
+    vcpu->remove_exit_handler_for_reason(basic_exit_reason::hlt, {&scheduler::handle_yield, this});
+    vcpu->remove_pause_handler({&scheduler::handle_pause, this});
+}
+
+void
+scheduler::run()
+{
+    auto now = ::x64::tsc::get();
+    auto next = m_run_queue.next(now);
+
+    expects(next != nullptr);
+    this->switch_to(nullptr, next, now);
+}
+
+bool
+scheduler::yield_to(gsl::not_null<vcpu *> current, gsl::not_null<vcpu *> target)
+{
+    expects(m_run_queue.current() == current);
+
+    if (!m_run_queue.boost(target)) {
+        return false;
+    }
+
+    return this->handle_pause(current);
+}
+
+uint64_t
+scheduler::tsc_frequency_khz()
+{
+    using namespace ::intel_x64::cpuid;
+    auto max_leaf = ::x64::cpuid::eax::get(0);
+
+    // The TSC runs at the core crystal clock frequency multiplied by the
+    // ratio reported by leaf 0x15. If the crystal clock is not reported,
+    // the base frequency from leaf 0x16 is used instead, which is the
+    // frequency of the TSC on any processor with an invariant TSC.
+
+    if (max_leaf >= time_stamp_count::addr) {
+        uint64_t den = time_stamp_count::eax::get();
+        uint64_t num = time_stamp_count::ebx::get();
+        uint64_t hz = time_stamp_count::ecx::get();
+
+        if (den != 0 && num != 0 && hz != 0) {
+            return ((hz * num) / den) / 1000;
+        }
+    }
+
+    if (max_leaf >= processor_freq::addr) {
+        if (uint64_t mhz = processor_freq::eax::get(); mhz != 0) {
+            return mhz * 1000;
+        }
+    }
+
+    throw std::runtime_error("scheduler: unable to determine the TSC frequency");
+}
+
+// -----------------------------------------------------------------------------
+// Handlers
+// -----------------------------------------------------------------------------
+
+bool
+scheduler::handle_preemption(vcpu *vcpu)
+{
+    auto now = ::x64::tsc::get();
+
+    this->switch_to(vcpu, m_run_queue.next(now), now);
+    return true;
+}
+
+bool
+scheduler::handle_yield(vcpu *vcpu)
+{
+    // If the vCPU has the core to itself, there is no one to yield to. The
+    // HLT is not advanced over, so once HLT exiting is disabled, the guest
+    // executes it again and stays in the HLT activity state until its next
+    // interrupt, instead of spinning on HLT exits.
+
+    if (m_run_queue.size() < 2) {
+        this->update_hlt_exiting();
+        return true;
+    }
+
+    vcpu->advance();
+    return this->handle_preemption(vcpu);
+}
+
+bool
+scheduler::handle_pause(vcpu *vcpu)
+{
+    auto now = ::x64::tsc::get();
+
+    // If the vCPU has the core to itself, there is no one to yield to, in
+    // which case the exit is left to the default PAUSE handler.
+
+    auto ticks = m_run_queue.remaining(now);
+    if (ticks == 0) {
+        return false;
+    }
+
+    m_spin_ticks_saved += ticks;
+
+    vcpu->advance();
+    this->switch_to(vcpu, m_run_queue.next(now), now);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Private
+// -----------------------------------------------------------------------------
+
+void
+scheduler::switch_to(vcpu *current, vcpu *next, tick_t now)
+{
+    using namespace vmcs_n;
+
+    if (next == current) {
+        this->update_hlt_exiting();
+        this->arm(next, now);
+        return;
+    }
+
+    // The VMCS of a vCPU can only be written while it is loaded, which is
+    // why the exit controls are set here instead of in add(). Saving the
+    // preemption timer on exit keeps the remaining count across VM exits
+    // that do not switch vCPUs, instead of reloading the full slice on the
+    // next VM entry. The timer only counts down in VMX non-root operation,
+    // so time spent in the VMM is not charged to any vCPU's slice.
+
+    next->load();
+
+    this->update_hlt_exiting();
+    next->enable_pause_loop_exiting();
+    vm_exit_controls::save_preemption_timer_value::enable_if_allowed();
+
+    this->arm(next, now);
+    next->run();
+}
+
+void
+scheduler::update_hlt_exiting()
+{
+    using namespace vmcs_n::primary_processor_based_vm_execution_controls;
+
+    if (m_run_queue.size() > 1) {
+        hlt_exiting::enable();
+    }
+    else {
+        hlt_exiting::disable();
+    }
+}
+
+void
+scheduler::arm(vcpu *vcpu, tick_t now)
+{
+    auto ticks = m_run_queue.remaining(now);
+
+    if (ticks == 0) {
+        vcpu->disable_preemption_timer();
+        return;
+    }
+
+    auto value = ticks >> m_timer_shift;
+    vcpu->set_preemption_timer(value < 0xFFFFFFFFU ? (value != 0 ? value : 1) : 0xFFFFFFFFU);
+}
+
+}
@@ -27,11 +27,22 @@
 //     impractical.
 //
 
+// TIDY_EXCLUSION=-cppcoreguidelines-pro-bounds-pointer-arithmetic
+//
+// Reason:
+//     The general purpose registers in the vCPU's save state are laid out
+//     using the hardware's register encoding so that they can be indexed
+//     directly, which requires pointer arithmetic.
+//
+
+#include <cstring>
+
 #include <bfcallonce.h>
 #include <bfthreadcontext.h>
 
 #include <hve/arch/intel_x64/vcpu.h>
 #include <hve/arch/intel_x64/exception.h>
+#include <hve/arch/intel_x64/vmcs_template.h>
 
 //==============================================================================
 // C Prototypes
@@ -61,6 +72,9 @@ static ::intel_x64::cr4::value_type g_cr4_reg{};
 static ::intel_x64::msrs::value_type g_ia32_pat_msr{};
 static ::intel_x64::msrs::value_type g_ia32_efer_msr{};
 
+static bfvmm::intel_x64::vmcs_template g_host_vcpu_template{};
+static bfvmm::intel_x64::vmcs_template g_guest_vcpu_template{};
+
 static void
 setup()
 {
@@ -70,13 +84,13 @@ setup()
     using namespace bfvmm::x64;
     using attr_type = bfvmm::x64::cr3::mmap::attr_type;
 
-    for (const auto &md : g_mm->descriptors()) {
-        if (md.type == (MEMORY_TYPE_R | MEMORY_TYPE_E)) {
-            g_cr3->map_4k(md.virt, md.phys, attr_type::read_execute);
+    for (const auto &run : g_mm->descriptor_runs()) {
+        if (run.type == (MEMORY_TYPE_R | MEMORY_TYPE_E)) {
+            g_cr3->map_range(run.virt, run.phys, run.size, attr_type::read_execute);
             continue;
         }
 
-        g_cr3->map_4k(md.virt, md.phys, attr_type::read_write);
+        g_cr3->map_range(run.virt, run.phys, run.size, attr_type::read_write);
     }
 
     g_ia32_efer_msr |= msrs::ia32_efer::lme::mask;
@@ -85,6 +99,7 @@ setup()
 
     g_cr0_reg |= cr0::protection_enable::mask;
     g_cr0_reg |= cr0::monitor_coprocessor::mask;
+    g_cr0_reg |= cr0::task_switched::mask;
     g_cr0_reg |= cr0::extension_type::mask;
     g_cr0_reg |= cr0::numeric_error::mask;
     g_cr0_reg |= cr0::write_protect::mask;
@@ -156,14 +171,17 @@ vcpu::vcpu(
     m_monitor_trap_handler{this},
     m_nmi_window_handler{this},
     m_nmi_handler{this},
+    m_pause_handler{this},
     m_preemption_timer_handler{this},
     m_rdmsr_handler{this},
     m_sipi_signal_handler{this},
+    m_vmcall_handler{this},
     m_wrmsr_handler{this},
     m_xsetbv_handler{this},
 
     m_ept_handler{this},
     m_microcode_handler{this},
+    m_msr_policy{this},
     m_vpid_handler{this}
 {
     using namespace ::intel_x64;
@@ -171,12 +189,7 @@ vcpu::vcpu(
 
     bfn::call_once(g_once_flag, setup);
 
-    m_state->vcpu_ptr =
-        reinterpret_cast<uintptr_t>(this);
-
-    m_state->exit_handler_ptr =
-        reinterpret_cast<uintptr_t>(&m_exit_handler);
-
+    this->init_state();
     this->init_xsave();
 
     // Note:
@@ -193,6 +206,7 @@ vcpu::vcpu(
 
     this->load();
 
+    this->write_template_state();
     this->write_host_state();
     this->write_control_state();
 
@@ -206,6 +220,119 @@ vcpu::vcpu(
     m_control_register_handler.enable_wrcr4_exiting(0);
 }
 
+void
+vcpu::reset(vcpuid::type id)
+{
+    expects(this->is_guest_vcpu());
+    expects(vcpuid::is_guest_vcpu(id));
+
+    // Note:
+    //
+    // The interrupt window handler is reset first as it is the only part
+    // of the vCPU that can refuse to be reset, in which case the vCPU is
+    // left untouched.
+    //
+
+    m_interrupt_window_handler.reset();
+    bfvmm::vcpu::reset(id);
+
+    // Note:
+    //
+    // The VMCS is not loaded until it has been reset below, so everything
+    // up to that point only resets the vCPU's software state. This is also
+    // why EPT is dropped here instead of using disable_ept().
+    //
+
+    m_ept_handler.reset();
+    m_mmap = nullptr;
+
+    // The delegates added by the constructors are restored, and the ones
+    // added for the last guest are dropped (see save_construction_state()).
+
+    this->save_construction_state();
+
+    m_launched = false;
+    m_launch_delegates = m_saved_launch_delegates;
+    m_resume_delegates = m_saved_resume_delegates;
+    m_clear_delegates = m_saved_clear_delegates;
+
+    m_vmcs_cache = vmcs_write_cache{};
+    m_vpid_handler.reset();
+
+    // The pointers and CPUID values in the software state were set up by
+    // the constructor and do not change, so they are kept while the rest
+    // of the state (i.e. the last guest's registers) is zeroed.
+
+    auto old_state = *m_state;
+    *m_state = {};
+
+    this->init_state();
+
+    m_state->guest_xsaves_area_ptr = old_state.guest_xsaves_area_ptr;
+    m_state->host_xsaves_area_ptr = old_state.host_xsaves_area_ptr;
+    m_state->xcr0_cpuid = old_state.xcr0_cpuid;
+    m_state->ia32_xss_cpuid = old_state.ia32_xss_cpuid;
+
+    auto size = xsaves_area_size();
+    std::memset(m_guest_xsaves_area.get(), 0, size);
+    std::memset(m_host_xsaves_area.get(), 0, size);
+
+    // The MSR and IO bitmaps are kept, as they hold the traps of the
+    // handlers that were added by the constructor, which are kept as
+    // well. The MSR policy is compiled again, which restores the bitmap
+    // bits of its rules and the initial values of its shadow rules.
+
+    m_msr_policy.reset();
+
+    // Finally, the VMCS is reset and written again, the same way the
+    // constructor writes it. The stacks are set up again as well, as the
+    // thread context at the top of each stack stores the vCPU's id.
+
+    m_vmcs.reset();
+    this->load();
+
+    this->write_template_state();
+    this->write_host_state();
+    this->write_control_state();
+
+    m_vpid_handler.enable();
+    m_nmi_handler.enable_exiting();
+    m_control_register_handler.set_wrcr0_mask(m_saved_wrcr0_mask);
+    m_control_register_handler.set_wrcr4_mask(m_saved_wrcr4_mask);
+}
+
+void
+vcpu::retire()
+{
+    this->save_construction_state();
+    this->clear();
+}
+
+// Note:
+//
+// A subclass adds its delegates and CR0/CR4 traps after this class's
+// constructor has returned, so the state that reset() restores cannot be
+// saved by the constructor. Instead, it is saved the first time the vCPU
+// is launched or retired, as anything added before then was added while
+// the vCPU was being set up, and not for a specific guest.
+
+void
+vcpu::save_construction_state()
+{
+    if (m_construction_state_saved) {
+        return;
+    }
+
+    m_saved_launch_delegates = m_launch_delegates;
+    m_saved_resume_delegates = m_resume_delegates;
+    m_saved_clear_delegates = m_clear_delegates;
+
+    m_saved_wrcr0_mask = m_control_register_handler.wrcr0_mask();
+    m_saved_wrcr4_mask = m_control_register_handler.wrcr4_mask();
+
+    m_construction_state_saved = true;
+}
+
 void
 vcpu::run()
 {
@@ -215,16 +342,23 @@ vcpu::run()
             d(this);
         }
 
+        m_vpid_handler.refresh();
+        m_vmcs_cache.flush();
         m_vmcs.resume();
     }
     else {
 
+        this->save_construction_state();
+
         try {
 
             for (const auto &d : m_launch_delegates) {
                 d(this);
             }
 
+            m_vpid_handler.refresh();
+            m_vmcs_cache.flush();
+
             m_launched = true;
             m_vmcs.launch();
         }
@@ -235,6 +369,23 @@ vcpu::run()
     }
 }
 
+//==============================================================================
+// State Init
+//==============================================================================
+
+void
+vcpu::init_state()
+{
+    m_state->vcpu_ptr =
+        reinterpret_cast<uintptr_t>(this);
+
+    m_state->exit_handler_ptr =
+        reinterpret_cast<uintptr_t>(&m_exit_handler);
+
+    m_state->fast_handlers_ptr =
+        reinterpret_cast<uintptr_t>(m_exit_handler.fast_handlers());
+}
+
 //==============================================================================
 // XSAVE Init
 //==============================================================================
@@ -292,16 +443,61 @@ vcpu::init_xsave()
 //==============================================================================
 
 void
-vcpu::write_host_state()
+vcpu::write_template_state()
+{
+    auto &golden =
+        this->is_host_vcpu() ? g_host_vcpu_template : g_guest_vcpu_template;
+
+    if (golden.apply()) {
+        return;
+    }
+
+    write_shared_state(golden, this->is_host_vcpu());
+}
+
+void
+vcpu::write_shared_state(vmcs_template &golden, bool host)
 {
     using namespace ::intel_x64::vmcs;
-    using namespace ::x64::access_rights;
 
-    m_host_gdt.set(1, nullptr, 0xFFFFFFFF, ring0_cs_descriptor);
-    m_host_gdt.set(2, nullptr, 0xFFFFFFFF, ring0_ss_descriptor);
-    m_host_gdt.set(3, nullptr, 0xFFFFFFFF, ring0_fs_descriptor);
-    m_host_gdt.set(4, nullptr, 0xFFFFFFFF, ring0_gs_descriptor);
-    m_host_gdt.set(5, &m_host_tss, sizeof(m_host_tss), ring0_tr_descriptor);
+    // Note:
+    //
+    // These are the fields written by write_shared_host_state() and
+    // write_shared_control_state(). If either of these functions is changed
+    // to write a new field, the field must be added here as well, otherwise
+    // only the first vCPU of each kind will get it. The vmcs_template tests
+    // check this list against the writers.
+    //
+
+    write_shared_host_state();
+    write_shared_control_state(host);
+
+    golden.capture({
+        host_cs_selector::addr,
+        host_ss_selector::addr,
+        host_fs_selector::addr,
+        host_gs_selector::addr,
+        host_tr_selector::addr,
+        host_ia32_pat::addr,
+        host_ia32_efer::addr,
+        host_cr0::addr,
+        host_cr3::addr,
+        host_cr4::addr,
+        host_rip::addr,
+        pin_based_vm_execution_controls::addr,
+        primary_processor_based_vm_execution_controls::addr,
+        secondary_processor_based_vm_execution_controls::addr,
+        vm_exit_controls::addr,
+        vm_entry_controls::addr,
+        ple_gap::addr,
+        ple_window::addr
+    });
+}
+
+void
+vcpu::write_shared_host_state()
+{
+    using namespace ::intel_x64::vmcs;
 
     host_cs_selector::set(1 << 3);
     host_ss_selector::set(2 << 3);
@@ -316,6 +512,21 @@ vcpu::write_host_state()
     host_cr3::set(g_cr3_reg);
     host_cr4::set(g_cr4_reg);
 
+    host_rip::set(exit_handler_entry);
+}
+
+void
+vcpu::write_host_state()
+{
+    using namespace ::intel_x64::vmcs;
+    using namespace ::x64::access_rights;
+
+    m_host_gdt.set(1, nullptr, 0xFFFFFFFF, ring0_cs_descriptor);
+    m_host_gdt.set(2, nullptr, 0xFFFFFFFF, ring0_ss_descriptor);
+    m_host_gdt.set(3, nullptr, 0xFFFFFFFF, ring0_fs_descriptor);
+    m_host_gdt.set(4, nullptr, 0xFFFFFFFF, ring0_gs_descriptor);
+    m_host_gdt.set(5, &m_host_tss, sizeof(m_host_tss), ring0_tr_descriptor);
+
     host_gs_base::set(reinterpret_cast<uintptr_t>(m_state.get()));
     host_tr_base::set(m_host_gdt.base(5));
 
@@ -332,7 +543,6 @@ vcpu::write_host_state()
 
     set_default_esrs(&m_host_idt, 8);
 
-    host_rip::set(exit_handler_entry);
     host_rsp::set(setup_stack(m_stack.get(), this->id()));
 }
 
@@ -443,6 +653,16 @@ vcpu::write_control_state()
 {
     using namespace ::intel_x64::vmcs;
 
+    address_of_msr_bitmap::set(g_mm->virtptr_to_physint(m_msr_bitmap.get()));
+    address_of_io_bitmap_a::set(g_mm->virtptr_to_physint(m_io_bitmap_a.get()));
+    address_of_io_bitmap_b::set(g_mm->virtptr_to_physint(m_io_bitmap_b.get()));
+}
+
+void
+vcpu::write_shared_control_state(bool host)
+{
+    using namespace ::intel_x64::vmcs;
+
     auto ia32_vmx_pinbased_ctls_msr =
         ::intel_x64::msrs::ia32_vmx_true_pinbased_ctls::get();
     auto ia32_vmx_procbased_ctls_msr =
@@ -476,16 +696,12 @@ vcpu::write_control_state()
     using namespace primary_processor_based_vm_execution_controls;
     using namespace secondary_processor_based_vm_execution_controls;
 
-    address_of_msr_bitmap::set(g_mm->virtptr_to_physint(m_msr_bitmap.get()));
-    address_of_io_bitmap_a::set(g_mm->virtptr_to_physint(m_io_bitmap_a.get()));
-    address_of_io_bitmap_b::set(g_mm->virtptr_to_physint(m_io_bitmap_b.get()));
-
     use_msr_bitmap::enable();
     use_io_bitmaps::enable();
 
     activate_secondary_controls::enable_if_allowed();
 
-    if (this->is_host_vcpu()) {
+    if (host) {
         enable_rdtscp::enable_if_allowed();
         enable_invpcid::enable_if_allowed();
         conceal_vmx_from_pt::enable_if_allowed();
@@ -493,6 +709,11 @@ vcpu::write_control_state()
         pt_uses_guest_physical_addresses::enable_if_allowed();
     }
 
+    if (pause_loop_exiting::is_allowed1()) {
+        ple_gap::set(pause_handler::default_gap);
+        ple_window::set(pause_handler::default_window);
+    }
+
     vm_exit_controls::save_debug_controls::enable();
     vm_exit_controls::host_address_space_size::enable();
     vm_exit_controls::load_ia32_perf_global_ctrl::enable_if_allowed();
@@ -535,7 +756,10 @@ vcpu::clear()
 
 void
 vcpu::promote()
-{ m_vmcs.promote(); }
+{
+    m_vmcs_cache.flush();
+    m_vmcs.promote();
+}
 
 bool
 vcpu::advance()
@@ -546,6 +770,14 @@ vcpu::advance()
     return true;
 }
 
+void
+vcpu::flush_vmcs_writes()
+{ m_vmcs_cache.flush(); }
+
+const vmcs_write_cache::stats_t &
+vcpu::vmcs_write_stats() const noexcept
+{ return m_vmcs_cache.stats(); }
+
 //==============================================================================
 // Handler Operations
 //==============================================================================
@@ -561,6 +793,24 @@ vcpu::add_exit_handler_for_reason(
     const handler_delegate_t &d)
 { m_exit_handler.add_handler(reason, d); }
 
+void
+vcpu::remove_exit_handler_for_reason(
+    ::intel_x64::vmcs::value_type reason,
+    const handler_delegate_t &d)
+{ m_exit_handler.remove_handler(reason, d); }
+
+void
+vcpu::add_result_handler_for_reason(
+    ::intel_x64::vmcs::value_type reason,
+    const result_delegate_t &d)
+{ m_exit_handler.add_result_handler(reason, d); }
+
+void
+vcpu::set_fast_exit_handler(
+    ::intel_x64::vmcs::value_type reason,
+    fast_handler_t func)
+{ m_exit_handler.set_fast_handler(reason, func); }
+
 //==============================================================================
 // Fault Handling
 //==============================================================================
@@ -671,6 +921,14 @@ vcpu::add_wrcr4_handler(
     m_control_register_handler.enable_wrcr4_exiting(mask);
 }
 
+void
+vcpu::set_wrcr0_mask(vmcs_n::value_type mask)
+{ m_control_register_handler.set_wrcr0_mask(mask); }
+
+void
+vcpu::set_wrcr4_mask(vmcs_n::value_type mask)
+{ m_control_register_handler.set_wrcr4_mask(mask); }
+
 void
 vcpu::execute_wrcr0()
 { m_control_register_handler.execute_wrcr0(this); }
@@ -786,6 +1044,18 @@ void
 vcpu::inject_external_interrupt(uint64_t vector)
 { m_interrupt_window_handler.inject_external_interrupt(vector); }
 
+void
+vcpu::enable_virtual_interrupt_delivery()
+{ m_interrupt_window_handler.enable_virtual_interrupt_delivery(); }
+
+void
+vcpu::enable_posted_interrupts(uint64_t notification_vector)
+{ m_interrupt_window_handler.enable_posted_interrupts(notification_vector); }
+
+bool
+vcpu::post_external_interrupt(uint64_t vector)
+{ return m_interrupt_window_handler.post_external_interrupt(vector); }
+
 //--------------------------------------------------------------------------
 // IO Instruction
 //--------------------------------------------------------------------------
@@ -812,6 +1082,16 @@ vcpu::add_io_instruction_handler(
     m_io_instruction_handler.add_handler(port, in_d, out_d);
 }
 
+void
+vcpu::add_io_string_instruction_handler(
+    vmcs_n::value_type port,
+    const io_instruction_handler::string_handler_delegate_t &in_d,
+    const io_instruction_handler::string_handler_delegate_t &out_d)
+{
+    m_io_instruction_handler.trap_on_access(port);
+    m_io_instruction_handler.add_string_handler(port, in_d, out_d);
+}
+
 void
 vcpu::emulate_io_instruction(
     vmcs_n::value_type port,
@@ -954,6 +1234,18 @@ vcpu::add_default_wrmsr_handler(
     const ::handler_delegate_t &d)
 { m_wrmsr_handler.set_default_handler(d); }
 
+//--------------------------------------------------------------------------
+// MSR Policy
+//--------------------------------------------------------------------------
+
+void
+vcpu::set_msr_policy(const std::vector<msr_policy::rule_t> &rules)
+{ m_msr_policy.compile(rules); }
+
+uint64_t
+vcpu::msr_policy_value(uint32_t msr) const
+{ return m_msr_policy.value(msr); }
+
 //--------------------------------------------------------------------------
 // XSetBV
 //--------------------------------------------------------------------------
@@ -972,6 +1264,11 @@ vcpu::add_preemption_timer_handler(
     const preemption_timer_handler::handler_delegate_t &d)
 { m_preemption_timer_handler.add_handler(d); }
 
+void
+vcpu::remove_preemption_timer_handler(
+    const preemption_timer_handler::handler_delegate_t &d)
+{ m_preemption_timer_handler.remove_handler(d); }
+
 void
 vcpu::set_preemption_timer(
     const preemption_timer_handler::value_t val)
@@ -992,6 +1289,54 @@ void
 vcpu::disable_preemption_timer()
 { m_preemption_timer_handler.disable_exiting(); }
 
+//--------------------------------------------------------------------------
+// PAUSE-loop exiting
+//--------------------------------------------------------------------------
+
+void
+vcpu::add_pause_handler(
+    const pause_handler::handler_delegate_t &d)
+{ m_pause_handler.add_handler(d); }
+
+void
+vcpu::remove_pause_handler(
+    const pause_handler::handler_delegate_t &d)
+{ m_pause_handler.remove_handler(d); }
+
+void
+vcpu::enable_pause_loop_exiting()
+{ m_pause_handler.enable_exiting(); }
+
+void
+vcpu::disable_pause_loop_exiting()
+{ m_pause_handler.disable_exiting(); }
+
+void
+vcpu::set_pause_loop_window(
+    pause_handler::value_t gap, pause_handler::value_t window)
+{ m_pause_handler.set_window(gap, window); }
+
+const pause_handler::stats_t &
+vcpu::pause_loop_stats() const noexcept
+{ return m_pause_handler.stats(); }
+
+//--------------------------------------------------------------------------
+// Hypercall Ring
+//--------------------------------------------------------------------------
+
+void
+vcpu::add_hypercall_handler(
+    const vmcall_handler::handler_delegate_t &d)
+{ m_vmcall_handler.add_handler(d); }
+
+void
+vcpu::enable_hypercall_ring_polling()
+{ m_vmcall_handler.enable_polling(); }
+
+const vmcall_handler::stats_t &
+vcpu::hypercall_ring_stats() const noexcept
+{ return m_vmcall_handler.stats(); }
+
 //==========================================================================
 // EPT
 //==========================================================================
@@ -999,9 +1344,6 @@ vcpu::disable_preemption_timer()
 void
 vcpu::set_eptp(ept::mmap &map)
 {
-    using namespace ::intel_x64::vmcs;
-    using namespace ::intel_x64::cr0;
-
     m_ept_handler.set_eptp(&map);
     m_mmap = &map;
 
@@ -1010,22 +1352,18 @@ vcpu::set_eptp(ept::mmap &map)
     // They were enabled by vCPU constructor for systems not using unrestricted
     // guests. This led to different treatment of mode changes on BSP than APs,
     // and as a result to inability to use some modes on BSP (e.g. 32b mode
-    // without PAE).
-    cr0_guest_host_mask::set(cr0_guest_host_mask::get() & ~(paging::mask | protection_enable::mask));
-    m_control_register_handler.enable_wrcr0_exiting(cr0_guest_host_mask::get());
+    // without PAE). set_eptp() removes them from the fixed bits, so all that
+    // is left to do is to recompute the guest/host mask.
+    m_control_register_handler.enable_wrcr0_exiting(0);
 }
 
 void
 vcpu::disable_ept()
 {
-    using namespace ::intel_x64::vmcs;
-    using namespace ::intel_x64::cr0;
-
     m_ept_handler.set_eptp(nullptr);
     m_mmap = nullptr;
 
-    cr0_guest_host_mask::set(cr0_guest_host_mask::get() | (paging::mask | protection_enable::mask));
-    m_control_register_handler.enable_wrcr0_exiting(cr0_guest_host_mask::get());
+    m_control_register_handler.enable_wrcr0_exiting(0);
 }
 
 void
@@ -1086,13 +1424,26 @@ vcpu::gpa_to_hpa(uintptr_t gpa)
     return m_mmap->virt_to_phys(gpa);
 }
 
+// The paging bit is read from the write cache, so that a CR0 write made
+// earlier in the same exit is seen before it is flushed. The guest's own
+// CR0 is used instead of cr0(), as the read shadow of a masked PG bit is
+// what the guest sees, not whether paging is enabled.
+//
+bool
+vcpu::guest_paging_enabled() const noexcept
+{
+    return vmcs_n::guest_cr0::paging::is_enabled(
+        m_vmcs_cache.read(vmcs_write_cache::cr0)
+    );
+}
+
 std::pair<uintptr_t, uintptr_t>
 vcpu::gva_to_gpa(uint64_t gva)
 {
     using namespace ::x64;
     using namespace vmcs_n;
 
-    if (guest_cr0::paging::is_disabled()) {
+    if (!this->guest_paging_enabled()) {
         return {gva, 0};
     }
 
@@ -1271,6 +1622,14 @@ vcpu::get_entry(uintptr_t tble_gpa, std::ptrdiff_t index)
 // Registers
 //==============================================================================
 
+uint64_t
+vcpu::gpr(uint64_t index) const noexcept
+{ return reinterpret_cast<const uint64_t *>(m_state.get())[index & 0xF]; }
+
+void
+vcpu::set_gpr(uint64_t index, uint64_t val) noexcept
+{ reinterpret_cast<uint64_t *>(m_state.get())[index & 0xF] = val; }
+
 uint64_t
 vcpu::rax() const noexcept
 { return m_state->rax; }
@@ -1409,50 +1768,56 @@ vcpu::set_rsp(uint64_t val) noexcept
 
 uint64_t
 vcpu::gdt_base() const noexcept
-{ return vmcs_n::guest_gdtr_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::gdtr_base); }
 
 void
 vcpu::set_gdt_base(uint64_t val) noexcept
-{ vmcs_n::guest_gdtr_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::gdtr_base, val); }
 
 uint64_t
 vcpu::gdt_limit() const noexcept
-{ return vmcs_n::guest_gdtr_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::gdtr_limit); }
 
 void
 vcpu::set_gdt_limit(uint64_t val) noexcept
-{ vmcs_n::guest_gdtr_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::gdtr_limit, val); }
 
 uint64_t
 vcpu::idt_base() const noexcept
-{ return vmcs_n::guest_idtr_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::idtr_base); }
 
 void
 vcpu::set_idt_base(uint64_t val) noexcept
-{ vmcs_n::guest_idtr_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::idtr_base, val); }
 
 uint64_t
 vcpu::idt_limit() const noexcept
-{ return vmcs_n::guest_idtr_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::idtr_limit); }
 
 void
 vcpu::set_idt_limit(uint64_t val) noexcept
-{ vmcs_n::guest_idtr_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::idtr_limit, val); }
 
 uint64_t
 vcpu::cr0() const noexcept
-{ return vmcs_n::cr0_read_shadow::get(); }
+{
+    auto mask = vmcs_n::cr0_guest_host_mask::get();
+
+    return
+        (m_vmcs_cache.read(vmcs_write_cache::cr0) & ~mask) |
+        (m_vmcs_cache.read(vmcs_write_cache::cr0_read_shadow) & mask);
+}
 
 void
 vcpu::set_cr0(uint64_t val) noexcept
 {
-    vmcs_n::cr0_read_shadow::set(val);
+    m_vmcs_cache.write(vmcs_write_cache::cr0_read_shadow, val);
 
     ::intel_x64::cr0::extension_type::enable(val);
     ::intel_x64::cr0::not_write_through::disable(val);
     ::intel_x64::cr0::cache_disable::disable(val);
 
-    vmcs_n::guest_cr0::set(val | m_global_state->ia32_vmx_cr0_fixed0);
+    m_vmcs_cache.write(vmcs_write_cache::cr0, val | m_global_state->ia32_vmx_cr0_fixed0);
 }
 
 uint64_t
@@ -1465,23 +1830,29 @@ vcpu::set_cr2(uint64_t val) noexcept
 
 uint64_t
 vcpu::cr3() const noexcept
-{ return vmcs_n::guest_cr3::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::cr3); }
 
 void
 vcpu::set_cr3(uint64_t val) noexcept
 {
-    vmcs_n::guest_cr3::set(val & 0x7FFFFFFFFFFFFFFF);
+    m_vmcs_cache.write(vmcs_write_cache::cr3, val & 0x7FFFFFFFFFFFFFFF);
 }
 
 uint64_t
 vcpu::cr4() const noexcept
-{ return vmcs_n::cr4_read_shadow::get(); }
+{
+    auto mask = vmcs_n::cr4_guest_host_mask::get();
+
+    return
+        (m_vmcs_cache.read(vmcs_write_cache::cr4) & ~mask) |
+        (m_vmcs_cache.read(vmcs_write_cache::cr4_read_shadow) & mask);
+}
 
 void
 vcpu::set_cr4(uint64_t val) noexcept
 {
-    vmcs_n::cr4_read_shadow::set(val);
-    vmcs_n::guest_cr4::set(val | m_global_state->ia32_vmx_cr4_fixed0);
+    m_vmcs_cache.write(vmcs_write_cache::cr4_read_shadow, val);
+    m_vmcs_cache.write(vmcs_write_cache::cr4, val | m_global_state->ia32_vmx_cr4_fixed0);
 }
 
 uint64_t
@@ -1534,11 +1905,11 @@ vcpu::set_dr6(uint64_t val) noexcept
 
 uint64_t
 vcpu::dr7() const noexcept
-{ return vmcs_n::guest_dr7::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::dr7); }
 
 void
 vcpu::set_dr7(uint64_t val) noexcept
-{ vmcs_n::guest_dr7::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::dr7, val); }
 
 uint64_t
 vcpu::xcr0() const noexcept
@@ -1558,276 +1929,276 @@ vcpu::set_ia32_xss(uint64_t val) noexcept
 
 uint64_t
 vcpu::ia32_efer() const noexcept
-{ return vmcs_n::guest_ia32_efer::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ia32_efer); }
 
 void
 vcpu::set_ia32_efer(uint64_t val) noexcept
-{ vmcs_n::guest_ia32_efer::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ia32_efer, val); }
 
 uint64_t
 vcpu::ia32_pat() const noexcept
-{ return vmcs_n::guest_ia32_pat::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ia32_pat); }
 
 void
 vcpu::set_ia32_pat(uint64_t val) noexcept
-{ vmcs_n::guest_ia32_pat::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ia32_pat, val); }
 
 
 uint64_t
 vcpu::es_selector() const noexcept
-{ return vmcs_n::guest_es_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::es_selector); }
 
 void
 vcpu::set_es_selector(uint64_t val) noexcept
-{ vmcs_n::guest_es_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::es_selector, val); }
 
 uint64_t
 vcpu::es_base() const noexcept
-{ return vmcs_n::guest_es_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::es_base); }
 
 void
 vcpu::set_es_base(uint64_t val) noexcept
-{ vmcs_n::guest_es_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::es_base, val); }
 
 uint64_t
 vcpu::es_limit() const noexcept
-{ return vmcs_n::guest_es_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::es_limit); }
 
 void
 vcpu::set_es_limit(uint64_t val) noexcept
-{ vmcs_n::guest_es_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::es_limit, val); }
 
 uint64_t
 vcpu::es_access_rights() const noexcept
-{ return vmcs_n::guest_es_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::es_access_rights); }
 
 void
 vcpu::set_es_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_es_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::es_access_rights, val); }
 
 uint64_t
 vcpu::cs_selector() const noexcept
-{ return vmcs_n::guest_cs_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::cs_selector); }
 
 void
 vcpu::set_cs_selector(uint64_t val) noexcept
-{ vmcs_n::guest_cs_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::cs_selector, val); }
 
 uint64_t
 vcpu::cs_base() const noexcept
-{ return vmcs_n::guest_cs_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::cs_base); }
 
 void
 vcpu::set_cs_base(uint64_t val) noexcept
-{ vmcs_n::guest_cs_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::cs_base, val); }
 
 uint64_t
 vcpu::cs_limit() const noexcept
-{ return vmcs_n::guest_cs_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::cs_limit); }
 
 void
 vcpu::set_cs_limit(uint64_t val) noexcept
-{ vmcs_n::guest_cs_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::cs_limit, val); }
 
 uint64_t
 vcpu::cs_access_rights() const noexcept
-{ return vmcs_n::guest_cs_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::cs_access_rights); }
 
 void
 vcpu::set_cs_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_cs_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::cs_access_rights, val); }
 
 uint64_t
 vcpu::ss_selector() const noexcept
-{ return vmcs_n::guest_ss_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ss_selector); }
 
 void
 vcpu::set_ss_selector(uint64_t val) noexcept
-{ vmcs_n::guest_ss_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ss_selector, val); }
 
 uint64_t
 vcpu::ss_base() const noexcept
-{ return vmcs_n::guest_ss_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ss_base); }
 
 void
 vcpu::set_ss_base(uint64_t val) noexcept
-{ vmcs_n::guest_ss_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ss_base, val); }
 
 uint64_t
 vcpu::ss_limit() const noexcept
-{ return vmcs_n::guest_ss_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ss_limit); }
 
 void
 vcpu::set_ss_limit(uint64_t val) noexcept
-{ vmcs_n::guest_ss_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ss_limit, val); }
 
 uint64_t
 vcpu::ss_access_rights() const noexcept
-{ return vmcs_n::guest_ss_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ss_access_rights); }
 
 void
 vcpu::set_ss_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_ss_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ss_access_rights, val); }
 
 uint64_t
 vcpu::ds_selector() const noexcept
-{ return vmcs_n::guest_ds_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ds_selector); }
 
 void
 vcpu::set_ds_selector(uint64_t val) noexcept
-{ vmcs_n::guest_ds_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ds_selector, val); }
 
 uint64_t
 vcpu::ds_base() const noexcept
-{ return vmcs_n::guest_ds_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ds_base); }
 
 void
 vcpu::set_ds_base(uint64_t val) noexcept
-{ vmcs_n::guest_ds_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ds_base, val); }
 
 uint64_t
 vcpu::ds_limit() const noexcept
-{ return vmcs_n::guest_ds_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ds_limit); }
 
 void
 vcpu::set_ds_limit(uint64_t val) noexcept
-{ vmcs_n::guest_ds_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ds_limit, val); }
 
 uint64_t
 vcpu::ds_access_rights() const noexcept
-{ return vmcs_n::guest_ds_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ds_access_rights); }
 
 void
 vcpu::set_ds_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_ds_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ds_access_rights, val); }
 
 uint64_t
 vcpu::fs_selector() const noexcept
-{ return vmcs_n::guest_fs_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::fs_selector); }
 
 void
 vcpu::set_fs_selector(uint64_t val) noexcept
-{ vmcs_n::guest_fs_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::fs_selector, val); }
 
 uint64_t
 vcpu::fs_base() const noexcept
-{ return vmcs_n::guest_fs_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::fs_base); }
 
 void
 vcpu::set_fs_base(uint64_t val) noexcept
-{ vmcs_n::guest_fs_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::fs_base, val); }
 
 uint64_t
 vcpu::fs_limit() const noexcept
-{ return vmcs_n::guest_fs_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::fs_limit); }
 
 void
 vcpu::set_fs_limit(uint64_t val) noexcept
-{ vmcs_n::guest_fs_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::fs_limit, val); }
 
 uint64_t
 vcpu::fs_access_rights() const noexcept
-{ return vmcs_n::guest_fs_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::fs_access_rights); }
 
 void
 vcpu::set_fs_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_fs_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::fs_access_rights, val); }
 
 uint64_t
 vcpu::gs_selector() const noexcept
-{ return vmcs_n::guest_gs_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::gs_selector); }
 
 void
 vcpu::set_gs_selector(uint64_t val) noexcept
-{ vmcs_n::guest_gs_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::gs_selector, val); }
 
 uint64_t
 vcpu::gs_base() const noexcept
-{ return vmcs_n::guest_gs_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::gs_base); }
 
 void
 vcpu::set_gs_base(uint64_t val) noexcept
-{ vmcs_n::guest_gs_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::gs_base, val); }
 
 uint64_t
 vcpu::gs_limit() const noexcept
-{ return vmcs_n::guest_gs_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::gs_limit); }
 
 void
 vcpu::set_gs_limit(uint64_t val) noexcept
-{ vmcs_n::guest_gs_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::gs_limit, val); }
 
 uint64_t
 vcpu::gs_access_rights() const noexcept
-{ return vmcs_n::guest_gs_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::gs_access_rights); }
 
 void
 vcpu::set_gs_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_gs_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::gs_access_rights, val); }
 
 uint64_t
 vcpu::tr_selector() const noexcept
-{ return vmcs_n::guest_tr_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::tr_selector); }
 
 void
 vcpu::set_tr_selector(uint64_t val) noexcept
-{ vmcs_n::guest_tr_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::tr_selector, val); }
 
 uint64_t
 vcpu::tr_base() const noexcept
-{ return vmcs_n::guest_tr_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::tr_base); }
 
 void
 vcpu::set_tr_base(uint64_t val) noexcept
-{ vmcs_n::guest_tr_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::tr_base, val); }
 
 uint64_t
 vcpu::tr_limit() const noexcept
-{ return vmcs_n::guest_tr_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::tr_limit); }
 
 void
 vcpu::set_tr_limit(uint64_t val) noexcept
-{ vmcs_n::guest_tr_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::tr_limit, val); }
 
 uint64_t
 vcpu::tr_access_rights() const noexcept
-{ return vmcs_n::guest_tr_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::tr_access_rights); }
 
 void
 vcpu::set_tr_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_tr_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::tr_access_rights, val); }
 
 uint64_t
 vcpu::ldtr_selector() const noexcept
-{ return vmcs_n::guest_ldtr_selector::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ldtr_selector); }
 
 void
 vcpu::set_ldtr_selector(uint64_t val) noexcept
-{ vmcs_n::guest_ldtr_selector::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ldtr_selector, val); }
 
 uint64_t
 vcpu::ldtr_base() const noexcept
-{ return vmcs_n::guest_ldtr_base::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ldtr_base); }
 
 void
 vcpu::set_ldtr_base(uint64_t val) noexcept
-{ vmcs_n::guest_ldtr_base::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ldtr_base, val); }
 
 uint64_t
 vcpu::ldtr_limit() const noexcept
-{ return vmcs_n::guest_ldtr_limit::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ldtr_limit); }
 
 void
 vcpu::set_ldtr_limit(uint64_t val) noexcept
-{ vmcs_n::guest_ldtr_limit::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ldtr_limit, val); }
 
 uint64_t
 vcpu::ldtr_access_rights() const noexcept
-{ return vmcs_n::guest_ldtr_access_rights::get(); }
+{ return m_vmcs_cache.read(vmcs_write_cache::ldtr_access_rights); }
 
 void
 vcpu::set_ldtr_access_rights(uint64_t val) noexcept
-{ vmcs_n::guest_ldtr_access_rights::set(val); }
+{ m_vmcs_cache.write(vmcs_write_cache::ldtr_access_rights, val); }
 
 //==============================================================================
 // General Registers
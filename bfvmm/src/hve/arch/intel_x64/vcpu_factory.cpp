@@ -30,6 +30,15 @@ WEAK_SYM std::unique_ptr<vcpu>
 vcpu_factory::make(vcpuid::type vcpuid, void *data)
 {
     bfignored(data);
+
+    // Host vCPUs only ever run on the physical CPU with the same id, so
+    // their structures (VMCS, stacks, bitmaps, EPT, etc...) are allocated
+    // from that CPU's node. Guest vCPUs use the node of the CPU that
+    // creates them.
+
+    auto node = vcpuid::is_host_vcpu(vcpuid) ? g_mm->cpu_node(vcpuid) : g_mm->node();
+    memory_manager::node_scope scope{node};
+
     return std::make_unique<intel_x64::vcpu>(vcpuid);
 }
 
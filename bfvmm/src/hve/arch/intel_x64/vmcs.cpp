@@ -57,10 +57,7 @@ vmcs::vmcs(
     m_vmcs_region{make_page<uint32_t>()},
     m_vmcs_region_phys{g_mm->virtptr_to_physint(m_vmcs_region.get())}
 {
-    this->clear();
-
-    gsl::span<uint32_t> id{m_vmcs_region.get(), 1024};
-    id[0] = gsl::narrow<uint32_t>(::intel_x64::msrs::ia32_vmx_basic::revision_id::get());
+    this->reset();
 
     bfdebug_transaction(1, [&](std::string * msg) {
         bfdebug_pass(1, "vmcs region", msg);
@@ -113,6 +110,17 @@ void
 vmcs::clear()
 { ::intel_x64::vm::clear(&m_vmcs_region_phys); }
 
+void
+vmcs::reset()
+{
+    this->clear();
+
+    gsl::span<uint32_t> region{m_vmcs_region.get(), 1024};
+    std::fill(region.begin(), region.end(), 0U);
+
+    region[0] = gsl::narrow<uint32_t>(::intel_x64::msrs::ia32_vmx_basic::revision_id::get());
+}
+
 bool
 vmcs::check() const noexcept
 {
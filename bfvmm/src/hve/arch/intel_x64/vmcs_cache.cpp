@@ -0,0 +1,144 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <bfgsl.h>
+#include <bfdebug.h>
+
+#include <hve/arch/intel_x64/vmcs_cache.h>
+
+#include <intrinsics.h>
+
+namespace bfvmm::intel_x64
+{
+
+namespace vmcs_n = ::intel_x64::vmcs;
+
+// The VMCS field encoding of each cached field, in index_t order.
+
+static const std::array<vmcs_write_cache::field_type, vmcs_write_cache::num_fields> s_fields = {
+    vmcs_n::guest_es_selector::addr,
+    vmcs_n::guest_es_base::addr,
+    vmcs_n::guest_es_limit::addr,
+    vmcs_n::guest_es_access_rights::addr,
+    vmcs_n::guest_cs_selector::addr,
+    vmcs_n::guest_cs_base::addr,
+    vmcs_n::guest_cs_limit::addr,
+    vmcs_n::guest_cs_access_rights::addr,
+    vmcs_n::guest_ss_selector::addr,
+    vmcs_n::guest_ss_base::addr,
+    vmcs_n::guest_ss_limit::addr,
+    vmcs_n::guest_ss_access_rights::addr,
+    vmcs_n::guest_ds_selector::addr,
+    vmcs_n::guest_ds_base::addr,
+    vmcs_n::guest_ds_limit::addr,
+    vmcs_n::guest_ds_access_rights::addr,
+    vmcs_n::guest_fs_selector::addr,
+    vmcs_n::guest_fs_base::addr,
+    vmcs_n::guest_fs_limit::addr,
+    vmcs_n::guest_fs_access_rights::addr,
+    vmcs_n::guest_gs_selector::addr,
+    vmcs_n::guest_gs_base::addr,
+    vmcs_n::guest_gs_limit::addr,
+    vmcs_n::guest_gs_access_rights::addr,
+    vmcs_n::guest_ldtr_selector::addr,
+    vmcs_n::guest_ldtr_base::addr,
+    vmcs_n::guest_ldtr_limit::addr,
+    vmcs_n::guest_ldtr_access_rights::addr,
+    vmcs_n::guest_tr_selector::addr,
+    vmcs_n::guest_tr_base::addr,
+    vmcs_n::guest_tr_limit::addr,
+    vmcs_n::guest_tr_access_rights::addr,
+    vmcs_n::guest_gdtr_base::addr,
+    vmcs_n::guest_gdtr_limit::addr,
+    vmcs_n::guest_idtr_base::addr,
+    vmcs_n::guest_idtr_limit::addr,
+    vmcs_n::guest_cr0::addr,
+    vmcs_n::cr0_read_shadow::addr,
+    vmcs_n::guest_cr3::addr,
+    vmcs_n::guest_cr4::addr,
+    vmcs_n::cr4_read_shadow::addr,
+    vmcs_n::guest_dr7::addr,
+    vmcs_n::guest_ia32_efer::addr,
+    vmcs_n::guest_ia32_pat::addr
+};
+
+vmcs_write_cache::value_type
+vmcs_write_cache::read(index_t index) const
+{
+    expects(index < num_fields);
+
+    if ((m_dirty & (1ULL << index)) != 0) {
+        return m_values.at(index);
+    }
+
+    return ::intel_x64::vm::read(s_fields.at(index));
+}
+
+void
+vmcs_write_cache::write(index_t index, value_type val)
+{
+    expects(index < num_fields);
+
+    m_values.at(index) = val;
+    m_dirty |= (1ULL << index);
+
+    m_stats.writes++;
+}
+
+void
+vmcs_write_cache::flush()
+{
+    if (m_dirty == 0) {
+        return;
+    }
+
+    m_stats.flushes++;
+
+    // Each field is marked clean once it has been written so that, if a
+    // VMWRITE fails and throws, a retry only writes what is still pending.
+
+    for (auto index = 0ULL; index < num_fields; index++) {
+        const auto bit = 1ULL << index;
+
+        if ((m_dirty & bit) == 0) {
+            continue;
+        }
+
+        ::intel_x64::vm::write(s_fields.at(index), m_values.at(index));
+
+        m_dirty &= ~bit;
+        m_stats.vmwrites++;
+
+        if (m_dirty == 0) {
+            break;
+        }
+    }
+}
+
+vmcs_write_cache::field_type
+vmcs_write_cache::field(index_t index)
+{
+    expects(index < num_fields);
+    return s_fields.at(index);
+}
+
+}
@@ -23,9 +23,11 @@ bits 64
 default rel
 
 %define IA32_XSS_MSR   0xDA0
+%define CR0_TS         0x8
 %define VMCS_GUEST_RSP 0x0000681C
 %define VMCS_GUEST_RIP 0x0000681E
 
+extern lazy_xsave_switch
 global vmcs_launch:function
 
 section .text
@@ -67,6 +69,18 @@ vmcs_launch:
     ; not been run on the save area, which means it has not been properly
     ; configured to be used with xrstors (not sure why Intel didn't include
     ; an init instruction for xsave, but this basically emulates it).
+    ;
+    ; If CR0.TS is set, we are being launched from another vCPU's exit
+    ; handler that has not switched its XSAVE state yet, so that vCPU's
+    ; state has to be saved before it is overwritten.
+
+    mov rax, cr0
+    test rax, CR0_TS
+    jz .restore_xsave
+
+    call lazy_xsave_switch wrt ..plt
+
+.restore_xsave:
 
     mov rsi, [rdi + 0x0C8]
     mov al, 0x80
@@ -86,26 +100,26 @@ vmcs_launch:
     xsetbv
 
     mov rsi, VMCS_GUEST_RSP
-    vmwrite rsi, [rdi + 0x080]
+    vmwrite rsi, [rdi + 0x020]
     mov rsi, VMCS_GUEST_RIP
-    vmwrite rsi, [rdi + 0x078]
-
-    mov r15, [rdi + 0x070]
-    mov r14, [rdi + 0x068]
-    mov r13, [rdi + 0x060]
-    mov r12, [rdi + 0x058]
-    mov r11, [rdi + 0x050]
-    mov r10, [rdi + 0x048]
-    mov r9,  [rdi + 0x040]
-    mov r8,  [rdi + 0x038]
-    mov rsi, [rdi + 0x028]
-    mov rbp, [rdi + 0x020]
-    mov rdx, [rdi + 0x018]
-    mov rcx, [rdi + 0x010]
-    mov rbx, [rdi + 0x008]
+    vmwrite rsi, [rdi + 0x080]
+
+    mov r15, [rdi + 0x078]
+    mov r14, [rdi + 0x070]
+    mov r13, [rdi + 0x068]
+    mov r12, [rdi + 0x060]
+    mov r11, [rdi + 0x058]
+    mov r10, [rdi + 0x050]
+    mov r9,  [rdi + 0x048]
+    mov r8,  [rdi + 0x040]
+    mov rsi, [rdi + 0x030]
+    mov rbp, [rdi + 0x028]
+    mov rbx, [rdi + 0x018]
+    mov rdx, [rdi + 0x010]
+    mov rcx, [rdi + 0x008]
     mov rax, [rdi + 0x000]
 
-    mov rdi, [rdi + 0x030]
+    mov rdi, [rdi + 0x038]
 
     vmlaunch
 
@@ -46,6 +46,8 @@ default rel
 %define IA32_GS_BASE_MSR                                          0xC0000101
 %define IA32_XSS_MSR                                              0x00000DA0
 
+%define CR0_TS                                                    0x00000008
+
 %define VMCS_GUEST_ES_SELECTOR                                    0x00000800
 %define VMCS_GUEST_CS_SELECTOR                                    0x00000802
 %define VMCS_GUEST_SS_SELECTOR                                    0x00000804
@@ -83,6 +85,7 @@ extern _write_cr3
 extern _write_cr4
 extern _write_dr7
 extern _cpuid_eax
+extern lazy_xsave_switch
 
 section .text
 
@@ -101,6 +104,47 @@ vmcs_promote:
 
     mov r15, rdi
 
+    ;
+    ; Restore XSAVE State
+    ;
+    ; This has to happen before the guest's CR0 is restored, as the guest
+    ; might have TS set, in which case xrstors would fault (#NM). If the
+    ; host's CR0.TS is still set, the lazy XSAVE switch is pending (see the
+    ; exit handler and resume logic), which means that when promoting the
+    ; vCPU that exited, the guest's state never left the CPU and there is
+    ; nothing to restore (the guest's save area is stale). When promoting
+    ; a different vCPU, the exiting vCPU's state has to be saved first.
+    ;
+
+    mov rax, cr0
+    test rax, CR0_TS
+    jz .restore_xsave
+
+    mov rax, [gs:0x098]
+    cmp rax, [rdi + 0x098]
+    je .skip_xsave
+
+    call lazy_xsave_switch wrt ..plt
+
+.restore_xsave:
+
+    mov rsi, [rdi + 0x0C8]
+    xor edx, edx
+    mov eax, 0xFFFFFFFF
+    xrstors64 [rsi]
+
+    mov eax, [rdi + 0x0B8]
+    xor edx, edx
+    mov ecx, IA32_XSS_MSR
+    wrmsr
+
+    mov eax, [rdi + 0x0A8]
+    xor edx, edx
+    xor ecx, ecx
+    xsetbv
+
+.skip_xsave:
+
     ;
     ; Restore Control Registers
     ;
@@ -295,43 +339,26 @@ vmcs_promote:
     mov rsi, [rdi + 0x0D8]
     mov cr2, rsi
 
-    ; See the exit handler and resume logic for comments.
-
-    mov rsi, [rdi + 0x0C8]
-    xor edx, edx
-    mov eax, 0xFFFFFFFF
-    xrstors64 [rsi]
-
-    mov eax, [rdi + 0x0B8]
-    xor edx, edx
-    mov ecx, IA32_XSS_MSR
-    wrmsr
-
-    mov eax, [rdi + 0x0A8]
-    xor edx, edx
-    xor ecx, ecx
-    xsetbv
-
-    mov rsp, [rdi + 0x080]
-    mov rax, [rdi + 0x078]
+    mov rsp, [rdi + 0x020]
+    mov rax, [rdi + 0x080]
     push rax
 
-    mov r15, [rdi + 0x070]
-    mov r14, [rdi + 0x068]
-    mov r13, [rdi + 0x060]
-    mov r12, [rdi + 0x058]
-    mov r11, [rdi + 0x050]
-    mov r10, [rdi + 0x048]
-    mov r9,  [rdi + 0x040]
-    mov r8,  [rdi + 0x038]
-    mov rsi, [rdi + 0x028]
-    mov rbp, [rdi + 0x020]
-    mov rdx, [rdi + 0x018]
-    mov rcx, [rdi + 0x010]
-    mov rbx, [rdi + 0x008]
+    mov r15, [rdi + 0x078]
+    mov r14, [rdi + 0x070]
+    mov r13, [rdi + 0x068]
+    mov r12, [rdi + 0x060]
+    mov r11, [rdi + 0x058]
+    mov r10, [rdi + 0x050]
+    mov r9,  [rdi + 0x048]
+    mov r8,  [rdi + 0x040]
+    mov rsi, [rdi + 0x030]
+    mov rbp, [rdi + 0x028]
+    mov rbx, [rdi + 0x018]
+    mov rdx, [rdi + 0x010]
+    mov rcx, [rdi + 0x008]
     mov rax, [rdi + 0x000]
 
-    mov rdi, [rdi + 0x030]
+    mov rdi, [rdi + 0x038]
 
     sti
     ret
@@ -23,9 +23,11 @@ bits 64
 default rel
 
 %define IA32_XSS_MSR   0xDA0
+%define CR0_TS         0x8
 %define VMCS_GUEST_RSP 0x0000681C
 %define VMCS_GUEST_RIP 0x0000681E
 
+extern lazy_xsave_switch
 global vmcs_resume:function
 
 section .text
@@ -71,6 +73,23 @@ vmcs_resume:
     ; restore the state, we then set the xcr0 and xss to the value the
     ; guest VM expects. Not that this scheme is repeated in the promote and
     ; launch logic.
+    ;
+    ; If CR0.TS is still set, the VMM did not use any XSAVE state during
+    ; this exit, so the guest's state never left the CPU. When resuming the
+    ; vCPU that exited, there is nothing to restore. When resuming a
+    ; different vCPU, the exiting vCPU's state has to be saved first.
+
+    mov rax, cr0
+    test rax, CR0_TS
+    jz .restore_xsave
+
+    mov rax, [gs:0x098]
+    cmp rax, [rdi + 0x098]
+    je .skip_xsave
+
+    call lazy_xsave_switch wrt ..plt
+
+.restore_xsave:
 
     mov rsi, [rdi + 0x0C8]
     xor edx, edx
@@ -87,27 +106,29 @@ vmcs_resume:
     xor ecx, ecx
     xsetbv
 
+.skip_xsave:
+
     mov rsi, VMCS_GUEST_RSP
-    vmwrite rsi, [rdi + 0x080]
+    vmwrite rsi, [rdi + 0x020]
     mov rsi, VMCS_GUEST_RIP
-    vmwrite rsi, [rdi + 0x078]
-
-    mov r15, [rdi + 0x070]
-    mov r14, [rdi + 0x068]
-    mov r13, [rdi + 0x060]
-    mov r12, [rdi + 0x058]
-    mov r11, [rdi + 0x050]
-    mov r10, [rdi + 0x048]
-    mov r9,  [rdi + 0x040]
-    mov r8,  [rdi + 0x038]
-    mov rsi, [rdi + 0x028]
-    mov rbp, [rdi + 0x020]
-    mov rdx, [rdi + 0x018]
-    mov rcx, [rdi + 0x010]
-    mov rbx, [rdi + 0x008]
+    vmwrite rsi, [rdi + 0x080]
+
+    mov r15, [rdi + 0x078]
+    mov r14, [rdi + 0x070]
+    mov r13, [rdi + 0x068]
+    mov r12, [rdi + 0x060]
+    mov r11, [rdi + 0x058]
+    mov r10, [rdi + 0x050]
+    mov r9,  [rdi + 0x048]
+    mov r8,  [rdi + 0x040]
+    mov rsi, [rdi + 0x030]
+    mov rbp, [rdi + 0x028]
+    mov rbx, [rdi + 0x018]
+    mov rdx, [rdi + 0x010]
+    mov rcx, [rdi + 0x008]
     mov rax, [rdi + 0x000]
 
-    mov rdi, [rdi + 0x030]
+    mov rdi, [rdi + 0x038]
 
     vmresume
 
@@ -0,0 +1,90 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <mutex>
+#include <shared_mutex>
+
+#include <hve/arch/intel_x64/vmcs_template.h>
+
+#include <intrinsics.h>
+
+namespace bfvmm::intel_x64
+{
+
+void
+vmcs_template::capture(std::initializer_list<field_type> fields)
+{
+    std::lock_guard<bfn::rwlock> guard(m_lock);
+
+    if (m_captured) {
+        return;
+    }
+
+    m_entries.clear();
+    m_entries.reserve(fields.size());
+
+    for (const auto &field : fields) {
+        value_type val{};
+
+        if (!_vmread(field, &val) || val == 0) {
+            continue;
+        }
+
+        m_entries.push_back({field, val});
+    }
+
+    m_captured = true;
+}
+
+bool
+vmcs_template::apply() const
+{
+    std::shared_lock<bfn::rwlock> guard(m_lock);
+
+    if (!m_captured) {
+        return false;
+    }
+
+    for (const auto &entry : m_entries) {
+        ::intel_x64::vm::write(entry.field, entry.val);
+    }
+
+    return true;
+}
+
+void
+vmcs_template::clear() noexcept
+{
+    std::lock_guard<bfn::rwlock> guard(m_lock);
+
+    m_entries.clear();
+    m_captured = false;
+}
+
+bool
+vmcs_template::captured() const noexcept
+{
+    std::shared_lock<bfn::rwlock> guard(m_lock);
+    return m_captured;
+}
+
+}
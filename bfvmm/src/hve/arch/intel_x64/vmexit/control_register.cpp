@@ -20,6 +20,7 @@
 // SOFTWARE.
 
 #include <hve/arch/intel_x64/vcpu.h>
+#include <hve/arch/intel_x64/decoder.h>
 
 namespace bfvmm::intel_x64
 {
@@ -31,147 +32,15 @@ namespace bfvmm::intel_x64
 void
 emulate_rdgpr(vcpu *vcpu)
 {
-    using namespace ::intel_x64::vmcs;
-    using namespace exit_qualification::control_register_access;
-
-    switch (general_purpose_register::get()) {
-        case general_purpose_register::rax:
-            vcpu->set_gr1(vcpu->rax());
-            return;
-
-        case general_purpose_register::rbx:
-            vcpu->set_gr1(vcpu->rbx());
-            return;
-
-        case general_purpose_register::rcx:
-            vcpu->set_gr1(vcpu->rcx());
-            return;
-
-        case general_purpose_register::rdx:
-            vcpu->set_gr1(vcpu->rdx());
-            return;
-
-        case general_purpose_register::rsp:
-            vcpu->set_gr1(vcpu->rsp());
-            return;
-
-        case general_purpose_register::rbp:
-            vcpu->set_gr1(vcpu->rbp());
-            return;
-
-        case general_purpose_register::rsi:
-            vcpu->set_gr1(vcpu->rsi());
-            return;
-
-        case general_purpose_register::rdi:
-            vcpu->set_gr1(vcpu->rdi());
-            return;
-
-        case general_purpose_register::r8:
-            vcpu->set_gr1(vcpu->r08());
-            return;
-
-        case general_purpose_register::r9:
-            vcpu->set_gr1(vcpu->r09());
-            return;
-
-        case general_purpose_register::r10:
-            vcpu->set_gr1(vcpu->r10());
-            return;
-
-        case general_purpose_register::r11:
-            vcpu->set_gr1(vcpu->r11());
-            return;
-
-        case general_purpose_register::r12:
-            vcpu->set_gr1(vcpu->r12());
-            return;
-
-        case general_purpose_register::r13:
-            vcpu->set_gr1(vcpu->r13());
-            return;
-
-        case general_purpose_register::r14:
-            vcpu->set_gr1(vcpu->r14());
-            return;
-
-        default:
-            vcpu->set_gr1(vcpu->r15());
-            return;
-    }
+    auto qualification = vmcs_n::exit_qualification::get();
+    vcpu->set_gr1(vcpu->gpr(decoder::cr_access_gpr(qualification)));
 }
 
 void
 emulate_wrgpr(vcpu *vcpu)
 {
-    using namespace ::intel_x64::vmcs;
-    using namespace exit_qualification::control_register_access;
-
-    switch (general_purpose_register::get()) {
-        case general_purpose_register::rax:
-            vcpu->set_rax(vcpu->gr1());
-            return;
-
-        case general_purpose_register::rbx:
-            vcpu->set_rbx(vcpu->gr1());
-            return;
-
-        case general_purpose_register::rcx:
-            vcpu->set_rcx(vcpu->gr1());
-            return;
-
-        case general_purpose_register::rdx:
-            vcpu->set_rdx(vcpu->gr1());
-            return;
-
-        case general_purpose_register::rsp:
-            vcpu->set_rsp(vcpu->gr1());
-            return;
-
-        case general_purpose_register::rbp:
-            vcpu->set_rbp(vcpu->gr1());
-            return;
-
-        case general_purpose_register::rsi:
-            vcpu->set_rsi(vcpu->gr1());
-            return;
-
-        case general_purpose_register::rdi:
-            vcpu->set_rdi(vcpu->gr1());
-            return;
-
-        case general_purpose_register::r8:
-            vcpu->set_r08(vcpu->gr1());
-            return;
-
-        case general_purpose_register::r9:
-            vcpu->set_r09(vcpu->gr1());
-            return;
-
-        case general_purpose_register::r10:
-            vcpu->set_r10(vcpu->gr1());
-            return;
-
-        case general_purpose_register::r11:
-            vcpu->set_r11(vcpu->gr1());
-            return;
-
-        case general_purpose_register::r12:
-            vcpu->set_r12(vcpu->gr1());
-            return;
-
-        case general_purpose_register::r13:
-            vcpu->set_r13(vcpu->gr1());
-            return;
-
-        case general_purpose_register::r14:
-            vcpu->set_r14(vcpu->gr1());
-            return;
-
-        default:
-            vcpu->set_r15(vcpu->gr1());
-            return;
-    }
+    auto qualification = vmcs_n::exit_qualification::get();
+    vcpu->set_gpr(decoder::cr_access_gpr(qualification), vcpu->gr1());
 }
 
 static void
@@ -182,20 +51,23 @@ emulate_ia_32e_mode_switch(vcpu *vcpu)
     using namespace vmcs_n::vm_entry_controls;
     using namespace vmcs_n::secondary_processor_based_vm_execution_controls;
 
-    if (unrestricted_guest::is_disabled() || lme::is_disabled()) {
+    auto efer = vcpu->ia32_efer();
+
+    if (unrestricted_guest::is_disabled() || lme::is_disabled(efer)) {
         return;
     }
 
     if (paging::is_enabled(vcpu->gr1())) {
-        lma::enable();
+        lma::enable(efer);
         ia_32e_mode_guest::enable();
-        vcpu->invept();
     }
     else {
-        lma::disable();
+        lma::disable(efer);
         ia_32e_mode_guest::disable();
-        vcpu->invept();
     }
+
+    vcpu->set_ia32_efer(efer);
+    vcpu->invept();
 }
 
 static bool
@@ -294,12 +166,16 @@ void
 control_register_handler::enable_wrcr0_exiting(
     vmcs_n::value_type mask)
 {
-    mask |= ::intel_x64::cr0::extension_type::mask;
-    mask |= ::intel_x64::cr0::not_write_through::mask;
-    mask |= ::intel_x64::cr0::cache_disable::mask;
+    m_wrcr0_mask |= mask;
+    this->write_cr0_guest_host_mask();
+}
 
-    mask |= m_vcpu->global_state()->ia32_vmx_cr0_fixed0;
-    vmcs_n::cr0_guest_host_mask::set(mask);
+void
+control_register_handler::set_wrcr0_mask(
+    vmcs_n::value_type mask)
+{
+    m_wrcr0_mask = mask;
+    this->write_cr0_guest_host_mask();
 }
 
 void
@@ -320,8 +196,59 @@ void
 control_register_handler::enable_wrcr4_exiting(
     vmcs_n::value_type mask)
 {
+    m_wrcr4_mask |= mask;
+    this->write_cr4_guest_host_mask();
+}
+
+void
+control_register_handler::set_wrcr4_mask(
+    vmcs_n::value_type mask)
+{
+    m_wrcr4_mask = mask;
+    this->write_cr4_guest_host_mask();
+}
+
+// Note:
+//
+// The guest reads the read shadow for every bit that is set in the
+// guest/host mask, and the guest's actual control register for every other
+// bit. Since writes to bits that are not in the mask do not exit, the read
+// shadow is only up to date for the bits that are in the mask. For this
+// reason, the guest's view of the control register is captured (using the
+// old mask) before the mask is changed, and written back to the read shadow
+// once the new mask is in place.
+
+void
+control_register_handler::write_cr0_guest_host_mask()
+{
+    auto mask = m_wrcr0_mask;
+
+    mask |= ::intel_x64::cr0::extension_type::mask;
+    mask |= ::intel_x64::cr0::not_write_through::mask;
+    mask |= ::intel_x64::cr0::cache_disable::mask;
+    mask |= m_vcpu->global_state()->ia32_vmx_cr0_fixed0;
+
+    // The read shadow is written directly, so any write to it that is
+    // still sitting in the vCPU's VMCS write cache has to land first.
+
+    m_vcpu->flush_vmcs_writes();
+
+    auto cr0 = m_vcpu->cr0();
+    vmcs_n::cr0_guest_host_mask::set(mask);
+    vmcs_n::cr0_read_shadow::set(cr0);
+}
+
+void
+control_register_handler::write_cr4_guest_host_mask()
+{
+    auto mask = m_wrcr4_mask;
     mask |= m_vcpu->global_state()->ia32_vmx_cr4_fixed0;
+
+    m_vcpu->flush_vmcs_writes();
+
+    auto cr4 = m_vcpu->cr4();
     vmcs_n::cr4_guest_host_mask::set(mask);
+    vmcs_n::cr4_read_shadow::set(cr4);
 }
 
 // -----------------------------------------------------------------------------
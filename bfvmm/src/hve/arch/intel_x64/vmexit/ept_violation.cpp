@@ -100,9 +100,8 @@ ept_violation_handler::handle(vcpu *vcpu)
         return handle_execute(vcpu, info);
     }
 
-    throw std::runtime_error(
-        "ept_violation_handler::handle: unhandled ept violation"
-    );
+    bferror_nhex(0, "unhandled ept violation", info.gpa);
+    return false;
 }
 
 bool
@@ -123,9 +122,8 @@ ept_violation_handler::handle_read(vcpu *vcpu, info_t &info)
         return m_default_read_handler(vcpu);
     }
 
-    throw std::runtime_error(
-        "ept_violation_handler: unhandled ept read violation"
-    );
+    bferror_nhex(0, "unhandled ept read violation", info.gpa);
+    return false;
 }
 
 bool
@@ -146,9 +144,8 @@ ept_violation_handler::handle_write(vcpu *vcpu, info_t &info)
         return m_default_write_handler(vcpu);
     }
 
-    throw std::runtime_error(
-        "ept_violation_handler: unhandled ept write violation"
-    );
+    bferror_nhex(0, "unhandled ept write violation", info.gpa);
+    return false;
 }
 
 bool
@@ -169,9 +166,8 @@ ept_violation_handler::handle_execute(vcpu *vcpu, info_t &info)
         return m_default_execute_handler(vcpu);
     }
 
-    throw std::runtime_error(
-        "ept_violation_handler: unhandled ept execute violation"
-    );
+    bferror_nhex(0, "unhandled ept execute violation", info.gpa);
+    return false;
 }
 
 }
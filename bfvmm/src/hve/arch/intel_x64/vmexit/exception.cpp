@@ -83,9 +83,8 @@ exception_handler::handle(vcpu *vcpu)
         }
     }
 
-    throw std::runtime_error(
-        "Unhandled exception vector: " + std::to_string(info.vector)
-    );
+    bferror_nhex(0, "unhandled exception vector", info.vector);
+    return false;
 }
 
 }
@@ -77,9 +77,8 @@ external_interrupt_handler::handle(vcpu *vcpu)
         }
     }
 
-    throw std::runtime_error(
-        "Unhandled interrupt vector: " + std::to_string(info.vector)
-    );
+    bferror_nhex(0, "unhandled interrupt vector", info.vector);
+    return false;
 }
 
 }
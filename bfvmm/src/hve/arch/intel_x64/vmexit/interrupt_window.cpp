@@ -27,7 +27,9 @@ namespace bfvmm::intel_x64
 interrupt_window_handler::interrupt_window_handler(
     gsl::not_null<vcpu *> vcpu
 ) :
-    m_vcpu{vcpu}
+    m_vcpu{vcpu},
+    m_virtual_apic_page{make_nullptr_page<uint32_t>()},
+    m_pi_desc{make_nullptr_page<posted_interrupt_descriptor>()}
 {
     using namespace vmcs_n;
 
@@ -44,6 +46,17 @@ interrupt_window_handler::interrupt_window_handler(
 void
 interrupt_window_handler::queue_external_interrupt(uint64_t vector)
 {
+    // When virtual interrupt delivery is enabled, the vector is written
+    // directly to the VIRR, and the hardware delivers it as soon as the
+    // guest is able to take it, without the need for an interrupt window.
+
+    if (m_virtual_apic_page) {
+        m_pi_desc->post(vector);
+        this->sync_posted_interrupts();
+
+        return;
+    }
+
     // Note:
     //
     // There are two ways to handle injection. Currently, we inject using an
@@ -125,6 +138,104 @@ interrupt_window_handler::inject_external_interrupt(uint64_t vector)
     info_n::set(info);
 }
 
+void
+interrupt_window_handler::enable_virtual_interrupt_delivery()
+{
+    using namespace vmcs_n;
+    expects(pin_based_vm_execution_controls::external_interrupt_exiting::is_enabled());
+
+    if (m_virtual_apic_page) {
+        return;
+    }
+
+    m_virtual_apic_page = make_page<uint32_t>();
+    m_pi_desc = make_page<posted_interrupt_descriptor>();
+
+    virtual_apic_address::set(g_mm->virtptr_to_physint(m_virtual_apic_page.get()));
+    tpr_threshold::set(0);
+
+    eoi_exit_bitmap_0::set(0);
+    eoi_exit_bitmap_1::set(0);
+    eoi_exit_bitmap_2::set(0);
+    eoi_exit_bitmap_3::set(0);
+    guest_interrupt_status::set(0);
+
+    primary_processor_based_vm_execution_controls::use_tpr_shadow::enable();
+    secondary_processor_based_vm_execution_controls::virtualize_x2apic_mode::enable();
+    secondary_processor_based_vm_execution_controls::virtual_interrupt_delivery::enable();
+
+    // Anything that was still waiting on an interrupt window is moved to
+    // the VIRR so that nothing is lost during the switch.
+
+    while (!m_interrupt_queue.empty()) {
+        m_pi_desc->post(m_interrupt_queue.pop());
+    }
+
+    this->disable_exiting();
+    this->sync_posted_interrupts();
+
+    m_vcpu->add_exit_handler({&interrupt_window_handler::handle_posted, this});
+}
+
+void
+interrupt_window_handler::enable_posted_interrupts(uint64_t notification_vector)
+{
+    using namespace vmcs_n;
+    expects(m_virtual_apic_page);
+
+    if (!pin_based_vm_execution_controls::process_posted_interrupts::is_allowed1()) {
+        return;
+    }
+
+    m_pi_desc->set_notification_vector(notification_vector);
+    m_pi_desc->set_notification_destination(
+        gsl::narrow_cast<uint32_t>(::intel_x64::msrs::ia32_x2apic_apicid::get())
+    );
+
+    posted_interrupt_notification_vector::set(notification_vector);
+    posted_interrupt_descriptor_address::set(g_mm->virtptr_to_physint(m_pi_desc.get()));
+
+    pin_based_vm_execution_controls::process_posted_interrupts::enable();
+
+    // If the notification vector arrives while the guest is not running
+    // (or while the vCPU is exiting), it is taken as a normal external
+    // interrupt exit, in which case the posts have to be synced by hand.
+
+    if (!m_posted_interrupts_enabled) {
+        m_vcpu->add_external_interrupt_handler(
+            {&interrupt_window_handler::handle_notification, this}
+        );
+    }
+
+    m_notification_vector = notification_vector;
+    m_posted_interrupts_enabled = true;
+}
+
+bool
+interrupt_window_handler::post_external_interrupt(uint64_t vector)
+{
+    expects(m_pi_desc);
+
+    // Without posted-interrupt processing, there is nothing listening for
+    // the notification vector, and the post is picked up on the next VM
+    // exit instead.
+
+    auto notify = m_pi_desc->post(vector);
+    return m_posted_interrupts_enabled && notify;
+}
+
+void
+interrupt_window_handler::reset()
+{
+    expects(!m_virtual_apic_page);
+
+    while (!m_interrupt_queue.empty()) {
+        m_interrupt_queue.pop();
+    }
+
+    m_enabled = false;
+}
+
 // -----------------------------------------------------------------------------
 // Handlers
 // -----------------------------------------------------------------------------
@@ -142,10 +253,58 @@ interrupt_window_handler::handle(vcpu *vcpu)
     return true;
 }
 
+bool
+interrupt_window_handler::handle_notification(
+    vcpu *vcpu, external_interrupt_handler::info_t &info)
+{
+    bfignored(vcpu);
+
+    if (info.vector != m_notification_vector) {
+        return false;
+    }
+
+    if (m_pi_desc->pending()) {
+        this->sync_posted_interrupts();
+    }
+
+    ::intel_x64::msrs::ia32_x2apic_eoi::set(0);
+    return true;
+}
+
+bool
+interrupt_window_handler::handle_posted(vcpu *vcpu)
+{
+    bfignored(vcpu);
+
+    if (m_pi_desc->pending()) {
+        this->sync_posted_interrupts();
+    }
+
+    return false;
+}
+
 // -----------------------------------------------------------------------------
 // Private
 // -----------------------------------------------------------------------------
 
+void
+interrupt_window_handler::sync_posted_interrupts()
+{
+    namespace status_n = vmcs_n::guest_interrupt_status;
+
+    auto vector = m_pi_desc->sync(
+        gsl::make_span(m_virtual_apic_page.get(), BAREFLANK_PAGE_SIZE / sizeof(uint32_t))
+    );
+
+    // The RVI (bits 7:0 of the guest interrupt status) must always contain
+    // the highest vector in the VIRR, otherwise the hardware will not
+    // evaluate the new vector on the next VM entry.
+
+    if (auto status = status_n::get(); vector > (status & 0xFFU)) {
+        status_n::set((status & 0xFF00U) | vector);
+    }
+}
+
 void
 interrupt_window_handler::enable_exiting()
 {
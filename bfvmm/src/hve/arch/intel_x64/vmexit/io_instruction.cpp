@@ -27,17 +27,29 @@
 //     saying the lvalue (d) can't bind to the rvalue.
 //
 
+#include <cstring>
 #include <hve/arch/intel_x64/vcpu.h>
 
 namespace bfvmm::intel_x64
 {
 
+// The maximum number of bytes a single string instruction exit will
+// transfer. Larger transfers are split across multiple exits by leaving the
+// guest's instruction pointer on the rep prefixed instruction, which limits
+// how much of the guest's memory is mapped into the VMM at once. This is
+// large enough for a 64k element rep insd to be handled in a single exit.
+//
+constexpr const auto max_string_bytes = 0x40000ULL;
+
 io_instruction_handler::io_instruction_handler(
     gsl::not_null<vcpu *> vcpu
 ) :
     m_vcpu{vcpu},
     m_io_bitmap_a{vcpu->io_bitmap_a(), ::x64::pt::page_size},
-    m_io_bitmap_b{vcpu->io_bitmap_b(), ::x64::pt::page_size}
+    m_io_bitmap_b{vcpu->io_bitmap_b(), ::x64::pt::page_size},
+    m_address_size_reported{
+        ::intel_x64::msrs::ia32_vmx_basic::ins_outs_exit_information::is_enabled()
+    }
 {
     using namespace vmcs_n;
 
@@ -61,6 +73,16 @@ io_instruction_handler::add_handler(
     m_out_handlers[port].push_front(std::move(out_d));
 }
 
+void
+io_instruction_handler::add_string_handler(
+    vmcs_n::value_type port,
+    const string_handler_delegate_t &in_d,
+    const string_handler_delegate_t &out_d)
+{
+    m_string_in_handlers[port].push_front(std::move(in_d));
+    m_string_out_handlers[port].push_front(std::move(out_d));
+}
+
 void
 io_instruction_handler::emulate(vmcs_n::value_type port)
 { m_emulate[port] = true; }
@@ -130,11 +152,6 @@ io_instruction_handler::handle(vcpu *vcpu)
     namespace io_instruction = vmcs_n::exit_qualification::io_instruction;
     auto eq = io_instruction::get();
 
-    auto reps = 1ULL;
-    if (io_instruction::rep_prefixed::is_enabled(eq)) {
-        reps = vcpu->rcx() & 0x00000000FFFFFFFFULL;
-    }
-
     struct info_t info = {
         0ULL,
         io_instruction::size_of_access::get(eq),
@@ -155,21 +172,27 @@ io_instruction_handler::handle(vcpu *vcpu)
     }
 
     if (io_instruction::string_instruction::is_enabled(eq)) {
+        auto mask = this->string_address_mask(vcpu);
+
+        auto reps = 1ULL;
+        if (io_instruction::rep_prefixed::is_enabled(eq)) {
+            reps = vcpu->rcx() & mask;
+        }
+
         info.address = vmcs_n::guest_linear_address::get();
-    }
 
-    for (auto i = 0ULL; i < reps; i++) {
-        switch (io_instruction::direction_of_access::get(eq)) {
-            case io_instruction::direction_of_access::in:
-                handle_in(vcpu, info);
-                break;
+        handle_string(vcpu, info, reps, mask);
+        return true;
+    }
 
-            default:
-                handle_out(vcpu, info);
-                break;
-        }
+    switch (io_instruction::direction_of_access::get(eq)) {
+        case io_instruction::direction_of_access::in:
+            handle_in(vcpu, info);
+            break;
 
-        info.address += info.size_of_access + 1ULL;
+        default:
+            handle_out(vcpu, info);
+            break;
     }
 
     return true;
@@ -244,6 +267,298 @@ io_instruction_handler::handle_out(vcpu *vcpu, info_t &info)
     return false;
 }
 
+uint64_t
+io_instruction_handler::string_address_mask(vcpu *vcpu)
+{
+    // If the CPU reports the address size of ins / outs exits, it includes
+    // any address size prefix. Otherwise, the default address size of the
+    // guest's code segment is used.
+
+    if (m_address_size_reported) {
+        namespace ins = vmcs_n::vm_exit_instruction_information::ins;
+
+        switch (ins::address_size::get()) {
+            case ins::address_size::_16bit:
+                return 0x000000000000FFFFULL;
+
+            case ins::address_size::_32bit:
+                return 0x00000000FFFFFFFFULL;
+
+            default:
+                return 0xFFFFFFFFFFFFFFFFULL;
+        }
+    }
+
+    auto cs_access_rights = vcpu->cs_access_rights();
+
+    if (vmcs_n::guest_cs_access_rights::l::is_enabled(cs_access_rights)) {
+        return 0xFFFFFFFFFFFFFFFFULL;
+    }
+
+    if (vmcs_n::guest_cs_access_rights::db::is_enabled(cs_access_rights)) {
+        return 0x00000000FFFFFFFFULL;
+    }
+
+    return 0x000000000000FFFFULL;
+}
+
+// String instructions use rcx, rsi and rdi as 16, 32 or 64bit registers
+// depending on their address size. A write to a 32bit register clears the
+// upper 32 bits, while a write to a 16bit register leaves the upper bits
+// alone.
+//
+uint64_t
+io_instruction_handler::string_register_add(
+    uint64_t reg, uint64_t val, uint64_t mask) noexcept
+{
+    if (mask == 0x000000000000FFFFULL) {
+        return (reg & ~mask) | ((reg + val) & mask);
+    }
+
+    return (reg + val) & mask;
+}
+
+bool
+io_instruction_handler::handle_string(
+    vcpu *vcpu, info_t &info, uint64_t reps, uint64_t mask)
+{
+    namespace io_instruction = vmcs_n::exit_qualification::io_instruction;
+    auto eq = io_instruction::get();
+
+    if (reps == 0) {
+        return vcpu->advance();
+    }
+
+    auto in = io_instruction::direction_of_access::get(eq) ==
+              io_instruction::direction_of_access::in;
+
+    // If no handler is registered for the port, the guest's buffer is not
+    // needed, so the default handler is called before any of it is mapped.
+
+    if (!this->has_string_handlers(info.port_number, in)) {
+        return this->handle_string_default(vcpu, info);
+    }
+
+    // Note:
+    //
+    // When the direction flag is set, the guest walks its buffer backwards.
+    // Instead of reversing the buffer, we handle one element per exit in
+    // this case, which is rare enough that the extra exits do not matter.
+    //
+
+    auto size = info.size_of_access + 1ULL;
+    auto backwards = vmcs_n::guest_rflags::direction_flag::is_enabled();
+
+    auto count = backwards ? 1ULL : std::min<uint64_t>(reps, max_string_bytes / size);
+    auto map = m_vcpu->map_gva_4k<uint8_t>(info.address, count * size);
+
+    struct string_info_t sinfo = {
+        info.port_number,
+        info.size_of_access,
+        info.address,
+        count,
+        gsl::span<uint8_t>(map.get(), gsl::narrow_cast<std::ptrdiff_t>(count * size)),
+        false,
+        false
+    };
+
+    // Note:
+    //
+    // If a handler does not accept an element, sinfo.count is set to the
+    // number of elements that were handled before it. Those elements are
+    // completed, and the guest is not advanced, so it exits again on the
+    // element that was not accepted, which is then given to the default
+    // handler, just like a single access that no handler accepts.
+    //
+
+    auto handled = in ? handle_string_in(vcpu, sinfo) : handle_string_out(vcpu, sinfo);
+    if (!handled || sinfo.count == 0) {
+        return this->handle_string_default(vcpu, info);
+    }
+
+    if (sinfo.ignore_advance) {
+        return true;
+    }
+
+    count = sinfo.count;
+
+    auto bytes = backwards ? 0ULL - size : count * size;
+
+    if (in) {
+        vcpu->set_rdi(string_register_add(vcpu->rdi(), bytes, mask));
+    }
+    else {
+        vcpu->set_rsi(string_register_add(vcpu->rsi(), bytes, mask));
+    }
+
+    if (io_instruction::rep_prefixed::is_enabled(eq)) {
+        vcpu->set_rcx(string_register_add(vcpu->rcx(), 0ULL - count, mask));
+    }
+
+    if (count == reps) {
+        return vcpu->advance();
+    }
+
+    return true;
+}
+
+bool
+io_instruction_handler::has_string_handlers(
+    vmcs_n::value_type port, bool in) const
+{
+    if (in) {
+        return m_string_in_handlers.count(port) != 0 || m_in_handlers.count(port) != 0;
+    }
+
+    return m_string_out_handlers.count(port) != 0 || m_out_handlers.count(port) != 0;
+}
+
+bool
+io_instruction_handler::handle_string_default(vcpu *vcpu, info_t &info)
+{
+    if (m_default_handler) {
+        bfdebug_nhex(0, "handle_string", info.port_number);
+        return m_default_handler(vcpu);
+    }
+
+    return false;
+}
+
+bool
+io_instruction_handler::handle_string_in(vcpu *vcpu, string_info_t &info)
+{
+    auto emulate = m_emulate[info.port_number];
+
+    // Note:
+    //
+    // The string handlers are called before the port is read, so that the
+    // port is never read if a handler provides the data itself. If none of
+    // them handle the access, the port is read once, using a single rep
+    // ins, and the per-element handlers are given the result.
+    //
+
+    const auto &shdlrs =
+        m_string_in_handlers.find(info.port_number);
+
+    if (shdlrs != m_string_in_handlers.end()) {
+        for (const auto &d : shdlrs->second) {
+            if (d(vcpu, info)) {
+                return true;
+            }
+        }
+    }
+
+    const auto &hdlrs =
+        m_in_handlers.find(info.port_number);
+
+    if (hdlrs == m_in_handlers.end()) {
+        return false;
+    }
+
+    if (!emulate) {
+        emulate_string_in(info);
+    }
+
+    auto size = info.size_of_access + 1ULL;
+
+    for (auto i = 0ULL; i < info.count; i++) {
+        struct info_t einfo = {
+            info.port_number,
+            info.size_of_access,
+            info.address + (i * size),
+            0ULL,
+            false,
+            true
+        };
+
+        auto element = info.buf.subspan(gsl::narrow_cast<std::ptrdiff_t>(i * size));
+        std::memcpy(&einfo.val, element.data(), size);
+
+        auto handled = false;
+        for (const auto &d : hdlrs->second) {
+            if (d(vcpu, einfo)) {
+                handled = true;
+                break;
+            }
+        }
+
+        if (!handled) {
+            info.count = i;
+            return true;
+        }
+
+        if (!einfo.ignore_write) {
+            std::memcpy(element.data(), &einfo.val, size);
+        }
+    }
+
+    return true;
+}
+
+bool
+io_instruction_handler::handle_string_out(vcpu *vcpu, string_info_t &info)
+{
+    auto emulate = m_emulate[info.port_number];
+
+    const auto &shdlrs =
+        m_string_out_handlers.find(info.port_number);
+
+    if (shdlrs != m_string_out_handlers.end()) {
+        for (const auto &d : shdlrs->second) {
+            if (d(vcpu, info)) {
+
+                if (!info.ignore_write && !emulate) {
+                    emulate_string_out(info);
+                }
+
+                return true;
+            }
+        }
+    }
+
+    const auto &hdlrs =
+        m_out_handlers.find(info.port_number);
+
+    if (hdlrs == m_out_handlers.end()) {
+        return false;
+    }
+
+    auto size = info.size_of_access + 1ULL;
+
+    for (auto i = 0ULL; i < info.count; i++) {
+        struct info_t einfo = {
+            info.port_number,
+            info.size_of_access,
+            info.address + (i * size),
+            0ULL,
+            false,
+            true
+        };
+
+        auto element = info.buf.subspan(gsl::narrow_cast<std::ptrdiff_t>(i * size));
+        std::memcpy(&einfo.val, element.data(), size);
+
+        auto handled = false;
+        for (const auto &d : hdlrs->second) {
+            if (d(vcpu, einfo)) {
+                handled = true;
+                break;
+            }
+        }
+
+        if (!handled) {
+            info.count = i;
+            return true;
+        }
+
+        if (!einfo.ignore_write && !emulate) {
+            emulate_out(einfo);
+        }
+    }
+
+    return true;
+}
+
 void
 io_instruction_handler::emulate_in(info_t &info)
 {
@@ -293,6 +608,52 @@ io_instruction_handler::emulate_out(info_t &info)
     }
 }
 
+void
+io_instruction_handler::emulate_string_in(string_info_t &info)
+{
+    namespace io_instruction = vmcs_n::exit_qualification::io_instruction;
+
+    auto port = gsl::narrow_cast<uint16_t>(info.port_number);
+    auto count = gsl::narrow_cast<uint32_t>(info.count);
+
+    switch (info.size_of_access) {
+        case io_instruction::size_of_access::one_byte:
+            ::x64::portio::insbrep(port, info.buf.data(), count);
+            break;
+
+        case io_instruction::size_of_access::two_byte:
+            ::x64::portio::inswrep(port, info.buf.data(), count);
+            break;
+
+        default:
+            ::x64::portio::insdrep(port, info.buf.data(), count);
+            break;
+    }
+}
+
+void
+io_instruction_handler::emulate_string_out(string_info_t &info)
+{
+    namespace io_instruction = vmcs_n::exit_qualification::io_instruction;
+
+    auto port = gsl::narrow_cast<uint16_t>(info.port_number);
+    auto count = gsl::narrow_cast<uint32_t>(info.count);
+
+    switch (info.size_of_access) {
+        case io_instruction::size_of_access::one_byte:
+            ::x64::portio::outsbrep(port, info.buf.data(), count);
+            break;
+
+        case io_instruction::size_of_access::two_byte:
+            ::x64::portio::outswrep(port, info.buf.data(), count);
+            break;
+
+        default:
+            ::x64::portio::outsdrep(port, info.buf.data(), count);
+            break;
+    }
+}
+
 void
 io_instruction_handler::load_operand(
     vcpu *vcpu, info_t &info)
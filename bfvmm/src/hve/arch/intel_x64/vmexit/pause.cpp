@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <hve/arch/intel_x64/vcpu.h>
+
+namespace bfvmm::intel_x64
+{
+
+pause_handler::pause_handler(
+    gsl::not_null<vcpu *> vcpu
+) :
+    m_vcpu{vcpu}
+{
+    using namespace vmcs_n;
+
+    vcpu->add_exit_handler_for_reason(
+        exit_reason::basic_exit_reason::pause,
+    {&pause_handler::handle, this}
+    );
+}
+
+// -----------------------------------------------------------------------------
+// Add Handler / Enablers
+// -----------------------------------------------------------------------------
+
+void
+pause_handler::add_handler(const handler_delegate_t &d)
+{ m_handlers.push_front(d); }
+
+void
+pause_handler::remove_handler(const handler_delegate_t &d)
+{ m_handlers.remove(d); }
+
+void
+pause_handler::enable_exiting()
+{
+    using namespace vmcs_n::secondary_processor_based_vm_execution_controls;
+    pause_loop_exiting::enable_if_allowed();
+}
+
+void
+pause_handler::disable_exiting()
+{
+    using namespace vmcs_n::secondary_processor_based_vm_execution_controls;
+    pause_loop_exiting::disable_if_allowed();
+}
+
+void
+pause_handler::set_window(value_t gap, value_t window)
+{
+    vmcs_n::ple_gap::set(gap);
+    vmcs_n::ple_window::set(window);
+
+    m_window = window;
+}
+
+// -----------------------------------------------------------------------------
+// Handlers
+// -----------------------------------------------------------------------------
+
+bool
+pause_handler::handle(vcpu *vcpu)
+{
+    m_stats.exits++;
+    m_stats.spin_ticks += m_window;
+
+    // A handler that yields the physical core never returns, so the yield
+    // is counted before the handler is called, and taken back once the
+    // handler returns. A handler that returns true acted on the exit
+    // without yielding (e.g., it boosted the lock holder).
+
+    for (const auto &d : m_handlers) {
+        m_stats.yields++;
+        auto handled = d(vcpu);
+        m_stats.yields--;
+
+        if (handled) {
+            m_stats.boosts++;
+            return true;
+        }
+    }
+
+    // The PAUSE instruction is only a hint, so if nothing is done about
+    // the spinning vCPU, the guest is simply resumed.
+
+    return vcpu->advance();
+}
+
+}
@@ -45,6 +45,10 @@ void
 preemption_timer_handler::add_handler(const handler_delegate_t &d)
 { m_handlers.push_front(d); }
 
+void
+preemption_timer_handler::remove_handler(const handler_delegate_t &d)
+{ m_handlers.remove(d); }
+
 void
 preemption_timer_handler::enable_exiting()
 {
@@ -80,9 +84,8 @@ preemption_timer_handler::handle(vcpu *vcpu)
         }
     }
 
-    throw std::runtime_error(
-        "preemption_timer_handler::handle: unhandled vmx-preemption timer exit"
-    );
+    bferror_info(0, "unhandled vmx-preemption timer exit");
+    return false;
 }
 
 }
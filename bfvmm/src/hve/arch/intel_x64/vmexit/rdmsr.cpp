@@ -145,6 +145,11 @@ rdmsr_handler::pass_through_all_accesses()
 bool
 rdmsr_handler::handle(vcpu *vcpu)
 {
+    // emulate_rdmsr() accesses the guest's EFER, PAT, FS base and GS base
+    // through the VMCS directly, so they cannot be left in the write cache.
+
+    vcpu->flush_vmcs_writes();
+
     auto user_already_emulating = m_emulate[vcpu->rcx()];
 
     struct info_t info = {
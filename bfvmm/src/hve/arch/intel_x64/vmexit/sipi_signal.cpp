@@ -90,6 +90,12 @@ sipi_signal_handler::handle(vcpu *vcpu)
     //   at some point, we should fill in the proper value
     //
 
+    // The reset state below is written to the VMCS directly, so anything
+    // still in the vCPU's write cache must land first, or it would be
+    // written on top of the reset state when the vCPU is resumed.
+
+    vcpu->flush_vmcs_writes();
+
     vmcs_n::guest_rflags::set(0x00000002);
     vcpu->set_rip(0x0000FFF0);
 
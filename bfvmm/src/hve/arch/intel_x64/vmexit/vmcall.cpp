@@ -0,0 +1,177 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <hve/arch/intel_x64/vcpu.h>
+
+namespace bfvmm::intel_x64
+{
+
+vmcall_handler::vmcall_handler(
+    gsl::not_null<vcpu *> vcpu
+) :
+    m_vcpu{vcpu}
+{
+    using namespace vmcs_n;
+
+    vcpu->add_result_handler_for_reason(
+        exit_reason::basic_exit_reason::vmcall,
+    {&vmcall_handler::handle, this}
+    );
+}
+
+// -----------------------------------------------------------------------------
+// Add Handler / Enablers
+// -----------------------------------------------------------------------------
+
+void
+vmcall_handler::add_handler(const handler_delegate_t &d)
+{ m_handlers.push_front(d); }
+
+void
+vmcall_handler::enable_polling()
+{
+    if (m_polling) {
+        return;
+    }
+
+    m_vcpu->add_exit_handler({&vmcall_handler::poll, this});
+    m_polling = true;
+}
+
+uint64_t
+vmcall_handler::drain()
+{
+    if (!m_ring) {
+        return 0;
+    }
+
+    auto num = bfn::hypercall_ring_consume(m_ring.get(), [&](auto & entry) {
+        this->complete(entry);
+    });
+
+    m_stats.hypercalls += num;
+    return num;
+}
+
+// -----------------------------------------------------------------------------
+// Handlers
+// -----------------------------------------------------------------------------
+
+exit_result_t
+vmcall_handler::handle(vcpu *vcpu)
+{
+    // This is a result handler, so it is not allowed to throw. Anything that
+    // can is guarded, and the resulting status is returned to userspace in
+    // rax, the same way a vmcall returns its result.
+
+    status_t ret = SUCCESS;
+
+    switch (vcpu->rax()) {
+        case HYPERCALL_RING_REGISTER:
+            ret = guard_exceptions(BF_ERROR_INVALID_ARG, [&] {
+                this->register_ring(vcpu->rbx());
+            });
+            break;
+
+        case HYPERCALL_RING_UNREGISTER:
+            ret = guard_exceptions(BF_ERROR_INVALID_ARG, [&] {
+                m_ring.reset();
+            });
+            break;
+
+        case HYPERCALL_RING_DOORBELL:
+            m_stats.doorbells++;
+            ret = guard_exceptions(BF_ERROR_INVALID_ARG, [&] {
+                if (!m_ring) {
+                    throw std::runtime_error("hypercall ring: doorbell without a ring");
+                }
+
+                this->drain();
+            });
+            break;
+
+        default:
+            return false;
+    }
+
+    vcpu->set_rax(static_cast<uint64_t>(ret));
+
+    if (guard_exceptions(VMEXIT_ERROR_INVALID_STATE, [&] { vcpu->advance(); }) != SUCCESS) {
+        return bfn::unexpected(VMEXIT_ERROR_INVALID_STATE);
+    }
+
+    return true;
+}
+
+bool
+vmcall_handler::poll(vcpu *vcpu)
+{
+    bfignored(vcpu);
+
+    if (this->drain() != 0) {
+        m_stats.polls++;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Private
+// -----------------------------------------------------------------------------
+
+void
+vmcall_handler::register_ring(uintptr_t gva)
+{
+    if (gva == 0) {
+        throw std::invalid_argument("hypercall ring: gva == 0");
+    }
+
+    auto ring = m_vcpu->map_gva_4k<bfn::hypercall_ring_t>(gva, 1);
+    if (ring->magic != HYPERCALL_RING_MAGIC) {
+        throw std::runtime_error("hypercall ring: invalid magic");
+    }
+
+    m_ring = std::move(ring);
+}
+
+void
+vmcall_handler::complete(bfn::hypercall_ring_entry_t &entry)
+{
+    // The entry lives in memory that userspace can write to at any time, so
+    // the handlers are given a copy, and only the result is written back.
+
+    auto copy = entry;
+    auto handled = false;
+
+    guard_exceptions([&] {
+        for (const auto &d : m_handlers) {
+            if (d(m_vcpu, copy)) {
+                handled = true;
+                return;
+            }
+        }
+    });
+
+    entry.reg1 = handled ? copy.reg1 : HYPERCALL_RING_UNHANDLED;
+}
+
+}
@@ -155,6 +155,11 @@ wrmsr_handler::pass_through_all_accesses()
 bool
 wrmsr_handler::handle(vcpu *vcpu)
 {
+    // emulate_wrmsr() accesses the guest's EFER, PAT, FS base and GS base
+    // through the VMCS directly, so they cannot be left in the write cache.
+
+    vcpu->flush_vmcs_writes();
+
     auto user_already_emulating = m_emulate[vcpu->rcx()];
 
     struct info_t info = {
@@ -19,30 +19,123 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+
+#include <bfconstants.h>
+#include <bfthreadcontext.h>
+
 #include <hve/arch/intel_x64/vcpu.h>
 
 namespace bfvmm::intel_x64
 {
 
-vpid_handler::vpid_handler(
-    gsl::not_null<vcpu *> vcpu)
+// -----------------------------------------------------------------------------
+// VPID Allocator
+// -----------------------------------------------------------------------------
+
+bool
+vpid_allocator::acquire(id_type &id, generation_type &gen) noexcept
 {
-    bfignored(vcpu);
+    if (this->is_valid(id, gen)) {
+        return false;
+    }
 
-    static uint16_t s_id = 1;
-    m_id = s_id++;
+    auto rollover = false;
+
+    if (m_next > max_id) {
+        m_generation++;
+        m_next = 1;
+
+        m_stats.rollovers++;
+        rollover = true;
+    }
+
+    id = static_cast<id_type>(m_next++);
+    gen = m_generation;
+
+    m_stats.allocations++;
+    return rollover;
 }
 
+vpid_allocator &
+vpid_allocator::instance(uint64_t pcpuid)
+{
+    static std::array<vpid_allocator, MAX_NUM_PCPUS> s_allocators{};
+    return s_allocators.at(pcpuid);
+}
+
+// -----------------------------------------------------------------------------
+// VPID Handler
+// -----------------------------------------------------------------------------
+
+static void
+flush_all_vpids()
+{
+    using namespace ::intel_x64::msrs::ia32_vmx_ept_vpid_cap;
+
+    if (invvpid_all_context_support::is_enabled()) {
+        ::intel_x64::vmx::invvpid_all_contexts();
+        return;
+    }
+
+    for (auto id = 1ULL; id <= vpid_allocator::max_id; id++) {
+        ::intel_x64::vmx::invvpid_single_context(id);
+    }
+}
+
+vpid_handler::vpid_handler(
+    gsl::not_null<vcpu *> vcpu)
+{ bfignored(vcpu); }
+
 void vpid_handler::enable()
 {
-    vmcs_n::virtual_processor_identifier::set(m_id);
+    m_enabled = true;
+    this->refresh();
+
     vmcs_n::secondary_processor_based_vm_execution_controls::enable_vpid::enable();
 }
 
 void vpid_handler::disable()
 {
+    m_enabled = false;
+
     vmcs_n::virtual_processor_identifier::set(0);
     vmcs_n::secondary_processor_based_vm_execution_controls::enable_vpid::disable();
 }
 
+void vpid_handler::reset() noexcept
+{
+    m_enabled = false;
+
+    m_id = 0;
+    m_generation = 0;
+}
+
+void vpid_handler::refresh()
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    auto pcpuid = thread_context_cpuid();
+    auto &allocator = vpid_allocator::instance(pcpuid);
+
+    if (GSL_LIKELY(pcpuid == m_pcpuid && allocator.is_valid(m_id, m_generation))) {
+        return;
+    }
+
+    // A VPID is only meaningful on the core it was acquired on, so if the
+    // vCPU moved, the one it holds is dropped and a new one is acquired.
+
+    if (pcpuid != m_pcpuid) {
+        m_id = 0;
+        m_pcpuid = pcpuid;
+    }
+
+    if (allocator.acquire(m_id, m_generation)) {
+        flush_all_vpids();
+    }
+
+    vmcs_n::virtual_processor_identifier::set(m_id);
+}
+
 }
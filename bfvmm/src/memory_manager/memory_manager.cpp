@@ -35,9 +35,11 @@
 //
 
 #include <bfgsl.h>
+#include <bfrwlock.h>
 #include <bfconstants.h>
 #include <bfexception.h>
 #include <bfupperlower.h>
+#include <bfthreadcontext.h>
 
 #include <memory_manager/memory_manager.h>
 
@@ -46,10 +48,13 @@
 // -----------------------------------------------------------------------------
 
 #include <mutex>
+#include <utility>
+#include <algorithm>
+#include <shared_mutex>
 
 auto &md_mutex()
 {
-    static std::mutex s_md_mutex{};
+    static bfn::rwlock s_md_mutex{};
     return s_md_mutex;
 }
 
@@ -71,6 +76,12 @@ auto &alloc_mem_map_mutex()
     return s_alloc_mem_map_mutex;
 }
 
+auto &alloc_node_mutex()
+{
+    static std::mutex s_alloc_node_mutex{};
+    return s_alloc_node_mutex;
+}
+
 // -----------------------------------------------------------------------------
 // Stats
 // -----------------------------------------------------------------------------
@@ -135,14 +146,18 @@ namespace bfvmm
 // Global Memory
 // -----------------------------------------------------------------------------
 
+// The page and huge pools are aligned to a large page so that, if the
+// driver was able to allocate them from contiguous memory, the VMM can map
+// them using large pages (see descriptor_runs).
+
 /// \cond
 
 constexpr auto g_page_pool_k = PAGE_POOL_K;
-alignas(BAREFLANK_PAGE_SIZE) uint8_t g_page_pool_buffer[buddy_allocator::buffer_size(g_page_pool_k)] = {};
+alignas(BAREFLANK_LARGE_PAGE_SIZE) uint8_t g_page_pool_buffer[buddy_allocator::buffer_size(g_page_pool_k)] = {};
 alignas(BAREFLANK_PAGE_SIZE) uint8_t g_page_pool_node_tree[buddy_allocator::node_tree_size(g_page_pool_k)] = {};
 
 constexpr auto g_huge_pool_k = HUGE_POOL_K;
-alignas(BAREFLANK_PAGE_SIZE) uint8_t g_huge_pool_buffer[buddy_allocator::buffer_size(g_huge_pool_k)] = {};
+alignas(BAREFLANK_LARGE_PAGE_SIZE) uint8_t g_huge_pool_buffer[buddy_allocator::buffer_size(g_huge_pool_k)] = {};
 alignas(BAREFLANK_PAGE_SIZE) uint8_t g_huge_pool_node_tree[buddy_allocator::node_tree_size(g_huge_pool_k)] = {};
 
 constexpr auto g_mem_map_pool_k = MEM_MAP_POOL_K;
@@ -210,6 +225,10 @@ memory_manager::alloc(size_type size) noexcept
         }
 
         if (size > BAREFLANK_PAGE_SIZE) {
+            if (auto ptr = this->alloc_node(size)) {
+                return ptr;
+            }
+
             return static_cast<pointer>(g_huge_pool.allocate(size));
         }
 
@@ -224,6 +243,10 @@ memory_manager::alloc(size_type size) noexcept
 memory_manager::pointer
 memory_manager::alloc_page() noexcept
 {
+    if (auto ptr = this->alloc_node(BAREFLANK_PAGE_SIZE)) {
+        return ptr;
+    }
+
 #ifdef ENABLE_BUILD_TEST
     return static_cast<pointer>(g_page_pool.allocate(BAREFLANK_PAGE_SIZE));
 #else
@@ -304,6 +327,10 @@ memory_manager::free(pointer ptr) noexcept
 void
 memory_manager::free_page(pointer ptr) noexcept
 {
+    if (this->free_node(ptr)) {
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(alloc_page_mutex());
     return g_page_pool.deallocate(ptr);
 }
@@ -366,6 +393,10 @@ memory_manager::size(pointer ptr) const noexcept
 memory_manager::size_type
 memory_manager::size_page(pointer ptr) const noexcept
 {
+    if (auto size = this->size_node(ptr); size != 0) {
+        return size;
+    }
+
     std::lock_guard<std::mutex> lock(alloc_page_mutex());
 
     if (g_page_pool.contains(ptr)) {
@@ -393,7 +424,7 @@ memory_manager::virtint_to_physint(integer_pointer virt) const
     auto lower = bfn::lower(virt);
     auto upper = bfn::upper(virt);
 
-    std::lock_guard<std::mutex> guard(md_mutex());
+    std::shared_lock<bfn::rwlock> guard(md_mutex());
 
     if (auto iter = m_virt_map.find(upper); iter != m_virt_map.end()) {
         return iter->second.phys | lower;
@@ -422,7 +453,7 @@ memory_manager::physint_to_virtint(integer_pointer phys) const
     auto lower = bfn::lower(phys);
     auto upper = bfn::upper(phys);
 
-    std::lock_guard<std::mutex> guard(md_mutex());
+    std::shared_lock<bfn::rwlock> guard(md_mutex());
 
     if (auto iter = m_phys_map.find(upper); iter != m_phys_map.end()) {
         return iter->second.virt | lower;
@@ -449,7 +480,7 @@ void
 memory_manager::add_md(integer_pointer virt, integer_pointer phys, attr_type attr)
 {
     auto ___ = gsl::on_failure([&] {
-        std::lock_guard<std::mutex> guard(md_mutex());
+        std::lock_guard<bfn::rwlock> guard(md_mutex());
 
         m_virt_map.erase(virt);
         m_phys_map.erase(phys);
@@ -459,7 +490,7 @@ memory_manager::add_md(integer_pointer virt, integer_pointer phys, attr_type att
     expects(bfn::lower(phys) == 0);
 
     {
-        std::lock_guard<std::mutex> guard(md_mutex());
+        std::lock_guard<bfn::rwlock> guard(md_mutex());
 
         if (m_virt_map.find(virt) != m_virt_map.end()) {
             throw std::runtime_error(
@@ -485,7 +516,7 @@ memory_manager::remove_md(integer_pointer virt, integer_pointer phys)
     expects(bfn::lower(phys) == 0);
 
     {
-        std::lock_guard<std::mutex> guard(md_mutex());
+        std::lock_guard<bfn::rwlock> guard(md_mutex());
 
         m_virt_map.erase(virt);
         m_phys_map.erase(phys);
@@ -496,7 +527,7 @@ memory_manager::memory_descriptor_list
 memory_manager::descriptors() const
 {
     memory_descriptor_list list;
-    std::lock_guard<std::mutex> guard(md_mutex());
+    std::shared_lock<bfn::rwlock> guard(md_mutex());
 
     for (const auto &p : m_virt_map) {
         list.push_back({p.second.phys, p.first, p.second.attr});
@@ -505,6 +536,264 @@ memory_manager::descriptors() const
     return list;
 }
 
+memory_manager::memory_descriptor_run_list
+memory_manager::descriptor_runs() const
+{
+    auto list = this->descriptors();
+    memory_descriptor_run_list runs;
+
+    std::sort(list.begin(), list.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.virt < rhs.virt;
+    });
+
+    for (const auto &md : list) {
+        if (!runs.empty()) {
+            auto &run = runs.back();
+
+            if (run.virt + run.size == md.virt &&
+                run.phys + run.size == md.phys && run.type == md.type) {
+                run.size += BAREFLANK_PAGE_SIZE;
+                continue;
+            }
+        }
+
+        runs.push_back({md.phys, md.virt, BAREFLANK_PAGE_SIZE, md.type});
+    }
+
+    return runs;
+}
+
+void
+memory_manager::add_node_pool(integer_pointer virt, size_type size)
+{
+    expects(bfn::lower(virt) == 0);
+    expects(size >= BAREFLANK_PAGE_SIZE);
+
+    size_type k = 0;
+    while ((BAREFLANK_PAGE_SIZE << k) < size) {
+        k++;
+    }
+
+    expects((BAREFLANK_PAGE_SIZE << k) == size);
+
+    // The driver tags each page of a node pool with the node that the
+    // memory is local to, so the whole pool has to be tagged with the
+    // same node.
+
+    node_type node = 0;
+
+    {
+        std::shared_lock<bfn::rwlock> guard(md_mutex());
+
+        for (size_type i = 0; i < size; i += BAREFLANK_PAGE_SIZE) {
+            auto iter = m_virt_map.find(virt + i);
+            if (iter == m_virt_map.end()) {
+                throw std::runtime_error(
+                    "memory_manager::add_node_pool: md missing: " + bfn::to_string(virt + i, 16)
+                );
+            }
+
+            auto md_node = MEMORY_TYPE_GET_NODE(iter->second.attr);
+            if (i == 0) {
+                node = md_node;
+            }
+
+            expects(md_node == node);
+        }
+    }
+
+    expects(node < MAX_NUM_NODES);
+
+    auto node_tree = std::make_unique<uint8_t[]>(buddy_allocator::node_tree_size(k));
+    auto pool = std::make_unique<buddy_allocator>(virt, k, node_tree.get());
+
+    std::lock_guard<std::mutex> lock(alloc_node_mutex());
+    auto &node_pool = m_node_pools.at(node);
+
+    if (node_pool.pool) {
+        throw std::runtime_error(
+            "memory_manager::add_node_pool: node already added: " + bfn::to_string(node, 16)
+        );
+    }
+
+    node_pool.node_tree = std::move(node_tree);
+    node_pool.pool = std::move(pool);
+
+    m_num_node_pools.fetch_add(1, std::memory_order_release);
+}
+
+void
+memory_manager::remove_node_pool(node_type node) noexcept
+{
+    if (node >= MAX_NUM_NODES) {
+        return;
+    }
+
+    node_pool_t node_pool{};
+
+    {
+        std::lock_guard<std::mutex> lock(alloc_node_mutex());
+        std::swap(node_pool, m_node_pools.at(node));
+
+        if (node_pool.pool) {
+            m_num_node_pools.fetch_sub(1, std::memory_order_release);
+        }
+    }
+}
+
+void
+memory_manager::set_cpu_node(uint64_t cpuid, node_type node)
+{
+    expects(cpuid < MAX_NUM_PCPUS);
+    expects(node < MAX_NUM_NODES);
+
+    m_cpu_nodes.at(cpuid) = node;
+}
+
+memory_manager::node_type
+memory_manager::cpu_node(uint64_t cpuid) const noexcept
+{
+    if (cpuid >= MAX_NUM_PCPUS) {
+        return 0;
+    }
+
+    return m_cpu_nodes.at(cpuid);
+}
+
+memory_manager::node_type
+memory_manager::node() const noexcept
+{
+    auto cpuid = thread_context_cpuid();
+
+    if (cpuid >= MAX_NUM_PCPUS) {
+        return 0;
+    }
+
+    if (auto node = m_scope_nodes.at(cpuid); node != invalid_node) {
+        return node;
+    }
+
+    return m_cpu_nodes.at(cpuid);
+}
+
+memory_manager::node_type
+memory_manager::node(pointer ptr) const noexcept
+{
+    auto node = this->owner(ptr);
+    if (node == invalid_node) {
+        return invalid_node;
+    }
+
+    std::lock_guard<std::mutex> lock(alloc_node_mutex());
+
+    if (const auto &pool = m_node_pools.at(node).pool; pool && pool->contains(ptr)) {
+        return node;
+    }
+
+    return invalid_node;
+}
+
+memory_manager::node_type
+memory_manager::owner(pointer ptr) const noexcept
+{
+    // Most systems have a single node and never add a node pool, in which
+    // case none of the node locks need to be taken. Otherwise, the node a
+    // page belongs to is already recorded in its memory descriptor (the
+    // driver tags node-local memory with its node), which is the only
+    // node pool that could own the page.
+
+    if (m_num_node_pools.load(std::memory_order_acquire) == 0) {
+        return invalid_node;
+    }
+
+    auto virt = bfn::upper(reinterpret_cast<integer_pointer>(ptr));
+    std::shared_lock<bfn::rwlock> guard(md_mutex());
+
+    if (auto iter = m_virt_map.find(virt); iter != m_virt_map.end()) {
+        if (auto node = MEMORY_TYPE_GET_NODE(iter->second.attr); node < MAX_NUM_NODES) {
+            return node;
+        }
+    }
+
+    return invalid_node;
+}
+
+memory_manager::pointer
+memory_manager::alloc_node(size_type size) noexcept
+{
+    if (m_num_node_pools.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+
+    auto node = this->node();
+    std::lock_guard<std::mutex> lock(alloc_node_mutex());
+
+    // Running out of node-local memory is not an error, the caller falls
+    // back to the global pools, which is why bad_alloc is not reported
+    // here.
+
+    try {
+        if (auto &pool = m_node_pools.at(node).pool) {
+            return static_cast<pointer>(pool->allocate(size));
+        }
+    }
+    catch (...)
+    { }
+
+    return nullptr;
+}
+
+bool
+memory_manager::free_node(pointer ptr) noexcept
+{
+    auto node = this->owner(ptr);
+    if (node == invalid_node) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(alloc_node_mutex());
+
+    if (auto &pool = m_node_pools.at(node).pool; pool && pool->contains(ptr)) {
+        pool->deallocate(ptr);
+        return true;
+    }
+
+    return false;
+}
+
+memory_manager::size_type
+memory_manager::size_node(pointer ptr) const noexcept
+{
+    auto node = this->owner(ptr);
+    if (node == invalid_node) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(alloc_node_mutex());
+
+    if (const auto &pool = m_node_pools.at(node).pool; pool && pool->contains(ptr)) {
+        return pool->size(ptr);
+    }
+
+    return 0;
+}
+
+memory_manager::node_scope::node_scope(node_type node) noexcept :
+    m_cpuid{thread_context_cpuid()},
+    m_prev{invalid_node}
+{
+    if (m_cpuid < MAX_NUM_PCPUS) {
+        m_prev = std::exchange(g_mm->m_scope_nodes.at(m_cpuid), node);
+    }
+}
+
+memory_manager::node_scope::~node_scope() noexcept
+{
+    if (m_cpuid < MAX_NUM_PCPUS) {
+        g_mm->m_scope_nodes.at(m_cpuid) = m_prev;
+    }
+}
+
 memory_manager::memory_manager() noexcept :
     g_page_pool(static_cast<void *>(g_page_pool_buffer), g_page_pool_k, static_cast<void *>(g_page_pool_node_tree)),
     g_huge_pool(static_cast<void *>(g_huge_pool_buffer), g_huge_pool_k, static_cast<void *>(g_huge_pool_node_tree)),
@@ -518,7 +807,10 @@ memory_manager::memory_manager() noexcept :
     slab200(0x200, 0),
     slab400(0x400, 0),
     slab800(0x800, 0)
-{ }
+{
+    m_cpu_nodes.fill(0);
+    m_scope_nodes.fill(invalid_node);
+}
 
 }
 
@@ -26,6 +26,10 @@
 
 using namespace bfvmm;
 
+extern "C" uint64_t
+thread_context_cpuid(void)
+{ return 0; }
+
 debug_ring_resources_t *drr;
 
 char rb[DEBUG_RING_SIZE];
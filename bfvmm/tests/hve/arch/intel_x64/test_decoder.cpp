@@ -0,0 +1,80 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+#include <hve/arch/intel_x64/decoder.h>
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+using namespace bfvmm::intel_x64;
+
+TEST_CASE("decoder: gpr encoding")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+
+    g_state.rcx = 1;
+    g_state.rsp = 4;
+    g_state.r15 = 15;
+
+    CHECK(vcpu->gpr(1) == 1);
+    CHECK(vcpu->gpr(4) == 4);
+    CHECK(vcpu->gpr(15) == 15);
+
+    vcpu->set_gpr(8, 42);
+    CHECK(g_state.r08 == 42);
+}
+
+TEST_CASE("decoder: register operands")
+{
+    CHECK(decoder::cr_access_gpr(0x00000F00) == 15);
+    CHECK(decoder::cr_access_gpr(0x00000304) == 3);
+    CHECK(decoder::mov_dr_gpr(0x00000211) == 2);
+    CHECK(decoder::reg1(0x00000028) == 5);
+    CHECK(decoder::reg2(0x70000000) == 7);
+}
+
+TEST_CASE("decoder: memory operand")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+
+    g_state.rbx = 0x1000;
+    g_state.rsi = 0x10;
+
+    // base == rbx, index == rsi, scale == 8, 64bit
+    CHECK(decoder::memory_operand(vcpu, 0x01980103, 0x4) == 0x1084);
+
+    // base == rbx, index invalid, 64bit
+    CHECK(decoder::memory_operand(vcpu, 0x01C00100, 0x4) == 0x1004);
+
+    // base invalid, index invalid, 16bit
+    CHECK(decoder::memory_operand(vcpu, 0x08400000, 0x12345) == 0x2345);
+}
+
+#endif
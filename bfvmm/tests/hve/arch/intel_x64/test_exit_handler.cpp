@@ -30,6 +30,28 @@ static bool
 test_handler(vcpu_t *vcpu)
 { bfignored(vcpu); return true; }
 
+static bool
+test_fast_handler(vcpu_t *vcpu) noexcept
+{ bfignored(vcpu); return true; }
+
+static int g_legacy_called = 0;
+
+static bool
+test_legacy_handler(vcpu_t *vcpu)
+{ bfignored(vcpu); g_legacy_called++; return false; }
+
+static exit_result_t
+test_result_handler(vcpu_t *vcpu) noexcept
+{ bfignored(vcpu); return true; }
+
+static exit_result_t
+test_result_pass(vcpu_t *vcpu) noexcept
+{ bfignored(vcpu); return false; }
+
+static exit_result_t
+test_result_error(vcpu_t *vcpu) noexcept
+{ bfignored(vcpu); return bfn::unexpected(VMEXIT_ERROR_UNHANDLED); }
+
 TEST_CASE("quiet")
 {
     setup_test_support();
@@ -127,4 +149,102 @@ TEST_CASE("exit_handler: add_exit_handler")
     CHECK_NOTHROW(handle_exit(vcpu, &ehlr));
 }
 
+TEST_CASE("exit_handler: add_result_handler invalid reason")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&ehlr = bfvmm::intel_x64::exit_handler{vcpu};
+
+    CHECK_THROWS(
+        ehlr.add_result_handler(1000, test_result_handler)
+    );
+}
+
+TEST_CASE("exit_handler: result handler handles the exit")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&ehlr = bfvmm::intel_x64::exit_handler{vcpu};
+
+    g_legacy_called = 0;
+    ehlr.add_handler(0, test_legacy_handler);
+    ehlr.add_result_handler(0, test_result_handler);
+
+    CHECK_NOTHROW(handle_exit(vcpu, &ehlr));
+    CHECK(g_legacy_called == 0);
+}
+
+TEST_CASE("exit_handler: result handler passes the exit on")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&ehlr = bfvmm::intel_x64::exit_handler{vcpu};
+
+    g_legacy_called = 0;
+    ehlr.add_handler(0, test_legacy_handler);
+    ehlr.add_result_handler(0, test_result_pass);
+
+    CHECK_NOTHROW(handle_exit(vcpu, &ehlr));
+    CHECK(g_legacy_called == 1);
+}
+
+TEST_CASE("exit_handler: result handler error")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&ehlr = bfvmm::intel_x64::exit_handler{vcpu};
+
+    g_legacy_called = 0;
+    ehlr.add_handler(0, test_legacy_handler);
+    ehlr.add_result_handler(0, test_result_pass);
+    ehlr.add_result_handler(0, test_result_error);
+
+    CHECK_NOTHROW(handle_exit(vcpu, &ehlr));
+    CHECK(g_legacy_called == 0);
+}
+
+TEST_CASE("exit_handler: set_fast_handler")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&ehlr = bfvmm::intel_x64::exit_handler{vcpu};
+
+    CHECK(ehlr.fast_handlers()[10] == nullptr);
+
+    CHECK_NOTHROW(
+        ehlr.set_fast_handler(10, test_fast_handler)
+    );
+
+    CHECK(ehlr.fast_handlers()[10] == test_fast_handler);
+
+    CHECK_NOTHROW(
+        ehlr.set_fast_handler(10, nullptr)
+    );
+
+    CHECK(ehlr.fast_handlers()[10] == nullptr);
+}
+
+TEST_CASE("exit_handler: set_fast_handler invalid reason")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&ehlr = bfvmm::intel_x64::exit_handler{vcpu};
+
+    CHECK_THROWS(
+        ehlr.set_fast_handler(1000, test_fast_handler)
+    );
+}
+
 #endif
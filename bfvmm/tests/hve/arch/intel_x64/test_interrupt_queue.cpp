@@ -0,0 +1,81 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+#include <test/support.h>
+
+using namespace bfvmm::intel_x64;
+
+TEST_CASE("interrupt_queue: empty")
+{
+    interrupt_queue queue;
+
+    CHECK(queue.empty());
+    CHECK_THROWS(queue.pop());
+}
+
+TEST_CASE("interrupt_queue: push / pop")
+{
+    interrupt_queue queue;
+
+    queue.push(0x30);
+    CHECK(!queue.empty());
+
+    CHECK(queue.pop() == 0x30);
+    CHECK(queue.empty());
+}
+
+TEST_CASE("interrupt_queue: invalid vector")
+{
+    interrupt_queue queue;
+    CHECK_THROWS(queue.push(256));
+}
+
+TEST_CASE("interrupt_queue: pops by priority")
+{
+    interrupt_queue queue;
+
+    queue.push(0x20);
+    queue.push(0xFF);
+    queue.push(0x00);
+    queue.push(0x41);
+    queue.push(0x40);
+
+    CHECK(queue.pop() == 0xFF);
+    CHECK(queue.pop() == 0x41);
+    CHECK(queue.pop() == 0x40);
+    CHECK(queue.pop() == 0x20);
+    CHECK(queue.pop() == 0x00);
+    CHECK(queue.empty());
+}
+
+TEST_CASE("interrupt_queue: duplicates coalesce")
+{
+    interrupt_queue queue;
+
+    queue.push(0x30);
+    queue.push(0x30);
+    queue.push(0x30);
+
+    CHECK(queue.pop() == 0x30);
+    CHECK(queue.empty());
+}
@@ -0,0 +1,200 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+using msr_policy_t = bfvmm::intel_x64::msr_policy;
+using type_t = msr_policy_t::type_t;
+
+static void
+setup_wrmsr(uint64_t msr, uint64_t val)
+{
+    g_state.rcx = msr;
+    g_state.rax = (val >> 0x00) & 0x00000000FFFFFFFF;
+    g_state.rdx = (val >> 0x20) & 0x00000000FFFFFFFF;
+}
+
+TEST_CASE("msr_policy: construct / destruct")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+
+    CHECK_NOTHROW(msr_policy_t{vcpu});
+}
+
+TEST_CASE("msr_policy: invalid msr")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&policy = msr_policy_t{vcpu};
+
+    CHECK_THROWS(policy.compile({{0x40000000, type_t::constant}}));
+    CHECK_THROWS(policy.compile({{0xC0002000, type_t::trap}}));
+}
+
+TEST_CASE("msr_policy: not emulated")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&policy = msr_policy_t{vcpu};
+
+    g_state.rcx = 0x10;
+    CHECK(!policy.handle_rdmsr(vcpu));
+    CHECK(!policy.handle_wrmsr(vcpu));
+
+    policy.compile({
+        {0x10, type_t::passthrough},
+        {0x11, type_t::trap}
+    });
+
+    g_state.rcx = 0x10;
+    CHECK(!policy.handle_rdmsr(vcpu));
+    CHECK(!policy.handle_wrmsr(vcpu));
+    g_state.rcx = 0x11;
+    CHECK(!policy.handle_rdmsr(vcpu));
+    CHECK(!policy.handle_wrmsr(vcpu));
+
+    CHECK_THROWS(policy.value(0x10));
+}
+
+TEST_CASE("msr_policy: constant")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&policy = msr_policy_t{vcpu};
+
+    policy.compile({{0xC0000100, type_t::constant, 0x0000000100000002}});
+
+    g_state.rcx = 0xC0000100;
+    CHECK(policy.handle_rdmsr(vcpu));
+    CHECK(g_state.rax == 0x2);
+    CHECK(g_state.rdx == 0x1);
+
+    g_msrs[0xC0000100] = 0;
+    setup_wrmsr(0xC0000100, 42);
+    CHECK(policy.handle_wrmsr(vcpu));
+    CHECK(g_msrs[0xC0000100] == 0);
+    CHECK(policy.value(0xC0000100) == 0x0000000100000002);
+}
+
+TEST_CASE("msr_policy: shadow")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&policy = msr_policy_t{vcpu};
+
+    policy.compile({
+        {0x48, type_t::shadow, 0x0, 0x7, true},
+        {0x49, type_t::shadow, 0x0, 0xF, false}
+    });
+
+    g_msrs[0x48] = 0;
+    setup_wrmsr(0x48, 0xFF);
+    CHECK(policy.handle_wrmsr(vcpu));
+    CHECK(policy.value(0x48) == 0x7);
+    CHECK(g_msrs[0x48] == 0x7);
+
+    g_state.rcx = 0x48;
+    CHECK(policy.handle_rdmsr(vcpu));
+    CHECK(g_state.rax == 0x7);
+    CHECK(g_state.rdx == 0x0);
+
+    g_msrs[0x49] = 0;
+    setup_wrmsr(0x49, 0x3);
+    CHECK(policy.handle_wrmsr(vcpu));
+    CHECK(policy.value(0x49) == 0x3);
+    CHECK(g_msrs[0x49] == 0);
+}
+
+TEST_CASE("msr_policy: masked")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&policy = msr_policy_t{vcpu};
+
+    policy.compile({{0x1A0, type_t::masked, 0x0, 0x1}});
+
+    g_state.rcx = 0x1A0;
+    CHECK(!policy.handle_rdmsr(vcpu));
+
+    g_msrs[0x1A0] = 0xF0;
+    setup_wrmsr(0x1A0, 0x0F);
+    CHECK(policy.handle_wrmsr(vcpu));
+    CHECK(g_msrs[0x1A0] == 0xF1);
+
+    CHECK_THROWS(policy.value(0x1A0));
+}
+
+TEST_CASE("msr_policy: recompile")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&policy = msr_policy_t{vcpu};
+
+    policy.compile({{0x10, type_t::constant, 42}});
+    policy.compile({{0x11, type_t::constant, 43}});
+
+    g_state.rcx = 0x10;
+    CHECK(!policy.handle_rdmsr(vcpu));
+
+    g_state.rcx = 0x11;
+    CHECK(policy.handle_rdmsr(vcpu));
+    CHECK(g_state.rax == 43);
+}
+
+TEST_CASE("msr_policy: reset")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto &&vcpu = setup_vcpu(mocks, 0x0);
+    auto &&policy = msr_policy_t{vcpu};
+
+    policy.compile({{0x49, type_t::shadow, 0x1, 0xF, false}});
+
+    setup_wrmsr(0x49, 0x3);
+    CHECK(policy.handle_wrmsr(vcpu));
+    CHECK(policy.value(0x49) == 0x3);
+
+    policy.reset();
+    CHECK(policy.value(0x49) == 0x1);
+}
+
+#endif
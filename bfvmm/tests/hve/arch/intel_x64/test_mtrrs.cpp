@@ -0,0 +1,168 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+#include <test/support.h>
+
+#include <hve/arch/intel_x64/mtrrs.h>
+
+using namespace bfvmm::intel_x64;
+using memory_type = ept::mmap::memory_type;
+
+namespace msrs_n = ::intel_x64::msrs;
+
+constexpr const auto phys_addr_size = 39ULL;
+
+// Synthetic MTRRs
+//
+// Sets up the MTRR MSRs with the provided default type and list of variable
+// ranges. Each variable range is given as {type, base, size}, and its mask
+// is generated from the size the same way the MTRRs are decoded.
+//
+static void
+setup_mtrrs(
+    uint64_t def_type, std::initializer_list<std::array<uint64_t, 3>> ranges, bool enable = true)
+{
+    g_msrs.clear();
+    g_eax_cpuid[::x64::cpuid::addr_size::addr] = phys_addr_size;
+
+    g_msrs[msrs_n::ia32_mtrr_def_type::addr] = def_type | (enable ? (1ULL << 11) : 0);
+    g_msrs[::x64::msrs::ia32_mtrrcap::addr] = ranges.size();
+
+    auto i = 0U;
+    for (const auto &range : ranges) {
+        auto mask = ~(range[2] - 1U) & ((1ULL << phys_addr_size) - 1U);
+
+        g_msrs[msrs_n::ia32_mtrr_physbase::addr + i] = range[1] | range[0];
+        g_msrs[msrs_n::ia32_mtrr_physmask::addr + i] = (mask & ~0xFFFULL) | (1ULL << 11);
+
+        i += 2U;
+    }
+}
+
+constexpr const auto uc = 0ULL;
+constexpr const auto wt = 4ULL;
+constexpr const auto wb = 6ULL;
+
+constexpr const auto _1m = 0x100000ULL;
+constexpr const auto _2m = 0x200000ULL;
+constexpr const auto _1g = 0x40000000ULL;
+
+TEST_CASE("mtrrs: disabled")
+{
+    setup_mtrrs(uc, {}, false);
+    mtrrs ranges{};
+
+    CHECK(ranges.type_of(0) == memory_type::write_back);
+    CHECK(ranges.type_of(0xFFFFFFFFF000) == memory_type::write_back);
+    CHECK(ranges.largest_uniform_run(0x1000) == 0xFFFFFFFFFFFFFFFF - 0x1000);
+}
+
+TEST_CASE("mtrrs: type_of")
+{
+    setup_mtrrs(wb, {
+        {uc, 3 * _1g, _1g},
+        {wt, 4 * _1g, _2m}
+    });
+
+    mtrrs ranges{};
+
+    CHECK(ranges.type_of(0) == memory_type::uncacheable);
+    CHECK(ranges.type_of(_1m - 0x1000) == memory_type::uncacheable);
+    CHECK(ranges.type_of(_1m) == memory_type::write_back);
+    CHECK(ranges.type_of(3 * _1g - 1) == memory_type::write_back);
+    CHECK(ranges.type_of(3 * _1g) == memory_type::uncacheable);
+    CHECK(ranges.type_of(4 * _1g - 1) == memory_type::uncacheable);
+    CHECK(ranges.type_of(4 * _1g) == memory_type::write_through);
+    CHECK(ranges.type_of(4 * _1g + _2m) == memory_type::write_back);
+    CHECK(ranges.type_of(0xFFFFFFFFF000) == memory_type::write_back);
+}
+
+TEST_CASE("mtrrs: largest_uniform_run")
+{
+    setup_mtrrs(wb, {
+        {uc, 3 * _1g, _1g},
+        {wt, 4 * _1g, _2m}
+    });
+
+    mtrrs ranges{};
+
+    CHECK(ranges.largest_uniform_run(0) == _1m);
+    CHECK(ranges.largest_uniform_run(0x1000) == _1m - 0x1000);
+    CHECK(ranges.largest_uniform_run(_1m) == 3 * _1g - _1m);
+    CHECK(ranges.largest_uniform_run(3 * _1g) == _1g);
+    CHECK(ranges.largest_uniform_run(4 * _1g + 0x1000) == _2m - 0x1000);
+}
+
+TEST_CASE("mtrrs: neighbouring ranges of the same type are merged")
+{
+    setup_mtrrs(wb, {
+        {wb, _2m, _2m},
+        {uc, 3 * _1g, _1g}
+    });
+
+    mtrrs ranges{};
+
+    CHECK(ranges.size() > 4);
+    CHECK(ranges.type_of(_2m) == memory_type::write_back);
+    CHECK(ranges.largest_uniform_run(_1m) == 3 * _1g - _1m);
+}
+
+TEST_CASE("mtrrs: type_of matches the ranges")
+{
+    setup_mtrrs(wb, {
+        {uc, 3 * _1g, _1g},
+        {wt, 4 * _1g, _2m},
+        {wb, _2m, _2m},
+        {uc, 0xE0000000, 0x10000000}
+    });
+
+    mtrrs ranges{};
+
+    for (auto addr = 0ULL; addr < 8 * _1g; addr += _1m) {
+        for (auto i = 0U; i < ranges.size(); i++) {
+            const auto &range = ranges.ranges().at(i);
+
+            if (addr >= range.base && addr - range.base < range.size) {
+                CHECK(ranges.type_of(addr) == range.type);
+                CHECK(ranges.largest_uniform_run(addr) >= range.size - (addr - range.base));
+            }
+        }
+    }
+}
+
+TEST_CASE("mtrrs: no ranges")
+{
+    // Ranges that intersect without one being a subset of the other are not
+    // supported, which results in an empty range list.
+
+    setup_mtrrs(wb, {
+        {uc, 3 * _1g, 0x60000000},
+        {wt, 4 * _1g, 2 * _1g}
+    });
+
+    mtrrs ranges{};
+
+    CHECK(ranges.size() == 0);
+    CHECK(ranges.type_of(_1m) == memory_type::uncacheable);
+    CHECK(ranges.largest_uniform_run(_1m) == 0);
+}
@@ -0,0 +1,207 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+
+using namespace bfvmm::intel_x64;
+
+// The VIRR is stored in the virtual-APIC page as eight 32 bit registers
+// starting at offset 0x200, with each register aligned to 16 bytes.
+
+static uint32_t
+virr(const std::array<uint32_t, 0x400> &page, std::size_t i)
+{ return page.at((0x200 / sizeof(uint32_t)) + (i * 4)); }
+
+TEST_CASE("posted_interrupt: descriptor size")
+{
+    CHECK(sizeof(posted_interrupt_descriptor) == 64);
+}
+
+TEST_CASE("posted_interrupt: empty")
+{
+    posted_interrupt_descriptor desc{};
+    std::array<uint32_t, 0x400> page{};
+
+    CHECK(!desc.pending());
+    CHECK(desc.sync(page) == 0);
+}
+
+TEST_CASE("posted_interrupt: invalid vector")
+{
+    posted_interrupt_descriptor desc{};
+
+    CHECK_THROWS(desc.post(256));
+    CHECK_THROWS(desc.set_notification_vector(256));
+}
+
+TEST_CASE("posted_interrupt: only the first post notifies")
+{
+    posted_interrupt_descriptor desc{};
+
+    CHECK(desc.post(0x30));
+    CHECK(!desc.post(0x31));
+    CHECK(!desc.post(0x30));
+    CHECK(desc.pending());
+}
+
+TEST_CASE("posted_interrupt: sync moves the pir into the virr")
+{
+    posted_interrupt_descriptor desc{};
+    std::array<uint32_t, 0x400> page{};
+
+    desc.post(0x20);
+    desc.post(0x41);
+    desc.post(0xFF);
+
+    CHECK(desc.sync(page) == 0xFF);
+    CHECK(!desc.pending());
+
+    CHECK(virr(page, 0) == 0);
+    CHECK(virr(page, 1) == 0x00000001);
+    CHECK(virr(page, 2) == 0x00000002);
+    CHECK(virr(page, 7) == 0x80000000);
+
+    CHECK(desc.sync(page) == 0);
+}
+
+TEST_CASE("posted_interrupt: sync preserves the virr")
+{
+    posted_interrupt_descriptor desc{};
+    std::array<uint32_t, 0x400> page{};
+
+    desc.post(0x40);
+    desc.sync(page);
+
+    desc.post(0x30);
+    CHECK(desc.sync(page) == 0x30);
+    CHECK(virr(page, 1) == 0x00010000);
+    CHECK(virr(page, 2) == 0x00000001);
+}
+
+TEST_CASE("posted_interrupt: notify again after sync")
+{
+    posted_interrupt_descriptor desc{};
+    std::array<uint32_t, 0x400> page{};
+
+    CHECK(desc.post(0x30));
+    desc.sync(page);
+    CHECK(desc.post(0x30));
+}
+
+TEST_CASE("posted_interrupt: notification fields")
+{
+    posted_interrupt_descriptor desc{};
+
+    desc.set_notification_vector(0xF2);
+    desc.set_notification_destination(0xDEADBEEF);
+
+    CHECK(desc.notification_vector() == 0xF2);
+    CHECK(desc.notification_destination() == 0xDEADBEEF);
+
+    desc.post(0x30);
+    CHECK(desc.notification_vector() == 0xF2);
+    CHECK(desc.notification_destination() == 0xDEADBEEF);
+}
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+constexpr const auto notification_vector = 0xF2ULL;
+
+static auto
+setup_interrupt_window(
+    MockRepository &mocks, bfvmm::intel_x64::vcpu *vcpu,
+    external_interrupt_handler::handler_delegate_t &notification_handler)
+{
+    using namespace vmcs_n;
+
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::add_external_interrupt_handler).Do(
+    [&](const external_interrupt_handler::handler_delegate_t &d) {
+        notification_handler = d;
+    });
+
+    pin_based_vm_execution_controls::external_interrupt_exiting::enable();
+
+    auto handler = std::make_unique<interrupt_window_handler>(vcpu);
+    handler->enable_virtual_interrupt_delivery();
+
+    return handler;
+}
+
+TEST_CASE("posted_interrupt: notification vector exit")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    external_interrupt_handler::handler_delegate_t notification_handler;
+    auto handler = setup_interrupt_window(mocks, vcpu, notification_handler);
+
+    handler->enable_posted_interrupts(notification_vector);
+    CHECK(vmcs_n::pin_based_vm_execution_controls::process_posted_interrupts::is_enabled());
+
+    CHECK(handler->post_external_interrupt(0x30));
+    CHECK(!handler->post_external_interrupt(0x31));
+
+    external_interrupt_handler::info_t info{0x30};
+    CHECK(!notification_handler(vcpu, info));
+
+    g_msrs[::intel_x64::msrs::ia32_x2apic_eoi::addr] = 1;
+
+    info.vector = notification_vector;
+    CHECK(notification_handler(vcpu, info));
+    CHECK(g_msrs[::intel_x64::msrs::ia32_x2apic_eoi::addr] == 0);
+    CHECK((vmcs_n::guest_interrupt_status::get() & 0xFFU) == 0x31);
+
+    CHECK(handler->post_external_interrupt(0x32));
+}
+
+TEST_CASE("posted_interrupt: not supported")
+{
+    using namespace ::intel_x64::msrs;
+    namespace pin_based = vmcs_n::pin_based_vm_execution_controls;
+
+    auto allowed1 = pin_based::process_posted_interrupts::mask << 32;
+
+    setup_test_support();
+    g_msrs[ia32_vmx_true_pinbased_ctls::addr] &= ~allowed1;
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    external_interrupt_handler::handler_delegate_t notification_handler;
+    auto handler = setup_interrupt_window(mocks, vcpu, notification_handler);
+
+    handler->enable_posted_interrupts(notification_vector);
+    CHECK(pin_based::process_posted_interrupts::is_disabled());
+
+    // Nothing listens for the notification vector, so the caller must not
+    // send it. The post is picked up on the next exit instead.
+
+    CHECK(!handler->post_external_interrupt(0x30));
+    CHECK(!handler->handle_posted(vcpu));
+    CHECK((vmcs_n::guest_interrupt_status::get() & 0xFFU) == 0x30);
+}
+
+#endif
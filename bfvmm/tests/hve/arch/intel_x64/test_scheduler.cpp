@@ -0,0 +1,223 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+#include <hve/arch/intel_x64/scheduler.h>
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+using namespace bfvmm::intel_x64;
+
+TEST_CASE("run_queue: invalid slice")
+{
+    CHECK_THROWS(run_queue{0});
+}
+
+TEST_CASE("run_queue: empty")
+{
+    run_queue queue{100};
+
+    CHECK(queue.size() == 0);
+    CHECK(queue.current() == nullptr);
+    CHECK(queue.next(0) == nullptr);
+    CHECK(queue.remaining(0) == 0);
+}
+
+TEST_CASE("run_queue: duplicate vcpu")
+{
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    run_queue queue{100};
+    queue.add(vcpu);
+
+    CHECK_THROWS(queue.add(vcpu));
+}
+
+TEST_CASE("run_queue: single vcpu is never preempted")
+{
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    run_queue queue{100};
+    queue.add(vcpu);
+
+    CHECK(queue.next(0) == vcpu);
+    CHECK(queue.remaining(50) == 0);
+    CHECK(queue.remaining(500) == 0);
+    CHECK(queue.next(500) == vcpu);
+}
+
+TEST_CASE("run_queue: round robin")
+{
+    MockRepository mocks;
+    auto vcpu1 = setup_vcpu(mocks);
+    auto vcpu2 = setup_vcpu(mocks);
+    auto vcpu3 = setup_vcpu(mocks);
+
+    run_queue queue{100};
+    queue.add(vcpu1);
+    queue.add(vcpu2);
+    queue.add(vcpu3);
+
+    CHECK(queue.next(0) == vcpu1);
+    CHECK(queue.current() == vcpu1);
+    CHECK(queue.next(100) == vcpu2);
+    CHECK(queue.next(200) == vcpu3);
+    CHECK(queue.next(300) == vcpu1);
+}
+
+TEST_CASE("run_queue: remaining uses the simulated clock")
+{
+    MockRepository mocks;
+    auto vcpu1 = setup_vcpu(mocks);
+    auto vcpu2 = setup_vcpu(mocks);
+
+    run_queue queue{100};
+    queue.add(vcpu1);
+    queue.add(vcpu2, 300);
+
+    CHECK(queue.next(1000) == vcpu1);
+    CHECK(queue.remaining(1000) == 100);
+    CHECK(queue.remaining(1040) == 60);
+    CHECK(queue.remaining(1100) == 1);
+    CHECK(queue.remaining(2000) == 1);
+
+    // vcpu1 yields early, and vcpu2 gets its own (larger) time slice
+
+    CHECK(queue.next(1020) == vcpu2);
+    CHECK(queue.remaining(1020) == 300);
+    CHECK(queue.remaining(1120) == 200);
+}
+
+TEST_CASE("run_queue: remove")
+{
+    MockRepository mocks;
+    auto vcpu1 = setup_vcpu(mocks);
+    auto vcpu2 = setup_vcpu(mocks);
+    auto vcpu3 = setup_vcpu(mocks);
+
+    run_queue queue{100};
+    queue.add(vcpu1);
+    queue.add(vcpu2);
+    queue.add(vcpu3);
+
+    CHECK(queue.next(0) == vcpu1);
+
+    queue.remove(vcpu2);
+    CHECK(queue.size() == 2);
+    CHECK(queue.current() == vcpu1);
+    CHECK(queue.next(100) == vcpu3);
+
+    queue.remove(vcpu3);
+    CHECK(queue.current() == nullptr);
+    CHECK(queue.remaining(100) == 0);
+    CHECK(queue.next(200) == vcpu1);
+    CHECK(queue.remaining(250) == 0);
+}
+
+TEST_CASE("run_queue: boost")
+{
+    MockRepository mocks;
+    auto vcpu1 = setup_vcpu(mocks);
+    auto vcpu2 = setup_vcpu(mocks);
+    auto vcpu3 = setup_vcpu(mocks);
+    auto vcpu4 = setup_vcpu(mocks);
+
+    run_queue queue{100};
+    queue.add(vcpu1);
+    queue.add(vcpu2);
+    queue.add(vcpu3);
+
+    CHECK(!queue.boost(vcpu4));
+    CHECK(queue.boost(vcpu3));
+    CHECK(queue.next(0) == vcpu3);
+
+    CHECK(!queue.boost(vcpu3));
+    CHECK(queue.boost(vcpu2));
+    CHECK(queue.next(10) == vcpu2);
+    CHECK(queue.next(20) == vcpu1);
+    CHECK(queue.next(30) == vcpu3);
+}
+
+TEST_CASE("scheduler: usec to ticks")
+{
+    CHECK(scheduler::usec_to_ticks(0, 2000000) == 0);
+    CHECK(scheduler::usec_to_ticks(1000, 2000000) == 2000000);
+    CHECK(scheduler::usec_to_ticks(1, 2400000) == 2400);
+}
+
+static void
+setup_tsc_frequency()
+{
+    using namespace ::intel_x64::cpuid;
+
+    g_eax_cpuid[0] = time_stamp_count::addr;
+    g_eax_cpuid[time_stamp_count::addr] = 1;
+    g_ebx_cpuid[time_stamp_count::addr] = 1;
+    g_ecx_cpuid[time_stamp_count::addr] = 1000000;
+}
+
+static bool
+hlt_exiting_enabled()
+{
+    using namespace vmcs_n::primary_processor_based_vm_execution_controls;
+    return hlt_exiting::is_enabled();
+}
+
+TEST_CASE("scheduler: single vcpu does not exit on hlt")
+{
+    setup_test_support();
+    setup_tsc_frequency();
+
+    MockRepository mocks;
+    auto vcpu1 = setup_vcpu(mocks);
+    auto vcpu2 = setup_vcpu(mocks);
+
+    mocks.OnCall(vcpu1, bfvmm::intel_x64::vcpu::run);
+    mocks.OnCall(vcpu2, bfvmm::intel_x64::vcpu::run);
+
+    scheduler sched;
+    sched.add(vcpu1);
+    sched.run();
+
+    CHECK(!hlt_exiting_enabled());
+
+    // A HLT that exits anyway (i.e., before HLT exiting was disabled) is
+    // not advanced over, so the guest executes it again natively.
+
+    g_state.rip = 0;
+    CHECK(sched.handle_yield(vcpu1));
+    CHECK(g_state.rip == 0);
+    CHECK(!hlt_exiting_enabled());
+
+    sched.add(vcpu2);
+    CHECK(hlt_exiting_enabled());
+
+    CHECK(sched.handle_yield(vcpu1));
+    CHECK(g_state.rip == 42);
+    CHECK(hlt_exiting_enabled());
+}
+
+#endif
@@ -0,0 +1,192 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+namespace cr0 = ::intel_x64::cr0;
+namespace cr4 = ::intel_x64::cr4;
+
+constexpr const auto guest_id = 0x0000000100000001ULL;
+constexpr const auto guest_msr = 0x10ULL;
+constexpr const auto guest_port = 0x42ULL;
+
+static bool
+test_rdmsr_handler(
+    vcpu_t *vcpu, bfvmm::intel_x64::rdmsr_handler::info_t &info)
+{ bfignored(vcpu); bfignored(info); return true; }
+
+static bool
+test_io_handler(
+    vcpu_t *vcpu, bfvmm::intel_x64::io_instruction_handler::info_t &info)
+{ bfignored(vcpu); bfignored(info); return true; }
+
+static bool
+test_cr_handler(vcpu_t *vcpu)
+{ bfignored(vcpu); return true; }
+
+static uint64_t g_constructor_clears{};
+static uint64_t g_guest_clears{};
+
+class pooled_vcpu : public bfvmm::intel_x64::vcpu
+{
+public:
+
+    explicit pooled_vcpu(vcpuid::type id) :
+        bfvmm::intel_x64::vcpu{id}
+    {
+        this->add_rdmsr_handler(guest_msr, test_rdmsr_handler);
+        this->add_io_instruction_handler(guest_port, test_io_handler, test_io_handler);
+        this->add_wrcr0_handler(cr0::task_switched::mask, test_cr_handler);
+        this->add_clear_delegate({[](vcpu_t *) { g_constructor_clears++; }});
+    }
+};
+
+static void
+setup_vcpu_reset_test()
+{
+    setup_test_support();
+
+    namespace cpuid = ::intel_x64::cpuid;
+
+    g_msrs[::intel_x64::msrs::ia32_vmx_ept_vpid_cap::addr] = 0xFFFFFFFFFFFFFFFFULL;
+
+    g_ecx_cpuid[cpuid::feature_information::addr] |=
+        cpuid::feature_information::ecx::xsave::mask;
+    g_eax_cpuid[cpuid::extended_state_enum::addr] =
+        cpuid::extended_state_enum::subleaf1::eax::xsaves_xrstors::mask;
+    g_ebx_cpuid[cpuid::extended_state_enum::addr] = 0x1000;
+
+    g_constructor_clears = 0;
+    g_guest_clears = 0;
+}
+
+static bool
+msr_trapped(bfvmm::intel_x64::vcpu &vcpu, uint64_t msr)
+{ return (vcpu.msr_bitmap()[msr / 8] & (1U << (msr % 8))) != 0; }
+
+static bool
+port_trapped(bfvmm::intel_x64::vcpu &vcpu, uint64_t port)
+{ return (vcpu.io_bitmap_a()[port / 8] & (1U << (port % 8))) != 0; }
+
+TEST_CASE("vcpu: reset keeps the constructor's traps")
+{
+    setup_vcpu_reset_test();
+    pooled_vcpu vcpu{guest_id};
+
+    CHECK(msr_trapped(vcpu, guest_msr));
+    CHECK(port_trapped(vcpu, guest_port));
+
+    CHECK_NOTHROW(vcpu.retire());
+    CHECK_NOTHROW(vcpu.reset(guest_id + 1));
+
+    CHECK(vcpu.id() == guest_id + 1);
+    CHECK(msr_trapped(vcpu, guest_msr));
+    CHECK(port_trapped(vcpu, guest_port));
+}
+
+TEST_CASE("vcpu: retire runs the clear delegates")
+{
+    setup_vcpu_reset_test();
+    pooled_vcpu vcpu{guest_id};
+
+    CHECK_NOTHROW(vcpu.retire());
+    CHECK(g_constructor_clears == 1);
+}
+
+TEST_CASE("vcpu: reset keeps the constructor's delegates")
+{
+    setup_vcpu_reset_test();
+    pooled_vcpu vcpu{guest_id};
+
+    vcpu.retire();
+    vcpu.reset(guest_id + 1);
+
+    vcpu.add_clear_delegate({[](vcpu_t *) { g_guest_clears++; }});
+
+    vcpu.retire();
+    CHECK(g_constructor_clears == 2);
+    CHECK(g_guest_clears == 1);
+
+    vcpu.reset(guest_id + 2);
+
+    vcpu.retire();
+    CHECK(g_constructor_clears == 3);
+    CHECK(g_guest_clears == 1);
+}
+
+TEST_CASE("vcpu: reset restores the cr0 and cr4 masks")
+{
+    setup_vcpu_reset_test();
+
+    bfvmm::intel_x64::vcpu vcpu{guest_id};
+    auto cr0_mask = vmcs_n::cr0_guest_host_mask::get();
+    auto cr4_mask = vmcs_n::cr4_guest_host_mask::get();
+
+    vcpu.retire();
+    vcpu.reset(guest_id + 1);
+
+    vcpu.add_wrcr0_handler(cr0::task_switched::mask, test_cr_handler);
+    vcpu.add_wrcr4_handler(cr4::page_global_enable::mask, test_cr_handler);
+
+    CHECK(vmcs_n::cr0_guest_host_mask::get() == (cr0_mask | cr0::task_switched::mask));
+    CHECK(vmcs_n::cr4_guest_host_mask::get() == (cr4_mask | cr4::page_global_enable::mask));
+
+    vcpu.retire();
+    vcpu.reset(guest_id + 2);
+
+    CHECK(vmcs_n::cr0_guest_host_mask::get() == cr0_mask);
+    CHECK(vmcs_n::cr4_guest_host_mask::get() == cr4_mask);
+}
+
+TEST_CASE("vcpu: reset keeps the constructor's cr0 and cr4 traps")
+{
+    setup_vcpu_reset_test();
+    pooled_vcpu vcpu{guest_id};
+
+    CHECK((vmcs_n::cr0_guest_host_mask::get() & cr0::task_switched::mask) != 0);
+
+    vcpu.retire();
+    vcpu.reset(guest_id + 1);
+
+    CHECK((vmcs_n::cr0_guest_host_mask::get() & cr0::task_switched::mask) != 0);
+}
+
+TEST_CASE("vcpu: gva_to_gpa sees a cached cr0 write")
+{
+    setup_vcpu_reset_test();
+    pooled_vcpu vcpu{guest_id};
+
+    // The guest turns paging off, but the write has not been flushed to
+    // the VMCS yet, so translations must already be identity mapped
+
+    vmcs_n::guest_cr0::set(cr0::paging::mask | cr0::protection_enable::mask);
+    vcpu.set_cr0(cr0::protection_enable::mask);
+
+    CHECK(vmcs_n::guest_cr0::paging::is_enabled());
+    CHECK(vcpu.gva_to_gpa(0x1000).first == 0x1000);
+}
+
+#endif
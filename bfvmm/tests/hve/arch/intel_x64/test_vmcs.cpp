@@ -109,6 +109,31 @@ TEST_CASE("vmcs: promote failure")
     CHECK_THROWS(vmcs.promote());
 }
 
+TEST_CASE("vmcs: promote with the lazy xsave switch pending")
+{
+    using namespace bfvmm::intel_x64;
+
+    MockRepository mocks;
+    auto vmcs = setup_vmcs(mocks);
+
+    // vmcs_promote decides whether the guest's XSAVE state has to be
+    // restored using these fields, so their offsets have to match the
+    // ones used by the assembly.
+
+    CHECK(offsetof(vcpu_state_t, vcpu_ptr) == 0x098);
+    CHECK(offsetof(vcpu_state_t, xcr0) == 0x0A8);
+    CHECK(offsetof(vcpu_state_t, ia32_xss) == 0x0B8);
+    CHECK(offsetof(vcpu_state_t, guest_xsaves_area_ptr) == 0x0C8);
+    CHECK(offsetof(vcpu_state_t, xsave_switched) == 0x110);
+
+    g_state.xsave_switched = 0;
+    g_promoted_state = nullptr;
+
+    CHECK_THROWS(vmcs.promote());
+    CHECK(g_promoted_state == &g_state);
+    CHECK(g_state.xsave_switched == 0);
+}
+
 TEST_CASE("vmcs: resume failure")
 {
     MockRepository mocks;
@@ -0,0 +1,109 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+#include <test/support.h>
+
+using namespace bfvmm::intel_x64;
+
+TEST_CASE("vmcs_write_cache: read through when clean")
+{
+    vmcs_write_cache cache{};
+    g_vmcs_fields[::intel_x64::vmcs::guest_cr3::addr] = 42;
+
+    CHECK(!cache.dirty());
+    CHECK(cache.read(vmcs_write_cache::cr3) == 42);
+}
+
+TEST_CASE("vmcs_write_cache: write is deferred until flush")
+{
+    vmcs_write_cache cache{};
+    g_vmcs_fields[::intel_x64::vmcs::guest_cr3::addr] = 42;
+
+    cache.write(vmcs_write_cache::cr3, 0x1000);
+
+    CHECK(cache.dirty());
+    CHECK(cache.read(vmcs_write_cache::cr3) == 0x1000);
+    CHECK(g_vmcs_fields[::intel_x64::vmcs::guest_cr3::addr] == 42);
+
+    cache.flush();
+
+    CHECK(!cache.dirty());
+    CHECK(g_vmcs_fields[::intel_x64::vmcs::guest_cr3::addr] == 0x1000);
+    CHECK(cache.read(vmcs_write_cache::cr3) == 0x1000);
+}
+
+TEST_CASE("vmcs_write_cache: writes are coalesced")
+{
+    vmcs_write_cache cache{};
+
+    cache.write(vmcs_write_cache::cr0, 1);
+    cache.write(vmcs_write_cache::cr0, 2);
+    cache.write(vmcs_write_cache::cr0, 3);
+    cache.write(vmcs_write_cache::ia32_efer, 4);
+    cache.flush();
+
+    CHECK(g_vmcs_fields[::intel_x64::vmcs::guest_cr0::addr] == 3);
+    CHECK(g_vmcs_fields[::intel_x64::vmcs::guest_ia32_efer::addr] == 4);
+
+    CHECK(cache.stats().writes == 4);
+    CHECK(cache.stats().vmwrites == 2);
+    CHECK(cache.stats().flushes == 1);
+}
+
+TEST_CASE("vmcs_write_cache: empty flush")
+{
+    vmcs_write_cache cache{};
+    cache.flush();
+
+    CHECK(cache.stats().flushes == 0);
+    CHECK(cache.stats().vmwrites == 0);
+}
+
+TEST_CASE("vmcs_write_cache: every field has an encoding")
+{
+    for (auto i = 0ULL; i < vmcs_write_cache::num_fields; i++) {
+        auto index = static_cast<vmcs_write_cache::index_t>(i);
+        g_vmcs_fields.erase(vmcs_write_cache::field(index));
+
+        vmcs_write_cache cache{};
+        cache.write(index, i + 1);
+        cache.flush();
+
+        CHECK(g_vmcs_fields[vmcs_write_cache::field(index)] == i + 1);
+    }
+
+    CHECK(vmcs_write_cache::field(vmcs_write_cache::es_selector) ==
+          ::intel_x64::vmcs::guest_es_selector::addr);
+    CHECK(vmcs_write_cache::field(vmcs_write_cache::ia32_pat) ==
+          ::intel_x64::vmcs::guest_ia32_pat::addr);
+}
+
+TEST_CASE("vmcs_write_cache: out of range")
+{
+    vmcs_write_cache cache{};
+    auto index = vmcs_write_cache::num_fields;
+
+    CHECK_THROWS(cache.read(index));
+    CHECK_THROWS(cache.write(index, 0));
+    CHECK_THROWS(vmcs_write_cache::field(index));
+}
@@ -0,0 +1,165 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+#include <test/support.h>
+
+#include <hve/arch/intel_x64/vmcs_template.h>
+
+using namespace bfvmm::intel_x64;
+namespace vmcs_n = ::intel_x64::vmcs;
+
+static void
+write_test_state()
+{
+    vmcs_n::host_cs_selector::set(1 << 3);
+    vmcs_n::host_ss_selector::set(2 << 3);
+    vmcs_n::host_fs_selector::set(0);
+    vmcs_n::host_cr3::set(0x1000);
+    vmcs_n::host_rip::set(0xABCDEF);
+    vmcs_n::pin_based_vm_execution_controls::set(0x16);
+    vmcs_n::vm_entry_controls::set(0x93FF);
+}
+
+static const std::initializer_list<uint64_t> test_fields = {
+    vmcs_n::host_cs_selector::addr,
+    vmcs_n::host_ss_selector::addr,
+    vmcs_n::host_fs_selector::addr,
+    vmcs_n::host_cr3::addr,
+    vmcs_n::host_rip::addr,
+    vmcs_n::pin_based_vm_execution_controls::addr,
+    vmcs_n::vm_entry_controls::addr
+};
+
+TEST_CASE("vmcs_template: apply before capture")
+{
+    g_vmcs_fields.clear();
+    vmcs_template golden{};
+
+    CHECK(!golden.captured());
+    CHECK(!golden.apply());
+    CHECK(g_vmcs_fields.empty());
+}
+
+TEST_CASE("vmcs_template: capture skips fields that are not set")
+{
+    g_vmcs_fields.clear();
+    write_test_state();
+
+    vmcs_template golden{};
+    golden.capture(test_fields);
+
+    CHECK(golden.captured());
+    CHECK(golden.entries().size() == 6);
+
+    for (const auto &entry : golden.entries()) {
+        CHECK(entry.field != vmcs_n::host_fs_selector::addr);
+    }
+}
+
+TEST_CASE("vmcs_template: apply matches the captured vmcs")
+{
+    g_vmcs_fields.clear();
+    write_test_state();
+
+    auto expected = g_vmcs_fields;
+
+    vmcs_template golden{};
+    golden.capture(test_fields);
+
+    g_vmcs_fields.clear();
+    CHECK(golden.apply());
+
+    for (const auto &field : test_fields) {
+        CHECK(::intel_x64::vm::read(field) == expected[field]);
+    }
+}
+
+TEST_CASE("vmcs_template: capture only once")
+{
+    g_vmcs_fields.clear();
+    write_test_state();
+
+    vmcs_template golden{};
+    golden.capture(test_fields);
+
+    vmcs_n::host_rip::set(0x42);
+    golden.capture(test_fields);
+
+    g_vmcs_fields.clear();
+    golden.apply();
+
+    CHECK(vmcs_n::host_rip::get() == 0xABCDEF);
+}
+
+TEST_CASE("vmcs_template: clear")
+{
+    g_vmcs_fields.clear();
+    write_test_state();
+
+    vmcs_template golden{};
+    golden.capture(test_fields);
+    golden.clear();
+
+    CHECK(!golden.captured());
+    CHECK(golden.entries().empty());
+    CHECK(!golden.apply());
+
+    vmcs_n::host_rip::set(0x42);
+    golden.capture(test_fields);
+
+    g_vmcs_fields.clear();
+    golden.apply();
+
+    CHECK(vmcs_n::host_rip::get() == 0x42);
+}
+
+static std::map<uint64_t, uint64_t>
+written_fields()
+{
+    std::map<uint64_t, uint64_t> fields;
+
+    for (const auto &[field, val] : g_vmcs_fields) {
+        if (val != 0) {
+            fields[field] = val;
+        }
+    }
+
+    return fields;
+}
+
+TEST_CASE("vmcs_template: captures every field the shared writers write")
+{
+    for (auto host : {true, false}) {
+        setup_test_support();
+        g_vmcs_fields.clear();
+
+        vmcs_template golden{};
+        bfvmm::intel_x64::vcpu::write_shared_state(golden, host);
+
+        auto expected = written_fields();
+        g_vmcs_fields.clear();
+
+        CHECK(golden.apply());
+        CHECK(written_fields() == expected);
+    }
+}
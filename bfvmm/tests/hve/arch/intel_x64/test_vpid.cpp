@@ -0,0 +1,124 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <catch/catch.hpp>
+#include <test/support.h>
+
+using namespace bfvmm::intel_x64;
+
+TEST_CASE("vpid_allocator: acquire")
+{
+    vpid_allocator allocator{};
+
+    vpid_allocator::id_type id1{};
+    vpid_allocator::id_type id2{};
+    vpid_allocator::generation_type gen1{};
+    vpid_allocator::generation_type gen2{};
+
+    CHECK(!allocator.acquire(id1, gen1));
+    CHECK(!allocator.acquire(id2, gen2));
+
+    CHECK(id1 == 1);
+    CHECK(id2 == 2);
+    CHECK(gen1 == allocator.generation());
+    CHECK(gen2 == allocator.generation());
+    CHECK(allocator.stats().allocations == 2);
+}
+
+TEST_CASE("vpid_allocator: valid vpids are kept")
+{
+    vpid_allocator allocator{};
+
+    vpid_allocator::id_type id{};
+    vpid_allocator::generation_type gen{};
+
+    CHECK(!allocator.acquire(id, gen));
+    CHECK(!allocator.acquire(id, gen));
+    CHECK(!allocator.acquire(id, gen));
+
+    CHECK(id == 1);
+    CHECK(allocator.is_valid(id, gen));
+    CHECK(allocator.stats().allocations == 1);
+}
+
+TEST_CASE("vpid_allocator: rollover")
+{
+    vpid_allocator allocator{};
+
+    vpid_allocator::id_type old_id{};
+    vpid_allocator::generation_type old_gen{};
+
+    CHECK(!allocator.acquire(old_id, old_gen));
+
+    for (auto i = 1ULL; i < vpid_allocator::max_id; i++) {
+        vpid_allocator::id_type id{};
+        vpid_allocator::generation_type gen{};
+
+        CHECK(!allocator.acquire(id, gen));
+    }
+
+    vpid_allocator::id_type id{};
+    vpid_allocator::generation_type gen{};
+
+    CHECK(allocator.acquire(id, gen));
+    CHECK(id == 1);
+    CHECK(gen == old_gen + 1);
+    CHECK(allocator.stats().rollovers == 1);
+
+    CHECK(!allocator.is_valid(old_id, old_gen));
+    CHECK(!allocator.acquire(old_id, old_gen));
+    CHECK(old_id == 2);
+    CHECK(old_gen == gen);
+}
+
+TEST_CASE("vpid_allocator: churn")
+{
+    vpid_allocator allocator{};
+
+    // A long running guest vCPU, with thousands of short lived vCPUs being
+    // created and destroyed on the same core
+
+    vpid_allocator::id_type guest_id{};
+    vpid_allocator::generation_type guest_gen{};
+
+    CHECK(!allocator.acquire(guest_id, guest_gen));
+
+    for (auto i = 0; i < 10000; i++) {
+        vpid_allocator::id_type id{};
+        vpid_allocator::generation_type gen{};
+
+        CHECK(!allocator.acquire(id, gen));
+        CHECK(!allocator.acquire(guest_id, guest_gen));
+    }
+
+    CHECK(guest_id == 1);
+    CHECK(allocator.stats().rollovers == 0);
+    CHECK(allocator.stats().allocations == 10001);
+}
+
+TEST_CASE("vpid_allocator: instance")
+{
+    CHECK(&vpid_allocator::instance(0) == &vpid_allocator::instance(0));
+    CHECK(&vpid_allocator::instance(0) != &vpid_allocator::instance(1));
+
+    CHECK_THROWS(vpid_allocator::instance(MAX_NUM_PCPUS));
+}
@@ -0,0 +1,190 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+using handler_t = bfvmm::intel_x64::control_register_handler;
+
+namespace cr0 = ::intel_x64::cr0;
+namespace cr4 = ::intel_x64::cr4;
+
+constexpr const auto cr0_always_owned =
+    cr0::protection_enable::mask | cr0::paging::mask |
+    cr0::extension_type::mask | cr0::not_write_through::mask | cr0::cache_disable::mask;
+
+constexpr const auto cr4_always_owned =
+    cr4::vmx_enable_bit::mask;
+
+// The mocked vCPU returns the guest's view of CR0/CR4 the same way
+// vcpu::cr0()/cr4() do: the read shadow for bits in the guest/host mask,
+// and the guest's control register for every other bit.
+
+auto
+setup_cr_vcpu(MockRepository &mocks)
+{
+    auto vcpu = setup_vcpu(mocks);
+
+    g_global_state.ia32_vmx_cr0_fixed0 = cr0::protection_enable::mask | cr0::paging::mask;
+    g_global_state.ia32_vmx_cr4_fixed0 = cr4::vmx_enable_bit::mask;
+
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::cr0).Do([] {
+        auto mask = g_vmcs_fields[vmcs_n::cr0_guest_host_mask::addr];
+        return (g_vmcs_fields[vmcs_n::guest_cr0::addr] & ~mask) |
+               (g_vmcs_fields[vmcs_n::cr0_read_shadow::addr] & mask);
+    });
+
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::cr4).Do([] {
+        auto mask = g_vmcs_fields[vmcs_n::cr4_guest_host_mask::addr];
+        return (g_vmcs_fields[vmcs_n::guest_cr4::addr] & ~mask) |
+               (g_vmcs_fields[vmcs_n::cr4_read_shadow::addr] & mask);
+    });
+
+    return vcpu;
+}
+
+TEST_CASE("control_register: wrcr0 mask only owns the required bits")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_cr_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.enable_wrcr0_exiting(0);
+
+    CHECK(vmcs_n::cr0_guest_host_mask::get() == cr0_always_owned);
+}
+
+TEST_CASE("control_register: wrcr0 exiting adds to the mask")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_cr_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.enable_wrcr0_exiting(cr0::task_switched::mask);
+    handler.enable_wrcr0_exiting(cr0::write_protect::mask);
+
+    CHECK(vmcs_n::cr0_guest_host_mask::get() ==
+          (cr0_always_owned | cr0::task_switched::mask | cr0::write_protect::mask));
+}
+
+TEST_CASE("control_register: set wrcr0 mask replaces the mask")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_cr_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.enable_wrcr0_exiting(cr0::task_switched::mask);
+    handler.set_wrcr0_mask(cr0::write_protect::mask);
+
+    CHECK(vmcs_n::cr0_guest_host_mask::get() == (cr0_always_owned | cr0::write_protect::mask));
+
+    handler.set_wrcr0_mask(0);
+    CHECK(vmcs_n::cr0_guest_host_mask::get() == cr0_always_owned);
+}
+
+TEST_CASE("control_register: wrcr0 mask keeps the guest's view in the read shadow")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_cr_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.set_wrcr0_mask(0);
+
+    // The guest set CR0.TS without an exit, so only the guest's CR0 has it
+
+    auto guest_cr0 = cr0::protection_enable::mask | cr0::paging::mask | cr0::task_switched::mask;
+    vmcs_n::guest_cr0::set(guest_cr0);
+    vmcs_n::cr0_read_shadow::set(cr0::protection_enable::mask | cr0::paging::mask);
+
+    handler.enable_wrcr0_exiting(cr0::task_switched::mask);
+
+    CHECK(vmcs_n::cr0_read_shadow::get() == guest_cr0);
+    CHECK(vcpu->cr0() == guest_cr0);
+}
+
+TEST_CASE("control_register: wrcr4 mask only owns the required bits")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_cr_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.enable_wrcr4_exiting(0);
+
+    CHECK(vmcs_n::cr4_guest_host_mask::get() == cr4_always_owned);
+}
+
+TEST_CASE("control_register: set wrcr4 mask replaces the mask")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_cr_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.enable_wrcr4_exiting(cr4::page_global_enable::mask);
+    handler.enable_wrcr4_exiting(cr4::osxsave::mask);
+
+    CHECK(vmcs_n::cr4_guest_host_mask::get() ==
+          (cr4_always_owned | cr4::page_global_enable::mask | cr4::osxsave::mask));
+
+    handler.set_wrcr4_mask(cr4::osxsave::mask);
+    CHECK(vmcs_n::cr4_guest_host_mask::get() == (cr4_always_owned | cr4::osxsave::mask));
+}
+
+TEST_CASE("control_register: wrcr4 mask keeps the guest's view in the read shadow")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_cr_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.set_wrcr4_mask(0);
+
+    // The guest set CR4.PGE without an exit, so only the guest's CR4 has it
+
+    auto guest_cr4 = cr4::vmx_enable_bit::mask | cr4::page_global_enable::mask;
+    vmcs_n::guest_cr4::set(guest_cr4);
+    vmcs_n::cr4_read_shadow::set(0);
+
+    handler.enable_wrcr4_exiting(cr4::page_global_enable::mask);
+
+    // VMXE is owned by the VMM, so the guest keeps seeing it as clear
+
+    CHECK(vmcs_n::cr4_read_shadow::get() == cr4::page_global_enable::mask);
+    CHECK(vcpu->cr4() == cr4::page_global_enable::mask);
+}
+
+#endif
@@ -0,0 +1,375 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+using handler_t = bfvmm::intel_x64::io_instruction_handler;
+
+constexpr const auto port = 0x42ULL;
+constexpr const auto one_byte = 0ULL;
+
+bool
+in_string_handler(bfvmm::intel_x64::vcpu *vcpu, handler_t::string_info_t &info)
+{
+    bfignored(vcpu);
+
+    // The port has not been read yet, so buf still holds the guest's memory
+
+    for (auto &byte : info.buf) {
+        CHECK(byte == 0xAA);
+        byte = 0x11;
+    }
+
+    return true;
+}
+
+bool
+in_string_handler_declined(bfvmm::intel_x64::vcpu *vcpu, handler_t::string_info_t &info)
+{
+    bfignored(vcpu);
+    bfignored(info);
+
+    return false;
+}
+
+bool
+in_handler(bfvmm::intel_x64::vcpu *vcpu, handler_t::info_t &info)
+{
+    bfignored(vcpu);
+
+    CHECK(info.val == 0x23);
+    info.val = 0x24;
+
+    return true;
+}
+
+bool
+in_handler_declined(bfvmm::intel_x64::vcpu *vcpu, handler_t::info_t &info)
+{
+    bfignored(vcpu);
+    bfignored(info);
+
+    return false;
+}
+
+bool
+in_handler_first_two(bfvmm::intel_x64::vcpu *vcpu, handler_t::info_t &info)
+{
+    bfignored(vcpu);
+
+    info.val = 0x24;
+    return info.address < 0x1002;
+}
+
+bool
+out_handler(bfvmm::intel_x64::vcpu *vcpu, handler_t::info_t &info)
+{
+    bfignored(vcpu);
+
+    CHECK(info.val == 0x55);
+    return true;
+}
+
+auto
+setup_string_info(std::array<uint8_t, 4> &buf)
+{
+    return handler_t::string_info_t {
+        port,
+        one_byte,
+        0x1000,
+        buf.size(),
+        gsl::span<uint8_t>(buf),
+        false,
+        false
+    };
+}
+
+TEST_CASE("io_instruction: string in handled by string handler")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_string_handler(
+        port,
+        in_string_handler,
+        in_string_handler_declined
+    );
+
+    std::array<uint8_t, 4> buf{0xAA, 0xAA, 0xAA, 0xAA};
+    auto info = setup_string_info(buf);
+
+    g_ports[port] = 0x23;
+    CHECK(handler.handle_string_in(vcpu, info));
+
+    for (const auto &byte : buf) {
+        CHECK(byte == 0x11);
+    }
+}
+
+TEST_CASE("io_instruction: string in falls back to a single rep ins")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_string_handler(
+        port,
+        in_string_handler_declined,
+        in_string_handler_declined
+    );
+    handler.add_handler(
+        port,
+        in_handler,
+        out_handler
+    );
+
+    std::array<uint8_t, 4> buf{0xAA, 0xAA, 0xAA, 0xAA};
+    auto info = setup_string_info(buf);
+
+    g_ports[port] = 0x23;
+    CHECK(handler.handle_string_in(vcpu, info));
+
+    for (const auto &byte : buf) {
+        CHECK(byte == 0x24);
+    }
+}
+
+TEST_CASE("io_instruction: string in without handlers")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_string_handler(
+        port,
+        in_string_handler_declined,
+        in_string_handler_declined
+    );
+
+    std::array<uint8_t, 4> buf{0xAA, 0xAA, 0xAA, 0xAA};
+    auto info = setup_string_info(buf);
+
+    // Nothing handles the access, so the port must not be consumed
+
+    g_ports[port] = 0x23;
+    CHECK_FALSE(handler.handle_string_in(vcpu, info));
+
+    for (const auto &byte : buf) {
+        CHECK(byte == 0xAA);
+    }
+}
+
+TEST_CASE("io_instruction: string in emulated without a handler")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_handler(
+        port,
+        in_handler_declined,
+        out_handler
+    );
+    handler.emulate(port);
+
+    std::array<uint8_t, 4> buf{0xAA, 0xAA, 0xAA, 0xAA};
+    auto info = setup_string_info(buf);
+
+    g_ports[port] = 0x23;
+    CHECK(handler.handle_string_in(vcpu, info));
+    CHECK(info.count == 0);
+}
+
+TEST_CASE("io_instruction: string in element not handled")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_handler(
+        port,
+        in_handler_declined,
+        out_handler
+    );
+
+    std::array<uint8_t, 4> buf{0xAA, 0xAA, 0xAA, 0xAA};
+    auto info = setup_string_info(buf);
+
+    // Like a single access, an element that no handler accepts is left to
+    // the default handler, even though the port was read
+
+    g_ports[port] = 0x23;
+    CHECK(handler.handle_string_in(vcpu, info));
+    CHECK(info.count == 0);
+}
+
+TEST_CASE("io_instruction: string in stops at the first element not handled")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_handler(
+        port,
+        in_handler_first_two,
+        out_handler
+    );
+
+    std::array<uint8_t, 4> buf{0xAA, 0xAA, 0xAA, 0xAA};
+    auto info = setup_string_info(buf);
+
+    g_ports[port] = 0x23;
+    CHECK(handler.handle_string_in(vcpu, info));
+    CHECK(info.count == 2);
+    CHECK(buf.at(0) == 0x24);
+    CHECK(buf.at(1) == 0x24);
+}
+
+TEST_CASE("io_instruction: string handlers")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    CHECK_FALSE(handler.has_string_handlers(port, true));
+    CHECK_FALSE(handler.has_string_handlers(port, false));
+
+    handler.add_handler(
+        port,
+        in_handler,
+        out_handler
+    );
+
+    CHECK(handler.has_string_handlers(port, true));
+    CHECK(handler.has_string_handlers(port, false));
+    CHECK_FALSE(handler.has_string_handlers(port + 1, true));
+}
+
+TEST_CASE("io_instruction: string out")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_handler(
+        port,
+        in_handler,
+        out_handler
+    );
+
+    std::array<uint8_t, 4> buf{0x55, 0x55, 0x55, 0x55};
+    auto info = setup_string_info(buf);
+
+    g_ports[port] = 0x23;
+    CHECK(handler.handle_string_out(vcpu, info));
+    CHECK(g_ports[port] == 0x55);
+}
+
+TEST_CASE("io_instruction: string address size from the exit information")
+{
+    namespace info = vmcs_n::vm_exit_instruction_information;
+    namespace ins = info::ins;
+
+    setup_test_support();
+    g_msrs[::intel_x64::msrs::ia32_vmx_basic::addr] |=
+        ::intel_x64::msrs::ia32_vmx_basic::ins_outs_exit_information::mask;
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+
+    g_vmcs_fields[info::addr] = ins::address_size::_16bit << ins::address_size::from;
+    CHECK(handler.string_address_mask(vcpu) == 0x000000000000FFFFULL);
+
+    g_vmcs_fields[info::addr] = ins::address_size::_32bit << ins::address_size::from;
+    CHECK(handler.string_address_mask(vcpu) == 0x00000000FFFFFFFFULL);
+
+    g_vmcs_fields[info::addr] = ins::address_size::_64bit << ins::address_size::from;
+    CHECK(handler.string_address_mask(vcpu) == 0xFFFFFFFFFFFFFFFFULL);
+}
+
+TEST_CASE("io_instruction: string address size from the code segment")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::cs_access_rights).Return(0);
+    CHECK(handler.string_address_mask(vcpu) == 0x000000000000FFFFULL);
+
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::cs_access_rights).Return(
+        vmcs_n::guest_cs_access_rights::db::mask
+    );
+    CHECK(handler.string_address_mask(vcpu) == 0x00000000FFFFFFFFULL);
+
+    mocks.OnCall(vcpu, bfvmm::intel_x64::vcpu::cs_access_rights).Return(
+        vmcs_n::guest_cs_access_rights::l::mask
+    );
+    CHECK(handler.string_address_mask(vcpu) == 0xFFFFFFFFFFFFFFFFULL);
+}
+
+TEST_CASE("io_instruction: string register updates")
+{
+    constexpr const auto mask16 = 0x000000000000FFFFULL;
+    constexpr const auto mask32 = 0x00000000FFFFFFFFULL;
+    constexpr const auto mask64 = 0xFFFFFFFFFFFFFFFFULL;
+
+    auto ret = handler_t::string_register_add(0x123456789ABCFFFF, 2, mask16);
+    CHECK(ret == 0x123456789ABC0001);
+    ret = handler_t::string_register_add(0x1234567800000002, 0ULL - 4, mask16);
+    CHECK(ret == 0x123456780000FFFE);
+
+    ret = handler_t::string_register_add(0x12345678FFFFFFFF, 2, mask32);
+    CHECK(ret == 0x0000000000000001);
+    ret = handler_t::string_register_add(0x1234567800000010, 0ULL - 4, mask32);
+    CHECK(ret == 0x000000000000000C);
+
+    ret = handler_t::string_register_add(0x12345678FFFFFFFF, 2, mask64);
+    CHECK(ret == 0x1234567900000001);
+}
+
+#endif
@@ -0,0 +1,198 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch/catch.hpp>
+#include <hippomocks.h>
+
+#include <test/support.h>
+
+#ifdef _HIPPOMOCKS__ENABLE_CFUNC_MOCKING_SUPPORT
+
+using handler_t = bfvmm::intel_x64::pause_handler;
+
+namespace ple = vmcs_n::secondary_processor_based_vm_execution_controls;
+
+bool
+pause_handler_declined(bfvmm::intel_x64::vcpu *vcpu)
+{
+    bfignored(vcpu);
+    return false;
+}
+
+bool
+pause_handler_boost(bfvmm::intel_x64::vcpu *vcpu)
+{
+    bfignored(vcpu);
+    return true;
+}
+
+TEST_CASE("pause: enable and disable exiting")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+
+    handler.enable_exiting();
+    CHECK(ple::pause_loop_exiting::is_enabled());
+
+    handler.disable_exiting();
+    CHECK(ple::pause_loop_exiting::is_disabled());
+}
+
+TEST_CASE("pause: enable exiting not supported")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    g_msrs[intel_x64::msrs::ia32_vmx_procbased_ctls2::addr] = 0;
+
+    handler.enable_exiting();
+    CHECK(ple::pause_loop_exiting::is_disabled());
+}
+
+TEST_CASE("pause: set window")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.set_window(42, 1000);
+
+    CHECK(vmcs_n::ple_gap::get() == 42);
+    CHECK(vmcs_n::ple_window::get() == 1000);
+
+    CHECK(handler.handle(vcpu));
+    CHECK(handler.handle(vcpu));
+    CHECK(handler.stats().spin_ticks == 2000);
+}
+
+TEST_CASE("pause: no policy resumes the guest")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_handler(pause_handler_declined);
+
+    g_state.rip = 0;
+    CHECK(handler.handle(vcpu));
+    CHECK(g_state.rip == 42);
+
+    CHECK(handler.stats().exits == 1);
+    CHECK(handler.stats().yields == 0);
+    CHECK(handler.stats().boosts == 0);
+    CHECK(handler.stats().spin_ticks == handler_t::default_window);
+}
+
+TEST_CASE("pause: removed policy is not called")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_handler(pause_handler_boost);
+    handler.remove_handler(pause_handler_boost);
+
+    CHECK(handler.handle(vcpu));
+    CHECK(handler.stats().boosts == 0);
+}
+
+TEST_CASE("pause: boost policy is not counted as a yield")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    handler.add_handler(pause_handler_declined);
+    handler.add_handler(pause_handler_boost);
+
+    g_state.rip = 0;
+    CHECK(handler.handle(vcpu));
+    CHECK(g_state.rip == 0);
+
+    CHECK(handler.stats().exits == 1);
+    CHECK(handler.stats().yields == 0);
+    CHECK(handler.stats().boosts == 1);
+}
+
+TEST_CASE("pause: yield policy is counted as a yield")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+
+    // A policy that yields the core never returns, which is modeled here
+    // by throwing from the handler once the yield is visible.
+
+    handler.add_handler([&](bfvmm::intel_x64::vcpu *) -> bool {
+
+        CHECK(handler.stats().yields == 1);
+        throw std::runtime_error("yield");
+    });
+
+    CHECK_THROWS(handler.handle(vcpu));
+
+    CHECK(handler.stats().exits == 1);
+    CHECK(handler.stats().yields == 1);
+    CHECK(handler.stats().boosts == 0);
+}
+
+TEST_CASE("pause: policies are called in reverse order")
+{
+    setup_test_support();
+
+    MockRepository mocks;
+    auto vcpu = setup_vcpu(mocks);
+
+    handler_t handler{vcpu};
+    std::vector<int> order;
+
+    handler.add_handler([&](bfvmm::intel_x64::vcpu *) -> bool {
+        order.push_back(1);
+        return false;
+    });
+    handler.add_handler([&](bfvmm::intel_x64::vcpu *) -> bool {
+        order.push_back(2);
+        return false;
+    });
+
+    CHECK(handler.handle(vcpu));
+    CHECK(order == std::vector<int>{2, 1});
+}
+
+#endif
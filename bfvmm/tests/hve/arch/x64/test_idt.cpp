@@ -68,3 +68,19 @@ TEST_CASE("idt_limit")
     bfvmm::x64::idt idt;
     CHECK(idt.limit() == (4 * sizeof(bfvmm::x64::idt::interrupt_descriptor_type)) - 1);
 }
+
+TEST_CASE("idt_set_ist")
+{
+    setup_test_support();
+
+    bfvmm::x64::idt idt{4};
+    idt.set(1, bfvmm::x64::idt::offset_type{0x1000}, 8);
+    CHECK(idt.ist(1) == 1);
+
+    idt.set_ist(1, 0);
+    CHECK(idt.ist(1) == 0);
+    CHECK(idt.present(1));
+    CHECK(idt.selector(1) == 8);
+
+    CHECK_THROWS(idt.set_ist(1, 8));
+}
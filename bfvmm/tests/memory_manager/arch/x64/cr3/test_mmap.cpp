@@ -76,6 +76,45 @@ TEST_CASE("mmap: map 4k")
     CHECK(g_allocated_pages.empty());
 }
 
+TEST_CASE("mmap: map range")
+{
+    {
+        cr3::mmap mmap{};
+        mmap.map_range(0x1FF000, 0x1FF000, 0x402000);
+
+        CHECK(mmap.is_4k(0x1FF000));
+        CHECK(mmap.is_2m(0x200000));
+        CHECK(mmap.is_2m(0x400000));
+        CHECK(mmap.is_4k(0x600000));
+        CHECK(mmap.virt_to_phys(0x400000).first == 0x400000);
+    }
+
+    CHECK(g_allocated_pages.empty());
+}
+
+TEST_CASE("mmap: map range unaligned phys")
+{
+    {
+        cr3::mmap mmap{};
+        mmap.map_range(0x200000, 0x201000, 0x200000);
+
+        CHECK(mmap.is_4k(0x200000));
+        CHECK(mmap.is_4k(0x3FF000));
+        CHECK(mmap.virt_to_phys(0x3FF000).first == 0x400000);
+    }
+
+    CHECK(g_allocated_pages.empty());
+}
+
+TEST_CASE("mmap: map range invalid args")
+{
+    cr3::mmap mmap{};
+
+    CHECK_THROWS(mmap.map_range(0x200123, 0x200000, 0x1000));
+    CHECK_THROWS(mmap.map_range(0x200000, 0x200123, 0x1000));
+    CHECK_THROWS(mmap.map_range(0x200000, 0x200000, 0x123));
+}
+
 TEST_CASE("mmap: map 1g attribute types")
 {
     constexpr auto addr1 = ::x64::pdpt::page_size * 1;
@@ -196,3 +196,143 @@ TEST_CASE("physint_to_virtint success")
 
     g_mm->remove_md(0x12345000, 0x54321000);
 }
+
+TEST_CASE("descriptor_runs merges contiguous descriptors")
+{
+    g_mm->add_md(0x12345000, 0x54321000, MEMORY_TYPE_R | MEMORY_TYPE_W);
+    g_mm->add_md(0x12347000, 0x54323000, MEMORY_TYPE_R | MEMORY_TYPE_W);
+    g_mm->add_md(0x12346000, 0x54322000, MEMORY_TYPE_R | MEMORY_TYPE_W);
+    g_mm->add_md(0x12348000, 0x54324000, MEMORY_TYPE_R | MEMORY_TYPE_E);
+    g_mm->add_md(0x12349000, 0x54330000, MEMORY_TYPE_R | MEMORY_TYPE_E);
+
+    bfvmm::memory_manager::memory_descriptor_run_list runs;
+    for (const auto &run : g_mm->descriptor_runs()) {
+        if (run.virt >= 0x12345000 && run.virt < 0x1234A000) {
+            runs.push_back(run);
+        }
+    }
+
+    REQUIRE(runs.size() == 3);
+    CHECK(runs.at(0).virt == 0x12345000);
+    CHECK(runs.at(0).phys == 0x54321000);
+    CHECK(runs.at(0).size == 0x3000);
+    CHECK(runs.at(1).virt == 0x12348000);
+    CHECK(runs.at(1).size == 0x1000);
+    CHECK(runs.at(2).virt == 0x12349000);
+    CHECK(runs.at(2).phys == 0x54330000);
+    CHECK(runs.at(2).size == 0x1000);
+
+    g_mm->remove_md(0x12345000, 0x54321000);
+    g_mm->remove_md(0x12346000, 0x54322000);
+    g_mm->remove_md(0x12347000, 0x54323000);
+    g_mm->remove_md(0x12348000, 0x54324000);
+    g_mm->remove_md(0x12349000, 0x54330000);
+}
+
+TEST_CASE("node pools: none added")
+{
+    auto ptr = g_mm->alloc_page();
+    CHECK(g_mm->node(ptr) == bfvmm::memory_manager::invalid_node);
+    CHECK(g_mm->size(ptr) == BAREFLANK_PAGE_SIZE);
+
+    g_mm->free_page(ptr);
+}
+
+TEST_CASE("node pools: alloc_page from the current node")
+{
+    numa_topology_simulator numa{2, 2};
+
+    numa.run_on(0);
+    auto ptr1 = g_mm->alloc_page();
+    CHECK(g_mm->node(ptr1) == 0);
+
+    numa.run_on(3);
+    auto ptr2 = g_mm->alloc_page();
+    CHECK(g_mm->node(ptr2) == 1);
+    CHECK(g_mm->size(ptr2) == BAREFLANK_PAGE_SIZE);
+
+    g_mm->free_page(ptr1);
+    g_mm->free_page(ptr2);
+}
+
+TEST_CASE("node pools: node scope")
+{
+    numa_topology_simulator numa{2, 2};
+    numa.run_on(0);
+
+    {
+        bfvmm::memory_manager::node_scope scope{1};
+        CHECK(g_mm->node() == 1);
+
+        auto ptr = g_mm->alloc_page();
+        CHECK(g_mm->node(ptr) == 1);
+        g_mm->free_page(ptr);
+    }
+
+    CHECK(g_mm->node() == 0);
+}
+
+TEST_CASE("node pools: huge alloc")
+{
+    numa_topology_simulator numa{2, 2};
+    numa.run_on(2);
+
+    auto ptr = g_mm->alloc(BAREFLANK_PAGE_SIZE * 2);
+    CHECK(g_mm->node(ptr) == 1);
+    CHECK(g_mm->size(ptr) == BAREFLANK_PAGE_SIZE * 2);
+
+    g_mm->free(ptr);
+}
+
+TEST_CASE("node pools: exhausted pool falls back")
+{
+    numa_topology_simulator numa{1, 1, 0};
+    numa.run_on(0);
+
+    auto ptr1 = g_mm->alloc_page();
+    auto ptr2 = g_mm->alloc_page();
+    CHECK(g_mm->node(ptr1) == 0);
+    CHECK(g_mm->node(ptr2) == bfvmm::memory_manager::invalid_node);
+
+    g_mm->free_page(ptr1);
+    g_mm->free_page(ptr2);
+}
+
+TEST_CASE("node pools: add node pool invalid args")
+{
+    auto buf = aligned_alloc(BAREFLANK_PAGE_SIZE, BAREFLANK_PAGE_SIZE * 4);
+    auto virt = reinterpret_cast<uintptr_t>(buf);
+
+    CHECK_THROWS(g_mm->add_node_pool(virt + 1, BAREFLANK_PAGE_SIZE));
+    CHECK_THROWS(g_mm->add_node_pool(virt, BAREFLANK_PAGE_SIZE * 3));
+    CHECK_THROWS(g_mm->add_node_pool(virt, BAREFLANK_PAGE_SIZE));
+
+    g_mm->add_md(virt, virt, MEMORY_TYPE_R | MEMORY_TYPE_W | MEMORY_TYPE_NODE(1));
+    g_mm->add_md(virt + BAREFLANK_PAGE_SIZE, virt + BAREFLANK_PAGE_SIZE, MEMORY_TYPE_R | MEMORY_TYPE_W);
+    CHECK_THROWS(g_mm->add_node_pool(virt, BAREFLANK_PAGE_SIZE * 2));
+
+    g_mm->remove_md(virt, virt);
+    g_mm->add_md(virt, virt, MEMORY_TYPE_R | MEMORY_TYPE_W | MEMORY_TYPE_NODE(MAX_NUM_NODES));
+    CHECK_THROWS(g_mm->add_node_pool(virt, BAREFLANK_PAGE_SIZE));
+
+    g_mm->remove_md(virt, virt);
+    g_mm->add_md(virt, virt, MEMORY_TYPE_R | MEMORY_TYPE_W | MEMORY_TYPE_NODE(1));
+    CHECK_NOTHROW(g_mm->add_node_pool(virt, BAREFLANK_PAGE_SIZE));
+    CHECK_THROWS(g_mm->add_node_pool(virt, BAREFLANK_PAGE_SIZE));
+
+    g_mm->remove_node_pool(1);
+    g_mm->remove_md(virt, virt);
+    g_mm->remove_md(virt + BAREFLANK_PAGE_SIZE, virt + BAREFLANK_PAGE_SIZE);
+    free(buf);
+}
+
+TEST_CASE("node pools: cpu node")
+{
+    CHECK_THROWS(g_mm->set_cpu_node(MAX_NUM_PCPUS, 0));
+    CHECK_THROWS(g_mm->set_cpu_node(0, MAX_NUM_NODES));
+    CHECK(g_mm->cpu_node(MAX_NUM_PCPUS) == 0);
+
+    CHECK_NOTHROW(g_mm->set_cpu_node(1, 1));
+    CHECK(g_mm->cpu_node(1) == 1);
+    CHECK_NOTHROW(g_mm->set_cpu_node(1, 0));
+}
@@ -63,3 +63,16 @@ TEST_CASE("vcpu: is_guest_vcpu")
     auto vc = std::make_unique<bfvmm::vcpu>(0x0000000100000000);
     CHECK(vc->is_guest_vcpu());
 }
+
+TEST_CASE("vcpu: reset")
+{
+    auto vc = std::make_unique<bfvmm::vcpu>(1);
+    vc->set_data<int>(42);
+
+    vc->reset(0x0000000100000000);
+    CHECK(vc->id() == 0x0000000100000000);
+    CHECK(vc->is_guest_vcpu());
+    CHECK_THROWS(vc->data<int>());
+
+    CHECK_THROWS(vc->reset(vcpuid::reserved));
+}
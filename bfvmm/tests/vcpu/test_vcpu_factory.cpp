@@ -21,7 +21,13 @@
 
 #include <catch/catch.hpp>
 #include <vcpu/vcpu_factory.h>
+
+#include <cstring>
+
+#include <bfdebug.h>
 #include <bfexports.h>
+#include <bfbenchmark.h>
+#include <bfconstants.h>
 
 namespace bfvmm
 {
@@ -40,3 +46,224 @@ TEST_CASE("vcpu_factory: make_vcpu")
     bfvmm::vcpu_factory factory;
     CHECK(factory.make(0, nullptr) != nullptr);
 }
+
+// -----------------------------------------------------------------------------
+// Pool
+// -----------------------------------------------------------------------------
+
+constexpr const auto guest_id1 = 0x0000000100000001ULL;
+constexpr const auto guest_id2 = 0x0000000100000002ULL;
+
+static uint64_t g_retires{};
+
+// The following vCPU allocates roughly what an intel_x64 vCPU allocates
+// (two stacks, three bitmaps, two XSAVE areas and a VMCS), and resets by
+// zeroing that memory, so that the cost of making a vCPU can be compared
+// with the cost of recycling one.
+//
+class heavy_vcpu : public bfvmm::vcpu
+{
+public:
+
+    explicit heavy_vcpu(vcpuid::type id) :
+        bfvmm::vcpu{id},
+        m_stack1{std::make_unique<uint8_t[]>(STACK_SIZE * 2)},
+        m_stack2{std::make_unique<uint8_t[]>(STACK_SIZE * 2)}
+    {
+        for (auto &page : m_pages) {
+            page = std::make_unique<uint8_t[]>(BAREFLANK_PAGE_SIZE);
+        }
+    }
+
+    void reset(vcpuid::type id) override
+    {
+        bfvmm::vcpu::reset(id);
+
+        for (auto &page : m_pages) {
+            std::memset(page.get(), 0, BAREFLANK_PAGE_SIZE);
+        }
+
+        m_resets++;
+    }
+
+    void retire() override
+    {
+        if (m_retire_fails) {
+            throw std::runtime_error("retire failed");
+        }
+
+        g_retires++;
+    }
+
+    uint64_t m_resets{};
+    bool m_retire_fails{};
+
+private:
+
+    std::unique_ptr<uint8_t[]> m_stack1;
+    std::unique_ptr<uint8_t[]> m_stack2;
+    std::array<std::unique_ptr<uint8_t[]>, 6> m_pages;
+};
+
+class heavy_vcpu_factory : public bfvmm::vcpu_factory
+{
+public:
+
+    std::unique_ptr<bfvmm::vcpu>
+    make(vcpuid::type vcpuid, void *data) override
+    {
+        bfignored(data);
+
+        m_makes++;
+        return std::make_unique<heavy_vcpu>(vcpuid);
+    }
+
+    uint64_t m_makes{};
+};
+
+TEST_CASE("vcpu_factory: pool disabled by default")
+{
+    heavy_vcpu_factory factory;
+    CHECK(factory.pool_size() == 0);
+
+    factory.release(factory.acquire(guest_id1, nullptr));
+    CHECK(factory.pooled() == 0);
+
+    factory.release(factory.acquire(guest_id1, nullptr));
+    CHECK(factory.m_makes == 2);
+}
+
+TEST_CASE("vcpu_factory: pool recycles guest vcpus")
+{
+    heavy_vcpu_factory factory;
+    factory.set_pool_size(1);
+
+    auto vcpu = factory.acquire(guest_id1, nullptr);
+    auto ptr = vcpu.get();
+    vcpu->set_data<int>(42);
+
+    factory.release(std::move(vcpu));
+    CHECK(factory.pooled() == 1);
+
+    vcpu = factory.acquire(guest_id2, nullptr);
+    CHECK(vcpu.get() == ptr);
+    CHECK(vcpu->id() == guest_id2);
+    CHECK_THROWS(vcpu->data<int>());
+    CHECK(dynamic_cast<heavy_vcpu *>(vcpu.get())->m_resets == 1);
+
+    CHECK(factory.m_makes == 1);
+    CHECK(factory.pool_stats().hits == 1);
+    CHECK(factory.pool_stats().misses == 1);
+}
+
+TEST_CASE("vcpu_factory: pool ignores host vcpus")
+{
+    heavy_vcpu_factory factory;
+    factory.set_pool_size(1);
+
+    factory.release(factory.acquire(1, nullptr));
+    CHECK(factory.pooled() == 0);
+
+    factory.release(factory.acquire(guest_id1, nullptr));
+    CHECK(factory.acquire(1, nullptr)->id() == 1);
+    CHECK(factory.pooled() == 1);
+}
+
+TEST_CASE("vcpu_factory: pool size")
+{
+    heavy_vcpu_factory factory;
+    factory.set_pool_size(2);
+
+    factory.prewarm(4);
+    CHECK(factory.pooled() == 2);
+    CHECK(factory.m_makes == 2);
+
+    factory.release(factory.acquire(guest_id1, nullptr));
+    factory.release(std::make_unique<heavy_vcpu>(guest_id2));
+    CHECK(factory.pooled() == 2);
+
+    factory.set_pool_size(1);
+    CHECK(factory.pooled() == 1);
+
+    factory.set_pool_size(0);
+    CHECK(factory.pooled() == 0);
+}
+
+TEST_CASE("vcpu_factory: pool drops vcpus that fail to reset")
+{
+    heavy_vcpu_factory factory;
+    factory.set_pool_size(1);
+
+    factory.release(std::make_unique<bfvmm::vcpu>(guest_id1));
+    CHECK(factory.pooled() == 1);
+
+    CHECK_THROWS(factory.acquire(vcpuid::reserved | guest_id2, nullptr));
+    CHECK(factory.pool_stats().dropped == 1);
+    CHECK(factory.pooled() == 0);
+}
+
+TEST_CASE("vcpu_factory: pool retires released vcpus")
+{
+    heavy_vcpu_factory factory;
+    g_retires = 0;
+
+    // Only vCPUs that go into the pool are retired. vCPUs that are
+    // destroyed because the pool is disabled or full, and host vCPUs, are
+    // destroyed the same way they would be without a pool.
+
+    factory.release(factory.acquire(guest_id1, nullptr));
+    CHECK(factory.pooled() == 0);
+    CHECK(g_retires == 0);
+
+    factory.set_pool_size(1);
+    factory.release(factory.acquire(guest_id1, nullptr));
+    CHECK(factory.pooled() == 1);
+    CHECK(g_retires == 1);
+
+    factory.release(std::make_unique<heavy_vcpu>(guest_id2));
+    CHECK(factory.pooled() == 1);
+    CHECK(g_retires == 1);
+
+    factory.release(factory.acquire(1, nullptr));
+    CHECK(g_retires == 1);
+}
+
+TEST_CASE("vcpu_factory: pool drops vcpus that fail to retire")
+{
+    heavy_vcpu_factory factory;
+    factory.set_pool_size(1);
+
+    auto vcpu = std::make_unique<heavy_vcpu>(guest_id1);
+    vcpu->m_retire_fails = true;
+
+    factory.release(std::move(vcpu));
+    CHECK(factory.pooled() == 0);
+    CHECK(factory.pool_stats().dropped == 1);
+}
+
+TEST_CASE("vcpu_factory: create / destroy latency")
+{
+    constexpr const auto num_iterations = 1000ULL;
+
+    heavy_vcpu_factory factory;
+
+    auto made = benchmark([&] {
+        for (auto i = 0ULL; i < num_iterations; i++) {
+            factory.release(factory.acquire(guest_id1, nullptr));
+        }
+    });
+
+    factory.set_pool_size(1);
+    factory.prewarm(1);
+
+    auto recycled = benchmark([&] {
+        for (auto i = 0ULL; i < num_iterations; i++) {
+            factory.release(factory.acquire(guest_id1, nullptr));
+        }
+    });
+
+    bfdebug_ndec(0, "make / destroy (ns per vcpu)", made / num_iterations);
+    bfdebug_ndec(0, "acquire / release (ns per vcpu)", recycled / num_iterations);
+
+    CHECK(factory.pool_stats().hits == num_iterations);
+}
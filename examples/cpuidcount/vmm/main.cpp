@@ -48,15 +48,93 @@ handle_cpuid(vcpu_t *vcpu)
     return false;
 }
 
+// -----------------------------------------------------------------------------
+// Fast Handler
+// -----------------------------------------------------------------------------
+
+// The following performs the same count as above, and then emulates CPUID
+// itself, as a fast handler. Fast handlers are executed directly by the exit
+// handler's entry point, which means they cannot throw, and if they return
+// false, they must not have modified the guest's state (nor counted the
+// exit, as the normal handler above will count it). Leaves that the base
+// hypervisor emulates are left to the normal handlers.
+
+bool
+fast_handle_cpuid(vcpu_t *vcpu) noexcept
+{
+    using namespace ::intel_x64::cpuid;
+
+    if ((vcpu->rax() & 0xFFFFFF00) == 0x4BF00000) {
+        return false;
+    }
+
+    uint64_t len = 0;
+    if (!_vmread(vmcs_n::vm_exit_instruction_length::addr, &len)) {
+        return false;
+    }
+
+    g_count++;
+    vcpu->data<uint64_t &>()++;
+
+    auto [rax, rbx, rcx, rdx] =
+        ::x64::cpuid::get(
+            gsl::narrow_cast<::x64::cpuid::field_type>(vcpu->rax()),
+            gsl::narrow_cast<::x64::cpuid::field_type>(vcpu->rbx()),
+            gsl::narrow_cast<::x64::cpuid::field_type>(vcpu->rcx()),
+            gsl::narrow_cast<::x64::cpuid::field_type>(vcpu->rdx())
+        );
+
+    // Nested virtualization is not supported, so just like the base
+    // hypervisor, VMX support is hidden from the guest.
+    //
+    if (vcpu->rax() == feature_information::addr) {
+        rcx = clear_bit(rcx, feature_information::ecx::vmx::from);
+    }
+
+    vcpu->set_rax(rax);
+    vcpu->set_rbx(rbx);
+    vcpu->set_rcx(rcx);
+    vcpu->set_rdx(rdx);
+
+    vcpu->set_rip(vcpu->rip() + len);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Mode Selection
+// -----------------------------------------------------------------------------
+
+// The userspace benchmark uses a VMCall to switch between the fast and the
+// normal handlers so that the two can be compared (rax == 0 selects the
+// normal handlers, anything else selects the fast handler). Note that this
+// only affects the vCPU that executed the VMCall.
+
+bool
+handle_vmcall(vcpu_t *vcpu)
+{
+    using namespace vmcs_n::exit_reason::basic_exit_reason;
+
+    vcpu->set_fast_exit_handler(
+        cpuid, vcpu->rax() != 0 ? fast_handle_cpuid : nullptr);
+
+    return vcpu->advance();
+}
+
 void
 vcpu_init_nonroot(vcpu_t *vcpu)
 {
     using namespace vmcs_n::exit_reason::basic_exit_reason;
 
+    vcpu->set_data<uint64_t>(0);
+
     vcpu->add_exit_handler_for_reason(
         cpuid, handle_cpuid);
 
-    vcpu->set_data<uint64_t>(0);
+    vcpu->add_exit_handler_for_reason(
+        vmcall, handle_vmcall);
+
+    vcpu->set_fast_exit_handler(
+        cpuid, fast_handle_cpuid);
 }
 
 void
@@ -0,0 +1,72 @@
+//
+// Copyright (C) 2019 Assured Information Security, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <chrono>
+#include <iostream>
+
+#include <bfaffinity.h>
+#include <intrinsics.h>
+
+// This userspace application measures how long it takes the hypervisor to
+// handle a RDTSC VM exit, first using the fast handlers (which are executed
+// directly by the exit handler's entry point), and then using the normal
+// exit handlers. Since the hypervisor switches between the two using a
+// VMCall that only affects the vCPU that made the call, this application
+// only runs on CPU 0.
+//
+// Note that std::chrono might also use RDTSC, but it is only called twice
+// per measurement, so its cost is in the noise.
+
+constexpr auto iterations = 1000000;
+
+constexpr uintptr_t slow_path = 0;
+constexpr uintptr_t fast_path = 1;
+
+double
+measure()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < iterations; i++) {
+        ::x64::tsc::get();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+
+    return elapsed.count() / iterations;
+}
+
+int main()
+{
+    set_affinity(0);
+
+    ::intel_x64::vm::call(fast_path);
+    auto fast = measure();
+
+    ::intel_x64::vm::call(slow_path);
+    auto slow = measure();
+
+    ::intel_x64::vm::call(fast_path);
+
+    std::cout << "fast path: " << fast << " ns per rdtsc exit" << '\n';
+    std::cout << "slow path: " << slow << " ns per rdtsc exit" << '\n';
+}
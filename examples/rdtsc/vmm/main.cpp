@@ -63,6 +63,78 @@ handle_rdtscp(vcpu_t *vcpu)
     return vcpu->advance();
 }
 
+// -----------------------------------------------------------------------------
+// Fast Handlers
+// -----------------------------------------------------------------------------
+
+// The following are the same handlers as above, written as fast handlers.
+// Fast handlers are executed directly by the exit handler's entry point,
+// which means they cannot throw, and if they return false, they must not
+// have modified the guest's state. For this reason, the instruction length
+// is read (without exceptions) before any registers are changed.
+
+static bool
+read_instruction_len(uint64_t &len) noexcept
+{ return _vmread(vmcs_n::vm_exit_instruction_length::addr, &len); }
+
+bool
+fast_handle_rdtsc(vcpu_t *vcpu) noexcept
+{
+    uint64_t len = 0;
+    if (!read_instruction_len(len)) {
+        return false;
+    }
+
+    auto ret = x64::tsc::get();
+    vcpu->set_rax((ret >> 0) & 0x00000000FFFFFFFF);
+    vcpu->set_rdx((ret >> 32) & 0x00000000FFFFFFFF);
+
+    vcpu->set_rip(vcpu->rip() + len);
+    return true;
+}
+
+bool
+fast_handle_rdtscp(vcpu_t *vcpu) noexcept
+{
+    uint64_t len = 0;
+    if (!read_instruction_len(len)) {
+        return false;
+    }
+
+    auto ret = x64::tscp::get();
+    vcpu->set_rax((ret >> 0) & 0x00000000FFFFFFFF);
+    vcpu->set_rdx((ret >> 32) & 0x00000000FFFFFFFF);
+    vcpu->set_rcx(x64::msrs::ia32_tsc_aux::get() & 0x00000000FFFFFFFF);
+
+    vcpu->set_rip(vcpu->rip() + len);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Mode Selection
+// -----------------------------------------------------------------------------
+
+// The userspace benchmark uses a VMCall to switch between the fast and the
+// normal handlers so that the two can be compared (rax == 0 selects the
+// normal handlers, anything else selects the fast handlers). Note that this
+// only affects the vCPU that executed the VMCall.
+
+void
+set_fast_handlers(vcpu_t *vcpu, bool enable)
+{
+    using namespace vmcs_n::exit_reason::basic_exit_reason;
+
+    vcpu->set_fast_exit_handler(rdtsc, enable ? fast_handle_rdtsc : nullptr);
+    vcpu->set_fast_exit_handler(rdtscp, enable ? fast_handle_rdtscp : nullptr);
+}
+
+bool
+handle_vmcall(vcpu_t *vcpu)
+{
+    set_fast_handlers(vcpu, vcpu->rax() != 0);
+    return vcpu->advance();
+}
+
 void
 vcpu_init_nonroot(vcpu_t *vcpu)
 {
@@ -72,6 +144,9 @@ vcpu_init_nonroot(vcpu_t *vcpu)
 
     vcpu->add_exit_handler_for_reason(rdtsc, handle_rdtsc);
     vcpu->add_exit_handler_for_reason(rdtscp, handle_rdtscp);
+    vcpu->add_exit_handler_for_reason(vmcall, handle_vmcall);
+
+    set_fast_handlers(vcpu, true);
 }
 
 // Expected Output (make dump)